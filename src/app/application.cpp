@@ -9,6 +9,13 @@
 
 namespace app
 {
+namespace
+{
+// Cycles executed per event loop turn while running until breakpoint
+constexpr uint64_t BatchCycles = 100000u;
+
+}  // namespace
+
 Application::Application(Settings& settings)
     : m_settings{settings}
 {
@@ -37,7 +44,7 @@ void Application::loadFile(const QString& path)
 
     auto objcopyOutput = objcopy.readAllStandardOutput();
 
-    initCpu(std::make_unique<std::vector<uint8_t>>(objcopyOutput.begin(), objcopyOutput.end()));
+    initCpu(stm32::FlashImage::fromBytes(std::vector<uint8_t>(objcopyOutput.begin(), objcopyOutput.end())));
 }
 
 void Application::resetCpu()
@@ -47,6 +54,7 @@ void Application::resetCpu()
     }
 
     m_state->cpu.reset();
+    m_state->reverseExecution.reset();
     m_state->shouldPause = true;
 
     emit stateChanged();
@@ -64,73 +72,109 @@ void Application::pauseExecution()
 
 void Application::executeNextInstruction()
 {
-    if (m_state.has_value()) {
-        m_state->shouldPause = true;
+    if (!m_state.has_value()) {
+        return;
     }
-    step();
+
+    m_state->shouldPause = true;
+    execute(1u);
+    updateNextInstructionAddress();
 }
 
 void Application::executeUntilBreakpoint()
 {
-    if (m_state.has_value()) {
-        m_state->shouldPause = false;
+    if (!m_state.has_value()) {
+        return;
     }
-    step();
+
+    m_state->shouldPause = false;
+    runBatch();
 }
 
-void Application::addBreakpoint(uint32_t address)
+void Application::executePreviousInstruction()
 {
     if (!m_state.has_value()) {
         return;
     }
 
-    m_state->breakpoints.insert(address);
+    m_state->shouldPause = true;
+    m_state->reverseExecution.stepBack();
+    updateNextInstructionAddress();
 }
 
-void Application::removeBreakpoint(uint32_t address)
+void Application::executeBackUntilBreakpoint()
 {
     if (!m_state.has_value()) {
         return;
     }
 
-    m_state->breakpoints.erase(address);
+    // Whole history is re-executed at most, so it isn't split into event loop batches
+    m_state->shouldPause = true;
+    m_state->reverseExecution.reverseContinue();
+    updateNextInstructionAddress();
 }
 
-void Application::initCpu(std::unique_ptr<std::vector<uint8_t>>&& flash)
+void Application::addBreakpoint(uint32_t address)
 {
-    emit stateChanged();
+    if (!m_state.has_value()) {
+        return;
+    }
 
-    auto flashView = stm32::utils::ArrayView<uint8_t, uint32_t>{flash->data(), static_cast<uint32_t>(flash->size())};
+    m_state->cpu.breakpoints().add(address);
+}
 
-    m_state.emplace(std::move(flash),
-                    stm32::Memory::Config{
-                        .flashMemoryStart = 0x08000000u,
-                        .flashMemoryEnd = 0x08020000u,
+void Application::removeBreakpoint(uint32_t address)
+{
+    if (!m_state.has_value()) {
+        return;
+    }
 
-                        .systemMemoryStart = 0x1ffff000u,
-                        .systemMemoryEnd = 0x1ffff800u,
+    m_state->cpu.breakpoints().remove(address);
+}
 
-                        .optionBytesStart = 0x1ffff800u,
-                        .optionBytesEnd = 0x1ffff80Fu,
+void Application::initCpu(std::shared_ptr<const stm32::FlashImage> flash)
+{
+    emit stateChanged();
+
+    const auto config = stm32::stm32f103c8Config(flash->view());
 
-                        .sramStart = 0x20000000u,
-                        .sramEnd = 0x20005000u,
+    m_state.emplace(std::move(flash), config);
+    m_state->cpu.flashInterface().setTimingEnabled(m_settings.isFlashTimingEnabled());
 
-                        .bootMode = stm32::BootMode::FlashMemory,
-                        .flash = flashView,
-                    });
+    // Stack growing below the start of SRAM always corrupts memory, so trap it by default
+    m_state->cpu.stackMonitor().setLimit(stm32::debug::StackType::Main, m_state->cpu.memory().config().sramStart);
 
     resetCpu();
 }
 
-void Application::step()
+void Application::runBatch()
 {
-    if (!m_state.has_value()) {
+    if (!m_state.has_value() || m_state->shouldPause) {
         return;
     }
 
+    // Breakpoints are checked by the core, so the event loop is only visited between batches
+    const auto stopReason = execute(BatchCycles);
+    updateNextInstructionAddress();
+
+    if (stopReason == stm32::StopReason::CycleLimit) {
+        QTimer::singleShot(0, this, &Application::runBatch);
+    }
+    else {
+        if (const auto overflow = m_state->cpu.stackMonitor().takeOverflow(); overflow.has_value()) {
+            printf("Stack overflow at 0x%08x: SP 0x%08x is below limit 0x%08x\n",
+                   overflow->instructionAddress,
+                   overflow->stackPointer,
+                   overflow->limit);
+        }
+        m_state->shouldPause = true;
+    }
+}
+
+auto Application::execute(uint64_t cycles) -> std::optional<stm32::StopReason>
+{
     try {
-        m_state->cpu.step();
+        return m_state->reverseExecution.run(cycles);
     }
     catch (const stm32::utils::CpuException& e) {
         printf("ERROR: %s\n", e.what());
@@ -142,16 +186,7 @@ void Application::step()
         printf("UNKNOWN ERROR\n");
     }
 
-    updateNextInstructionAddress();
-
-    if (m_state->shouldPause) {
-        return;
-    }
-
-    const auto it = m_state->breakpoints.find(m_state->nextInstructionAddress);
-    if (it == m_state->breakpoints.end()) {
-        QTimer::singleShot(0, this, &Application::step);
-    }
+    return std::nullopt;
 }
 
 void Application::updateNextInstructionAddress()
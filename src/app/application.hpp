@@ -2,7 +2,8 @@
 
 #include <QObject>
 #include <memory>
-#include <set>
+#include <stm32/debug/reverse_execution.hpp>
+#include <stm32/flash_image.hpp>
 #include <stm32/stm32.hpp>
 
 #include "models/assembly_view_model.hpp"
@@ -14,15 +15,16 @@ class Application final : public QObject {
     Q_OBJECT
 
     struct ApplicationState {
-        explicit ApplicationState(std::unique_ptr<std::vector<uint8_t>>&& data, stm32::Memory::Config config)
-            : flash{std::move(data)}
+        explicit ApplicationState(std::shared_ptr<const stm32::FlashImage> image, stm32::Memory::Config config)
+            : flash{std::move(image)}
             , cpu{config}
+            , reverseExecution{cpu, stm32::debug::ReverseExecution::Config{std::chrono::milliseconds{100}, size_t{256u} << 20u}}
         {
         }
 
-        std::unique_ptr<std::vector<uint8_t>> flash;
+        std::shared_ptr<const stm32::FlashImage> flash;
         stm32::Cpu cpu;
-        std::set<uint32_t> breakpoints{};
+        stm32::debug::ReverseExecution reverseExecution;
         uint32_t nextInstructionAddress{};
         bool shouldPause = true;
     };
@@ -35,6 +37,8 @@ public:
     void pauseExecution();
     void executeNextInstruction();
     void executeUntilBreakpoint();
+    void executePreviousInstruction();
+    void executeBackUntilBreakpoint();
 
     void addBreakpoint(uint32_t address);
     void removeBreakpoint(uint32_t address);
@@ -47,9 +51,10 @@ signals:
     void instructionChanged(uint32_t address);
 
 private:
-    void initCpu(std::unique_ptr<std::vector<uint8_t>>&& flash);
+    void initCpu(std::shared_ptr<const stm32::FlashImage> flash);
 
-    void step();
+    void runBatch();
+    auto execute(uint64_t cycles) -> std::optional<stm32::StopReason>;
 
     void updateNextInstructionAddress();
 
@@ -31,6 +31,8 @@ auto main(int argc, char** argv) -> int
     QWidget::connect(mainWindow.toolBar(), &app::MainToolBar::pauseExecution, &application, &app::Application::pauseExecution);
     QWidget::connect(mainWindow.toolBar(), &app::MainToolBar::nextInstruction, &application, &app::Application::executeNextInstruction);
     QWidget::connect(mainWindow.toolBar(), &app::MainToolBar::nextBreakpoint, &application, &app::Application::executeUntilBreakpoint);
+    QWidget::connect(mainWindow.toolBar(), &app::MainToolBar::previousInstruction, &application, &app::Application::executePreviousInstruction);
+    QWidget::connect(mainWindow.toolBar(), &app::MainToolBar::previousBreakpoint, &application, &app::Application::executeBackUntilBreakpoint);
 
     QWidget::connect(&assemblyViewModel, &app::AssemblyViewModel::breakpointAdded, &application, &app::Application::addBreakpoint);
     QWidget::connect(&assemblyViewModel, &app::AssemblyViewModel::breakpointRemoved, &application, &app::Application::removeBreakpoint);
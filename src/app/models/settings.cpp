@@ -16,6 +16,7 @@ constexpr auto OBJCOPY_DEFAULT_PATH = "llvm-objcopy";
 constexpr auto SETTINGS_OBJDUMP_PATH = "internal/objdump-path";
 constexpr auto SETTINGS_OBJCOPY_PATH = "internal/objcopy-path";
 constexpr auto SETTINGS_DEFAULT_DIRECTORY = "internal/default-directory";
+constexpr auto SETTINGS_FLASH_TIMING = "emulation/flash-timing";
 
 template <typename T>
 void set(QSettings& settings, const QString& key, const std::optional<T>& value)
@@ -76,4 +77,14 @@ void Settings::setDefaultDirectory(const QString& path)
     set(m_settings, SETTINGS_DEFAULT_DIRECTORY, std::optional{path});
 }
 
+auto Settings::isFlashTimingEnabled() -> bool
+{
+    return get<bool>(m_settings, SETTINGS_FLASH_TIMING).value_or(false);
+}
+
+void Settings::setFlashTimingEnabled(bool enabled)
+{
+    set(m_settings, SETTINGS_FLASH_TIMING, std::optional{enabled});
+}
+
 }  // namespace app
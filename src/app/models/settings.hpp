@@ -19,6 +19,9 @@ public:
     auto defaultDirectory() -> QString;
     void setDefaultDirectory(const QString& path);
 
+    auto isFlashTimingEnabled() -> bool;
+    void setFlashTimingEnabled(bool enabled);
+
 private:
     QSettings m_settings{};
 };
@@ -3,6 +3,8 @@
 
 #include "main_toolbar.hpp"
 
+#include <QStyle>
+
 namespace app
 {
 app::MainToolBar::MainToolBar(QWidget* parent)
@@ -20,6 +22,8 @@ void MainToolBar::init()
 
     addSeparator();
 
+    addAction(m_previousBreakpointAction);
+    addAction(m_previousInstructionAction);
     addAction(m_nextInstructionAction);
     addAction(m_nextBreakpointAction);
 }
@@ -41,6 +45,14 @@ void MainToolBar::loadActions()
     m_nextBreakpointAction = new QAction{QIcon{":/icons/last.png"}, tr("&Breakpoint"), this};
     m_nextBreakpointAction->setStatusTip(tr("Go to next breakpoint"));
     connect(m_nextBreakpointAction, &QAction::triggered, this, &MainToolBar::nextBreakpoint);
+
+    m_previousInstructionAction = new QAction{style()->standardIcon(QStyle::SP_MediaSeekBackward), tr("Step &back"), this};
+    m_previousInstructionAction->setStatusTip(tr("Go to previous instruction"));
+    connect(m_previousInstructionAction, &QAction::triggered, this, &MainToolBar::previousInstruction);
+
+    m_previousBreakpointAction = new QAction{style()->standardIcon(QStyle::SP_MediaSkipBackward), tr("&Reverse"), this};
+    m_previousBreakpointAction->setStatusTip(tr("Go back to previous breakpoint"));
+    connect(m_previousBreakpointAction, &QAction::triggered, this, &MainToolBar::previousBreakpoint);
 }
 
 }  // namespace app
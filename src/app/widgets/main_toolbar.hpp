@@ -21,6 +21,8 @@ signals:
     void pauseExecution();
     void nextInstruction();
     void nextBreakpoint();
+    void previousInstruction();
+    void previousBreakpoint();
 
 private:
     void init();
@@ -31,6 +33,8 @@ private:
     QAction* m_stopExecutionAction = nullptr;
     QAction* m_nextInstructionAction = nullptr;
     QAction* m_nextBreakpointAction = nullptr;
+    QAction* m_previousInstructionAction = nullptr;
+    QAction* m_previousBreakpointAction = nullptr;
 };
 
 }  // namespace app
@@ -17,7 +17,7 @@ void MemoryView::setMemory(stm32::Memory& memory)
 {
     m_flashHexView->setData(
         0u,
-        QByteArray::fromRawData(reinterpret_cast<char*>(memory.config().flash.begin()), static_cast<int>(memory.config().flash.size())));
+        QByteArray::fromRawData(reinterpret_cast<const char*>(memory.flash().begin()), static_cast<int>(memory.flash().size())));
     m_sramHexView->setData(memory.config().sramStart,
                            QByteArray::fromRawData(reinterpret_cast<char*>(memory.SRAM().data()), static_cast<int>(memory.SRAM().size())));
 
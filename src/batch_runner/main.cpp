@@ -0,0 +1,268 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <stm32/cpu.hpp>
+#include <stm32/debug/input_log.hpp>
+#include <stm32/flash_image.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "manifest.hpp"
+#include "report.hpp"
+#include "work_stealing_pool.hpp"
+
+namespace
+{
+/**
+ * Firmware images and input logs are loaded once and shared by all jobs which use them
+ */
+struct SharedFiles {
+    std::map<std::filesystem::path, std::shared_ptr<const stm32::FlashImage>> images{};
+    std::map<std::filesystem::path, std::shared_ptr<const stm32::debug::InputReplayer>> inputs{};
+    std::map<std::filesystem::path, std::string> errors{};
+};
+
+void printUsage(const char* program)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [--jobs <n>] [--junit <path>] [--json <path>] [--flash-timing] <manifest>\n"
+                 "\n"
+                 "  --jobs <n>       worker threads (default: number of hardware threads)\n"
+                 "  --junit <path>   write JUnit XML report\n"
+                 "  --json <path>    write JSON report\n"
+                 "  --flash-timing   charge flash wait states and prefetch buffer refills to the cycles of every job\n",
+                 program);
+}
+
+auto loadFiles(const std::vector<batch_runner::Job>& jobs) -> SharedFiles
+{
+    SharedFiles files;
+    for (const auto& job : jobs) {
+        if (!files.images.contains(job.firmware) && !files.errors.contains(job.firmware)) {
+            try {
+                files.images[job.firmware] = stm32::FlashImage::load(job.firmware.string());
+            }
+            catch (const std::exception& e) {
+                files.errors[job.firmware] = "failed to open " + job.firmware.string() + ": " + e.what();
+            }
+        }
+
+        if (!job.input.empty() && !files.inputs.contains(job.input) && !files.errors.contains(job.input)) {
+            try {
+                files.inputs[job.input] = std::make_shared<const stm32::debug::InputReplayer>(job.input.string());
+            }
+            catch (const std::exception& e) {
+                files.errors[job.input] = job.input.string() + ": " + e.what();
+            }
+        }
+    }
+    return files;
+}
+
+auto readRegister(stm32::Cpu& cpu, uint8_t reg) -> uint32_t
+{
+    switch (reg) {
+        case 13u:
+            return cpu.registers().SP();
+        case 14u:
+            return cpu.registers().LR();
+        case 15u:
+            return cpu.registers().PC();
+        default:
+            return cpu.R(reg);
+    }
+}
+
+void checkExpectations(const batch_runner::Job& job, stm32::Cpu& cpu, batch_runner::JobResult& result)
+{
+    if (result.outcome != job.expected) {
+        result.failure = "expected " + std::string{batch_runner::outcomeName(job.expected)} + ", got " + std::string{batch_runner::outcomeName(result.outcome)};
+        return;
+    }
+
+    for (const auto& expectation : job.registers) {
+        const auto value = readRegister(cpu, expectation.reg);
+        if (value != expectation.value) {
+            char message[64];
+            std::snprintf(message, sizeof(message), "register %u is 0x%08x, expected 0x%08x", expectation.reg, value, expectation.value);
+            result.failure = message;
+            return;
+        }
+    }
+}
+
+auto runJob(const batch_runner::Job& job, const SharedFiles& files, bool flashTiming) -> batch_runner::JobResult
+{
+    auto result = batch_runner::JobResult{
+        .executed = false,
+        .outcome = batch_runner::Outcome::CycleLimit,
+        .cycles = 0u,
+        .pc = 0u,
+        .detail = {},
+        .failure = {},
+        .error = {},
+        .seconds = {},
+    };
+
+    for (const auto& path : {job.firmware, job.input}) {
+        if (const auto error = files.errors.find(path); error != files.errors.end()) {
+            result.error = error->second;
+            return result;
+        }
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // Image is mapped once for all jobs, instances which program flash get a private overlay
+    auto cpu = std::make_unique<stm32::Cpu>(stm32::stm32f103c8Config(files.images.at(job.firmware)->view()));
+    cpu->flashInterface().setTimingEnabled(flashTiming);
+
+    std::optional<stm32::debug::InputReplayer> replayer;
+    if (!job.input.empty()) {
+        replayer.emplace(files.inputs.at(job.input)->records());
+        cpu->setInputReplayer(&*replayer);
+    }
+    for (const auto address : job.breakpoints) {
+        cpu->breakpoints().add(address);
+    }
+
+    try {
+        cpu->reset();
+        while (cpu->cycles() < job.cycles) {
+            const auto stopReason = cpu->run(job.cycles - cpu->cycles());
+            if (stopReason == stm32::StopReason::Breakpoint) {
+                result.outcome = batch_runner::Outcome::Breakpoint;
+                break;
+            }
+            if (stopReason == stm32::StopReason::StackOverflow) {
+                result.outcome = batch_runner::Outcome::StackOverflow;
+                break;
+            }
+            if (stopReason == stm32::StopReason::Watchpoint) {
+                cpu->watchpoints().takeHit();
+            }
+        }
+        result.pc = cpu->registers().PC();
+    }
+    catch (const std::exception& e) {
+        result.outcome = batch_runner::Outcome::Fault;
+        result.pc = cpu->currentInstructionAddress();
+        result.detail = e.what();
+    }
+
+    result.executed = true;
+    result.cycles = cpu->cycles();
+    checkExpectations(job, *cpu, result);
+    result.seconds = std::chrono::steady_clock::now() - start;
+    return result;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    size_t workerCount = std::max(std::thread::hardware_concurrency(), 1u);
+    const char* manifestPath = nullptr;
+    const char* junitPath = nullptr;
+    const char* jsonPath = nullptr;
+    auto flashTiming = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const auto argument = std::string_view{argv[i]};
+        const auto hasValue = i + 1 < argc;
+
+        if (argument == "--jobs" && hasValue) {
+            workerCount = std::strtoul(argv[++i], nullptr, 10);
+        }
+        else if (argument == "--junit" && hasValue) {
+            junitPath = argv[++i];
+        }
+        else if (argument == "--json" && hasValue) {
+            jsonPath = argv[++i];
+        }
+        else if (argument == "--flash-timing") {
+            flashTiming = true;
+        }
+        else if (!argument.starts_with("--") && manifestPath == nullptr) {
+            manifestPath = argv[i];
+        }
+        else {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (manifestPath == nullptr || workerCount == 0u) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::ifstream manifest{manifestPath};
+    if (!manifest) {
+        std::fprintf(stderr, "Failed to open %s\n", manifestPath);
+        return EXIT_FAILURE;
+    }
+
+    std::vector<batch_runner::Job> jobs;
+    try {
+        jobs = batch_runner::parseManifest(manifest, std::filesystem::path{manifestPath}.parent_path());
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "%s: %s\n", manifestPath, e.what());
+        return EXIT_FAILURE;
+    }
+
+    const auto start = std::chrono::steady_clock::now();
+    const auto files = loadFiles(jobs);
+
+    std::vector<batch_runner::JobResult> results(jobs.size());
+    std::mutex outputMutex;
+    batch_runner::WorkStealingPool pool{std::min(workerCount, std::max<size_t>(jobs.size(), 1u))};
+    pool.run(jobs.size(), [&](size_t task, size_t) {
+        // Anything thrown outside the emulation, e.g. allocation of the core, fails only its own job
+        try {
+            results[task] = runJob(jobs[task], files, flashTiming);
+        }
+        catch (const std::exception& e) {
+            results[task] = batch_runner::JobResult{};
+            results[task].error = std::string{"failed to run: "} + e.what();
+        }
+
+        if (!batch_runner::isPassed(results[task])) {
+            const auto& reason = results[task].executed ? results[task].failure : results[task].error;
+            std::lock_guard lock{outputMutex};
+            std::fprintf(stderr, "FAIL %s: %s\n", jobs[task].name.c_str(), reason.c_str());
+        }
+    });
+
+    const auto seconds = std::chrono::duration<double>{std::chrono::steady_clock::now() - start};
+    const auto passed = static_cast<size_t>(std::count_if(results.begin(), results.end(), batch_runner::isPassed));
+    std::fprintf(stderr, "%zu/%zu jobs passed in %.2f s on %zu workers\n", passed, jobs.size(), seconds.count(), pool.workerCount());
+
+    const auto writeReport = [&](const char* path, auto write) {
+        if (path == nullptr) {
+            return true;
+        }
+        std::ofstream stream{path};
+        write(stream, jobs, results, seconds);
+        if (!stream) {
+            std::fprintf(stderr, "Failed to write %s\n", path);
+            return false;
+        }
+        return true;
+    };
+    const auto junitWritten = writeReport(junitPath, batch_runner::writeJunit);
+    const auto jsonWritten = writeReport(jsonPath, batch_runner::writeJson);
+
+    return passed == jobs.size() && junitWritten && jsonWritten ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,155 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "manifest.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+namespace batch_runner
+{
+namespace
+{
+constexpr std::array<std::pair<std::string_view, Outcome>, 4u> OutcomeNames{{
+    {"cycle-limit", Outcome::CycleLimit},
+    {"breakpoint", Outcome::Breakpoint},
+    {"stack-overflow", Outcome::StackOverflow},
+    {"fault", Outcome::Fault},
+}};
+
+auto parseNumber(std::string_view text) -> std::optional<uint64_t>
+{
+    const auto value = std::string{text};
+    char* end = nullptr;
+    const auto number = std::strtoull(value.c_str(), &end, 0);
+    if (value.empty() || *end != '\0') {
+        return std::nullopt;
+    }
+    return number;
+}
+
+auto parseRegister(std::string_view name) -> std::optional<uint8_t>
+{
+    if (name == "sp") {
+        return uint8_t{13u};
+    }
+    if (name == "lr") {
+        return uint8_t{14u};
+    }
+    if (name == "pc") {
+        return uint8_t{15u};
+    }
+    const auto digits = name.substr(std::min<size_t>(name.size(), 1u));
+    if (!name.starts_with('r') || digits.empty() || digits.size() > 2u || (digits.size() == 2u && digits[0] == '0')) {
+        return std::nullopt;
+    }
+    if (!std::all_of(digits.begin(), digits.end(), [](char c) { return c >= '0' && c <= '9'; })) {
+        return std::nullopt;
+    }
+
+    const auto number = std::stoul(std::string{digits});
+    return number <= 12u ? std::optional<uint8_t>{static_cast<uint8_t>(number)} : std::nullopt;
+}
+
+}  // namespace
+
+auto outcomeName(Outcome outcome) -> std::string_view
+{
+    for (const auto& [name, value] : OutcomeNames) {
+        if (value == outcome) {
+            return name;
+        }
+    }
+    return "unknown";
+}
+
+auto parseOutcome(std::string_view name) -> std::optional<Outcome>
+{
+    for (const auto& [outcomeName, value] : OutcomeNames) {
+        if (outcomeName == name) {
+            return value;
+        }
+    }
+    return std::nullopt;
+}
+
+auto parseManifest(std::istream& stream, const std::filesystem::path& baseDirectory) -> std::vector<Job>
+{
+    std::vector<Job> jobs;
+
+    std::string line;
+    for (size_t lineNumber = 1u; std::getline(stream, line); ++lineNumber) {
+        const auto fail = [&](const std::string& reason) {
+            throw std::runtime_error{"manifest line " + std::to_string(lineNumber) + ": " + reason};
+        };
+
+        std::istringstream fields{line};
+        auto job = Job{
+            .name = {},
+            .firmware = {},
+            .input = {},
+            .cycles = 10000000u,
+            .breakpoints = {},
+            .expected = Outcome::CycleLimit,
+            .registers = {},
+        };
+        std::string firmware;
+        if (!(fields >> job.name) || job.name.starts_with('#')) {
+            continue;
+        }
+        if (!(fields >> firmware)) {
+            fail("firmware is missing");
+        }
+        job.firmware = baseDirectory / firmware;
+
+        std::string field;
+        while (fields >> field) {
+            const auto separator = field.find('=');
+            if (separator == std::string::npos) {
+                fail("expected key=value, got " + field);
+            }
+            const auto key = std::string_view{field}.substr(0u, separator);
+            const auto value = std::string_view{field}.substr(separator + 1u);
+
+            if (key == "input") {
+                job.input = baseDirectory / value;
+            }
+            else if (key == "expect") {
+                const auto outcome = parseOutcome(value);
+                if (!outcome.has_value()) {
+                    fail("unknown outcome " + std::string{value});
+                }
+                job.expected = *outcome;
+            }
+            else {
+                const auto number = parseNumber(value);
+                if (!number.has_value()) {
+                    fail("invalid number " + std::string{value});
+                }
+
+                if (key == "cycles") {
+                    job.cycles = *number;
+                }
+                else if (key == "break") {
+                    job.breakpoints.push_back(static_cast<uint32_t>(*number));
+                }
+                else if (const auto reg = parseRegister(key); reg.has_value()) {
+                    job.registers.push_back(RegisterExpectation{*reg, static_cast<uint32_t>(*number)});
+                }
+                else {
+                    fail("unknown key " + std::string{key});
+                }
+            }
+        }
+
+        jobs.push_back(std::move(job));
+    }
+
+    return jobs;
+}
+
+}  // namespace batch_runner
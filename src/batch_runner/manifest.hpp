@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <istream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace batch_runner
+{
+enum class Outcome : uint8_t {
+    CycleLimit,
+    Breakpoint,
+    StackOverflow,
+    Fault,
+};
+
+auto outcomeName(Outcome outcome) -> std::string_view;
+auto parseOutcome(std::string_view name) -> std::optional<Outcome>;
+
+/**
+ * Register value checked when the job stops, registers 13-15 are SP, LR and PC
+ */
+struct RegisterExpectation {
+    uint8_t reg;
+    uint32_t value;
+};
+
+struct Job {
+    std::string name;
+    std::filesystem::path firmware;
+    std::filesystem::path input;  ///< recorded input log, empty runs without external inputs
+    uint64_t cycles;              ///< cycle budget
+    std::vector<uint32_t> breakpoints;
+    Outcome expected;
+    std::vector<RegisterExpectation> registers;
+};
+
+/**
+ * Parses job list, one job per line:
+ *
+ *     <name> <firmware.bin> [cycles=<n>] [input=<log>] [break=<address>]... [expect=<outcome>] [r0..r12|sp|lr|pc=<value>]...
+ *
+ * Outcomes are cycle-limit (default), breakpoint, stack-overflow and fault. Numbers accept 0x prefix, relative paths
+ * are resolved against the manifest directory. Empty lines and lines starting with # are skipped.
+ *
+ * @throws std::runtime_error with line number if a line is malformed
+ */
+auto parseManifest(std::istream& stream, const std::filesystem::path& baseDirectory) -> std::vector<Job>;
+
+}  // namespace batch_runner
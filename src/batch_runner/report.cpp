@@ -0,0 +1,148 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "report.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace batch_runner
+{
+namespace
+{
+auto escapeXml(std::string_view text) -> std::string
+{
+    std::string result;
+    result.reserve(text.size());
+    for (const auto c : text) {
+        switch (c) {
+            case '&':
+                result += "&amp;";
+                break;
+            case '<':
+                result += "&lt;";
+                break;
+            case '>':
+                result += "&gt;";
+                break;
+            case '"':
+                result += "&quot;";
+                break;
+            case '\'':
+                result += "&apos;";
+                break;
+            default:
+                result += c;
+                break;
+        }
+    }
+    return result;
+}
+
+auto escapeJson(std::string_view text) -> std::string
+{
+    std::string result;
+    result.reserve(text.size() + 2u);
+    result += '"';
+    for (const auto c : text) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        }
+        else if (static_cast<unsigned char>(c) < 0x20u) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+            result += escaped;
+        }
+        else {
+            result += c;
+        }
+    }
+    result += '"';
+    return result;
+}
+
+auto countIf(std::span<const JobResult> results, bool (*predicate)(const JobResult&)) -> size_t
+{
+    return static_cast<size_t>(std::count_if(results.begin(), results.end(), predicate));
+}
+
+}  // namespace
+
+void writeJunit(std::ostream& stream, std::span<const Job> jobs, std::span<const JobResult> results, std::chrono::duration<double> seconds)
+{
+    const auto errors = countIf(results, [](const JobResult& result) { return !result.executed; });
+    const auto failures = countIf(results, [](const JobResult& result) { return result.executed && !result.failure.empty(); });
+
+    stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n";
+    stream << "<testsuites tests=\"" << jobs.size() << "\" failures=\"" << failures << "\" errors=\"" << errors << "\" time=\""
+           << seconds.count() << "\">\n";
+    stream << "  <testsuite name=\"stm32-batch\" tests=\"" << jobs.size() << "\" failures=\"" << failures << "\" errors=\"" << errors
+           << "\" time=\"" << seconds.count() << "\">\n";
+
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const auto& result = results[i];
+        stream << "    <testcase classname=\"" << escapeXml(jobs[i].firmware.filename().string()) << "\" name=\"" << escapeXml(jobs[i].name)
+               << "\" time=\"" << result.seconds.count() << "\"";
+
+        if (isPassed(result)) {
+            stream << "/>\n";
+            continue;
+        }
+
+        stream << ">\n";
+        if (!result.executed) {
+            stream << "      <error message=\"" << escapeXml(result.error) << "\"/>\n";
+        }
+        else {
+            stream << "      <failure message=\"" << escapeXml(result.failure) << "\">" << escapeXml(outcomeName(result.outcome));
+            if (!result.detail.empty()) {
+                stream << ": " << escapeXml(result.detail);
+            }
+            stream << "</failure>\n";
+        }
+        stream << "    </testcase>\n";
+    }
+
+    stream << "  </testsuite>\n";
+    stream << "</testsuites>\n";
+}
+
+void writeJson(std::ostream& stream, std::span<const Job> jobs, std::span<const JobResult> results, std::chrono::duration<double> seconds)
+{
+    const auto passed = countIf(results, isPassed);
+
+    stream << "{\n";
+    stream << "  \"tests\": " << jobs.size() << ",\n";
+    stream << "  \"passed\": " << passed << ",\n";
+    stream << "  \"failed\": " << jobs.size() - passed << ",\n";
+    stream << "  \"time\": " << seconds.count() << ",\n";
+    stream << "  \"jobs\": [";
+
+    for (size_t i = 0; i < jobs.size(); ++i) {
+        const auto& result = results[i];
+        stream << (i == 0u ? "\n" : ",\n");
+        stream << "    {\"name\": " << escapeJson(jobs[i].name) << ", \"firmware\": " << escapeJson(jobs[i].firmware.string())
+               << ", \"passed\": " << (isPassed(result) ? "true" : "false") << ", \"time\": " << result.seconds.count();
+
+        if (!result.executed) {
+            stream << ", \"error\": " << escapeJson(result.error) << "}";
+            continue;
+        }
+
+        stream << ", \"outcome\": " << escapeJson(outcomeName(result.outcome)) << ", \"expected\": " << escapeJson(outcomeName(jobs[i].expected))
+               << ", \"cycles\": " << result.cycles << ", \"pc\": " << result.pc;
+        if (!result.detail.empty()) {
+            stream << ", \"detail\": " << escapeJson(result.detail);
+        }
+        if (!result.failure.empty()) {
+            stream << ", \"failure\": " << escapeJson(result.failure);
+        }
+        stream << "}";
+    }
+
+    stream << (jobs.empty() ? "]\n" : "\n  ]\n");
+    stream << "}\n";
+}
+
+}  // namespace batch_runner
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <string>
+
+#include "manifest.hpp"
+
+namespace batch_runner
+{
+struct JobResult {
+    bool executed = false;                    ///< false if the job couldn't be started, error says why
+    Outcome outcome = Outcome::CycleLimit;    ///< how the run stopped
+    uint64_t cycles = 0u;                     ///< cycles executed
+    uint32_t pc = 0u;                         ///< PC at the stop, faulting instruction on faults
+    std::string detail{};                     ///< fault description
+    std::string failure{};                    ///< mismatched expectations, empty if the job passed
+    std::string error{};                      ///< reason why the job wasn't executed
+    std::chrono::duration<double> seconds{};  ///< wall time of the job
+};
+
+inline auto isPassed(const JobResult& result) -> bool
+{
+    return result.executed && result.failure.empty();
+}
+
+/**
+ * JUnit XML, one testsuite with a testcase per job, failed expectations are failures and jobs which couldn't be
+ * started are errors
+ */
+void writeJunit(std::ostream& stream, std::span<const Job> jobs, std::span<const JobResult> results, std::chrono::duration<double> seconds);
+
+/**
+ * JSON object with totals and an array of per-job results
+ */
+void writeJson(std::ostream& stream, std::span<const Job> jobs, std::span<const JobResult> results, std::chrono::duration<double> seconds);
+
+}  // namespace batch_runner
@@ -0,0 +1,74 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "work_stealing_pool.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace batch_runner
+{
+WorkStealingPool::WorkStealingPool(size_t workerCount)
+    : m_queues{}
+{
+    m_queues.resize(std::max<size_t>(workerCount, 1u));
+    for (auto& queue : m_queues) {
+        queue = std::make_unique<Queue>();
+    }
+}
+
+void WorkStealingPool::run(size_t taskCount, const Task& task)
+{
+    for (size_t i = 0; i < taskCount; ++i) {
+        m_queues[i % m_queues.size()]->tasks.push_back(i);
+    }
+
+    // No tasks are added while running, so a worker which finds every deque empty is done
+    const auto work = [&](size_t worker) {
+        while (true) {
+            auto next = takeOwn(worker);
+            if (!next.has_value()) {
+                next = steal(worker);
+            }
+            if (!next.has_value()) {
+                return;
+            }
+            task(*next, worker);
+        }
+    };
+
+    std::vector<std::jthread> threads;
+    threads.reserve(m_queues.size() - 1u);
+    for (size_t worker = 1u; worker < m_queues.size(); ++worker) {
+        threads.emplace_back(work, worker);
+    }
+    work(0u);
+}
+
+auto WorkStealingPool::takeOwn(size_t worker) -> std::optional<size_t>
+{
+    auto& queue = *m_queues[worker];
+    std::lock_guard lock{queue.mutex};
+    if (queue.tasks.empty()) {
+        return std::nullopt;
+    }
+    const auto task = queue.tasks.back();
+    queue.tasks.pop_back();
+    return task;
+}
+
+auto WorkStealingPool::steal(size_t worker) -> std::optional<size_t>
+{
+    for (size_t i = 1u; i < m_queues.size(); ++i) {
+        auto& queue = *m_queues[(worker + i) % m_queues.size()];
+        std::lock_guard lock{queue.mutex};
+        if (!queue.tasks.empty()) {
+            const auto task = queue.tasks.front();
+            queue.tasks.pop_front();
+            return task;
+        }
+    }
+    return std::nullopt;
+}
+
+}  // namespace batch_runner
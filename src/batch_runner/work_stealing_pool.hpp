@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace batch_runner
+{
+/**
+ * Fixed set of worker threads running a known list of tasks
+ *
+ * Tasks are dealt round-robin into per-worker deques. A worker takes its own tasks from the back and, once its deque
+ * is empty, steals from the front of the others, so a few long jobs don't leave the rest of the workers idle.
+ */
+class WorkStealingPool {
+public:
+    using Task = std::function<void(size_t task, size_t worker)>;
+
+    explicit WorkStealingPool(size_t workerCount);
+
+    inline auto workerCount() const -> size_t { return m_queues.size(); }
+
+    /**
+     * Runs task for every index in [0, taskCount) and blocks until all of them are done
+     */
+    void run(size_t taskCount, const Task& task);
+
+private:
+    struct Queue {
+        std::mutex mutex{};
+        std::deque<size_t> tasks{};
+    };
+
+    auto takeOwn(size_t worker) -> std::optional<size_t>;
+    auto steal(size_t worker) -> std::optional<size_t>;
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+};
+
+}  // namespace batch_runner
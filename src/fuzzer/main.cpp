@@ -0,0 +1,363 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <stm32/cpu.hpp>
+#include <stm32/debug/elf_file.hpp>
+#include <stm32/debug/fuzz_harness.hpp>
+#include <stm32/debug/semihosting.hpp>
+#include <stm32/flash_image.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <random>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace
+{
+using Input = std::vector<uint8_t>;
+
+void printUsage(const char* program)
+{
+    std::fprintf(stderr,
+                 "Usage: %s --entry <symbol|address> (--buffer <address> | --uart <address>) [options] <firmware.bin>\n"
+                 "\n"
+                 "  --elf <path>          resolve entry symbol from the firmware ELF image\n"
+                 "  --entry <function>    function which receives the input, name or address\n"
+                 "  --buffer <address>    copy input to RAM buffer, pass address and size in r0 and r1\n"
+                 "  --uart <address>      deliver input bytes one by one to RAM receive FIFO, byte count first\n"
+                 "  --byte-cycles <n>     cycles between peripheral input bytes (default: 1000)\n"
+                 "  --max-size <bytes>    maximum input size (default: 256)\n"
+                 "  --budget <cycles>     cycle budget of one execution (default: 1000000)\n"
+                 "  --startup <cycles>    cycle budget for reaching the entry (default: 100000000)\n"
+                 "  --corpus <dir>        seed inputs, inputs with new coverage are added to it\n"
+                 "  --crashes <dir>       inputs which fault the core (default: crashes)\n"
+                 "  --runs <n>            number of executions, zero runs forever (default: 0)\n"
+                 "  --seed <n>            random seed (default: random)\n"
+                 "\n"
+                 "Semihosting console is discarded, firmware which exits with a failure status is treated as crashed.\n",
+                 program);
+}
+
+auto readFile(const std::filesystem::path& path) -> Input
+{
+    std::ifstream file{path, std::ios::binary};
+    return Input{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+}
+
+void writeFile(const std::filesystem::path& path, const Input& input)
+{
+    std::ofstream file{path, std::ios::binary};
+    file.write(reinterpret_cast<const char*>(input.data()), static_cast<std::streamsize>(input.size()));
+}
+
+auto parseAddress(std::string_view value, const stm32::debug::ElfFile* elf) -> std::optional<uint32_t>
+{
+    if (elf != nullptr) {
+        if (const auto* symbol = elf->findFunction(value); symbol != nullptr) {
+            return symbol->address;
+        }
+    }
+
+    const auto text = std::string{value};
+    char* end = nullptr;
+    const auto address = std::strtoul(text.c_str(), &end, 0);
+    if (text.empty() || *end != '\0') {
+        return std::nullopt;
+    }
+    return static_cast<uint32_t>(address);
+}
+
+/**
+ * AFL-style havoc stage: a random stack of small mutations, splicing with another corpus entry now and then
+ */
+class Mutator {
+public:
+    explicit Mutator(uint64_t seed, size_t maxSize)
+        : m_random{seed}
+        , m_maxSize{maxSize}
+    {
+    }
+
+    auto mutate(const Input& input, const std::vector<Input>& corpus) -> Input
+    {
+        auto result = input;
+        const auto count = 1u << below(5u);
+        for (uint32_t i = 0; i < count; ++i) {
+            mutateOnce(result, corpus);
+        }
+        if (result.size() > m_maxSize) {
+            result.resize(m_maxSize);
+        }
+        return result;
+    }
+
+private:
+    static constexpr std::array<uint8_t, 9u> InterestingBytes{0x00u, 0x01u, 0x10u, 0x20u, 0x40u, 0x7Fu, 0x80u, 0xFEu, 0xFFu};
+
+    auto below(size_t limit) -> uint32_t { return static_cast<uint32_t>(m_random() % limit); }
+
+    void mutateOnce(Input& input, const std::vector<Input>& corpus)
+    {
+        if (input.empty()) {
+            input.push_back(static_cast<uint8_t>(m_random()));
+            return;
+        }
+
+        const auto position = below(input.size());
+        switch (below(7u)) {
+            case 0u:
+                input[position] ^= static_cast<uint8_t>(1u << below(8u));
+                break;
+            case 1u:
+                input[position] = static_cast<uint8_t>(m_random());
+                break;
+            case 2u:
+                input[position] = InterestingBytes[below(InterestingBytes.size())];
+                break;
+            case 3u:
+                input[position] = static_cast<uint8_t>(input[position] + below(35u) - 17u);
+                break;
+            case 4u:
+                if (input.size() < m_maxSize) {
+                    input.insert(input.begin() + position, static_cast<uint8_t>(m_random()));
+                }
+                break;
+            case 5u:
+                if (input.size() > 1u) {
+                    input.erase(input.begin() + position, input.begin() + position + 1u + below(input.size() - position) / 2u);
+                }
+                break;
+            case 6u: {
+                // Tail of another entry, keeps tokens which already got somewhere
+                const auto& other = corpus[below(corpus.size())];
+                if (!other.empty()) {
+                    const auto start = below(other.size());
+                    input.resize(position);
+                    input.insert(input.end(), other.begin() + start, other.end());
+                }
+                break;
+            }
+        }
+    }
+
+    std::mt19937_64 m_random;
+    size_t m_maxSize;
+};
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    auto config = stm32::debug::FuzzHarness::Config{
+        .entryAddress = 0u,
+        .inputTarget = stm32::debug::FuzzHarness::InputTarget::Memory,
+        .inputAddress = 0u,
+        .maxInputSize = 256u,
+        .inputChannel = 0u,
+        .byteCycles = 1000u,
+        .startupCycles = 100000000u,
+        .cycleBudget = 1000000u,
+    };
+    const char* firmwarePath = nullptr;
+    const char* elfPath = nullptr;
+    const char* entry = nullptr;
+    const char* buffer = nullptr;
+    std::filesystem::path corpusPath;
+    std::filesystem::path crashesPath{"crashes"};
+    uint64_t runs = 0u;
+    uint64_t seed = std::random_device{}();
+
+    for (int i = 1; i < argc; ++i) {
+        const auto argument = std::string_view{argv[i]};
+        const auto hasValue = i + 1 < argc;
+
+        if (argument == "--elf" && hasValue) {
+            elfPath = argv[++i];
+        }
+        else if (argument == "--entry" && hasValue) {
+            entry = argv[++i];
+        }
+        else if (argument == "--buffer" && hasValue) {
+            buffer = argv[++i];
+            config.inputTarget = stm32::debug::FuzzHarness::InputTarget::Memory;
+        }
+        else if (argument == "--uart" && hasValue) {
+            buffer = argv[++i];
+            config.inputTarget = stm32::debug::FuzzHarness::InputTarget::Peripheral;
+        }
+        else if (argument == "--byte-cycles" && hasValue) {
+            config.byteCycles = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (argument == "--max-size" && hasValue) {
+            config.maxInputSize = static_cast<uint32_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (argument == "--budget" && hasValue) {
+            config.cycleBudget = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (argument == "--startup" && hasValue) {
+            config.startupCycles = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (argument == "--corpus" && hasValue) {
+            corpusPath = argv[++i];
+        }
+        else if (argument == "--crashes" && hasValue) {
+            crashesPath = argv[++i];
+        }
+        else if (argument == "--runs" && hasValue) {
+            runs = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (argument == "--seed" && hasValue) {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (!argument.starts_with("--") && firmwarePath == nullptr) {
+            firmwarePath = argv[i];
+        }
+        else {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (firmwarePath == nullptr || entry == nullptr || buffer == nullptr || config.maxInputSize == 0u) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::optional<stm32::debug::ElfFile> elf;
+    try {
+        if (elfPath != nullptr) {
+            elf = stm32::debug::ElfFile::load(elfPath);
+        }
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "Failed to load %s: %s\n", elfPath, e.what());
+        return EXIT_FAILURE;
+    }
+
+    const auto entryAddress = parseAddress(entry, elf.has_value() ? &*elf : nullptr);
+    const auto bufferAddress = parseAddress(buffer, nullptr);
+    if (!entryAddress.has_value() || !bufferAddress.has_value()) {
+        std::fprintf(stderr, "Unknown entry or buffer address\n");
+        return EXIT_FAILURE;
+    }
+    config.entryAddress = *entryAddress;
+    config.inputAddress = *bufferAddress;
+
+    std::shared_ptr<const stm32::FlashImage> flash;
+    try {
+        flash = stm32::FlashImage::load(firmwarePath);
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "Failed to open %s: %s\n", firmwarePath, e.what());
+        return EXIT_FAILURE;
+    }
+
+    stm32::Cpu cpu{stm32::stm32f103c8Config(flash->view())};
+
+    // Console of every execution would flood the fuzzer output, and reading it would block on the terminal
+    const auto nullDescriptor = ::open("/dev/null", O_RDWR | O_CLOEXEC);
+    if (nullDescriptor < 0) {
+        std::fprintf(stderr, "Failed to open /dev/null\n");
+        return EXIT_FAILURE;
+    }
+    stm32::debug::Semihosting semihosting{stm32::debug::Semihosting::Config{
+        .consoleInput = nullDescriptor,
+        .consoleOutput = nullDescriptor,
+        .consoleError = nullDescriptor,
+    }};
+    cpu.setSemihosting(&semihosting);
+
+    std::optional<stm32::debug::FuzzHarness> harness;
+    try {
+        harness.emplace(cpu, config);
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "Failed to start fuzzing: %s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    std::vector<Input> corpus;
+    if (!corpusPath.empty()) {
+        std::filesystem::create_directories(corpusPath);
+        for (const auto& entryFile : std::filesystem::directory_iterator{corpusPath}) {
+            if (entryFile.is_regular_file()) {
+                corpus.push_back(readFile(entryFile.path()));
+            }
+        }
+    }
+    if (corpus.empty()) {
+        corpus.emplace_back(1u, uint8_t{0u});
+    }
+    std::filesystem::create_directories(crashesPath);
+
+    // Seeds are executed first, so that mutations start from their coverage
+    for (const auto& input : corpus) {
+        harness->execute(input);
+    }
+
+    Mutator mutator{seed, config.maxInputSize};
+    std::mt19937_64 random{seed ^ 0x5DEECE66Du};
+    std::set<uint32_t> crashAddresses;
+    uint64_t timeouts = 0u;
+
+    const auto start = std::chrono::steady_clock::now();
+    auto lastReport = start;
+    const auto report = [&](const char* event) {
+        const auto now = std::chrono::steady_clock::now();
+        const auto seconds = std::max(std::chrono::duration<double>{now - start}.count(), 1e-9);
+        std::fprintf(stderr, "#%llu %s corpus: %zu edges: %llu crashes: %zu timeouts: %llu exec/s: %.0f\n",
+                     static_cast<unsigned long long>(harness->executions()), event, corpus.size(),
+                     static_cast<unsigned long long>(std::count_if(harness->seenCoverage().begin(), harness->seenCoverage().end(), [](uint8_t bits) { return bits != 0u; })),
+                     crashAddresses.size(), static_cast<unsigned long long>(timeouts), static_cast<double>(harness->executions()) / seconds);
+        lastReport = now;
+    };
+
+    for (uint64_t run = 0u; runs == 0u || run < runs; ++run) {
+        const auto input = mutator.mutate(corpus[random() % corpus.size()], corpus);
+        const auto result = harness->execute(input);
+
+        if (result.outcome == stm32::debug::FuzzHarness::Outcome::Fault) {
+            // One input per faulting instruction, the rest are most likely the same bug
+            if (crashAddresses.insert(result.address).second) {
+                char name[32];
+                std::snprintf(name, sizeof(name), "crash-%08x", result.address);
+                writeFile(crashesPath / name, input);
+                report("CRASH");
+            }
+            continue;
+        }
+        if (result.outcome == stm32::debug::FuzzHarness::Outcome::Timeout) {
+            ++timeouts;
+        }
+
+        if (result.newCoverage != 0u) {
+            corpus.push_back(input);
+            if (!corpusPath.empty()) {
+                char name[32];
+                std::snprintf(name, sizeof(name), "id-%06zu", corpus.size());
+                writeFile(corpusPath / name, input);
+            }
+            report("NEW");
+        }
+        else if (std::chrono::steady_clock::now() - lastReport > std::chrono::seconds{1}) {
+            report("PULSE");
+        }
+    }
+
+    report("DONE");
+    return crashAddresses.empty() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
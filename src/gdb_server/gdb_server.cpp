@@ -0,0 +1,848 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "gdb_server.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cstring>
+#include <system_error>
+
+#include <stm32/debug/semihosting.hpp>
+#include <stm32/utils/exceptions.hpp>
+
+namespace stm32::debug
+{
+namespace
+{
+constexpr size_t PacketSize = 0x4000u;
+constexpr uint32_t RegisterCount = 17u;  // r0 - r12, sp, lr, pc, xpsr
+constexpr char InterruptRequest = '\x03';
+constexpr std::string_view HistoryStartReply = "T05replaylog:begin;";
+
+constexpr std::string_view TargetDescription =
+    R"(<?xml version="1.0"?>)"
+    R"(<!DOCTYPE target SYSTEM "gdb-target.dtd">)"
+    R"(<target version="1.0">)"
+    R"(<architecture>arm</architecture>)"
+    R"(<feature name="org.gnu.gdb.arm.m-profile">)"
+    R"(<reg name="r0" bitsize="32"/><reg name="r1" bitsize="32"/><reg name="r2" bitsize="32"/>)"
+    R"(<reg name="r3" bitsize="32"/><reg name="r4" bitsize="32"/><reg name="r5" bitsize="32"/>)"
+    R"(<reg name="r6" bitsize="32"/><reg name="r7" bitsize="32"/><reg name="r8" bitsize="32"/>)"
+    R"(<reg name="r9" bitsize="32"/><reg name="r10" bitsize="32"/><reg name="r11" bitsize="32"/>)"
+    R"(<reg name="r12" bitsize="32"/><reg name="sp" bitsize="32" type="data_ptr"/>)"
+    R"(<reg name="lr" bitsize="32"/><reg name="pc" bitsize="32" type="code_ptr"/>)"
+    R"(<reg name="xpsr" bitsize="32"/>)"
+    R"(</feature>)"
+    R"(</target>)";
+
+constexpr char HexDigits[] = "0123456789abcdef";
+
+inline void appendHexByte(std::string& output, uint8_t value)
+{
+    output.push_back(HexDigits[value >> 4u]);
+    output.push_back(HexDigits[value & 0xFu]);
+}
+
+// Registers are transferred in target byte order
+inline void appendHexWord(std::string& output, uint32_t value)
+{
+    for (uint32_t i = 0; i < 4u; ++i) {
+        appendHexByte(output, static_cast<uint8_t>(value >> (8u * i)));
+    }
+}
+
+inline auto toHex(uint32_t value) -> std::string
+{
+    char buffer[8];
+    const auto result = std::to_chars(std::begin(buffer), std::end(buffer), value, 16);
+    return std::string{buffer, result.ptr};
+}
+
+template <typename T>
+inline auto parseHex(std::string_view text) -> std::optional<T>
+{
+    T value{};
+    const auto result = std::from_chars(text.data(), text.data() + text.size(), value, 16);
+    if (result.ec != std::errc{} || result.ptr != text.data() + text.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+inline auto parseHexByte(std::string_view text, size_t offset) -> std::optional<uint8_t>
+{
+    if (offset + 2u > text.size()) {
+        return std::nullopt;
+    }
+    return parseHex<uint8_t>(text.substr(offset, 2u));
+}
+
+inline auto parseHexWord(std::string_view text, size_t offset) -> std::optional<uint32_t>
+{
+    uint32_t value = 0u;
+    for (uint32_t i = 0; i < 4u; ++i) {
+        const auto byte = parseHexByte(text, offset + 2u * i);
+        if (!byte.has_value()) {
+            return std::nullopt;
+        }
+        value |= static_cast<uint32_t>(*byte) << (8u * i);
+    }
+    return value;
+}
+
+/**
+ * Splits "addr,length" arguments
+ */
+inline auto parseAddressLength(std::string_view arguments) -> std::optional<std::pair<uint32_t, uint32_t>>
+{
+    const auto comma = arguments.find(',');
+    if (comma == std::string_view::npos) {
+        return std::nullopt;
+    }
+
+    const auto address = parseHex<uint32_t>(arguments.substr(0, comma));
+    const auto length = parseHex<uint32_t>(arguments.substr(comma + 1u));
+    if (!address.has_value() || !length.has_value()) {
+        return std::nullopt;
+    }
+    return std::make_pair(*address, *length);
+}
+
+inline auto checksum(std::string_view data) -> uint8_t
+{
+    uint8_t sum = 0u;
+    for (const auto c : data) {
+        sum = static_cast<uint8_t>(sum + static_cast<uint8_t>(c));
+    }
+    return sum;
+}
+
+[[noreturn]] inline void throwSystemError(const char* what)
+{
+    throw std::system_error{errno, std::generic_category(), what};
+}
+
+}  // namespace
+
+GdbServer::GdbServer(Cpu& cpu, Config config)
+    : m_cpu{cpu}
+    , m_config{std::move(config)}
+    , m_reverseExecution{}
+    , m_input{}
+    , m_lastStopReply{"S05"}
+    , m_insertedBreakpoints{}
+    , m_insertedWatchpoints{}
+{
+    m_cpu.flashInterface().setTimingEnabled(m_config.flashTiming);
+    if (m_config.reverseExecution) {
+        m_reverseExecution = std::make_unique<ReverseExecution>(m_cpu, ReverseExecution::Config{std::chrono::milliseconds{100}, size_t{256u} << 20u});
+    }
+}
+
+GdbServer::~GdbServer()
+{
+    closeClient();
+    if (m_listenSocket >= 0) {
+        ::close(m_listenSocket);
+        if (!m_config.socketPath.empty()) {
+            ::unlink(m_config.socketPath.c_str());
+        }
+    }
+}
+
+void GdbServer::listen()
+{
+    if (m_config.socketPath.empty()) {
+        m_listenSocket = ::socket(AF_INET, SOCK_STREAM, 0);
+        if (m_listenSocket < 0) {
+            throwSystemError("socket");
+        }
+
+        const int reuse = 1;
+        ::setsockopt(m_listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(m_config.port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::bind(m_listenSocket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+            throwSystemError("bind");
+        }
+
+        socklen_t length = sizeof(address);
+        ::getsockname(m_listenSocket, reinterpret_cast<sockaddr*>(&address), &length);
+        m_config.port = ntohs(address.sin_port);
+    }
+    else {
+        m_listenSocket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (m_listenSocket < 0) {
+            throwSystemError("socket");
+        }
+
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (m_config.socketPath.size() >= sizeof(address.sun_path)) {
+            throw std::system_error{std::make_error_code(std::errc::filename_too_long), "bind"};
+        }
+        std::memcpy(address.sun_path, m_config.socketPath.c_str(), m_config.socketPath.size() + 1u);
+
+        ::unlink(m_config.socketPath.c_str());
+        if (::bind(m_listenSocket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) < 0) {
+            throwSystemError("bind");
+        }
+    }
+
+    if (::listen(m_listenSocket, 1) < 0) {
+        throwSystemError("listen");
+    }
+}
+
+auto GdbServer::serve() -> bool
+{
+    m_clientSocket = ::accept(m_listenSocket, nullptr, nullptr);
+    if (m_clientSocket < 0) {
+        throwSystemError("accept");
+    }
+
+    if (m_config.socketPath.empty()) {
+        const int noDelay = 1;
+        ::setsockopt(m_clientSocket, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    }
+
+    m_input.clear();
+    m_inputPosition = 0u;
+    m_noAckMode = false;
+    m_detached = false;
+    m_killed = false;
+
+    while (m_clientSocket >= 0 && !m_detached && !m_killed) {
+        const auto packet = readPacket();
+        if (!packet.has_value()) {
+            break;
+        }
+
+        if (const auto reply = handlePacket(*packet); reply.has_value()) {
+            sendPacket(*reply);
+        }
+    }
+
+    // Connection may drop without detach
+    removeInsertedPoints();
+
+    closeClient();
+    return !m_killed;
+}
+
+auto GdbServer::readByte() -> std::optional<char>
+{
+    if (m_inputPosition == m_input.size()) {
+        m_input.resize(PacketSize);
+        m_inputPosition = 0u;
+
+        const auto received = ::recv(m_clientSocket, m_input.data(), m_input.size(), 0);
+        if (received <= 0) {
+            m_input.clear();
+            return std::nullopt;
+        }
+        m_input.resize(static_cast<size_t>(received));
+    }
+
+    return m_input[m_inputPosition++];
+}
+
+auto GdbServer::readPacket() -> std::optional<std::string>
+{
+    while (true) {
+        // Skip acknowledgments and interrupt requests which arrived after the target had already stopped
+        auto c = readByte();
+        while (c.has_value() && *c != '$') {
+            c = readByte();
+        }
+        if (!c.has_value()) {
+            return std::nullopt;
+        }
+
+        std::string packet;
+        for (c = readByte(); c.has_value() && *c != '#'; c = readByte()) {
+            packet.push_back(*c);
+        }
+
+        const auto high = readByte();
+        const auto low = readByte();
+        if (!high.has_value() || !low.has_value()) {
+            return std::nullopt;
+        }
+
+        const char checksumText[] = {*high, *low};
+        const auto expected = parseHex<uint8_t>(std::string_view{checksumText, 2u});
+        if (m_noAckMode) {
+            return packet;
+        }
+        if (expected.has_value() && *expected == checksum(packet)) {
+            sendRaw("+");
+            return packet;
+        }
+        sendRaw("-");
+    }
+}
+
+void GdbServer::sendPacket(std::string_view payload)
+{
+    std::string packet = "$";
+    packet.reserve(payload.size() + 4u);
+    for (const auto c : payload) {
+        // '*' starts run-length encoding in replies, so it is escaped too
+        if (c == '$' || c == '#' || c == '}' || c == '*') {
+            packet.push_back('}');
+            packet.push_back(static_cast<char>(c ^ 0x20));
+        }
+        else {
+            packet.push_back(c);
+        }
+    }
+    packet.push_back('#');
+    appendHexByte(packet, checksum(std::string_view{packet}.substr(1u)));
+
+    while (m_clientSocket >= 0) {
+        sendRaw(packet);
+        if (m_noAckMode) {
+            return;
+        }
+
+        auto c = readByte();
+        while (c.has_value() && *c != '+' && *c != '-') {
+            c = readByte();
+        }
+        if (!c.has_value() || *c == '+') {
+            return;
+        }
+    }
+}
+
+void GdbServer::sendRaw(std::string_view data)
+{
+#ifdef MSG_NOSIGNAL
+    constexpr int flags = MSG_NOSIGNAL;
+#else
+    constexpr int flags = 0;
+#endif
+
+    while (!data.empty() && m_clientSocket >= 0) {
+        const auto sent = ::send(m_clientSocket, data.data(), data.size(), flags);
+        if (sent <= 0) {
+            closeClient();
+            return;
+        }
+        data.remove_prefix(static_cast<size_t>(sent));
+    }
+}
+
+auto GdbServer::hasInterruptRequest() -> bool
+{
+    while (m_inputPosition < m_input.size()) {
+        if (m_input[m_inputPosition++] == InterruptRequest) {
+            return true;
+        }
+    }
+
+    pollfd descriptor{.fd = m_clientSocket, .events = POLLIN, .revents = 0};
+    if (::poll(&descriptor, 1u, 0) <= 0) {
+        return false;
+    }
+
+    // Disconnect also stops the target
+    const auto c = readByte();
+    return !c.has_value() || *c == InterruptRequest;
+}
+
+void GdbServer::closeClient()
+{
+    if (m_clientSocket >= 0) {
+        ::close(m_clientSocket);
+        m_clientSocket = -1;
+    }
+}
+
+auto GdbServer::handlePacket(std::string_view packet) -> std::optional<std::string>
+{
+    if (packet.empty()) {
+        return std::string{};
+    }
+
+    const auto arguments = packet.substr(1u);
+    switch (packet.front()) {
+        case '?':
+            return m_lastStopReply;
+        case 'g':
+            return readRegisters();
+        case 'G':
+            return writeRegisters(arguments);
+        case 'p':
+            if (const auto index = parseHex<uint32_t>(arguments); index.has_value()) {
+                if (const auto value = readRegister(*index); value.has_value()) {
+                    std::string reply;
+                    appendHexWord(reply, *value);
+                    return reply;
+                }
+            }
+            return std::string{"E01"};
+        case 'P': {
+            const auto equals = arguments.find('=');
+            if (equals != std::string_view::npos) {
+                const auto index = parseHex<uint32_t>(arguments.substr(0, equals));
+                const auto value = parseHexWord(arguments, equals + 1u);
+                if (index.has_value() && value.has_value() && writeRegister(*index, *value)) {
+                    stateChanged();
+                    return std::string{"OK"};
+                }
+            }
+            return std::string{"E01"};
+        }
+        case 'm':
+            return readMemory(arguments);
+        case 'M':
+            return writeMemory(arguments, false);
+        case 'X':
+            return writeMemory(arguments, true);
+        case 'c':
+        case 's':
+            if (!arguments.empty()) {
+                if (const auto address = parseHex<uint32_t>(arguments); address.has_value()) {
+                    m_cpu.registers().PC() = *address & ~uint32_t{0x1u};
+                    stateChanged();
+                }
+            }
+            return resume(packet.front() == 's');
+        case 'b':
+            if (arguments == "c" || arguments == "s") {
+                return resumeBackwards(arguments == "s");
+            }
+            return std::string{};
+        case 'Z':
+            return handleBreakpoint(arguments, true);
+        case 'z':
+            return handleBreakpoint(arguments, false);
+        case 'q':
+        case 'Q':
+            return handleQuery(packet);
+        case 'v':
+            return handleVerbose(packet);
+        case 'H':
+        case 'T':
+            return std::string{"OK"};
+        case 'D':
+            removeInsertedPoints();
+            m_detached = true;
+            return std::string{"OK"};
+        case 'k':
+            m_killed = true;
+            return std::nullopt;
+        default:
+            return std::string{};
+    }
+}
+
+auto GdbServer::handleQuery(std::string_view packet) -> std::optional<std::string>
+{
+    if (packet.starts_with("qSupported")) {
+        const auto* reverse = m_reverseExecution != nullptr ? ";ReverseStep+;ReverseContinue+" : "";
+        return "PacketSize=" + toHex(PacketSize) + ";QStartNoAckMode+;qXfer:features:read+;vContSupported+" + reverse;
+    }
+    if (packet == "QStartNoAckMode") {
+        // Acknowledgment of this reply is the last one
+        sendPacket("OK");
+        m_noAckMode = true;
+        return std::nullopt;
+    }
+    if (packet == "qAttached") {
+        return std::string{"1"};
+    }
+    if (packet == "qC") {
+        return std::string{"QC1"};
+    }
+    if (packet == "qfThreadInfo") {
+        return std::string{"m1"};
+    }
+    if (packet == "qsThreadInfo") {
+        return std::string{"l"};
+    }
+    if (packet == "qSymbol::") {
+        return std::string{"OK"};
+    }
+
+    constexpr std::string_view featuresRead = "qXfer:features:read:target.xml:";
+    if (packet.starts_with(featuresRead)) {
+        const auto range = parseAddressLength(packet.substr(featuresRead.size()));
+        if (!range.has_value()) {
+            return std::string{"E01"};
+        }
+
+        const auto [offset, length] = *range;
+        if (offset >= TargetDescription.size()) {
+            return std::string{"l"};
+        }
+
+        const auto chunk = TargetDescription.substr(offset, length);
+        return (offset + chunk.size() < TargetDescription.size() ? "m" : "l") + std::string{chunk};
+    }
+
+    constexpr std::string_view monitorCommand = "qRcmd,";
+    if (packet.starts_with(monitorCommand)) {
+        std::string command;
+        const auto hex = packet.substr(monitorCommand.size());
+        for (size_t i = 0; i + 1u < hex.size(); i += 2u) {
+            if (const auto byte = parseHexByte(hex, i); byte.has_value()) {
+                command.push_back(static_cast<char>(*byte));
+            }
+        }
+
+        if (command == "reset") {
+            m_cpu.reset();
+            if (m_reverseExecution != nullptr) {
+                m_reverseExecution->reset();
+            }
+            m_lastStopReply = "S05";
+            return std::string{"OK"};
+        }
+        return std::string{};
+    }
+
+    return std::string{};
+}
+
+auto GdbServer::handleVerbose(std::string_view packet) -> std::optional<std::string>
+{
+    if (packet == "vCont?") {
+        return std::string{"vCont;c;C;s;S"};
+    }
+    if (packet == "vKill" || packet.starts_with("vKill;")) {
+        m_killed = true;
+        return std::string{"OK"};
+    }
+
+    constexpr std::string_view resumeCommand = "vCont;";
+    if (packet.starts_with(resumeCommand)) {
+        // Target has a single thread, so the first action applies to it
+        const auto action = packet.substr(resumeCommand.size());
+        if (action.empty()) {
+            return std::string{"E01"};
+        }
+
+        switch (action.front()) {
+            case 'c':
+            case 'C':
+                return resume(false);
+            case 's':
+            case 'S':
+                return resume(true);
+            default:
+                return std::string{"E01"};
+        }
+    }
+
+    return std::string{};
+}
+
+auto GdbServer::handleBreakpoint(std::string_view arguments, bool insert) -> std::string
+{
+    // type,addr,kind
+    const auto firstComma = arguments.find(',');
+    if (firstComma == std::string_view::npos) {
+        return "E01";
+    }
+
+    const auto type = arguments.substr(0, firstComma);
+    const auto range = parseAddressLength(arguments.substr(firstComma + 1u));
+    if (type.size() != 1u || !range.has_value()) {
+        return "E01";
+    }
+
+    const auto [address, length] = *range;
+    switch (type.front()) {
+        case '0':
+        case '1':
+            if (insert) {
+                m_cpu.breakpoints().add(address);
+                m_insertedBreakpoints.insert(address);
+            }
+            else if (const auto it = m_insertedBreakpoints.find(address); it != m_insertedBreakpoints.end()) {
+                // Breakpoints at the same address set by FPB comparators stay in place
+                m_cpu.breakpoints().remove(address);
+                m_insertedBreakpoints.erase(it);
+            }
+            return "OK";
+        case '2':
+        case '3':
+        case '4': {
+            const auto watchpointType = type.front() == '2'   ? WatchpointType::Write
+                                        : type.front() == '3' ? WatchpointType::Read
+                                                              : WatchpointType::Access;
+            const auto watchpoint = Watchpoint{.address = address, .length = length, .type = watchpointType};
+            if (insert) {
+                m_cpu.watchpoints().add(watchpoint);
+                m_insertedWatchpoints.push_back(watchpoint);
+                return "OK";
+            }
+            // Watchpoints programmed by firmware through DWT comparators can't be removed by the debugger
+            const auto it = findInsertedWatchpoint(watchpoint);
+            if (it == m_insertedWatchpoints.end()) {
+                return "E01";
+            }
+            m_cpu.watchpoints().remove(watchpoint);
+            m_insertedWatchpoints.erase(it);
+            return "OK";
+        }
+        default:
+            return {};
+    }
+}
+
+void GdbServer::removeInsertedPoints()
+{
+    for (const auto address : m_insertedBreakpoints) {
+        m_cpu.breakpoints().remove(address);
+    }
+    m_insertedBreakpoints.clear();
+
+    for (const auto& watchpoint : m_insertedWatchpoints) {
+        m_cpu.watchpoints().remove(watchpoint);
+    }
+    m_insertedWatchpoints.clear();
+}
+
+auto GdbServer::findInsertedWatchpoint(const Watchpoint& watchpoint) -> std::vector<Watchpoint>::iterator
+{
+    return std::find_if(m_insertedWatchpoints.begin(), m_insertedWatchpoints.end(), [&](const Watchpoint& item) {
+        return item.address == watchpoint.address && item.length == watchpoint.length && item.type == watchpoint.type;
+    });
+}
+
+auto GdbServer::readRegisters() -> std::string
+{
+    std::string reply;
+    reply.reserve(RegisterCount * 8u);
+    for (uint32_t i = 0; i < RegisterCount; ++i) {
+        appendHexWord(reply, *readRegister(i));
+    }
+    return reply;
+}
+
+auto GdbServer::writeRegisters(std::string_view data) -> std::string
+{
+    for (uint32_t i = 0; i < RegisterCount; ++i) {
+        const auto value = parseHexWord(data, i * 8u);
+        if (!value.has_value()) {
+            return "E01";
+        }
+        writeRegister(i, *value);
+    }
+    stateChanged();
+    return "OK";
+}
+
+auto GdbServer::readRegister(uint32_t index) -> std::optional<uint32_t>
+{
+    auto& registers = m_cpu.registers();
+    switch (index) {
+        case 0u ... 12u:
+            return registers.getRegister(static_cast<uint8_t>(index));
+        case 13u:
+            return registers.SP();
+        case 14u:
+            return registers.LR();
+        case 15u:
+            return registers.PC();
+        case 16u:
+            return registers.xPSR();
+        default:
+            return std::nullopt;
+    }
+}
+
+auto GdbServer::writeRegister(uint32_t index, uint32_t value) -> bool
+{
+    auto& registers = m_cpu.registers();
+    switch (index) {
+        case 0u ... 12u:
+            registers.setRegister(static_cast<uint8_t>(index), value);
+            return true;
+        case 13u:
+            registers.SP() = value & ~uint32_t{0x3u};
+            return true;
+        case 14u:
+            registers.LR() = value;
+            return true;
+        case 15u:
+            registers.PC() = value & ~uint32_t{0x1u};
+            return true;
+        case 16u:
+            registers.xPSR() = value;
+            return true;
+        default:
+            return false;
+    }
+}
+
+auto GdbServer::readMemory(std::string_view arguments) -> std::string
+{
+    const auto range = parseAddressLength(arguments);
+    if (!range.has_value()) {
+        return "E01";
+    }
+
+    // Debugger accesses bypass MPU and watchpoints
+    const auto [address, length] = *range;
+    const auto count = std::min<uint32_t>(length, PacketSize / 2u);
+
+    std::string reply;
+    reply.reserve(count * 2u);
+    for (uint32_t i = 0; i < count; ++i) {
+        appendHexByte(reply, m_cpu.memory().read<uint8_t>(address + i));
+    }
+    return reply;
+}
+
+auto GdbServer::writeMemory(std::string_view arguments, bool binary) -> std::string
+{
+    const auto colon = arguments.find(':');
+    if (colon == std::string_view::npos) {
+        return "E01";
+    }
+
+    const auto range = parseAddressLength(arguments.substr(0, colon));
+    if (!range.has_value()) {
+        return "E01";
+    }
+
+    const auto [address, length] = *range;
+    const auto data = arguments.substr(colon + 1u);
+
+    uint32_t written = 0u;
+    if (binary) {
+        for (size_t i = 0; i < data.size() && written < length; ++i, ++written) {
+            auto byte = static_cast<uint8_t>(data[i]);
+            if (byte == '}' && i + 1u < data.size()) {
+                byte = static_cast<uint8_t>(data[++i] ^ 0x20);
+            }
+            m_cpu.memory().write<uint8_t>(address + written, byte);
+        }
+    }
+    else {
+        for (; written < length; ++written) {
+            const auto byte = parseHexByte(data, written * 2u);
+            if (!byte.has_value()) {
+                break;
+            }
+            m_cpu.memory().write<uint8_t>(address + written, *byte);
+        }
+    }
+
+    if (written != 0u) {
+        stateChanged();
+    }
+    return written == length ? "OK" : "E01";
+}
+
+auto GdbServer::resume(bool singleStep) -> std::string
+{
+    const auto run = [this](uint64_t cycles, uint64_t instructions) {
+        return m_reverseExecution != nullptr ? m_reverseExecution->run(cycles, instructions) : m_cpu.run(cycles, instructions);
+    };
+
+    try {
+        // Step is bounded by instructions, a flash wait state may take cycles without retiring one
+        if (singleStep) {
+            m_lastStopReply = stopReply(run(UINT64_MAX, 1u));
+            return m_lastStopReply;
+        }
+
+        while (true) {
+            const auto reason = run(m_config.batchCycles, UINT64_MAX);
+            if (reason != StopReason::CycleLimit) {
+                m_lastStopReply = stopReply(reason);
+                break;
+            }
+            if (hasInterruptRequest()) {
+                m_lastStopReply = "T02";
+                break;
+            }
+        }
+    }
+    catch (const utils::CpuException&) {
+        m_lastStopReply = "T0b";
+    }
+    catch (const utils::UndefinedException&) {
+        m_lastStopReply = "T04";
+    }
+    catch (const utils::UnpredictableException&) {
+        m_lastStopReply = "T04";
+    }
+
+    return m_lastStopReply;
+}
+
+auto GdbServer::resumeBackwards(bool singleStep) -> std::string
+{
+    if (m_reverseExecution == nullptr) {
+        return {};
+    }
+
+    // Recorded history is re-executed, so the faults were already reported on the way forward
+    if (singleStep) {
+        m_lastStopReply = m_reverseExecution->stepBack() ? "T05" : HistoryStartReply;
+    }
+    else {
+        const auto reason = m_reverseExecution->reverseContinue();
+        m_lastStopReply = reason.has_value() ? stopReply(*reason) : HistoryStartReply;
+    }
+    return m_lastStopReply;
+}
+
+void GdbServer::stateChanged()
+{
+    if (m_reverseExecution != nullptr) {
+        m_reverseExecution->discardFuture();
+    }
+}
+
+auto GdbServer::stopReply(StopReason reason) -> std::string
+{
+    switch (reason) {
+        case StopReason::StopRequested:
+            return "T02";
+        case StopReason::Watchpoint: {
+            const auto hit = m_cpu.watchpoints().takeHit();
+            if (!hit.has_value()) {
+                return "T05";
+            }
+
+            const auto* kind = hit->watchpoint.type == WatchpointType::Write  ? "watch"
+                               : hit->watchpoint.type == WatchpointType::Read ? "rwatch"
+                                                                              : "awatch";
+            return std::string{"T05"} + kind + ":" + toHex(hit->address) + ";";
+        }
+        case StopReason::StackOverflow:
+            m_cpu.stackMonitor().takeOverflow();
+            return "T0b";
+        case StopReason::Exit: {
+            const auto status = m_cpu.semihosting()->takeExit().value_or(0);
+            return "W" + toHex(static_cast<uint32_t>(status) & 0xFFu);
+        }
+        case StopReason::CycleLimit:
+        case StopReason::Breakpoint:
+        default:
+            return "T05";
+    }
+}
+
+}  // namespace stm32::debug
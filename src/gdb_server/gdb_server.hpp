@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <stm32/cpu.hpp>
+#include <stm32/debug/reverse_execution.hpp>
+
+namespace stm32::debug
+{
+/**
+ * GDB remote serial protocol stub
+ *
+ * Serves one GDB session at a time over a localhost TCP port or a Unix domain socket. Continue runs the core in
+ * batches of cycles with breakpoints and watchpoints checked by the core itself, the socket is polled for the interrupt
+ * request only between batches.
+ *
+ * Supported packets: ?, g/G, p/P, m/M/X, c/s, vCont, Z0-Z4/z0-z4, qSupported, qXfer:features:read, qRcmd (reset),
+ * QStartNoAckMode, D, k and the thread queries of a single-threaded target. With reverse execution enabled bc/bs move
+ * back through the recorded history, and any change of registers or memory drops the history after the current point.
+ */
+class GdbServer {
+public:
+    struct Config {
+        uint16_t port;           ///< TCP port on localhost, used when socket path is empty. Zero picks a free port
+        std::string socketPath;  ///< Unix domain socket path
+        uint64_t batchCycles;    ///< cycles executed between checks for interrupt request from GDB
+        bool reverseExecution;   ///< record history for reverse step and continue
+        bool flashTiming;        ///< charge flash wait states to the cycle counter, see FlashInterface
+    };
+
+    explicit GdbServer(Cpu& cpu, Config config);
+    ~GdbServer();
+
+public:
+    RESTRICT_COPY(GdbServer);
+
+    /**
+     * Opens listening socket, throws std::system_error on failure
+     */
+    void listen();
+
+    /**
+     * Waits for GDB connection and serves it until GDB detaches or disconnects
+     * @return false if GDB killed the target
+     */
+    auto serve() -> bool;
+
+    /**
+     * Actual TCP port, valid after listen
+     */
+    inline auto port() const -> uint16_t { return m_config.port; }
+
+private:
+    auto readByte() -> std::optional<char>;
+    auto readPacket() -> std::optional<std::string>;
+    void sendPacket(std::string_view payload);
+    void sendRaw(std::string_view data);
+    auto hasInterruptRequest() -> bool;
+    void closeClient();
+
+    auto handlePacket(std::string_view packet) -> std::optional<std::string>;
+    auto handleQuery(std::string_view packet) -> std::optional<std::string>;
+    auto handleVerbose(std::string_view packet) -> std::optional<std::string>;
+    auto handleBreakpoint(std::string_view packet, bool insert) -> std::string;
+    void removeInsertedPoints();
+    auto findInsertedWatchpoint(const Watchpoint& watchpoint) -> std::vector<Watchpoint>::iterator;
+
+    auto readRegisters() -> std::string;
+    auto writeRegisters(std::string_view data) -> std::string;
+    auto readRegister(uint32_t index) -> std::optional<uint32_t>;
+    auto writeRegister(uint32_t index, uint32_t value) -> bool;
+
+    auto readMemory(std::string_view arguments) -> std::string;
+    auto writeMemory(std::string_view arguments, bool binary) -> std::string;
+
+    auto resume(bool singleStep) -> std::string;
+    auto resumeBackwards(bool singleStep) -> std::string;
+    void stateChanged();
+    auto stopReply(StopReason reason) -> std::string;
+
+    Cpu& m_cpu;
+    Config m_config;
+    std::unique_ptr<ReverseExecution> m_reverseExecution;
+
+    int m_listenSocket = -1;
+    int m_clientSocket = -1;
+
+    std::string m_input;
+    size_t m_inputPosition = 0u;
+
+    bool m_noAckMode = false;
+    bool m_detached = false;
+    bool m_killed = false;
+    std::string m_lastStopReply;
+
+    std::multiset<uint32_t> m_insertedBreakpoints;
+    std::vector<Watchpoint> m_insertedWatchpoints;
+};
+
+}  // namespace stm32::debug
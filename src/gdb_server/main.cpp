@@ -0,0 +1,108 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <stm32/cpu.hpp>
+#include <stm32/flash_image.hpp>
+
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string_view>
+
+#include "gdb_server.hpp"
+
+namespace
+{
+void printUsage(const char* program)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [--port <port>] [--socket <path>] [--batch <cycles>] [--reverse] <firmware.bin>\n"
+                 "\n"
+                 "  --port <port>      listen on localhost TCP port (default: 3333)\n"
+                 "  --socket <path>    listen on Unix domain socket instead of TCP\n"
+                 "  --batch <cycles>   cycles executed between checks for interrupt from GDB (default: 100000)\n"
+                 "  --reverse          record execution history for reverse-step and reverse-continue\n"
+                 "  --flash-timing     charge flash wait states and prefetch buffer refills to the cycle counter\n",
+                 program);
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    auto config = stm32::debug::GdbServer::Config{
+        .port = 3333u,
+        .socketPath = {},
+        .batchCycles = 100000u,
+        .reverseExecution = false,
+        .flashTiming = false,
+    };
+    const char* firmwarePath = nullptr;
+
+    for (int i = 1; i < argc; ++i) {
+        const auto argument = std::string_view{argv[i]};
+        const auto hasValue = i + 1 < argc;
+
+        if (argument == "--port" && hasValue) {
+            config.port = static_cast<uint16_t>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (argument == "--socket" && hasValue) {
+            config.socketPath = argv[++i];
+        }
+        else if (argument == "--batch" && hasValue) {
+            config.batchCycles = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (argument == "--reverse") {
+            config.reverseExecution = true;
+        }
+        else if (argument == "--flash-timing") {
+            config.flashTiming = true;
+        }
+        else if (!argument.starts_with("--") && firmwarePath == nullptr) {
+            firmwarePath = argv[i];
+        }
+        else {
+            printUsage(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (firmwarePath == nullptr || config.batchCycles == 0u) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    std::shared_ptr<const stm32::FlashImage> flash;
+    try {
+        flash = stm32::FlashImage::load(firmwarePath);
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "Failed to open %s: %s\n", firmwarePath, e.what());
+        return EXIT_FAILURE;
+    }
+
+    stm32::Cpu cpu{stm32::stm32f103c8Config(flash->view())};
+    cpu.reset();
+
+    stm32::debug::GdbServer server{cpu, config};
+    try {
+        server.listen();
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "Failed to start server: %s\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    if (config.socketPath.empty()) {
+        std::fprintf(stderr, "Listening on localhost:%u\n", server.port());
+    }
+    else {
+        std::fprintf(stderr, "Listening on %s\n", config.socketPath.c_str());
+    }
+
+    // Keep the target between sessions until GDB kills it
+    while (server.serve()) {
+    }
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,277 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include <stm32/cpu.hpp>
+#include <stm32/debug/elf_file.hpp>
+#include <stm32/debug/itm_capture.hpp>
+#include <stm32/debug/pc_sampler.hpp>
+#include <stm32/debug/semihosting.hpp>
+#include <stm32/flash_image.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+constexpr uint32_t FlashStart = 0x08000000u;
+constexpr uint32_t FlashEnd = 0x08020000u;
+
+// Exit codes of the runner itself, shell conventions as timeout(1) and env(1) use them. Firmware statuses which
+// would collide with them or don't fit into an exit code are reported as OtherStatusExitCode
+constexpr int OtherStatusExitCode = 123;
+constexpr int LimitExitCode = 124;
+constexpr int FaultExitCode = 125;
+constexpr int LoadExitCode = 126;
+
+// Wall-clock limit is checked between batches, so that the run loop stays free of syscalls
+constexpr uint64_t BatchCycles = 1000000u;
+
+void printUsage(const char* program)
+{
+    std::fprintf(stderr,
+                 "Usage: %s [--instructions <n>] [--cycles <n>] [--timeout <seconds>] [--itm <port>=<path>]... [--pc-sample <n>=<path>]\n"
+                 "       [--flash-timing] <firmware.elf|firmware.bin>\n"
+                 "\n"
+                 "  --instructions <n>   stop after executing n instructions\n"
+                 "  --cycles <n>         stop after n cycles of virtual time\n"
+                 "  --timeout <seconds>  stop after wall-clock time\n"
+                 "  --itm <port>=<path>  write ITM stimulus port output to the file, e.g. --itm 0=/dev/stdout\n"
+                 "  --pc-sample <n>=<path>\n"
+                 "                       sample PC and LR every n cycles and write the counts to the file when the run\n"
+                 "                       ends, followed by the counts per function for ELF firmware\n"
+                 "  --flash-timing       charge flash wait states and prefetch buffer refills to the cycle counter and\n"
+                 "                       print the cycle count when the run ends\n"
+                 "\n"
+                 "Firmware output and exit status come through semihosting. Exit code is the firmware exit status when\n"
+                 "it is below %d and %d for any other status, which is then printed to stderr. Exit code is %d when a\n"
+                 "limit is reached, %d when the core faults or stops on a breakpoint and %d when firmware can't be loaded\n",
+                 program,
+                 OtherStatusExitCode,
+                 OtherStatusExitCode,
+                 LimitExitCode,
+                 FaultExitCode,
+                 LoadExitCode);
+}
+
+auto isElf(const char* path) -> bool
+{
+    char magic[4]{};
+    std::ifstream file{path, std::ios::binary};
+    file.read(magic, sizeof(magic));
+    return file && std::memcmp(magic, "\x7F" "ELF", sizeof(magic)) == 0;
+}
+
+/**
+ * ELF segments are placed at their load addresses, images linked at the flash boot alias are accepted as well
+ */
+auto loadFlashImage(const stm32::debug::ElfFile& elf) -> std::shared_ptr<const stm32::FlashImage>
+{
+    auto image = elf.loadImage(FlashStart, FlashEnd);
+    if (image.empty()) {
+        image = elf.loadImage(0u, FlashEnd - FlashStart);
+    }
+    if (image.empty()) {
+        throw std::runtime_error{"no loadable segments in flash"};
+    }
+    return stm32::FlashImage::fromBytes(std::move(image));
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    uint64_t instructionLimit = UINT64_MAX;
+    uint64_t cycleLimit = UINT64_MAX;
+    std::chrono::steady_clock::duration timeout = std::chrono::steady_clock::duration::max();
+    const char* firmwarePath = nullptr;
+    auto itmConfig = stm32::debug::ItmCapture::Config{};
+    auto isItmCaptured = false;
+    uint64_t sampleInterval = 0u;
+    const char* samplesPath = nullptr;
+    auto flashTiming = false;
+
+    for (int i = 1; i < argc; ++i) {
+        const auto argument = std::string_view{argv[i]};
+        const auto hasValue = i + 1 < argc;
+
+        if (argument == "--instructions" && hasValue) {
+            instructionLimit = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (argument == "--cycles" && hasValue) {
+            cycleLimit = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (argument == "--flash-timing") {
+            flashTiming = true;
+        }
+        else if (argument == "--timeout" && hasValue) {
+            timeout = std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>{std::strtod(argv[++i], nullptr)});
+        }
+        else if (argument == "--itm" && hasValue) {
+            char* end = nullptr;
+            const auto port = std::strtoul(argv[++i], &end, 10);
+            if (end == argv[i] || *end != '=' || end[1] == '\0' || port >= stm32::debug::Itm::PortCount) {
+                printUsage(argv[0]);
+                return LoadExitCode;
+            }
+            itmConfig.files[port] = end + 1;
+            isItmCaptured = true;
+        }
+        else if (argument == "--pc-sample" && hasValue) {
+            char* end = nullptr;
+            sampleInterval = std::strtoull(argv[++i], &end, 10);
+            if (sampleInterval == 0u || *end != '=' || end[1] == '\0') {
+                printUsage(argv[0]);
+                return LoadExitCode;
+            }
+            samplesPath = end + 1;
+        }
+        else if (!argument.starts_with("--") && firmwarePath == nullptr) {
+            firmwarePath = argv[i];
+        }
+        else {
+            printUsage(argv[0]);
+            return LoadExitCode;
+        }
+    }
+
+    if (firmwarePath == nullptr) {
+        printUsage(argv[0]);
+        return LoadExitCode;
+    }
+
+    std::optional<stm32::debug::ElfFile> elf;
+    std::shared_ptr<const stm32::FlashImage> flash;
+    try {
+        if (isElf(firmwarePath)) {
+            elf = stm32::debug::ElfFile::load(firmwarePath);
+            flash = loadFlashImage(*elf);
+        }
+        else {
+            flash = stm32::FlashImage::load(firmwarePath);
+        }
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "Failed to load %s: %s\n", firmwarePath, e.what());
+        return LoadExitCode;
+    }
+
+    stm32::Cpu cpu{stm32::stm32f103c8Config(flash->view())};
+    cpu.flashInterface().setTimingEnabled(flashTiming);
+
+    stm32::debug::Semihosting semihosting;
+    cpu.setSemihosting(&semihosting);
+
+    std::unique_ptr<stm32::debug::ItmCapture> itmCapture;
+    try {
+        if (isItmCaptured) {
+            itmCapture = std::make_unique<stm32::debug::ItmCapture>(itmConfig);
+            cpu.itm().setCapture(itmCapture.get());
+        }
+    }
+    catch (const std::exception& e) {
+        std::fprintf(stderr, "Failed to open ITM output: %s\n", e.what());
+        return LoadExitCode;
+    }
+
+    // Output is opened up front, so that a long run doesn't end without a place to report to
+    std::optional<stm32::debug::PcSampler> pcSampler;
+    std::ofstream samplesFile;
+    if (samplesPath != nullptr) {
+        samplesFile.open(samplesPath);
+        if (!samplesFile) {
+            std::fprintf(stderr, "Failed to open PC samples output %s\n", samplesPath);
+            return LoadExitCode;
+        }
+        pcSampler.emplace(sampleInterval);
+        cpu.setPcSampler(&*pcSampler);
+    }
+
+    const auto deadline = timeout == std::chrono::steady_clock::duration::max() ? std::chrono::steady_clock::time_point::max()
+                                                                                 : std::chrono::steady_clock::now() + timeout;
+
+    // Every exit path returns here, so the tools attached to the core always report
+    const auto runFirmware = [&]() -> int {
+        try {
+            cpu.reset();
+            while (true) {
+                if (cpu.cycles() >= cycleLimit || cpu.instructions() >= instructionLimit || std::chrono::steady_clock::now() >= deadline) {
+                    semihosting.flush();
+                    std::fprintf(stderr, "Limit reached after %llu instructions at PC 0x%08x\n", static_cast<unsigned long long>(cpu.instructions()),
+                                 cpu.registers().PC());
+                    return LimitExitCode;
+                }
+
+                const auto cycles = std::min(BatchCycles, cycleLimit - cpu.cycles());
+                switch (cpu.run(cycles, instructionLimit - cpu.instructions())) {
+                    case stm32::StopReason::Exit: {
+                        const auto status = *semihosting.takeExit();
+                        if (status < 0 || status >= OtherStatusExitCode) {
+                            std::fprintf(stderr, "Firmware exited with status %d\n", status);
+                            return OtherStatusExitCode;
+                        }
+                        return status;
+                    }
+                    case stm32::StopReason::StackOverflow: {
+                        semihosting.flush();
+                        const auto overflow = cpu.stackMonitor().takeOverflow();
+                        std::fprintf(stderr, "Stack overflow: SP 0x%08x below limit 0x%08x at 0x%08x\n", overflow->stackPointer, overflow->limit,
+                                     overflow->instructionAddress);
+                        return FaultExitCode;
+                    }
+                    case stm32::StopReason::Breakpoint:
+                        // FPB comparator programmed by the firmware, without a debugger the debug event escalates to a HardFault
+                        semihosting.flush();
+                        std::fprintf(stderr, "Breakpoint hit without a debugger at PC 0x%08x\n", cpu.registers().PC());
+                        return FaultExitCode;
+                    case stm32::StopReason::Watchpoint:
+                        // Comparators programmed by the firmware have no debugger to report to, execution continues
+                        cpu.watchpoints().takeHit();
+                        break;
+                    case stm32::StopReason::CycleLimit:
+                    case stm32::StopReason::StopRequested:
+                        break;
+                }
+            }
+        }
+        catch (const std::exception& e) {
+            semihosting.flush();
+            std::fprintf(stderr, "Core fault: %s at 0x%08x\n", e.what(), cpu.currentInstructionAddress());
+            return FaultExitCode;
+        }
+    };
+    const auto exitCode = runFirmware();
+
+    if (flashTiming) {
+        std::fprintf(stderr, "Executed %llu instructions in %llu cycles, %llu of them flash wait states\n",
+                     static_cast<unsigned long long>(cpu.instructions()), static_cast<unsigned long long>(cpu.cycles()),
+                     static_cast<unsigned long long>(cpu.flashInterface().statistics().waitCycles));
+    }
+
+    if (itmCapture != nullptr) {
+        itmCapture->flush();
+        if (const auto dropped = itmCapture->droppedBytes(); dropped != 0u) {
+            std::fprintf(stderr, "ITM dropped %llu bytes\n", static_cast<unsigned long long>(dropped));
+        }
+    }
+    if (pcSampler.has_value()) {
+        pcSampler->writeSamples(samplesFile);
+        if (elf.has_value()) {
+            samplesFile << '\n';
+            pcSampler->writeFunctions(samplesFile, *elf);
+        }
+        samplesFile.flush();
+        if (!samplesFile) {
+            std::fprintf(stderr, "Failed to write PC samples to %s\n", samplesPath);
+        }
+    }
+    return exitCode;
+}
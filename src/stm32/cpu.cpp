@@ -3,6 +3,16 @@
 
 #include "cpu.hpp"
 
+#include <algorithm>
+
+#include "debug/coverage.hpp"
+#include "debug/edge_coverage.hpp"
+#include "debug/heatmap.hpp"
+#include "debug/input_log.hpp"
+#include "debug/pc_sampler.hpp"
+#include "debug/profiler.hpp"
+#include "debug/semihosting.hpp"
+
 namespace stm32
 {
 using namespace utils;
@@ -14,9 +24,27 @@ Cpu::Cpu(const Memory::Config& memoryConfig)
     , m_nvicRegisters{}
     , m_memory{memoryConfig}
     , m_mpu{*this}
+    , m_nvic{m_nvicRegisters}
+    , m_flashInterface{}
+    , m_exclusiveMonitor{}
+    , m_breakpoints{}
+    , m_watchpoints{m_memory}
+    , m_fpb{m_breakpoints}
+    , m_dwt{m_watchpoints}
+    , m_itm{}
+    , m_stackMonitor{}
+    , m_breakpointStopAddress{}
     , m_currentMode{}
     , m_exceptionActive{}
+    , m_inputQueue{}
+    , m_pendingInputEvents{}
+    , m_inputEventHandler{}
 {
+    m_memory.attachRegion(m_nvic);
+    m_memory.attachRegion(m_flashInterface);
+    m_memory.attachRegion(m_fpb);
+    m_memory.attachRegion(m_dwt);
+    m_memory.attachRegion(m_itm);
 }
 
 void Cpu::reset()
@@ -25,11 +53,19 @@ void Cpu::reset()
     m_registers.reset();
 
     m_exceptionActive.reset();
+    m_currentMode = ExecutionMode::Thread;
 
     m_systemRegisters.reset();
     m_sysTickRegisters.reset();
     m_nvicRegisters.reset();
     m_mpu.reset();
+    m_flashInterface.reset();
+    m_fpb.reset();
+    m_dwt.reset();
+    m_itm.reset();
+    m_stackMonitor.reset();
+    m_breakpointStopAddress.reset();
+    m_exclusiveMonitor.clearExclusiveLocal();
 
     clearEventRegister();
 
@@ -37,6 +73,7 @@ void Cpu::reset()
 
     m_registers.SP_main() = m_mpu.alignedMemoryRead<uint32_t>(vectorTable, AccessType::VecTable) & ZEROS<2, uint32_t>;
     m_registers.SP_process() &= ZEROS<2, uint32_t>;
+    m_stackMonitor.update(debug::StackType::Main, m_registers.SP_main(), 0u);
     m_registers.LR() = std::numeric_limits<uint32_t>::max();
 
     const auto resetVector = m_mpu.alignedMemoryRead<uint32_t>(vectorTable + 4u, AccessType::VecTable);
@@ -48,6 +85,377 @@ void Cpu::reset()
     branchWritePC(resetVector);
 }
 
+auto Cpu::snapshot() -> Snapshot
+{
+    return Snapshot{
+        .registers = m_registers,
+        .systemRegisters = m_systemRegisters,
+        .sysTickRegisters = m_sysTickRegisters,
+        .nvicRegisters = m_nvicRegisters,
+        .mpuRegisters = m_mpu.registers(),
+        .flashInterface = m_flashInterface.state(),
+        .itm = m_itm.state(),
+
+        .currentMode = m_currentMode,
+        .exceptionActive = m_exceptionActive,
+        .wasEventRegistered = m_wasEventRegistered,
+        .skipAdvancingIT = m_skipAdvancingIT,
+        .currentInstructionAddress = m_currentInstructionAddress,
+        .nextInstructionAddress = m_nextInstructionAddress,
+        .cycles = m_cycles,
+        .stallCycles = m_stallCycles,
+        .pendingInputEvents = m_pendingInputEvents,
+
+        .memory = m_memory.snapshot(),
+    };
+}
+
+void Cpu::restore(const Snapshot& snapshot)
+{
+    m_memory.restore(snapshot.memory);
+
+    m_registers = snapshot.registers;
+    m_systemRegisters = snapshot.systemRegisters;
+    m_sysTickRegisters = snapshot.sysTickRegisters;
+    m_nvicRegisters = snapshot.nvicRegisters;
+    m_mpu.registers() = snapshot.mpuRegisters;
+    m_flashInterface.setState(snapshot.flashInterface);
+    m_itm.setState(snapshot.itm);
+
+    m_currentMode = snapshot.currentMode;
+    m_exceptionActive = snapshot.exceptionActive;
+    m_wasEventRegistered = snapshot.wasEventRegistered;
+    m_skipAdvancingIT = snapshot.skipAdvancingIT;
+    m_currentInstructionAddress = snapshot.currentInstructionAddress;
+    m_nextInstructionAddress = snapshot.nextInstructionAddress;
+    m_cycles = snapshot.cycles;
+    m_stallCycles = snapshot.stallCycles;
+    m_pendingInputEvents = snapshot.pendingInputEvents;
+
+    // Local monitor is cleared as on any context switch, host-side tools are re-anchored to the restored time
+    m_exclusiveMonitor.clearExclusiveLocal();
+    m_breakpointStopAddress.reset();
+    if (m_realTimePacer != nullptr) {
+        setRealTimePacer(m_realTimePacer);
+    }
+    if (m_pcSampler != nullptr) {
+        setPcSampler(m_pcSampler);
+    }
+}
+
+auto Cpu::run(uint64_t cycleBudget, uint64_t instructionBudget) -> StopReason
+{
+    const auto cycleLimit = m_cycles + std::min(cycleBudget, UINT64_MAX - m_cycles);
+    const auto instructionLimit = instructions() + std::min(instructionBudget, UINT64_MAX - instructions());
+    const auto resumeAddress = std::exchange(m_breakpointStopAddress, std::nullopt);
+    auto isFirstBlock = true;
+
+    while (true) {
+        serviceInputEvents();
+        takePendingInterrupt();
+
+        if (m_stopRequested.exchange(false, std::memory_order_relaxed)) {
+            return StopReason::StopRequested;
+        }
+        if (m_cycles >= cycleLimit || instructions() >= instructionLimit) {
+            return StopReason::CycleLimit;
+        }
+
+        if (m_realTimePacer != nullptr && m_cycles >= m_nextPaceCycle) {
+            m_realTimePacer->pace(m_cycles);
+            m_nextPaceCycle = m_cycles + m_realTimePacer->burstCycles();
+        }
+
+        if (m_pcSampler != nullptr && m_cycles >= m_nextSampleCycle) {
+            m_pcSampler->sample(m_registers.PC(), m_registers.LR());
+            m_nextSampleCycle = std::max(m_nextSampleCycle + m_pcSampler->interval(), m_cycles + 1u);
+        }
+
+        // Stop the block exactly at the next timestamped event so that it is delivered at the same point every run
+        auto blockLimit = cycleLimit;
+        if (!m_pendingInputEvents.empty()) {
+            blockLimit = std::clamp(m_pendingInputEvents.front().timestamp, m_cycles + 1u, cycleLimit);
+        }
+        if (m_realTimePacer != nullptr) {
+            blockLimit = std::min(blockLimit, m_nextPaceCycle);
+        }
+        if (m_pcSampler != nullptr) {
+            blockLimit = std::min(blockLimit, m_nextSampleCycle);
+        }
+        // Cycles inside a block are spent by instructions only
+        blockLimit = std::min(blockLimit, m_cycles + std::min(instructionLimit - instructions(), UINT64_MAX - m_cycles));
+        if (m_inputReplayer != nullptr) {
+            blockLimit = std::clamp(m_inputReplayer->nextBoundaryCycle(), m_cycles + 1u, blockLimit);
+        }
+
+        const auto resuming = std::exchange(isFirstBlock, false) && resumeAddress == m_registers.PC();
+        if (const auto stopReason = executeBlock(blockLimit, resuming); stopReason.has_value()) {
+            if (*stopReason == StopReason::Breakpoint) {
+                m_breakpointStopAddress = m_registers.PC();
+            }
+            return *stopReason;
+        }
+
+        // Checked per block, so the run loop stops at the end of the block which overflowed the stack
+        if (m_stackMonitor.isOverflowed()) {
+            return StopReason::StackOverflow;
+        }
+        if (m_semihosting != nullptr && m_semihosting->isExitPending()) {
+            return StopReason::Exit;
+        }
+    }
+}
+
+auto Cpu::postInterrupt(uint16_t interrupt, uint64_t timestamp) -> bool
+{
+    return postInputEvent(InputEvent{
+        .timestamp = timestamp,
+        .type = InputEventType::Interrupt,
+        .channel = interrupt,
+        .data = 0u,
+    });
+}
+
+auto Cpu::postInputEvent(const InputEvent& event) -> bool
+{
+    return m_inputQueue.tryPush(event);
+}
+
+void Cpu::setRealTimePacer(RealTimePacer* pacer)
+{
+    m_realTimePacer = pacer;
+    if (pacer != nullptr) {
+        pacer->start(m_cycles);
+        m_nextPaceCycle = m_cycles + pacer->burstCycles();
+    }
+}
+
+void Cpu::setPcSampler(debug::PcSampler* sampler)
+{
+    m_pcSampler = sampler;
+    if (sampler != nullptr) {
+        m_nextSampleCycle = m_cycles + sampler->interval();
+    }
+}
+
+void Cpu::setTraceRecorder(debug::TraceRecorder* recorder)
+{
+    m_traceRecorder = recorder;
+    updateSlowPath();
+}
+
+void Cpu::setHeatmap(debug::Heatmap* heatmap)
+{
+    m_heatmap = heatmap;
+    updateSlowPath();
+}
+
+void Cpu::updateSlowPath()
+{
+    const auto tracesDataAccesses = m_traceRecorder != nullptr && m_traceRecorder->recordsDataAccesses();
+    m_memory.setSlowPathEverywhere(tracesDataAccesses || m_heatmap != nullptr);
+    m_watchpoints.updatePages();
+}
+
+void Cpu::setProfiler(debug::Profiler* profiler)
+{
+    m_profiler = profiler;
+    if (profiler != nullptr) {
+        profiler->start(m_registers.PC());
+    }
+}
+
+void Cpu::checkDataAccess(uint32_t address, uint32_t size, bool write, uint32_t value)
+{
+    if (m_watchpoints.isArmed()) {
+        m_watchpoints.checkAccess(address, size, write, value);
+    }
+    if (m_traceRecorder != nullptr && m_traceRecorder->recordsDataAccesses()) {
+        m_traceRecorder->recordDataAccess(address, size, write, value);
+    }
+    if (m_heatmap != nullptr) {
+        m_heatmap->recordAccess(address, write);
+    }
+}
+
+auto Cpu::executeBlock(uint64_t cycleLimit, bool resuming) -> std::optional<StopReason>
+{
+    const auto firstAddress = m_registers.PC();
+    const auto firstCycle = m_cycles;
+    const auto firstInstruction = instructions();
+
+    std::optional<StopReason> stopReason;
+    if (m_breakpoints.empty() && !m_watchpoints.isArmed() && m_traceRecorder == nullptr && m_profiler == nullptr) {
+        // Block ends on any instruction which writes PC
+        if (m_flashInterface.isTimingEnabled()) {
+            while (waitForFetch(cycleLimit)) {
+                step();
+                if (m_skipIncrementingPC || m_cycles >= cycleLimit) {
+                    break;
+                }
+            }
+        }
+        else {
+            do {
+                step();
+            } while (!m_skipIncrementingPC && m_cycles < cycleLimit);
+        }
+    }
+    else {
+        stopReason = executeDebugBlock(cycleLimit, resuming);
+    }
+
+    // Block may consist of a flash stall only, when the run loop limit was reached before the instruction was fetched
+    if (instructions() == firstInstruction) {
+        if (m_inputRecorder != nullptr && m_cycles != firstCycle) {
+            m_inputRecorder->recordBoundary(m_cycles);
+        }
+        return stopReason;
+    }
+
+    if (m_coverage != nullptr) {
+        m_coverage->recordBlock(firstAddress, m_currentInstructionAddress, m_nextInstructionAddress, m_skipIncrementingPC);
+    }
+    if (m_edgeCoverage != nullptr) {
+        m_edgeCoverage->recordBlock(firstAddress, m_currentInstructionAddress, m_nextInstructionAddress, m_skipIncrementingPC);
+    }
+    if (m_heatmap != nullptr) {
+        m_heatmap->recordFetch(firstAddress, m_nextInstructionAddress);
+    }
+    // Block which didn't end on a branch was cut by the run loop, replay has to cut it at the same cycle
+    if (m_inputRecorder != nullptr && !m_skipIncrementingPC) {
+        m_inputRecorder->recordBoundary(m_cycles);
+    }
+
+    return stopReason;
+}
+
+auto Cpu::waitForFetch(uint64_t cycleLimit) -> bool
+{
+    // Stall never crosses the limit, the rest of it is charged when the run loop continues
+    const auto stallCycles = std::min(m_flashInterface.fetchStall(m_registers.PC(), m_cycles), cycleLimit - m_cycles);
+    m_cycles += stallCycles;
+    m_stallCycles += stallCycles;
+    return m_cycles < cycleLimit;
+}
+
+auto Cpu::executeDebugBlock(uint64_t cycleLimit, bool resuming) -> std::optional<StopReason>
+{
+    do {
+        // Instruction is fetched before the breakpoint is checked, so resuming from it doesn't stall again
+        if (m_flashInterface.isTimingEnabled() && !waitForFetch(cycleLimit)) {
+            break;
+        }
+        if (!resuming && m_breakpoints.contains(m_registers.PC()) && m_breakpoints.shouldStop(m_registers.PC(), *this)) {
+            return StopReason::Breakpoint;
+        }
+        resuming = false;
+
+        if (m_traceRecorder != nullptr) {
+            // Condition is evaluated before the instruction, as the flags may be changed by it
+            const auto conditional = isInItBlock();
+            const auto executed = !conditional || conditionPassed(currentCondition() & 0x0fu);
+            m_traceRecorder->recordInstruction(m_registers.PC(), conditional, executed, m_cycles);
+        }
+
+        if (m_profiler != nullptr) {
+            m_profiler->onInstruction();
+        }
+
+        step();
+
+        if (m_profiler != nullptr && m_skipIncrementingPC) {
+            m_profiler->onBranch(m_registers.PC(), m_registers.LR(), m_nextInstructionAddress);
+        }
+
+        // Watchpoint debug event is taken after the instruction which caused it
+        if (m_watchpoints.isHit()) {
+            return StopReason::Watchpoint;
+        }
+        if (m_stackMonitor.isOverflowed()) {
+            return StopReason::StackOverflow;
+        }
+    } while (!m_skipIncrementingPC && m_cycles < cycleLimit);
+
+    return std::nullopt;
+}
+
+void Cpu::scheduleInputEvent(const InputEvent& event)
+{
+    m_pendingInputEvents.push_back(event);
+    std::push_heap(m_pendingInputEvents.begin(), m_pendingInputEvents.end(), std::greater<InputEvent>{});
+}
+
+void Cpu::serviceInputEvents()
+{
+    const auto greater = std::greater<InputEvent>{};
+
+    while (auto event = m_inputQueue.tryPop()) {
+        scheduleInputEvent(*event);
+    }
+
+    if (m_inputReplayer != nullptr) {
+        m_pendingInputEvents.clear();
+        while (m_inputReplayer->nextCycle() <= m_cycles && !m_inputReplayer->isHostCallNext()) {
+            if (const auto record = m_inputReplayer->take(); record.event.has_value()) {
+                deliverInputEvent(*record.event);
+            }
+        }
+        return;
+    }
+
+    while (!m_pendingInputEvents.empty() && m_pendingInputEvents.front().timestamp <= m_cycles) {
+        std::pop_heap(m_pendingInputEvents.begin(), m_pendingInputEvents.end(), greater);
+        const auto event = m_pendingInputEvents.back();
+        m_pendingInputEvents.pop_back();
+
+        deliverInputEvent(event);
+    }
+}
+
+void Cpu::deliverInputEvent(const InputEvent& event)
+{
+    if (m_inputRecorder != nullptr) {
+        m_inputRecorder->recordEvent(m_cycles, event);
+    }
+
+    switch (event.type) {
+        case InputEventType::Interrupt:
+            if (event.channel < rg::NvicRegistersSet::InterruptCount) {
+                m_nvicRegisters.setPending(event.channel, true);
+            }
+            break;
+        case InputEventType::PeripheralInput:
+            if (m_inputEventHandler) {
+                m_inputEventHandler(event);
+            }
+            break;
+    }
+}
+
+void Cpu::takePendingInterrupt()
+{
+    const auto interrupt = m_nvicRegisters.highestPendingInterrupt();
+    if (!interrupt.has_value()) {
+        return;
+    }
+
+    const auto exceptionType = static_cast<uint16_t>(*interrupt + 16u);
+
+    // Only group priority takes part in preemption
+    const auto groupValue = static_cast<int32_t>(lsl(std::uint32_t{0b10}, m_systemRegisters.AIRCR().PRIGROUP));
+    auto priority = exceptionPriority(exceptionType);
+    priority -= priority % groupValue;
+
+    if (priority >= executionPriority()) {
+        return;
+    }
+
+    m_nvicRegisters.setPending(*interrupt, false);
+    m_nvicRegisters.setActive(*interrupt, true);
+    exceptionEntry(exceptionType);
+}
+
 void Cpu::branchWritePC(uint32_t address, bool skipIncrementingPC)
 {
     m_registers.PC() = address & ZEROS<1, uint32_t>;
@@ -57,7 +465,8 @@ void Cpu::branchWritePC(uint32_t address, bool skipIncrementingPC)
 void Cpu::bxWritePC(uint32_t address, bool skipIncrementingPC)
 {
     if (m_currentMode == ExecutionMode::Handler && getPart<28, 4>(address) == 0b1111u) {
-        // TODO: ExceptionReturn(address<27:0>); // see B1-597
+        exceptionReturn(getPart<0, 28, uint32_t>(address));
+        m_skipIncrementingPC = skipIncrementingPC;
     }
     else {
         m_registers.EPSR().T = isBitSet<0>(address);
@@ -179,11 +588,11 @@ auto Cpu::executionPriority() const -> int32_t
             continue;
         }
 
-        // if ExceptionPriority[i] < highestpri then
-        //      highestpri = ExceptionPriority[i];
-        //      // Include the PRIGROUP effect
-        //      subgroupvalue = highestpri MOD groupvalue;
-        //      highestpri = highestpri - subgroupvalue;
+        const auto priority = exceptionPriority(static_cast<uint16_t>(i));
+        if (priority < highestPRI) {
+            // Include the PRIGROUP effect
+            highestPRI = priority - priority % static_cast<int32_t>(groupValue);
+        }
     }
 
     if (m_registers.BASEPRI().level != 0) {
@@ -208,8 +617,14 @@ void Cpu::exceptionEntry(uint16_t exceptionType)
 {
     // TODO: see DerivedLateArrival
 
+    const auto interruptedAddress = returnAddress(exceptionType);
+
     pushStack(exceptionType);
     exceptionTaken(exceptionType);
+
+    if (m_profiler != nullptr) {
+        m_profiler->onException(m_registers.PC(), interruptedAddress);
+    }
 }
 
 void Cpu::pushStack(uint16_t exceptionType)
@@ -229,6 +644,7 @@ void Cpu::pushStack(uint16_t exceptionType)
         framePtrAlign = isBitSet<2>(SP_process) && forceAlign;
         SP_process = (SP_process - frameSize) & spMask;
         framePtr = SP_process;
+        m_stackMonitor.update(debug::StackType::Process, framePtr, m_currentInstructionAddress);
     }
     else {
         auto& SP_main = m_registers.SP_main();
@@ -236,6 +652,7 @@ void Cpu::pushStack(uint16_t exceptionType)
         framePtrAlign = isBitSet<2>(SP_main) && forceAlign;
         SP_main = (SP_main - frameSize) & spMask;
         framePtr = SP_main;
+        m_stackMonitor.update(debug::StackType::Main, framePtr, m_currentInstructionAddress);
     }
 
     const auto [xPSRlo, xPSRhi] = split<_<0, 9, uint32_t>, _<10, 22, uint32_t>>(m_registers.xPSR());
@@ -277,10 +694,104 @@ void Cpu::exceptionTaken(uint16_t exceptionType)
 
     m_exceptionActive.set(exceptionType, true);
     // TODO: update system registers as appropriate. See B1.5.14
+    m_exclusiveMonitor.clearExclusiveLocal();
+    setEventRegister();
+    instructionSynchronizationBarrier(0b1111u);
+}
+
+void Cpu::exceptionReturn(uint32_t excReturn)
+{
+    // see: B1.5.8
+    UNPREDICTABLE_IF((getPart<4, 24, uint32_t>(excReturn) != ONES<24, uint32_t>));
+
+    const auto returningExceptionNumber = static_cast<uint16_t>(m_registers.IPSR().exceptionNumber);
+    const auto nestedActivation = m_exceptionActive.count();
+
+    const auto invalidReturn = [this]() {
+        m_systemRegisters.CFSR().usageFault.INVPC = true;
+        throw utils::CpuException(ExceptionType::UsageFault);
+    };
+
+    if (!m_exceptionActive.test(returningExceptionNumber)) {
+        invalidReturn();
+    }
+
+    uint32_t framePtr;
+    switch (getPart<0, 4>(excReturn)) {
+        case 0b0001u:  // return to Handler
+            if (nestedActivation == 1u) {
+                invalidReturn();
+            }
+            framePtr = m_registers.SP_main();
+            m_currentMode = ExecutionMode::Handler;
+            m_registers.CONTROL().SPSEL = false;
+            break;
+
+        case 0b1001u:  // return to Thread using Main stack
+            if (nestedActivation != 1u && !m_systemRegisters.CCR().NONBASETHRDENA) {
+                invalidReturn();
+            }
+            framePtr = m_registers.SP_main();
+            m_currentMode = ExecutionMode::Thread;
+            m_registers.CONTROL().SPSEL = false;
+            break;
+
+        case 0b1101u:  // return to Thread using Process stack
+            if (nestedActivation != 1u && !m_systemRegisters.CCR().NONBASETHRDENA) {
+                invalidReturn();
+            }
+            framePtr = m_registers.SP_process();
+            m_currentMode = ExecutionMode::Thread;
+            m_registers.CONTROL().SPSEL = true;
+            break;
+
+        default:
+            invalidReturn();
+            return;
+    }
+
+    m_exceptionActive.reset(returningExceptionNumber);
+    if (returningExceptionNumber >= 16u) {
+        m_nvicRegisters.setActive(static_cast<uint16_t>(returningExceptionNumber - 16u), false);
+    }
+
+    popStack(framePtr, excReturn);
+
+    UNPREDICTABLE_IF(m_currentMode == ExecutionMode::Handler && m_registers.IPSR().exceptionNumber == 0u);
+    UNPREDICTABLE_IF(m_currentMode == ExecutionMode::Thread && m_registers.IPSR().exceptionNumber != 0u);
+
+    m_exclusiveMonitor.clearExclusiveLocal();
     setEventRegister();
     instructionSynchronizationBarrier(0b1111u);
 }
 
+void Cpu::popStack(uint32_t framePtr, uint32_t excReturn)
+{
+    // see: B1.5.8
+    const auto frameSize = 0x20u;
+    const auto forceAlign = m_systemRegisters.CCR().STKALIGN;
+
+    m_registers.setRegister(0, m_mpu.alignedMemoryRead<uint32_t>(framePtr + 0x0u));
+    m_registers.setRegister(1, m_mpu.alignedMemoryRead<uint32_t>(framePtr + 0x4u));
+    m_registers.setRegister(2, m_mpu.alignedMemoryRead<uint32_t>(framePtr + 0x8u));
+    m_registers.setRegister(3, m_mpu.alignedMemoryRead<uint32_t>(framePtr + 0xCu));
+    m_registers.setRegister(12, m_mpu.alignedMemoryRead<uint32_t>(framePtr + 0x10u));
+    m_registers.LR() = m_mpu.alignedMemoryRead<uint32_t>(framePtr + 0x14u);
+    m_registers.PC() = m_mpu.alignedMemoryRead<uint32_t>(framePtr + 0x18u) & ZEROS<1, uint32_t>;
+    const auto psr = m_mpu.alignedMemoryRead<uint32_t>(framePtr + 0x1Cu);
+
+    const auto spMask = combine<uint32_t>(_<0, 2>{0u}, _<2>{isBitSet<9>(psr) && forceAlign});
+    if (getPart<0, 4>(excReturn) == 0b1101u) {
+        m_registers.SP_process() = (m_registers.SP_process() + frameSize) | spMask;
+    }
+    else {
+        m_registers.SP_main() = (m_registers.SP_main() + frameSize) | spMask;
+    }
+
+    // APSR<31:27>, IPSR<8:0> and EPSR<26:24,15:10> are restored, bit[9] holds stack alignment
+    m_registers.xPSR() = psr & ~(0x1u << 9u);
+}
+
 auto Cpu::returnAddress(uint16_t exceptionType) -> uint32_t
 {
     switch (exceptionType) {
@@ -318,6 +829,35 @@ auto Cpu::returnAddress(uint16_t exceptionType) -> uint32_t
     }
 }
 
+auto Cpu::exceptionPriority(uint16_t exceptionType) const -> int32_t
+{
+    switch (exceptionType) {
+        case ExceptionType::Reset:
+            return -3;
+        case NMI:
+            return -2;
+        case HardFault:
+            return -1;
+        case MemManage:
+            return m_systemRegisters.SHPR1().PRI[0];
+        case BusFault:
+            return m_systemRegisters.SHPR1().PRI[1];
+        case UsageFault:
+            return m_systemRegisters.SHPR1().PRI[2];
+        case SVCall:
+            return m_systemRegisters.SHPR2().PRI[3];
+        case PendSV:
+            return m_systemRegisters.SHPR3().PRI[2];
+        case SysTick:
+            return m_systemRegisters.SHPR3().PRI[3];
+        default:
+            if (exceptionType >= 16u && exceptionType - 16u < rg::NvicRegistersSet::InterruptCount) {
+                return m_nvicRegisters.priority(static_cast<uint16_t>(exceptionType - 16u));
+            }
+            return 0;
+    }
+}
+
 auto Cpu::nextInstructionAddress() const -> uint32_t
 {
     if (m_skipIncrementingPC) {
@@ -352,4 +892,18 @@ void Cpu::preloadInstruction(uint32_t /*address*/)
 {
 }
 
+void Cpu::softwareBreakpoint(uint8_t imm8)
+{
+    // Halting debug is unimplemented, so other breakpoint instructions are ignored
+    if (imm8 != debug::Semihosting::BreakpointImmediate || m_semihosting == nullptr) {
+        return;
+    }
+
+    m_semihosting->call(*this);
+    if (m_semihosting->isExitPending()) {
+        // Ends the block, so that the run loop stops right after the exit call
+        branchWritePC(m_nextInstructionAddress);
+    }
+}
+
 }  // namespace stm32
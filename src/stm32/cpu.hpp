@@ -1,14 +1,43 @@
 #pragma once
 
+#include <atomic>
 #include <bitset>
+#include <functional>
+#include <optional>
+#include <vector>
 
+#include "debug/breakpoints.hpp"
+#include "debug/dwt.hpp"
+#include "debug/fpb.hpp"
+#include "debug/itm.hpp"
+#include "debug/stack_monitor.hpp"
+#include "debug/trace_recorder.hpp"
+#include "debug/watchpoints.hpp"
+#include "exclusive_monitor.hpp"
+#include "flash_interface.hpp"
+#include "input_event.hpp"
 #include "memory.hpp"
 #include "mpu.hpp"
+#include "nvic.hpp"
+#include "real_time_pacer.hpp"
 #include "registers/cpu_registers_set.hpp"
 #include "registers/nvic_registers_set.hpp"
 #include "registers/sys_tick_registers_set.hpp"
 #include "registers/system_control_registers_set.hpp"
 #include "utils/math.hpp"
+#include "utils/mpsc_queue.hpp"
+
+namespace stm32::debug
+{
+class Coverage;
+class EdgeCoverage;
+class Heatmap;
+class InputRecorder;
+class InputReplayer;
+class PcSampler;
+class Profiler;
+class Semihosting;
+}  // namespace stm32::debug
 
 namespace stm32
 {
@@ -20,13 +49,181 @@ enum class ExecutionMode {
     Handler,
 };
 
+/**
+ * Reason why the run loop returned control
+ */
+enum class StopReason {
+    CycleLimit,
+    StopRequested,
+    Breakpoint,
+    Watchpoint,
+    StackOverflow,
+    Exit,  ///< guest exited through semihosting
+};
+
 class Cpu {
 public:
+    using InputEventHandler = std::function<void(const InputEvent&)>;
+
+    /**
+     * Full machine state: core and system registers, exception state, virtual time, scheduled input events,
+     * flash interface, ITM registers and host-backed memory. Other debug units and host-side tools attached to the core
+     * are not included
+     */
+    struct Snapshot {
+        rg::CpuRegistersSet registers = rg::CpuRegistersSet{};
+        rg::SystemControlRegistersSet systemRegisters = rg::SystemControlRegistersSet{};
+        rg::SysTickRegistersSet sysTickRegisters = rg::SysTickRegistersSet{};
+        rg::NvicRegistersSet nvicRegisters = rg::NvicRegistersSet{};
+        rg::MpuRegistersSet mpuRegisters = rg::MpuRegistersSet{};
+        FlashInterface::State flashInterface{};
+        debug::Itm::State itm{};
+
+        ExecutionMode currentMode = ExecutionMode::Thread;
+        std::bitset<256> exceptionActive{};
+        bool wasEventRegistered = false;
+        bool skipAdvancingIT = false;
+        uint32_t currentInstructionAddress = 0u;
+        uint32_t nextInstructionAddress = 0u;
+        uint64_t cycles = 0u;
+        uint64_t stallCycles = 0u;
+        std::vector<InputEvent> pendingInputEvents{};
+
+        Memory::Snapshot memory{};
+    };
+
+    static constexpr size_t InputQueueCapacity = 1024u;
+
     explicit Cpu(const Memory::Config& memoryConfig);
 
+public:
+    RESTRICT_COPY(Cpu);
+
     void reset();
     void step();
 
+    /**
+     * Captures machine state, the core must be stopped
+     */
+    auto snapshot() -> Snapshot;
+
+    /**
+     * Returns machine to the captured state. Restoring the snapshot which was taken or restored last copies only
+     * memory pages written since then
+     */
+    void restore(const Snapshot& snapshot);
+
+    /**
+     * Executes instructions block by block until cycle budget is exhausted, stop is requested, a breakpoint or
+     * watchpoint is hit, a stack overflows its limit or the guest exits. Posted input events are delivered and pending interrupts are taken at block boundaries.
+     * When the previous run stopped on a breakpoint, execution resumes by stepping over it. Running out of the
+     * instruction budget is reported as StopReason::CycleLimit too
+     */
+    auto run(uint64_t cycleBudget, uint64_t instructionBudget = UINT64_MAX) -> StopReason;
+
+    /**
+     * Makes the next run step over the breakpoint at the current PC, as if the core has stopped on it
+     */
+    inline void skipBreakpointOnResume() { m_breakpointStopAddress = m_registers.PC(); }
+
+    /**
+     * Makes run loop return at the next block boundary. Safe to call from any thread
+     */
+    inline void requestStop() { m_stopRequested.store(true, std::memory_order_relaxed); }
+
+    /**
+     * Posts external interrupt. Safe to call from any thread, never blocks
+     * @return false if input queue is full
+     */
+    auto postInterrupt(uint16_t interrupt, uint64_t timestamp = 0u) -> bool;
+
+    /**
+     * Posts event for peripheral input handler. Safe to call from any thread, never blocks
+     * @return false if input queue is full
+     */
+    auto postInputEvent(const InputEvent& event) -> bool;
+
+    /**
+     * Schedules event bypassing the input queue. Must be called from the thread which runs the core, or while it is stopped
+     */
+    void scheduleInputEvent(const InputEvent& event);
+
+    inline void setInputEventHandler(InputEventHandler handler) { m_inputEventHandler = std::move(handler); }
+
+    /**
+     * Enables real-time pacing mode, run loop will sleep between bursts to match the pacer frequency.
+     * Pass nullptr to run at full speed
+     */
+    void setRealTimePacer(RealTimePacer* pacer);
+    inline auto realTimePacer() -> RealTimePacer* { return m_realTimePacer; }
+
+    /**
+     * Records every executed instruction into the trace until detached with nullptr, recorder is not owned
+     */
+    void setTraceRecorder(debug::TraceRecorder* recorder);
+    inline auto traceRecorder() -> debug::TraceRecorder* { return m_traceRecorder; }
+
+    /**
+     * Attributes every executed instruction to the guest function until detached with nullptr, profiler is not owned
+     */
+    void setProfiler(debug::Profiler* profiler);
+    inline auto profiler() -> debug::Profiler* { return m_profiler; }
+
+    /**
+     * Records executed blocks into the coverage until detached with nullptr, coverage is not owned
+     */
+    inline void setCoverage(debug::Coverage* coverage) { m_coverage = coverage; }
+    inline auto coverage() -> debug::Coverage* { return m_coverage; }
+
+    /**
+     * Records edges between executed blocks until detached with nullptr, coverage is not owned
+     */
+    inline void setEdgeCoverage(debug::EdgeCoverage* coverage) { m_edgeCoverage = coverage; }
+    inline auto edgeCoverage() -> debug::EdgeCoverage* { return m_edgeCoverage; }
+
+    /**
+     * Counts memory accesses per cache line until detached with nullptr, heatmap is not owned
+     */
+    void setHeatmap(debug::Heatmap* heatmap);
+    inline auto heatmap() -> debug::Heatmap* { return m_heatmap; }
+
+    /**
+     * Samples PC and LR every sampler interval until detached with nullptr, sampler is not owned
+     */
+    void setPcSampler(debug::PcSampler* sampler);
+    inline auto pcSampler() -> debug::PcSampler* { return m_pcSampler; }
+
+    /**
+     * Logs delivered input events and cut block boundaries until detached with nullptr, recorder is not owned
+     */
+    inline void setInputRecorder(debug::InputRecorder* recorder) { m_inputRecorder = recorder; }
+    inline auto inputRecorder() -> debug::InputRecorder* { return m_inputRecorder; }
+
+    /**
+     * Replaces live input with the logged one until detached with nullptr, replayer is not owned. Posted and scheduled
+     * events are discarded while replaying.
+     */
+    inline void setInputReplayer(debug::InputReplayer* replayer) { m_inputReplayer = replayer; }
+    inline auto inputReplayer() -> debug::InputReplayer* { return m_inputReplayer; }
+
+    /**
+     * Serves semihosting calls made with BKPT 0xAB until detached with nullptr, semihosting is not owned
+     */
+    inline void setSemihosting(debug::Semihosting* semihosting) { m_semihosting = semihosting; }
+    inline auto semihosting() -> debug::Semihosting* { return m_semihosting; }
+
+    /**
+     * Called by the MPU for data accesses to slow path memory pages
+     */
+    void checkDataAccess(uint32_t address, uint32_t size, bool write, uint32_t value);
+
+    inline auto cycles() const -> uint64_t { return m_cycles; }
+
+    /**
+     * Every instruction takes one cycle, the rest is spent waiting for flash
+     */
+    inline auto instructions() const -> uint64_t { return m_cycles - m_stallCycles; }
+
     void branchWritePC(uint32_t address, bool skipIncrementingPC = true);
     void bxWritePC(uint32_t address, bool skipIncrementingPC = true);
     void blxWritePC(uint32_t address, bool skipIncrementingPC = true);
@@ -48,7 +245,10 @@ public:
     void exceptionEntry(uint16_t exceptionType);
     void pushStack(uint16_t exceptionType);
     void exceptionTaken(uint16_t exceptionType);
+    void exceptionReturn(uint32_t excReturn);
+    void popStack(uint32_t framePtr, uint32_t excReturn);
     auto returnAddress(uint16_t exceptionType) -> uint32_t;
+    auto exceptionPriority(uint16_t exceptionType) const -> int32_t;
 
     auto currentInstructionAddress() const { return m_currentInstructionAddress; }
     auto nextInstructionAddress() const -> uint32_t;
@@ -58,13 +258,20 @@ public:
     void instructionSynchronizationBarrier(uint8_t option);
     void preloadData(uint32_t address);
     void preloadInstruction(uint32_t address);
+    void softwareBreakpoint(uint8_t imm8);
 
     inline void setEventRegister() { m_wasEventRegistered = true; }
     inline void clearEventRegister() { m_wasEventRegistered = false; }
     inline auto wasEventRegistered() -> bool { return m_wasEventRegistered; }
 
     inline auto R(uint8_t reg) const -> uint32_t { return m_registers.getRegister(reg); }
-    inline void setR(uint8_t reg, uint32_t value) { m_registers.setRegister(reg, value); }
+    inline void setR(uint8_t reg, uint32_t value)
+    {
+        m_registers.setRegister(reg, value);
+        if (reg == rg::RegisterType::SP) {
+            stackPointerWritten();
+        }
+    }
     inline auto registers() -> rg::CpuRegistersSet& { return m_registers; }
 
     inline auto systemRegisters() -> rg::SystemControlRegistersSet& { return m_systemRegisters; }
@@ -75,9 +282,38 @@ public:
 
     inline auto mpu() -> Mpu& { return m_mpu; }
 
+    inline auto exclusiveMonitor() -> ExclusiveMonitor& { return m_exclusiveMonitor; }
+
+    inline auto flashInterface() -> FlashInterface& { return m_flashInterface; }
+
+    inline auto breakpoints() -> debug::Breakpoints& { return m_breakpoints; }
+    inline auto watchpoints() -> debug::Watchpoints& { return m_watchpoints; }
+    inline auto fpb() -> debug::Fpb& { return m_fpb; }
+    inline auto dwt() -> debug::Dwt& { return m_dwt; }
+    inline auto itm() -> debug::Itm& { return m_itm; }
+
     inline auto memory() -> Memory& { return m_memory; }
 
+    inline auto stackMonitor() -> debug::StackMonitor& { return m_stackMonitor; }
+
+    /**
+     * Reports the current stack pointer to the stack monitor, called by instructions which write it
+     */
+    inline void stackPointerWritten()
+    {
+        const auto stack = m_registers.CONTROL().SPSEL ? debug::StackType::Process : debug::StackType::Main;
+        m_stackMonitor.update(stack, m_registers.SP(), m_currentInstructionAddress);
+    }
+
 private:
+    auto executeBlock(uint64_t cycleLimit, bool resuming) -> std::optional<StopReason>;
+    auto executeDebugBlock(uint64_t cycleLimit, bool resuming) -> std::optional<StopReason>;
+    auto waitForFetch(uint64_t cycleLimit) -> bool;
+    void serviceInputEvents();
+    void deliverInputEvent(const InputEvent& event);
+    void takePendingInterrupt();
+    void updateSlowPath();
+
     rg::CpuRegistersSet m_registers;
     rg::SystemControlRegistersSet m_systemRegisters;
     rg::SysTickRegistersSet m_sysTickRegisters;
@@ -85,6 +321,17 @@ private:
     Memory m_memory;
 
     Mpu m_mpu;
+    Nvic m_nvic;
+    FlashInterface m_flashInterface;
+    ExclusiveMonitor m_exclusiveMonitor;
+
+    debug::Breakpoints m_breakpoints;
+    debug::Watchpoints m_watchpoints;
+    debug::Fpb m_fpb;
+    debug::Dwt m_dwt;
+    debug::Itm m_itm;
+    debug::StackMonitor m_stackMonitor;
+    std::optional<uint32_t> m_breakpointStopAddress;
 
     ExecutionMode m_currentMode;
     std::bitset<256> m_exceptionActive;
@@ -95,6 +342,30 @@ private:
     uint32_t m_nextInstructionAddress = 0u;
 
     bool m_skipAdvancingIT = false;
+
+    uint64_t m_cycles = 0u;
+    uint64_t m_stallCycles = 0u;
+    std::atomic<bool> m_stopRequested{false};
+
+    utils::MpscQueue<InputEvent, InputQueueCapacity> m_inputQueue;
+    std::vector<InputEvent> m_pendingInputEvents;  // min-heap by timestamp
+    InputEventHandler m_inputEventHandler;
+
+    RealTimePacer* m_realTimePacer = nullptr;
+    uint64_t m_nextPaceCycle = 0u;
+
+    debug::TraceRecorder* m_traceRecorder = nullptr;
+    debug::Profiler* m_profiler = nullptr;
+    debug::Coverage* m_coverage = nullptr;
+    debug::EdgeCoverage* m_edgeCoverage = nullptr;
+    debug::Heatmap* m_heatmap = nullptr;
+
+    debug::PcSampler* m_pcSampler = nullptr;
+    uint64_t m_nextSampleCycle = 0u;
+
+    debug::InputRecorder* m_inputRecorder = nullptr;
+    debug::InputReplayer* m_inputReplayer = nullptr;
+    debug::Semihosting* m_semihosting = nullptr;
 };
 
 }  // namespace stm32
@@ -294,7 +294,7 @@ inline void handleMiscInstruction(uint16_t opCode, Cpu& cpu)
             return opcodes::cmdPop<opcodes::Encoding::T1>(opCode, cpu);
         case 0b1110'000u ... 0b1110'111u:
             // see: A7-215
-            return;  // SKIP BECAUSE DEBUG IS UNIMPLEMENTED!
+            return opcodes::cmdBreakpoint(opCode, cpu);
         case 0b1111'000u ... 0b1111'111u:
             // see A5-133
             switch (getPart<0, 4>(opCode)) {
@@ -412,11 +412,11 @@ inline void loadStoreDualOrExclusive(uint32_t opCode, Cpu& cpu)
     // see: A5-143
     if (op1 == 0b00u && op2 == 0b00u) {
         // see: A7-438
-        UNIMPLEMENTED;
+        return opcodes::cmdStoreRegisterExclusive<uint32_t>(opCode, cpu);
     }
     if (op1 == 0b00u && op2 == 0b01u) {
         // see: A7-270
-        UNIMPLEMENTED;
+        return opcodes::cmdLoadRegisterExclusive<uint32_t>(opCode, cpu);
     }
     if ((op2 == 0b10u && isBitClear<1>(op1)) || (isBitClear<0>(op2) && isBitSet<1>(op1))) {
         // see: A7-436
@@ -430,10 +430,10 @@ inline void loadStoreDualOrExclusive(uint32_t opCode, Cpu& cpu)
         switch (op3) {
             case 0b0100u:
                 // see: A7-439
-                UNIMPLEMENTED;
+                return opcodes::cmdStoreRegisterExclusive<uint8_t>(opCode, cpu);
             case 0b0101u:
                 // see: A7-440
-                UNIMPLEMENTED;
+                return opcodes::cmdStoreRegisterExclusive<uint16_t>(opCode, cpu);
             default:
                 break;
         }
@@ -448,10 +448,10 @@ inline void loadStoreDualOrExclusive(uint32_t opCode, Cpu& cpu)
                 return opcodes::cmdTableBranch<uint16_t>(opCode, cpu);
             case 0b0100u:
                 // see: A7-271
-                UNIMPLEMENTED;
+                return opcodes::cmdLoadRegisterExclusive<uint8_t>(opCode, cpu);
             case 0b0101u:
                 // see: A7-272
-                UNIMPLEMENTED;
+                return opcodes::cmdLoadRegisterExclusive<uint16_t>(opCode, cpu);
             default:
                 break;
         }
@@ -1207,6 +1207,8 @@ void Cpu::step()
     const auto op1 = getPart<11, 2>(opCodeHw1);
 
     if (op1 == 0u || (getPart<13, 3>(opCodeHw1) != 0b111u)) {
+        m_nextInstructionAddress = PC + 2u;
+
         switch (getPart<10, 6>(opCodeHw1)) {
             case 0b00'0000u ... 0b00'1111u:
                 hw::handleMathInstruction(opCodeHw1, *this);
@@ -1260,6 +1262,8 @@ void Cpu::step()
 
         const auto op2 = getPart<4, 7>(opCodeHw1);
 
+        m_nextInstructionAddress = PC + 4u;
+
         switch (op1) {
             case 0b01u:
                 switch (op2) {
@@ -1349,6 +1353,8 @@ void Cpu::step()
         advanceCondition();
     }
     m_skipAdvancingIT = false;
+
+    ++m_cycles;
 }  // namespace wo
 
 }  // namespace stm32
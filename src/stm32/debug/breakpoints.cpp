@@ -0,0 +1,177 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "breakpoints.hpp"
+
+#include <algorithm>
+#include <utility>
+
+#include "../utils/math.hpp"
+
+namespace stm32::debug
+{
+using namespace utils;
+
+Breakpoints::Breakpoints()
+    : m_chunks{}
+    , m_references{}
+    , m_conditionals{}
+    , m_tracepointRecords{}
+{
+}
+
+void Breakpoints::add(uint32_t address)
+{
+    address &= ZEROS<1, uint32_t>;
+    if (++m_references[address] == 1u) {
+        setBit(address, true);
+    }
+}
+
+void Breakpoints::remove(uint32_t address)
+{
+    address &= ZEROS<1, uint32_t>;
+
+    const auto it = m_references.find(address);
+    if (it == m_references.end()) {
+        return;
+    }
+
+    if (--it->second == 0u) {
+        m_references.erase(it);
+        setBit(address, false);
+    }
+}
+
+void Breakpoints::clear()
+{
+    for (const auto& [address, count] : m_references) {
+        setBit(address, false);
+    }
+    m_references.clear();
+    m_conditionals.clear();
+    m_tracepointRecords.clear();
+}
+
+auto Breakpoints::addConditional(uint32_t address, std::string_view condition) -> uint32_t
+{
+    return addConditional(ConditionalBreakpoint{
+        .id = 0u,
+        .address = address & ZEROS<1, uint32_t>,
+        .condition = Expression::compile(condition),
+        .collect = {},
+        .tracepoint = false,
+        .hits = 0u,
+    });
+}
+
+auto Breakpoints::addTracepoint(uint32_t address, std::string_view condition, const std::vector<std::string_view>& collect) -> uint32_t
+{
+    auto tracepoint = ConditionalBreakpoint{
+        .id = 0u,
+        .address = address & ZEROS<1, uint32_t>,
+        .condition = condition.empty() ? Expression{} : Expression::compile(condition),
+        .collect = {},
+        .tracepoint = true,
+        .hits = 0u,
+    };
+    for (const auto source : collect) {
+        tracepoint.collect.push_back(Expression::compile(source));
+    }
+
+    return addConditional(std::move(tracepoint));
+}
+
+auto Breakpoints::addConditional(ConditionalBreakpoint&& breakpoint) -> uint32_t
+{
+    breakpoint.id = m_nextConditionalId++;
+
+    const auto address = breakpoint.address;
+    m_conditionals[address].push_back(std::move(breakpoint));
+    add(address);
+
+    return m_conditionals[address].back().id;
+}
+
+auto Breakpoints::removeConditional(uint32_t id) -> bool
+{
+    for (auto it = m_conditionals.begin(); it != m_conditionals.end(); ++it) {
+        auto& breakpoints = it->second;
+        const auto found = std::find_if(breakpoints.begin(), breakpoints.end(), [&](const ConditionalBreakpoint& item) {
+            return item.id == id;
+        });
+        if (found == breakpoints.end()) {
+            continue;
+        }
+
+        const auto address = it->first;
+        breakpoints.erase(found);
+        if (breakpoints.empty()) {
+            m_conditionals.erase(it);
+        }
+        remove(address);
+        return true;
+    }
+
+    return false;
+}
+
+auto Breakpoints::shouldStop(uint32_t address, Cpu& cpu) -> bool
+{
+    const auto it = m_conditionals.find(address);
+    if (it == m_conditionals.end()) {
+        return true;
+    }
+
+    // Any reference which is not conditional is a plain breakpoint
+    auto stop = m_references[address] > it->second.size();
+
+    // All conditions are evaluated, so hit counts don't depend on the other breakpoints at the same address
+    for (auto& breakpoint : it->second) {
+        ++breakpoint.hits;
+        if (!breakpoint.condition.empty() && breakpoint.condition.evaluate(cpu, breakpoint.hits) == 0u) {
+            continue;
+        }
+
+        if (!breakpoint.tracepoint) {
+            stop = true;
+            continue;
+        }
+
+        auto& record = m_tracepointRecords.emplace_back(
+            TracepointRecord{.id = breakpoint.id, .address = address, .hits = breakpoint.hits, .values = {}});
+        for (const auto& expression : breakpoint.collect) {
+            record.values.push_back(expression.evaluate(cpu, breakpoint.hits));
+        }
+    }
+
+    return stop;
+}
+
+auto Breakpoints::takeTracepointRecords() -> std::vector<TracepointRecord>
+{
+    return std::exchange(m_tracepointRecords, {});
+}
+
+void Breakpoints::setBit(uint32_t address, bool value)
+{
+    auto& chunk = m_chunks[address >> ChunkShift];
+    if (chunk == nullptr) {
+        if (!value) {
+            return;
+        }
+        chunk = std::make_unique<Chunk>();
+        chunk->fill(0u);
+    }
+
+    const auto bit = (address & ((1u << ChunkShift) - 1u)) >> 1u;
+    const auto mask = uint64_t{1u} << (bit & 0x3Fu);
+    if (value) {
+        (*chunk)[bit >> 6u] |= mask;
+    }
+    else {
+        (*chunk)[bit >> 6u] &= ~mask;
+    }
+}
+
+}  // namespace stm32::debug
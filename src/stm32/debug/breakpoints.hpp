@@ -0,0 +1,108 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include "expression.hpp"
+
+namespace stm32::debug
+{
+struct ConditionalBreakpoint {
+    uint32_t id;
+    uint32_t address;
+    Expression condition;             ///< always true if empty
+    std::vector<Expression> collect;  ///< values recorded by a tracepoint
+    bool tracepoint;                  ///< record and continue instead of stopping
+    uint32_t hits;                    ///< number of times the address was reached
+};
+
+struct TracepointRecord {
+    uint32_t id;
+    uint32_t address;
+    uint32_t hits;
+    std::vector<uint32_t> values;  ///< collected values in order of the expressions
+};
+
+/**
+ * Instruction address breakpoints checked by the run loop before the instruction is executed
+ *
+ * Breakpoints are kept in a per-halfword bitmap split into lazily allocated 1 MiB chunks of address space, so the check
+ * is one table load and one bit test. Breakpoints are reference counted, the same address may be set by the debugger
+ * and by FPB comparators independently.
+ *
+ * Conditional breakpoints and tracepoints occupy the same bitmap, their precompiled expressions are evaluated only when
+ * the address matches.
+ */
+class Breakpoints {
+public:
+    static constexpr uint32_t ChunkShift = 20u;
+    static constexpr uint32_t ChunkCount = 1u << (32u - ChunkShift);
+    static constexpr uint32_t ChunkWords = (1u << ChunkShift) / 2u / 64u;
+
+    explicit Breakpoints();
+
+    void add(uint32_t address);
+    void remove(uint32_t address);
+    void clear();
+
+    /**
+     * Adds breakpoint which stops only when condition is non-zero
+     * @return identifier for removal
+     * @throws std::invalid_argument if condition can't be compiled
+     */
+    auto addConditional(uint32_t address, std::string_view condition) -> uint32_t;
+
+    /**
+     * Adds tracepoint which records collected values when condition is non-zero and never stops the core
+     * @return identifier for removal
+     * @throws std::invalid_argument if condition or collected expressions can't be compiled
+     */
+    auto addTracepoint(uint32_t address, std::string_view condition, const std::vector<std::string_view>& collect) -> uint32_t;
+
+    auto removeConditional(uint32_t id) -> bool;
+
+    /**
+     * Evaluates conditional breakpoints and tracepoints at the address, called only if contains() is true
+     * @return whether the core should stop
+     */
+    auto shouldStop(uint32_t address, Cpu& cpu) -> bool;
+
+    auto takeTracepointRecords() -> std::vector<TracepointRecord>;
+
+    inline auto contains(uint32_t address) const -> bool
+    {
+        const auto& chunk = m_chunks[address >> ChunkShift];
+        if (chunk == nullptr) {
+            return false;
+        }
+
+        const auto bit = (address & ((1u << ChunkShift) - 1u)) >> 1u;
+        return (((*chunk)[bit >> 6u] >> (bit & 0x3Fu)) & 0x1u) != 0u;
+    }
+
+    inline auto empty() const -> bool { return m_references.empty(); }
+
+    /**
+     * Breakpoint addresses with their reference counts
+     */
+    inline auto references() const -> const std::map<uint32_t, uint32_t>& { return m_references; }
+
+private:
+    using Chunk = std::array<uint64_t, ChunkWords>;
+
+    void setBit(uint32_t address, bool value);
+    auto addConditional(ConditionalBreakpoint&& breakpoint) -> uint32_t;
+
+    std::array<std::unique_ptr<Chunk>, ChunkCount> m_chunks;
+    std::map<uint32_t, uint32_t> m_references;
+
+    std::map<uint32_t, std::vector<ConditionalBreakpoint>> m_conditionals;
+    std::vector<TracepointRecord> m_tracepointRecords;
+    uint32_t m_nextConditionalId = 1u;
+};
+
+}  // namespace stm32::debug
@@ -0,0 +1,189 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "coverage.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+#include <map>
+#include <stdexcept>
+
+namespace stm32::debug
+{
+Coverage::Coverage(const Memory::Config& config)
+    : m_start{config.flashMemoryStart}
+    , m_size{config.flashMemoryEnd - config.flashMemoryStart}
+    , m_aliased{config.bootMode == BootMode::FlashMemory}
+    , m_flash{config.flash}
+    , m_executed((m_size / 2u + 63u) / 64u, 0u)
+    , m_fallthrough(m_executed.size(), 0u)
+    , m_branched(m_executed.size(), 0u)
+{
+}
+
+auto Coverage::isExecuted(uint32_t address) const -> bool
+{
+    const auto offset = toOffset(address);
+    return offset < m_size && testBit(m_executed, offset);
+}
+
+auto Coverage::hasFallenThrough(uint32_t address) const -> bool
+{
+    const auto offset = toOffset(address);
+    return offset < m_size && testBit(m_fallthrough, offset);
+}
+
+auto Coverage::hasBranched(uint32_t address) const -> bool
+{
+    const auto offset = toOffset(address);
+    return offset < m_size && testBit(m_branched, offset);
+}
+
+void Coverage::merge(const Coverage& other)
+{
+    if (other.m_start != m_start || other.m_size != m_size) {
+        throw std::invalid_argument{"coverage of different flash layouts can't be merged"};
+    }
+
+    for (size_t i = 0; i < m_executed.size(); ++i) {
+        m_executed[i] |= other.m_executed[i];
+        m_fallthrough[i] |= other.m_fallthrough[i];
+        m_branched[i] |= other.m_branched[i];
+    }
+}
+
+void Coverage::clear()
+{
+    std::fill(m_executed.begin(), m_executed.end(), 0u);
+    std::fill(m_fallthrough.begin(), m_fallthrough.end(), 0u);
+    std::fill(m_branched.begin(), m_branched.end(), 0u);
+}
+
+void Coverage::setRange(std::vector<uint64_t>& bitmap, uint32_t begin, uint32_t end)
+{
+    auto bit = begin >> 1u;
+    const auto endBit = (end + 1u) >> 1u;
+
+    // whole words are filled at once, only the partial ones at the edges need masks
+    while (bit < endBit) {
+        const auto word = bit >> 6u;
+        const auto first = bit & 0x3Fu;
+        const auto count = std::min(64u - first, endBit - bit);
+        const auto mask = count == 64u ? UINT64_MAX : ((uint64_t{1u} << count) - 1u) << first;
+        bitmap[word] |= mask;
+        bit += count;
+    }
+}
+
+void Coverage::writeRanges(std::ostream& output) const
+{
+    char line[32];
+    for (uint32_t offset = 0u; offset < m_size; offset += 2u) {
+        if (!testBit(m_executed, offset)) {
+            continue;
+        }
+
+        const auto begin = offset;
+        while (offset < m_size && testBit(m_executed, offset)) {
+            offset += 2u;
+        }
+
+        std::snprintf(line, sizeof(line), "%08" PRIx32 "-%08" PRIx32 "\n", m_start + begin, m_start + offset);
+        output << line;
+    }
+}
+
+auto Coverage::readHalfword(uint32_t offset) const -> uint16_t
+{
+    if (offset + 1u >= m_flash.size()) {
+        return 0u;
+    }
+    return static_cast<uint16_t>(m_flash[offset] | (m_flash[offset + 1u] << 8u));
+}
+
+auto Coverage::conditionalBranchSize(uint32_t offset) const -> uint32_t
+{
+    const auto hw1 = readHalfword(offset);
+
+    // B<c> T1 and CBZ/CBNZ
+    if (((hw1 & 0xF000u) == 0xD000u && ((hw1 >> 8u) & 0xEu) != 0xEu) || (hw1 & 0xF500u) == 0xB100u) {
+        return 2u;
+    }
+
+    // B<c> T3
+    const auto hw2 = readHalfword(offset + 2u);
+    if ((hw1 & 0xF800u) == 0xF000u && (hw2 & 0xD000u) == 0x8000u && ((hw1 >> 6u) & 0xEu) != 0xEu) {
+        return 4u;
+    }
+
+    return 0u;
+}
+
+void Coverage::writeLcov(std::ostream& output, const LineTable& lines, std::string_view testName) const
+{
+    struct LineCoverage {
+        bool hit = false;
+        std::vector<std::pair<bool, bool>> branches{};  // taken, not taken
+        bool branchesExecuted = false;
+    };
+
+    std::map<uint32_t, std::map<uint32_t, LineCoverage>> files;
+    for (const auto& range : lines.ranges()) {
+        const auto begin = toOffset(range.begin);
+        if (begin >= m_size || range.end - range.begin > m_size - begin) {
+            continue;
+        }
+
+        auto& line = files[range.file][range.line];
+        const auto end = begin + (range.end - range.begin);
+
+        // walk instructions of the range, 32-bit encodings start with 0b11101, 0b11110 or 0b11111
+        for (auto offset = begin; offset < end;) {
+            const auto executed = testBit(m_executed, offset);
+            line.hit = line.hit || executed;
+
+            if (const auto size = conditionalBranchSize(offset); size != 0u) {
+                line.branches.emplace_back(testBit(m_branched, offset), testBit(m_fallthrough, offset));
+                line.branchesExecuted = line.branchesExecuted || executed;
+            }
+
+            offset += (readHalfword(offset) >> 11u) >= 0b11101u ? 4u : 2u;
+        }
+    }
+
+    output << "TN:" << testName << '\n';
+    for (const auto& [file, fileLines] : files) {
+        output << "SF:" << lines.files()[file] << '\n';
+
+        uint32_t linesHit = 0u;
+        uint32_t branchesFound = 0u;
+        uint32_t branchesHit = 0u;
+        for (const auto& [number, line] : fileLines) {
+            uint32_t block = 0u;
+            for (const auto& [taken, notTaken] : line.branches) {
+                for (const auto direction : {taken, notTaken}) {
+                    output << "BRDA:" << number << ',' << block << ',' << branchesFound % 2u << ',';
+                    if (line.branchesExecuted) {
+                        output << (direction ? 1 : 0) << '\n';
+                    }
+                    else {
+                        output << "-\n";
+                    }
+                    ++branchesFound;
+                    branchesHit += direction ? 1u : 0u;
+                }
+                ++block;
+            }
+        }
+        for (const auto& [number, line] : fileLines) {
+            output << "DA:" << number << ',' << (line.hit ? 1 : 0) << '\n';
+            linesHit += line.hit ? 1u : 0u;
+        }
+
+        output << "BRF:" << branchesFound << '\n' << "BRH:" << branchesHit << '\n';
+        output << "LF:" << fileLines.size() << '\n' << "LH:" << linesHit << '\n';
+        output << "end_of_record\n";
+    }
+}
+
+}  // namespace stm32::debug
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <vector>
+
+#include "../memory.hpp"
+#include "line_table.hpp"
+
+namespace stm32::debug
+{
+/**
+ * Code coverage of the flash memory
+ *
+ * Run loop reports every executed block, which is a sequential run of instructions ending with a PC write or at the
+ * cycle limit. Three per-halfword bitmaps are ORed per block: executed halfwords, instructions which continued to the
+ * next one and instructions which wrote PC. Branch directions are derived from the last two, so nothing is done per
+ * instruction. Code outside flash and its boot alias is not recorded.
+ */
+class Coverage {
+public:
+    explicit Coverage(const Memory::Config& config);
+
+    /**
+     * @param first address of the first instruction of the block
+     * @param last address of the last instruction of the block
+     * @param next address following the last instruction
+     * @param branched whether the last instruction wrote PC
+     */
+    inline void recordBlock(uint32_t first, uint32_t last, uint32_t next, bool branched)
+    {
+        const auto offset = toOffset(first);
+        if (offset >= m_size || next - first > m_size - offset) {
+            return;
+        }
+
+        const auto lastOffset = offset + (last - first);
+        setRange(m_executed, offset, offset + (next - first));
+        if (branched) {
+            setRange(m_fallthrough, offset, lastOffset);
+            setBit(m_branched, lastOffset);
+        }
+        else {
+            setRange(m_fallthrough, offset, offset + (next - first));
+        }
+    }
+
+    auto isExecuted(uint32_t address) const -> bool;
+    auto hasFallenThrough(uint32_t address) const -> bool;
+    auto hasBranched(uint32_t address) const -> bool;
+
+    /**
+     * Adds coverage recorded by another run of the same firmware
+     */
+    void merge(const Coverage& other);
+    void clear();
+
+    /**
+     * Writes executed address ranges, one "start-end" line per range in hexadecimal, end is exclusive
+     */
+    void writeRanges(std::ostream& output) const;
+
+    /**
+     * Writes lcov tracefile with line and conditional branch coverage mapped through the line table
+     */
+    void writeLcov(std::ostream& output, const LineTable& lines, std::string_view testName) const;
+
+private:
+    inline auto toOffset(uint32_t address) const -> uint32_t
+    {
+        // flash is aliased at zero when booting from it
+        if (address < m_start && m_aliased) {
+            return address;
+        }
+        return address - m_start;
+    }
+
+    static inline auto testBit(const std::vector<uint64_t>& bitmap, uint32_t offset) -> bool
+    {
+        const auto bit = offset >> 1u;
+        return ((bitmap[bit >> 6u] >> (bit & 0x3Fu)) & 0x1u) != 0u;
+    }
+
+    static inline void setBit(std::vector<uint64_t>& bitmap, uint32_t offset)
+    {
+        const auto bit = offset >> 1u;
+        bitmap[bit >> 6u] |= uint64_t{1u} << (bit & 0x3Fu);
+    }
+
+    static void setRange(std::vector<uint64_t>& bitmap, uint32_t begin, uint32_t end);
+
+    auto readHalfword(uint32_t offset) const -> uint16_t;
+    auto conditionalBranchSize(uint32_t offset) const -> uint32_t;
+
+    uint32_t m_start;
+    uint32_t m_size;
+    bool m_aliased;
+    utils::ArrayView<const uint8_t, uint32_t> m_flash;
+
+    std::vector<uint64_t> m_executed;
+    std::vector<uint64_t> m_fallthrough;
+    std::vector<uint64_t> m_branched;
+};
+
+}  // namespace stm32::debug
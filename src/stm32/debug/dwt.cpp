@@ -0,0 +1,165 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "dwt.hpp"
+
+#include "../utils/math.hpp"
+
+namespace stm32::debug
+{
+using namespace utils;
+
+namespace
+{
+enum RegisterOffset : uint32_t {
+    DWT_CTRL = 0x000u,
+    DWT_COMP0 = 0x020u,
+    ComparatorStride = 0x010u,
+};
+
+enum ComparatorRegister : uint32_t {
+    COMP = 0x0u,
+    MASK = 0x4u,
+    FUNCTION = 0x8u,
+};
+
+// see: C1.8.17, DATAVADDR1, DATAVADDR0, DATAVSIZE, DATAVMATCH and FUNCTION are writable
+constexpr uint32_t FunctionWriteMask = 0x000FFD0Fu;
+constexpr uint32_t MaskWriteMask = 0x1Fu;
+// NUMCOMP [31:28], NOTRCPKT, NOEXTTRIG, NOCYCCNT and NOPRFCNT are set
+constexpr uint32_t ControlReadOnly = (Dwt::ComparatorCount << 28u) | 0x0F000000u;
+
+inline auto toWatchpointType(uint32_t function) -> std::optional<WatchpointType>
+{
+    switch (function) {
+        case 0b0101u:
+            return WatchpointType::Read;
+        case 0b0110u:
+            return WatchpointType::Write;
+        case 0b0111u:
+            return WatchpointType::Access;
+        default:
+            return std::nullopt;
+    }
+}
+
+}  // namespace
+
+Dwt::Dwt(Watchpoints& watchpoints)
+    : MemoryRegion{Memory::DwtStart, Memory::DwtEnd}
+    , m_watchpoints{watchpoints}
+    , m_comparators{}
+    , m_installed{}
+{
+}
+
+void Dwt::write(uint32_t address, uint8_t data)
+{
+    const auto offset = address - Memory::DwtStart;
+    auto* reg = registerReference(offset & ~0x3u);
+    if (reg == nullptr) {
+        return;
+    }
+
+    const auto shift = (offset & 0x3u) * 8u;
+    *reg = (*reg & ~(0xFFu << shift)) | (static_cast<uint32_t>(data) << shift);
+
+    if (const auto registerOffset = offset & ~0x3u; registerOffset == DWT_CTRL) {
+        m_control &= ~ControlReadOnly;
+    }
+    else if ((registerOffset - DWT_COMP0) % ComparatorStride == MASK) {
+        *reg &= MaskWriteMask;
+    }
+    else if ((registerOffset - DWT_COMP0) % ComparatorStride == FUNCTION) {
+        *reg &= FunctionWriteMask;
+    }
+
+    updateWatchpoints();
+}
+
+auto Dwt::read(uint32_t address) -> uint8_t
+{
+    const auto offset = address - Memory::DwtStart;
+    return static_cast<uint8_t>(readRegister(offset & ~0x3u) >> ((offset & 0x3u) * 8u));
+}
+
+void Dwt::reset()
+{
+    m_control = 0u;
+    m_comparators.fill(Comparator{});
+    updateWatchpoints();
+}
+
+auto Dwt::readRegister(uint32_t offset) -> uint32_t
+{
+    if (offset == DWT_CTRL) {
+        return m_control | ControlReadOnly;
+    }
+
+    const auto* reg = registerReference(offset);
+    return reg != nullptr ? *reg : 0u;
+}
+
+auto Dwt::registerReference(uint32_t offset) -> uint32_t*
+{
+    if (offset == DWT_CTRL) {
+        return &m_control;
+    }
+    if (offset < DWT_COMP0 || offset >= DWT_COMP0 + ComparatorStride * ComparatorCount) {
+        return nullptr;
+    }
+
+    auto& comparator = m_comparators[(offset - DWT_COMP0) / ComparatorStride];
+    switch ((offset - DWT_COMP0) % ComparatorStride) {
+        case COMP:
+            return &comparator.comp;
+        case MASK:
+            return &comparator.mask;
+        case FUNCTION:
+            return &comparator.function;
+        default:
+            return nullptr;
+    }
+}
+
+void Dwt::updateWatchpoints()
+{
+    for (const auto& watchpoint : m_installed) {
+        m_watchpoints.remove(watchpoint);
+    }
+    m_installed.clear();
+
+    for (uint32_t i = 0; i < ComparatorCount; ++i) {
+        const auto& comparator = m_comparators[i];
+        const auto type = toWatchpointType(getPart<0, 4>(comparator.function));
+        if (!type.has_value()) {
+            continue;
+        }
+
+        if (isBitSet<8>(comparator.function)) {
+            // see: C1.8.17, data value comparison limited by the linked address comparator
+            const auto size = getPart<10, 2>(comparator.function);
+            const auto valueMask = size >= 2u ? ONES<32, uint32_t> : (0x1u << (8u << size)) - 1u;
+            const auto linked = getPart<12, 4>(comparator.function);
+
+            auto watchpoint = Watchpoint{.address = 0u, .length = ONES<32, uint32_t>, .type = *type, .value = comparator.comp & valueMask};
+            if (linked != i && linked < ComparatorCount && getPart<0, 4>(m_comparators[linked].function) == 0u) {
+                const auto& address = m_comparators[linked];
+                watchpoint.address = address.comp & ~((0x1u << address.mask) - 1u);
+                watchpoint.length = 0x1u << address.mask;
+            }
+            m_installed.push_back(watchpoint);
+        }
+        else {
+            // see: C1.8.16, MASK ignores the low address bits
+            const auto length = 0x1u << comparator.mask;
+            m_installed.push_back(Watchpoint{.address = comparator.comp & ~(length - 1u), .length = length, .type = *type});
+        }
+    }
+
+    for (const auto& watchpoint : m_installed) {
+        m_watchpoints.add(watchpoint);
+    }
+}
+
+}  // namespace stm32::debug
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "../memory.hpp"
+#include "watchpoints.hpp"
+
+namespace stm32::debug
+{
+/**
+ * Data Watchpoint and Trace unit
+ *
+ * Enabled comparators with a data watchpoint function are installed as core watchpoints, so the pages they cover are
+ * the only ones which take the slow memory path. Data value matching uses the linked address comparator from
+ * DATAVADDR0 or the whole address space if there is none. PC match, trace packets, profiling counters and the
+ * MATCHED flag are not modelled.
+ *
+ * @par Register map (see C1.8)
+ *
+ * 0xE0001000: DWT_CTRL
+ * 0xE0001020 + 16 * n: DWT_COMPn
+ * 0xE0001024 + 16 * n: DWT_MASKn
+ * 0xE0001028 + 16 * n: DWT_FUNCTIONn
+ */
+class Dwt final : public MemoryRegion {
+public:
+    static constexpr uint32_t ComparatorCount = 4u;
+
+    explicit Dwt(Watchpoints& watchpoints);
+
+    void write(uint32_t address, uint8_t data) override;
+    auto read(uint32_t address) -> uint8_t override;
+
+    void reset();
+
+private:
+    struct Comparator {
+        uint32_t comp;
+        uint32_t mask;
+        uint32_t function;
+    };
+
+    auto readRegister(uint32_t offset) -> uint32_t;
+    auto registerReference(uint32_t offset) -> uint32_t*;
+    void updateWatchpoints();
+
+    Watchpoints& m_watchpoints;
+
+    uint32_t m_control = 0u;
+    std::array<Comparator, ComparatorCount> m_comparators;
+
+    std::vector<Watchpoint> m_installed;
+};
+
+}  // namespace stm32::debug
@@ -0,0 +1,83 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "edge_coverage.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace stm32::debug
+{
+namespace
+{
+constexpr auto Buckets = []() {
+    std::array<uint8_t, 256u> buckets{};
+    for (uint32_t count = 0; count < buckets.size(); ++count) {
+        buckets[count] = count == 0u    ? 0u
+                         : count == 1u  ? 1u
+                         : count == 2u  ? 2u
+                         : count == 3u  ? 4u
+                         : count < 8u   ? 8u
+                         : count < 16u  ? 16u
+                         : count < 32u  ? 32u
+                         : count < 128u ? 64u
+                                        : 128u;
+    }
+    return buckets;
+}();
+
+}  // namespace
+
+void EdgeCoverage::clear()
+{
+    m_map.fill(0u);
+    m_previousLocation = 0u;
+    m_hasPendingBlock = false;
+}
+
+void EdgeCoverage::classify()
+{
+    if (m_hasPendingBlock) {
+        closePendingBlock();
+    }
+
+    // Most of the bitmap is empty, so it is scanned a word at a time
+    for (size_t i = 0; i < m_map.size(); i += sizeof(uint64_t)) {
+        uint64_t word = 0u;
+        std::memcpy(&word, &m_map[i], sizeof(word));
+        if (word == 0u) {
+            continue;
+        }
+        for (size_t j = i; j < i + sizeof(uint64_t); ++j) {
+            m_map[j] = Buckets[m_map[j]];
+        }
+    }
+}
+
+auto EdgeCoverage::mergeInto(Map& seen) const -> uint32_t
+{
+    uint32_t newBits = 0u;
+    for (size_t i = 0; i < m_map.size(); i += sizeof(uint64_t)) {
+        uint64_t word = 0u;
+        uint64_t seenWord = 0u;
+        std::memcpy(&word, &m_map[i], sizeof(word));
+        std::memcpy(&seenWord, &seen[i], sizeof(seenWord));
+        if ((word & ~seenWord) == 0u) {
+            continue;
+        }
+        for (size_t j = i; j < i + sizeof(uint64_t); ++j) {
+            if ((m_map[j] & ~seen[j]) != 0u) {
+                seen[j] |= m_map[j];
+                ++newBits;
+            }
+        }
+    }
+    return newBits;
+}
+
+auto EdgeCoverage::edgeCount() const -> uint32_t
+{
+    return static_cast<uint32_t>(std::count_if(m_map.begin(), m_map.end(), [](uint8_t counter) { return counter != 0u; }));
+}
+
+}  // namespace stm32::debug
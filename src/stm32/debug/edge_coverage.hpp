@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace stm32::debug
+{
+/**
+ * AFL-style edge coverage bitmap
+ *
+ * Run loop reports every executed block, which also ends where the loop cuts it for input events, budgets, pacing or
+ * sampling. Cut blocks are joined back until control leaves them by a branch or by an exception entry, so an edge is
+ * recorded only on a control-flow transfer and doesn't depend on where the run loop happened to stop. The first and
+ * the last instruction of the joined block identify the path of fall-throughs inside it, and the transition between
+ * two consecutive joined blocks is hashed into one byte counter. Previous location is shifted so that A->B and B->A
+ * land in different counters. Counters wrap, so the bitmap is compared only after hit counts are classified into
+ * buckets.
+ */
+class EdgeCoverage {
+public:
+    static constexpr uint32_t MapSizeLog2 = 16u;
+    static constexpr uint32_t MapSize = 1u << MapSizeLog2;
+
+    using Map = std::array<uint8_t, MapSize>;
+
+    explicit EdgeCoverage() = default;
+
+    inline void recordBlock(uint32_t firstAddress, uint32_t lastAddress, uint32_t nextAddress, bool branched)
+    {
+        // Block which doesn't continue the cut one was entered by an exception
+        if (m_hasPendingBlock && firstAddress != m_pendingNextAddress) {
+            closePendingBlock();
+        }
+        if (!m_hasPendingBlock) {
+            m_pendingFirstAddress = firstAddress;
+        }
+
+        m_pendingLastAddress = lastAddress;
+        m_pendingNextAddress = nextAddress;
+        m_hasPendingBlock = true;
+        if (branched) {
+            closePendingBlock();
+        }
+    }
+
+    inline auto map() const -> const Map& { return m_map; }
+
+    /**
+     * Clears counters before the next execution
+     */
+    void clear();
+
+    /**
+     * Records the block cut at the end of the execution and replaces hit counts with AFL buckets: 1, 2, 3, 4-7, 8-15, 16-31, 32-127, 128+
+     */
+    void classify();
+
+    /**
+     * Merges classified bitmap into the set of seen buckets
+     * @return number of edges or buckets which were not seen before
+     */
+    auto mergeInto(Map& seen) const -> uint32_t;
+
+    /**
+     * @return number of edges with non-zero counter
+     */
+    auto edgeCount() const -> uint32_t;
+
+private:
+    inline void closePendingBlock()
+    {
+        // Fibonacci hashing spreads halfword aligned addresses over the whole bitmap
+        const auto location = ((m_pendingFirstAddress ^ (m_pendingLastAddress * 0x85EBCA6Bu)) * 0x9E3779B1u) >> (32u - MapSizeLog2);
+        ++m_map[location ^ m_previousLocation];
+        m_previousLocation = location >> 1u;
+        m_hasPendingBlock = false;
+    }
+
+    Map m_map{};
+    uint32_t m_previousLocation = 0u;
+    uint32_t m_pendingFirstAddress = 0u;
+    uint32_t m_pendingLastAddress = 0u;
+    uint32_t m_pendingNextAddress = 0u;
+    bool m_hasPendingBlock = false;
+};
+
+}  // namespace stm32::debug
@@ -0,0 +1,198 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "elf_file.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <system_error>
+
+namespace stm32::debug
+{
+namespace
+{
+// see: System V ABI, ELF header and section header layouts
+constexpr uint32_t HeaderSize = 52u;
+constexpr uint32_t ProgramHeaderSize = 32u;
+constexpr uint32_t SectionHeaderSize = 40u;
+constexpr uint32_t SymbolSize = 16u;
+
+constexpr uint8_t ElfClass32 = 1u;
+constexpr uint8_t ElfDataLittleEndian = 1u;
+
+constexpr uint32_t SegmentTypeLoad = 1u;
+constexpr uint32_t SectionTypeSymbolTable = 2u;
+constexpr uint8_t SymbolTypeFunction = 2u;
+
+}  // namespace
+
+auto ElfFile::load(const std::string& path) -> ElfFile
+{
+    std::ifstream file{path, std::ios::binary};
+    if (!file) {
+        throw std::system_error{errno, std::generic_category(), path};
+    }
+
+    return ElfFile{std::vector<uint8_t>{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}}};
+}
+
+ElfFile::ElfFile(std::vector<uint8_t> data)
+    : m_data{std::move(data)}
+    , m_segments{}
+    , m_sections{}
+    , m_functions{}
+{
+    if (m_data.size() < HeaderSize || m_data[0] != 0x7Fu || m_data[1] != 'E' || m_data[2] != 'L' || m_data[3] != 'F') {
+        throw std::runtime_error{"not an ELF image"};
+    }
+    if (m_data[4] != ElfClass32 || m_data[5] != ElfDataLittleEndian) {
+        throw std::runtime_error{"only 32-bit little-endian ELF images are supported"};
+    }
+
+    const auto programHeaders = read32(0x1Cu);
+    const auto programHeaderCount = read16(0x2Cu);
+    for (uint32_t i = 0; i < programHeaderCount; ++i) {
+        const auto header = programHeaders + i * ProgramHeaderSize;
+        m_segments.push_back(Segment{
+            .type = read32(header),
+            .offset = read32(header + 0x4u),
+            .physicalAddress = read32(header + 0xCu),
+            .fileSize = read32(header + 0x10u),
+        });
+    }
+
+    const auto sectionHeaders = read32(0x20u);
+    const auto sectionCount = read16(0x30u);
+    const auto sectionNames = read16(0x32u);
+
+    for (uint32_t i = 0; i < sectionCount; ++i) {
+        const auto header = sectionHeaders + i * SectionHeaderSize;
+        m_sections.push_back(Section{
+            .name = {},
+            .type = read32(header + 0x4u),
+            .address = read32(header + 0xCu),
+            .offset = read32(header + 0x10u),
+            .size = read32(header + 0x14u),
+        });
+    }
+
+    if (sectionNames < m_sections.size()) {
+        const auto namesOffset = m_sections[sectionNames].offset;
+        for (uint32_t i = 0; i < sectionCount; ++i) {
+            m_sections[i].name = readString(namesOffset + read32(sectionHeaders + i * SectionHeaderSize));
+        }
+    }
+
+    for (uint32_t i = 0; i < sectionCount; ++i) {
+        const auto link = read32(sectionHeaders + i * SectionHeaderSize + 0x18u);
+        if (m_sections[i].type == SectionTypeSymbolTable && link < m_sections.size()) {
+            readSymbols(m_sections[i], m_sections[link]);
+        }
+    }
+
+    std::sort(m_functions.begin(), m_functions.end(), [](const Symbol& left, const Symbol& right) {
+        return left.address < right.address;
+    });
+}
+
+auto ElfFile::findFunction(uint32_t address) const -> const Symbol*
+{
+    auto it = std::upper_bound(m_functions.begin(), m_functions.end(), address, [](uint32_t value, const Symbol& symbol) {
+        return value < symbol.address;
+    });
+    if (it == m_functions.begin()) {
+        return nullptr;
+    }
+
+    --it;
+    return address - it->address < std::max(it->size, 1u) ? &*it : nullptr;
+}
+
+auto ElfFile::findFunction(std::string_view name) const -> const Symbol*
+{
+    const auto it = std::find_if(m_functions.begin(), m_functions.end(), [&](const Symbol& symbol) {
+        return symbol.name == name;
+    });
+    return it != m_functions.end() ? &*it : nullptr;
+}
+
+auto ElfFile::findSection(std::string_view name) const -> const Section*
+{
+    const auto it = std::find_if(m_sections.begin(), m_sections.end(), [&](const Section& section) {
+        return section.name == name;
+    });
+    return it != m_sections.end() ? &*it : nullptr;
+}
+
+auto ElfFile::sectionData(const Section& section) const -> std::span<const uint8_t>
+{
+    if (uint64_t{section.offset} + section.size > m_data.size()) {
+        throw std::runtime_error{"section " + section.name + " is out of file bounds"};
+    }
+    return std::span<const uint8_t>{m_data}.subspan(section.offset, section.size);
+}
+
+auto ElfFile::loadImage(uint32_t start, uint32_t end) const -> std::vector<uint8_t>
+{
+    std::vector<uint8_t> image;
+    for (const auto& segment : m_segments) {
+        if (segment.type != SegmentTypeLoad || segment.fileSize == 0u || segment.physicalAddress < start || segment.physicalAddress >= end) {
+            continue;
+        }
+        if (uint64_t{segment.offset} + segment.fileSize > m_data.size()) {
+            throw std::runtime_error{"segment is out of file bounds"};
+        }
+
+        const auto offset = segment.physicalAddress - start;
+        const auto size = std::min(segment.fileSize, end - segment.physicalAddress);
+        if (image.size() < offset + size) {
+            image.resize(offset + size, 0xFFu);
+        }
+        std::copy_n(m_data.begin() + segment.offset, size, image.begin() + offset);
+    }
+    return image;
+}
+
+auto ElfFile::read16(uint32_t offset) const -> uint16_t
+{
+    if (uint64_t{offset} + 2u > m_data.size()) {
+        throw std::runtime_error{"truncated ELF image"};
+    }
+    return static_cast<uint16_t>(m_data[offset] | (m_data[offset + 1u] << 8u));
+}
+
+auto ElfFile::read32(uint32_t offset) const -> uint32_t
+{
+    return static_cast<uint32_t>(read16(offset)) | (static_cast<uint32_t>(read16(offset + 2u)) << 16u);
+}
+
+auto ElfFile::readString(uint32_t offset) const -> std::string
+{
+    std::string result;
+    for (; offset < m_data.size() && m_data[offset] != 0u; ++offset) {
+        result.push_back(static_cast<char>(m_data[offset]));
+    }
+    return result;
+}
+
+void ElfFile::readSymbols(const Section& symbolTable, const Section& stringTable)
+{
+    for (uint32_t offset = 0; offset + SymbolSize <= symbolTable.size; offset += SymbolSize) {
+        const auto symbol = symbolTable.offset + offset;
+        const auto info = m_data.at(symbol + 0xCu);
+        if ((info & 0xFu) != SymbolTypeFunction) {
+            continue;
+        }
+
+        m_functions.push_back(Symbol{
+            .name = readString(stringTable.offset + read32(symbol)),
+            .address = read32(symbol + 0x4u) & ~0x1u,
+            .size = read32(symbol + 0x8u),
+        });
+    }
+}
+
+}  // namespace stm32::debug
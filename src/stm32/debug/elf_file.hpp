@@ -0,0 +1,81 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace stm32::debug
+{
+/**
+ * Read-only view of a 32-bit little-endian ELF image, used to resolve firmware symbols and debug sections
+ */
+class ElfFile {
+public:
+    struct Symbol {
+        std::string name;
+        uint32_t address;  ///< Thumb bit cleared
+        uint32_t size;
+    };
+
+    /**
+     * Program header, loadable segments are placed in memory at their physical (load) address
+     */
+    struct Segment {
+        uint32_t type;
+        uint32_t offset;
+        uint32_t physicalAddress;
+        uint32_t fileSize;
+    };
+
+    struct Section {
+        std::string name;
+        uint32_t type;
+        uint32_t address;
+        uint32_t offset;
+        uint32_t size;
+    };
+
+    /**
+     * @throws std::system_error if file can't be read, std::runtime_error if it is not a valid ELF32 image
+     */
+    static auto load(const std::string& path) -> ElfFile;
+
+    /**
+     * @throws std::runtime_error if data is not a valid ELF32 image
+     */
+    explicit ElfFile(std::vector<uint8_t> data);
+
+    /**
+     * Function symbols sorted by address
+     */
+    inline auto functions() const -> const std::vector<Symbol>& { return m_functions; }
+    inline auto sections() const -> const std::vector<Section>& { return m_sections; }
+    inline auto segments() const -> const std::vector<Segment>& { return m_segments; }
+
+    auto findFunction(uint32_t address) const -> const Symbol*;
+    auto findFunction(std::string_view name) const -> const Symbol*;
+    auto findSection(std::string_view name) const -> const Section*;
+    auto sectionData(const Section& section) const -> std::span<const uint8_t>;
+
+    /**
+     * Contents of loadable segments which start in [start, end), as a raw binary based at start. Gaps between
+     * segments read as erased flash.
+     * @throws std::runtime_error if a segment is out of file bounds
+     */
+    auto loadImage(uint32_t start, uint32_t end) const -> std::vector<uint8_t>;
+
+private:
+    auto read16(uint32_t offset) const -> uint16_t;
+    auto read32(uint32_t offset) const -> uint32_t;
+    auto readString(uint32_t offset) const -> std::string;
+    void readSymbols(const Section& symbolTable, const Section& stringTable);
+
+    std::vector<uint8_t> m_data;
+    std::vector<Segment> m_segments;
+    std::vector<Section> m_sections;
+    std::vector<Symbol> m_functions;
+};
+
+}  // namespace stm32::debug
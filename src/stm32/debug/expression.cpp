@@ -0,0 +1,503 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "expression.hpp"
+
+#include <array>
+#include <cctype>
+#include <stdexcept>
+
+#include "../cpu.hpp"
+
+namespace stm32::debug
+{
+namespace
+{
+enum class Register : uint32_t {
+    SP = 13u,
+    LR = 14u,
+    PC = 15u,
+    XPSR = 16u,
+};
+
+}  // namespace
+
+/**
+ * Recursive descent parser which emits bytecode while parsing
+ */
+class ExpressionCompiler {
+    using OpCode = Expression::OpCode;
+
+public:
+    explicit ExpressionCompiler(std::string_view source)
+        : m_source{source}
+        , m_code{}
+    {
+    }
+
+    auto compile() -> std::vector<Expression::Instruction>
+    {
+        parseLogicalOr();
+        skipSpaces();
+        if (m_position != m_source.size()) {
+            fail("unexpected character");
+        }
+        return std::move(m_code);
+    }
+
+private:
+    struct BinaryOperator {
+        std::string_view token;
+        OpCode op;
+    };
+
+    [[noreturn]] void fail(const char* what) const
+    {
+        throw std::invalid_argument{std::string{what} + " at position " + std::to_string(m_position) + " in '" + std::string{m_source} + "'"};
+    }
+
+    void skipSpaces()
+    {
+        while (m_position < m_source.size() && std::isspace(static_cast<unsigned char>(m_source[m_position])) != 0) {
+            ++m_position;
+        }
+    }
+
+    auto accept(std::string_view token) -> bool
+    {
+        skipSpaces();
+        if (m_source.substr(m_position, token.size()) != token) {
+            return false;
+        }
+
+        // do not split longer operators, e.g. '<' must not match '<<' or '<='
+        const auto next = m_position + token.size();
+        if (token.size() == 1u && next < m_source.size() && !std::isalnum(static_cast<unsigned char>(token[0]))) {
+            const auto pair = std::string{token[0], m_source[next]};
+            if (pair == "<<" || pair == ">>" || pair == "<=" || pair == ">=" || pair == "==" || pair == "!=" || pair == "&&" ||
+                pair == "||") {
+                return false;
+            }
+        }
+
+        m_position = next;
+        return true;
+    }
+
+    void expect(std::string_view token)
+    {
+        if (!accept(token)) {
+            fail("expected token");
+        }
+    }
+
+    void emit(OpCode op, uint32_t operand = 0u)
+    {
+        switch (op) {
+            case OpCode::Constant:
+            case OpCode::Register:
+            case OpCode::Hits:
+                ++m_depth;
+                break;
+            case OpCode::Multiply:
+            case OpCode::Divide:
+            case OpCode::Modulo:
+            case OpCode::Add:
+            case OpCode::Subtract:
+            case OpCode::ShiftLeft:
+            case OpCode::ShiftRight:
+            case OpCode::BitwiseAnd:
+            case OpCode::BitwiseXor:
+            case OpCode::BitwiseOr:
+            case OpCode::Equal:
+            case OpCode::NotEqual:
+            case OpCode::Less:
+            case OpCode::LessEqual:
+            case OpCode::Greater:
+            case OpCode::GreaterEqual:
+            case OpCode::JumpIfFalse:
+            case OpCode::JumpIfTrue:
+                --m_depth;
+                break;
+            default:
+                break;
+        }
+
+        if (m_depth > Expression::MaxStackDepth) {
+            fail("expression is too complex");
+        }
+        m_code.push_back(Expression::Instruction{.op = op, .operand = operand});
+    }
+
+    void parseLogical(std::string_view token, OpCode jump, void (ExpressionCompiler::*parseOperand)())
+    {
+        (this->*parseOperand)();
+        while (accept(token)) {
+            const auto jumpIndex = m_code.size();
+            emit(jump);
+            (this->*parseOperand)();
+            emit(OpCode::ToBool);
+            m_code[jumpIndex].operand = static_cast<uint32_t>(m_code.size());
+        }
+    }
+
+    void parseLogicalOr() { parseLogical("||", OpCode::JumpIfTrue, &ExpressionCompiler::parseLogicalAnd); }
+
+    void parseLogicalAnd() { parseLogical("&&", OpCode::JumpIfFalse, &ExpressionCompiler::parseComparison); }
+
+    template <size_t N>
+    void parseBinary(const std::array<BinaryOperator, N>& operators, void (ExpressionCompiler::*parseOperand)(), bool repeated = true)
+    {
+        (this->*parseOperand)();
+        for (auto matched = true; matched;) {
+            matched = false;
+            for (const auto& binaryOperator : operators) {
+                if (accept(binaryOperator.token)) {
+                    (this->*parseOperand)();
+                    emit(binaryOperator.op);
+                    matched = repeated;
+                    break;
+                }
+            }
+        }
+    }
+
+    void parseComparison()
+    {
+        static constexpr std::array<BinaryOperator, 6> Operators = {{
+            {"==", OpCode::Equal},
+            {"!=", OpCode::NotEqual},
+            {"<=", OpCode::LessEqual},
+            {">=", OpCode::GreaterEqual},
+            {"<", OpCode::Less},
+            {">", OpCode::Greater},
+        }};
+        parseBinary(Operators, &ExpressionCompiler::parseBitwiseOr, false);
+    }
+
+    void parseBitwiseOr()
+    {
+        static constexpr std::array<BinaryOperator, 1> Operators = {{{"|", OpCode::BitwiseOr}}};
+        parseBinary(Operators, &ExpressionCompiler::parseBitwiseXor);
+    }
+
+    void parseBitwiseXor()
+    {
+        static constexpr std::array<BinaryOperator, 1> Operators = {{{"^", OpCode::BitwiseXor}}};
+        parseBinary(Operators, &ExpressionCompiler::parseBitwiseAnd);
+    }
+
+    void parseBitwiseAnd()
+    {
+        static constexpr std::array<BinaryOperator, 1> Operators = {{{"&", OpCode::BitwiseAnd}}};
+        parseBinary(Operators, &ExpressionCompiler::parseShift);
+    }
+
+    void parseShift()
+    {
+        static constexpr std::array<BinaryOperator, 2> Operators = {{{"<<", OpCode::ShiftLeft}, {">>", OpCode::ShiftRight}}};
+        parseBinary(Operators, &ExpressionCompiler::parseAdditive);
+    }
+
+    void parseAdditive()
+    {
+        static constexpr std::array<BinaryOperator, 2> Operators = {{{"+", OpCode::Add}, {"-", OpCode::Subtract}}};
+        parseBinary(Operators, &ExpressionCompiler::parseMultiplicative);
+    }
+
+    void parseMultiplicative()
+    {
+        static constexpr std::array<BinaryOperator, 3> Operators = {{
+            {"*", OpCode::Multiply},
+            {"/", OpCode::Divide},
+            {"%", OpCode::Modulo},
+        }};
+        parseBinary(Operators, &ExpressionCompiler::parseUnary);
+    }
+
+    void parseUnary()
+    {
+        if (accept("-")) {
+            parseUnary();
+            emit(OpCode::Negate);
+        }
+        else if (accept("!")) {
+            parseUnary();
+            emit(OpCode::LogicalNot);
+        }
+        else if (accept("~")) {
+            parseUnary();
+            emit(OpCode::BitwiseNot);
+        }
+        else {
+            parsePrimary();
+        }
+    }
+
+    void parseLoad(OpCode load)
+    {
+        expect("[");
+        parseLogicalOr();
+        expect("]");
+        emit(load);
+    }
+
+    void parsePrimary()
+    {
+        skipSpaces();
+        if (m_position == m_source.size()) {
+            fail("unexpected end of expression");
+        }
+
+        if (accept("(")) {
+            parseLogicalOr();
+            expect(")");
+            return;
+        }
+        if (m_source[m_position] == '[') {
+            parseLoad(OpCode::Load32);
+            return;
+        }
+        if (std::isdigit(static_cast<unsigned char>(m_source[m_position])) != 0) {
+            emit(OpCode::Constant, parseNumber());
+            return;
+        }
+
+        const auto begin = m_position;
+        while (m_position < m_source.size() && std::isalnum(static_cast<unsigned char>(m_source[m_position])) != 0) {
+            ++m_position;
+        }
+        auto name = std::string{m_source.substr(begin, m_position - begin)};
+        for (auto& c : name) {
+            c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+        }
+
+        if (name == "mem8") {
+            parseLoad(OpCode::Load8);
+        }
+        else if (name == "mem16") {
+            parseLoad(OpCode::Load16);
+        }
+        else if (name == "mem32") {
+            parseLoad(OpCode::Load32);
+        }
+        else if (name == "hits") {
+            emit(OpCode::Hits);
+        }
+        else if (name == "sp") {
+            emit(OpCode::Register, static_cast<uint32_t>(Register::SP));
+        }
+        else if (name == "lr") {
+            emit(OpCode::Register, static_cast<uint32_t>(Register::LR));
+        }
+        else if (name == "pc") {
+            emit(OpCode::Register, static_cast<uint32_t>(Register::PC));
+        }
+        else if (name == "xpsr") {
+            emit(OpCode::Register, static_cast<uint32_t>(Register::XPSR));
+        }
+        else if (name.size() >= 2u && name.size() <= 3u && name[0] == 'r' && std::isdigit(static_cast<unsigned char>(name[1])) != 0 &&
+                 std::isdigit(static_cast<unsigned char>(name.back())) != 0 && std::stoul(name.substr(1u)) <= 15u) {
+            emit(OpCode::Register, static_cast<uint32_t>(std::stoul(name.substr(1u))));
+        }
+        else {
+            m_position = begin;
+            fail("unknown identifier");
+        }
+    }
+
+    auto parseNumber() -> uint32_t
+    {
+        auto base = 10u;
+        if (m_source.substr(m_position, 2u) == "0x" || m_source.substr(m_position, 2u) == "0X") {
+            base = 16u;
+            m_position += 2u;
+        }
+        else if (m_source.substr(m_position, 2u) == "0b" || m_source.substr(m_position, 2u) == "0B") {
+            base = 2u;
+            m_position += 2u;
+        }
+
+        uint64_t value = 0u;
+        auto digits = 0u;
+        for (; m_position < m_source.size(); ++m_position) {
+            const auto c = static_cast<unsigned char>(std::tolower(static_cast<unsigned char>(m_source[m_position])));
+            if (c == '_') {
+                continue;
+            }
+
+            auto digit = base;
+            if (std::isdigit(c) != 0) {
+                digit = static_cast<uint32_t>(c - '0');
+            }
+            else if (c >= 'a' && c <= 'f') {
+                digit = static_cast<uint32_t>(c - 'a' + 10);
+            }
+            if (digit >= base) {
+                break;
+            }
+
+            value = value * base + digit;
+            if (value > UINT32_MAX) {
+                fail("number is too large");
+            }
+            ++digits;
+        }
+
+        if (digits == 0u) {
+            fail("invalid number");
+        }
+        return static_cast<uint32_t>(value);
+    }
+
+    std::string_view m_source;
+    size_t m_position = 0u;
+    size_t m_depth = 0u;
+    std::vector<Expression::Instruction> m_code;
+};
+
+Expression::Expression()
+    : m_source{}
+    , m_code{}
+{
+}
+
+auto Expression::compile(std::string_view source) -> Expression
+{
+    auto expression = Expression{};
+    expression.m_code = ExpressionCompiler{source}.compile();
+    expression.m_source = std::string{source};
+    return expression;
+}
+
+auto Expression::evaluate(Cpu& cpu, uint32_t hits) const -> uint32_t
+{
+    std::array<uint32_t, MaxStackDepth> stack;
+    size_t top = 0u;
+
+    const auto binary = [&](auto operation) {
+        --top;
+        stack[top - 1u] = static_cast<uint32_t>(operation(stack[top - 1u], stack[top]));
+    };
+
+    for (size_t pc = 0u; pc < m_code.size(); ++pc) {
+        const auto& instruction = m_code[pc];
+        switch (instruction.op) {
+            case OpCode::Constant:
+                stack[top++] = instruction.operand;
+                break;
+            case OpCode::Register:
+                switch (static_cast<Register>(instruction.operand)) {
+                    case Register::SP:
+                        stack[top++] = cpu.registers().SP();
+                        break;
+                    case Register::LR:
+                        stack[top++] = cpu.registers().LR();
+                        break;
+                    case Register::PC:
+                        stack[top++] = cpu.registers().PC();
+                        break;
+                    case Register::XPSR:
+                        stack[top++] = cpu.registers().xPSR();
+                        break;
+                    default:
+                        stack[top++] = cpu.R(static_cast<uint8_t>(instruction.operand));
+                        break;
+                }
+                break;
+            case OpCode::Hits:
+                stack[top++] = hits;
+                break;
+            case OpCode::Load8:
+                stack[top - 1u] = cpu.memory().read<uint8_t>(stack[top - 1u]);
+                break;
+            case OpCode::Load16:
+                stack[top - 1u] = cpu.memory().read<uint16_t>(stack[top - 1u]);
+                break;
+            case OpCode::Load32:
+                stack[top - 1u] = cpu.memory().read<uint32_t>(stack[top - 1u]);
+                break;
+            case OpCode::Negate:
+                stack[top - 1u] = 0u - stack[top - 1u];
+                break;
+            case OpCode::LogicalNot:
+                stack[top - 1u] = stack[top - 1u] == 0u ? 1u : 0u;
+                break;
+            case OpCode::BitwiseNot:
+                stack[top - 1u] = ~stack[top - 1u];
+                break;
+            case OpCode::Multiply:
+                binary([](uint32_t a, uint32_t b) { return a * b; });
+                break;
+            case OpCode::Divide:
+                binary([](uint32_t a, uint32_t b) { return b == 0u ? 0u : a / b; });
+                break;
+            case OpCode::Modulo:
+                binary([](uint32_t a, uint32_t b) { return b == 0u ? 0u : a % b; });
+                break;
+            case OpCode::Add:
+                binary([](uint32_t a, uint32_t b) { return a + b; });
+                break;
+            case OpCode::Subtract:
+                binary([](uint32_t a, uint32_t b) { return a - b; });
+                break;
+            case OpCode::ShiftLeft:
+                binary([](uint32_t a, uint32_t b) { return b >= 32u ? 0u : a << b; });
+                break;
+            case OpCode::ShiftRight:
+                binary([](uint32_t a, uint32_t b) { return b >= 32u ? 0u : a >> b; });
+                break;
+            case OpCode::BitwiseAnd:
+                binary([](uint32_t a, uint32_t b) { return a & b; });
+                break;
+            case OpCode::BitwiseXor:
+                binary([](uint32_t a, uint32_t b) { return a ^ b; });
+                break;
+            case OpCode::BitwiseOr:
+                binary([](uint32_t a, uint32_t b) { return a | b; });
+                break;
+            case OpCode::Equal:
+                binary([](uint32_t a, uint32_t b) { return a == b; });
+                break;
+            case OpCode::NotEqual:
+                binary([](uint32_t a, uint32_t b) { return a != b; });
+                break;
+            case OpCode::Less:
+                binary([](uint32_t a, uint32_t b) { return a < b; });
+                break;
+            case OpCode::LessEqual:
+                binary([](uint32_t a, uint32_t b) { return a <= b; });
+                break;
+            case OpCode::Greater:
+                binary([](uint32_t a, uint32_t b) { return a > b; });
+                break;
+            case OpCode::GreaterEqual:
+                binary([](uint32_t a, uint32_t b) { return a >= b; });
+                break;
+            case OpCode::JumpIfFalse:
+                if (stack[top - 1u] == 0u) {
+                    pc = instruction.operand - 1u;
+                }
+                else {
+                    --top;
+                }
+                break;
+            case OpCode::JumpIfTrue:
+                if (stack[top - 1u] != 0u) {
+                    stack[top - 1u] = 1u;
+                    pc = instruction.operand - 1u;
+                }
+                else {
+                    --top;
+                }
+                break;
+            case OpCode::ToBool:
+                stack[top - 1u] = stack[top - 1u] != 0u ? 1u : 0u;
+                break;
+        }
+    }
+
+    return top != 0u ? stack[top - 1u] : 0u;
+}
+
+}  // namespace stm32::debug
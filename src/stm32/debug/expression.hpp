@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace stm32
+{
+class Cpu;
+}  // namespace stm32
+
+namespace stm32::debug
+{
+/**
+ * Debugger expression compiled into stack machine bytecode
+ *
+ * @par Syntax
+ *
+ * Operands:    decimal, 0x hexadecimal and 0b binary literals with optional '_' separators,
+ *              r0 - r15, sp, lr, pc, xpsr, hits (hit count of the breakpoint, including current one),
+ *              [address] or mem32[address], mem16[address], mem8[address]
+ * Operators:   unary - ! ~, binary * / % + - << >> & ^ | == != < <= > >= && ||, with C precedence
+ *
+ * All arithmetic is unsigned 32-bit, division by zero gives zero. Memory is read directly, without the MPU and
+ * watchpoint checks which apply to the core accesses.
+ */
+class Expression {
+public:
+    explicit Expression();
+
+    /**
+     * Compiles source once
+     * @throws std::invalid_argument on syntax error
+     */
+    static auto compile(std::string_view source) -> Expression;
+
+    auto evaluate(Cpu& cpu, uint32_t hits) const -> uint32_t;
+
+    inline auto empty() const -> bool { return m_code.empty(); }
+    inline auto source() const -> const std::string& { return m_source; }
+
+private:
+    friend class ExpressionCompiler;
+
+    enum class OpCode : uint8_t {
+        Constant,
+        Register,
+        Hits,
+        Load8,
+        Load16,
+        Load32,
+        Negate,
+        LogicalNot,
+        BitwiseNot,
+        Multiply,
+        Divide,
+        Modulo,
+        Add,
+        Subtract,
+        ShiftLeft,
+        ShiftRight,
+        BitwiseAnd,
+        BitwiseXor,
+        BitwiseOr,
+        Equal,
+        NotEqual,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual,
+        JumpIfFalse,  ///< keeps false operand and jumps, otherwise drops it
+        JumpIfTrue,   ///< replaces true operand with one and jumps, otherwise drops it
+        ToBool,
+    };
+
+    struct Instruction {
+        OpCode op;
+        uint32_t operand;
+    };
+
+    static constexpr size_t MaxStackDepth = 32u;
+
+    std::string m_source;
+    std::vector<Instruction> m_code;
+};
+
+}  // namespace stm32::debug
@@ -0,0 +1,126 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "fpb.hpp"
+
+#include "../utils/math.hpp"
+
+namespace stm32::debug
+{
+using namespace utils;
+
+namespace
+{
+enum RegisterOffset : uint32_t {
+    FP_CTRL = 0x000u,
+    FP_REMAP = 0x004u,
+    FP_COMP0 = 0x008u,
+    PeripheralIdStart = 0xFD0u,
+};
+
+// PID4 - PID7, PID0 - PID3, CID0 - CID3
+constexpr std::array<uint32_t, 12> IdentificationRegisters = {
+    0x04u, 0x00u, 0x00u, 0x00u, 0x03u, 0xB0u, 0x2Bu, 0x00u, 0x0Du, 0xE0u, 0x05u, 0xB1u,
+};
+
+}  // namespace
+
+Fpb::Fpb(Breakpoints& breakpoints)
+    : MemoryRegion{Memory::FpbStart, Memory::FpbEnd}
+    , m_breakpoints{breakpoints}
+    , m_comparators{}
+    , m_installed{}
+{
+}
+
+void Fpb::write(uint32_t address, uint8_t data)
+{
+    const auto offset = address - Memory::FpbStart;
+    const auto registerOffset = offset & ~0x3u;
+    const auto shift = (offset & 0x3u) * 8u;
+    const auto mask = 0xFFu << shift;
+
+    if (registerOffset == FP_CTRL) {
+        // see: C1.11.3, ENABLE is written only together with KEY
+        m_controlWrite = (m_controlWrite & ~mask) | (static_cast<uint32_t>(data) << shift);
+        if (shift == 0u && isBitSet<1>(m_controlWrite)) {
+            m_enabled = isBitSet<0>(m_controlWrite);
+        }
+    }
+    else if (registerOffset >= FP_COMP0 && registerOffset < FP_COMP0 + 4u * m_comparators.size()) {
+        auto& comparator = m_comparators[(registerOffset - FP_COMP0) / 4u];
+        comparator = (comparator & ~mask) | (static_cast<uint32_t>(data) << shift);
+    }
+    else {
+        return;
+    }
+
+    updateBreakpoints();
+}
+
+auto Fpb::read(uint32_t address) -> uint8_t
+{
+    const auto offset = address - Memory::FpbStart;
+    return static_cast<uint8_t>(readRegister(offset & ~0x3u) >> ((offset & 0x3u) * 8u));
+}
+
+void Fpb::reset()
+{
+    m_enabled = false;
+    m_comparators.fill(0u);
+    m_controlWrite = 0u;
+    updateBreakpoints();
+}
+
+auto Fpb::readRegister(uint32_t offset) const -> uint32_t
+{
+    if (offset == FP_CTRL) {
+        // NUM_CODE1 [7:4], NUM_LIT [11:8], KEY reads as zero
+        return static_cast<uint32_t>(m_enabled) | (CodeComparatorCount << 4u) | (LiteralComparatorCount << 8u);
+    }
+    if (offset == FP_REMAP) {
+        return 0u;
+    }
+    if (offset >= FP_COMP0 && offset < FP_COMP0 + 4u * m_comparators.size()) {
+        return m_comparators[(offset - FP_COMP0) / 4u];
+    }
+    if (offset >= PeripheralIdStart && offset - PeripheralIdStart < 4u * IdentificationRegisters.size()) {
+        return IdentificationRegisters[(offset - PeripheralIdStart) / 4u];
+    }
+    return 0u;
+}
+
+void Fpb::updateBreakpoints()
+{
+    for (const auto address : m_installed) {
+        m_breakpoints.remove(address);
+    }
+    m_installed.clear();
+
+    if (!m_enabled) {
+        return;
+    }
+
+    // see: C1.11.5, literal comparators can only remap, so they never generate breakpoints
+    for (uint32_t i = 0; i < CodeComparatorCount; ++i) {
+        const auto comparator = m_comparators[i];
+        if (!isBitSet<0>(comparator)) {
+            continue;
+        }
+
+        const auto base = comparator & 0x1FFFFFFCu;
+        const auto replace = getPart<30, 2>(comparator);
+        if (isBitSet<0>(replace)) {
+            m_installed.push_back(base);
+        }
+        if (isBitSet<1>(replace)) {
+            m_installed.push_back(base + 2u);
+        }
+    }
+
+    for (const auto address : m_installed) {
+        m_breakpoints.add(address);
+    }
+}
+
+}  // namespace stm32::debug
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "../memory.hpp"
+#include "breakpoints.hpp"
+
+namespace stm32::debug
+{
+/**
+ * Flash Patch and Breakpoint unit
+ *
+ * Enabled instruction comparators with a breakpoint REPLACE value are installed into the core breakpoint bitmap, so
+ * firmware-visible hardware breakpoints stop the run loop the same way as debugger breakpoints do. The core is treated
+ * as halted by an attached debugger, so a match never escalates to DebugMonitor or HardFault. Flash patch remapping is
+ * not supported (FP_REMAP.RMPSPT is zero).
+ *
+ * @par Register map (see C1.11)
+ *
+ * 0xE0002000: FP_CTRL
+ * 0xE0002004: FP_REMAP
+ * 0xE0002008 - 0xE0002024: FP_COMP0 - FP_COMP7, six instruction and two literal comparators
+ * 0xE0002FD0 - 0xE0002FFC: Peripheral and component identification registers
+ */
+class Fpb final : public MemoryRegion {
+public:
+    static constexpr uint32_t CodeComparatorCount = 6u;
+    static constexpr uint32_t LiteralComparatorCount = 2u;
+
+    explicit Fpb(Breakpoints& breakpoints);
+
+    void write(uint32_t address, uint8_t data) override;
+    auto read(uint32_t address) -> uint8_t override;
+
+    void reset();
+
+    inline auto isEnabled() const -> bool { return m_enabled; }
+
+private:
+    auto readRegister(uint32_t offset) const -> uint32_t;
+    void updateBreakpoints();
+
+    Breakpoints& m_breakpoints;
+
+    bool m_enabled = false;
+    std::array<uint32_t, CodeComparatorCount + LiteralComparatorCount> m_comparators;
+    uint32_t m_controlWrite = 0u;
+
+    std::vector<uint32_t> m_installed;
+};
+
+}  // namespace stm32::debug
@@ -0,0 +1,154 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "fuzz_harness.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "../utils/exceptions.hpp"
+#include "semihosting.hpp"
+
+namespace stm32::debug
+{
+FuzzHarness::FuzzHarness(Cpu& cpu, Config config)
+    : m_cpu{cpu}
+    , m_config{config}
+    , m_coverage{}
+{
+    const auto entry = m_config.entryAddress & ~uint32_t{0x1u};
+
+    m_cpu.reset();
+    m_cpu.breakpoints().add(entry);
+    const auto startCycles = m_cpu.cycles();
+    auto reason = StopReason::CycleLimit;
+    while (m_cpu.cycles() - startCycles < m_config.startupCycles) {
+        reason = m_cpu.run(m_config.startupCycles - (m_cpu.cycles() - startCycles));
+        if (reason == StopReason::Breakpoint && m_cpu.registers().PC() == entry) {
+            break;
+        }
+    }
+    m_cpu.breakpoints().remove(entry);
+
+    if (reason != StopReason::Breakpoint || m_cpu.registers().PC() != entry) {
+        throw std::runtime_error{"fuzzing entry is not reached"};
+    }
+
+    // Recursive calls return to the entry function, only the outermost return reaches the fake address
+    m_returnAddress = m_cpu.registers().LR() & ~uint32_t{0x1u};
+    m_cpu.registers().LR() = ReturnAddress | 0x1u;
+    m_snapshot = m_cpu.snapshot();
+
+    m_cpu.setEdgeCoverage(&m_coverage);
+    if (m_config.inputTarget == InputTarget::Peripheral) {
+        m_cpu.setInputEventHandler([this](const InputEvent& event) { receiveByte(event); });
+    }
+}
+
+FuzzHarness::~FuzzHarness()
+{
+    if (m_cpu.edgeCoverage() == &m_coverage) {
+        m_cpu.setEdgeCoverage(nullptr);
+    }
+    if (m_config.inputTarget == InputTarget::Peripheral) {
+        m_cpu.setInputEventHandler(nullptr);
+    }
+}
+
+auto FuzzHarness::execute(std::span<const uint8_t> input) -> Result
+{
+    m_cpu.restore(m_snapshot);
+    m_coverage.clear();
+    injectInput(input.first(std::min<size_t>(input.size(), m_config.maxInputSize)));
+
+    const auto startCycles = m_cpu.cycles();
+    const auto outcome = runToReturn();
+
+    m_coverage.classify();
+    ++m_executions;
+
+    return Result{
+        .outcome = outcome,
+        .cycles = m_cpu.cycles() - startCycles,
+        .address = outcome == Outcome::Fault          ? m_cpu.currentInstructionAddress()
+                   : m_cpu.registers().PC() == ReturnAddress ? m_returnAddress
+                                                             : m_cpu.registers().PC(),
+        .newCoverage = m_coverage.mergeInto(m_seenCoverage),
+    };
+}
+
+void FuzzHarness::injectInput(std::span<const uint8_t> input)
+{
+    switch (m_config.inputTarget) {
+        case InputTarget::Memory:
+            for (uint32_t i = 0; i < input.size(); ++i) {
+                m_cpu.memory().write<uint8_t>(m_config.inputAddress + i, input[i]);
+            }
+            m_cpu.setR(0u, m_config.inputAddress);
+            m_cpu.setR(1u, static_cast<uint32_t>(input.size()));
+            break;
+        case InputTarget::Peripheral:
+            m_receivedBytes = 0u;
+            m_cpu.memory().write<uint32_t>(m_config.inputAddress, 0u);
+            for (uint32_t i = 0; i < input.size(); ++i) {
+                m_cpu.scheduleInputEvent(InputEvent{
+                    .timestamp = m_cpu.cycles() + (i + 1u) * m_config.byteCycles,
+                    .type = InputEventType::PeripheralInput,
+                    .channel = m_config.inputChannel,
+                    .data = input[i],
+                });
+            }
+            break;
+    }
+}
+
+void FuzzHarness::receiveByte(const InputEvent& event)
+{
+    if (event.channel != m_config.inputChannel) {
+        return;
+    }
+
+    // Count is kept by the host, so the firmware can't redirect the writes by corrupting it
+    m_cpu.memory().write<uint8_t>(m_config.inputAddress + 4u + m_receivedBytes, static_cast<uint8_t>(event.data));
+    m_cpu.memory().write<uint32_t>(m_config.inputAddress, ++m_receivedBytes);
+}
+
+auto FuzzHarness::runToReturn() -> Outcome
+{
+    const auto startCycles = m_cpu.cycles();
+
+    try {
+        while (m_cpu.cycles() - startCycles < m_config.cycleBudget) {
+            switch (m_cpu.run(m_config.cycleBudget - (m_cpu.cycles() - startCycles))) {
+                case StopReason::Breakpoint:
+                    // Comparators armed by the firmware itself, the next run resumes past them
+                    break;
+                case StopReason::Watchpoint:
+                    m_cpu.watchpoints().takeHit();
+                    break;
+                case StopReason::StackOverflow:
+                    m_cpu.stackMonitor().takeOverflow();
+                    return Outcome::Fault;
+                case StopReason::Exit:
+                    // Target which exits with a failure status is treated as crashed
+                    return m_cpu.semihosting()->takeExit().value_or(1) == 0 ? Outcome::Returned : Outcome::Fault;
+                case StopReason::CycleLimit:
+                case StopReason::StopRequested:
+                    return Outcome::Timeout;
+            }
+        }
+    }
+    catch (const utils::CpuException&) {
+        return m_cpu.registers().PC() == ReturnAddress ? Outcome::Returned : Outcome::Fault;
+    }
+    catch (const utils::UndefinedException&) {
+        return Outcome::Fault;
+    }
+    catch (const utils::UnpredictableException&) {
+        return Outcome::Fault;
+    }
+
+    return Outcome::Timeout;
+}
+
+}  // namespace stm32::debug
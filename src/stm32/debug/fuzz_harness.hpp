@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+#include "../cpu.hpp"
+#include "edge_coverage.hpp"
+
+namespace stm32::debug
+{
+/**
+ * In-process fuzzing target
+ *
+ * Firmware is run from reset to the entry function once and the machine is snapshotted there. Every execution
+ * restores the snapshot, which copies back only the memory pages written by the previous execution, injects the input
+ * and runs until the entry function returns, the core faults or the cycle budget is exhausted. Edges between executed
+ * blocks are collected by the run loop into an AFL-style bitmap.
+ *
+ * Input is either copied into a RAM buffer, with its address and size passed in r0 and r1 as to
+ * parse(const uint8_t*, size_t), or delivered to a peripheral channel one byte per input event, as from a UART RX FIFO.
+ * Peripheral bytes are appended to the receive buffer at inputAddress + 4 and the word at inputAddress counts the
+ * received bytes, so the firmware polls the count as the FIFO level. The entry must be reached by a regular call. Its
+ * return address is replaced with an execute-never system address, so the return is detected by the fetch fault there
+ * and executions stay on the fast path without breakpoints.
+ */
+class FuzzHarness {
+    RESTRICT_COPY(FuzzHarness);
+
+public:
+    static constexpr uint32_t ReturnAddress = 0xEFFFFFFEu;  ///< outside of the EXC_RETURN range in handler mode too
+
+    enum class InputTarget : uint8_t {
+        Memory,
+        Peripheral,
+    };
+
+    enum class Outcome : uint8_t {
+        Returned,
+        Fault,
+        Timeout,
+    };
+
+    struct Config {
+        uint32_t entryAddress;    ///< function which receives the input, Thumb bit is ignored
+        InputTarget inputTarget;  ///< where the input is injected
+        uint32_t inputAddress;    ///< RAM buffer for memory input or receive FIFO for peripheral input
+        uint32_t maxInputSize;    ///< longer inputs are truncated
+        uint16_t inputChannel;    ///< peripheral channel for peripheral input
+        uint64_t byteCycles;      ///< cycles between peripheral input bytes
+        uint64_t startupCycles;   ///< budget for reaching the entry from reset
+        uint64_t cycleBudget;     ///< budget of one execution
+    };
+
+    struct Result {
+        Outcome outcome;
+        uint64_t cycles;       ///< cycles spent by the execution
+        uint32_t address;      ///< instruction which faulted, where the execution stopped or the caller it returned to
+        uint32_t newCoverage;  ///< edges and hit count buckets seen for the first time
+    };
+
+    /**
+     * Resets the core and runs it to the entry
+     * @throws std::runtime_error if the entry isn't reached within the startup budget
+     */
+    explicit FuzzHarness(Cpu& cpu, Config config);
+    ~FuzzHarness();
+
+    auto execute(std::span<const uint8_t> input) -> Result;
+
+    /**
+     * Classified edges of the last execution
+     */
+    inline auto coverage() const -> const EdgeCoverage& { return m_coverage; }
+
+    /**
+     * Union of classified edges of all executions
+     */
+    inline auto seenCoverage() const -> const EdgeCoverage::Map& { return m_seenCoverage; }
+
+    inline auto executions() const -> uint64_t { return m_executions; }
+    inline auto config() const -> const Config& { return m_config; }
+
+private:
+    void injectInput(std::span<const uint8_t> input);
+    void receiveByte(const InputEvent& event);
+    auto runToReturn() -> Outcome;
+
+    Cpu& m_cpu;
+    Config m_config;
+
+    EdgeCoverage m_coverage;
+    EdgeCoverage::Map m_seenCoverage{};
+
+    Cpu::Snapshot m_snapshot = Cpu::Snapshot{};
+    uint32_t m_returnAddress = 0u;
+    uint64_t m_executions = 0u;
+    uint32_t m_receivedBytes = 0u;
+};
+
+}  // namespace stm32::debug
@@ -0,0 +1,128 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "heatmap.hpp"
+
+#include <cinttypes>
+#include <cstdio>
+
+namespace stm32::debug
+{
+namespace
+{
+void writeLittleEndian(std::ostream& output, uint32_t value)
+{
+    const char bytes[] = {
+        static_cast<char>(value),
+        static_cast<char>(value >> 8u),
+        static_cast<char>(value >> 16u),
+        static_cast<char>(value >> 24u),
+    };
+    output.write(bytes, sizeof(bytes));
+}
+
+}  // namespace
+
+Heatmap::Heatmap(const Memory::Config& config)
+    : m_regions{}
+    , m_counters{}
+{
+    addRegion(config.flashMemoryStart, config.flashMemoryEnd, false);
+    addRegion(config.systemMemoryStart, config.systemMemoryEnd, false);
+    addRegion(config.optionBytesStart, config.optionBytesEnd, false);
+    addRegion(config.sramStart, config.sramEnd, false);
+
+    // boot memory is aliased at zero and shares counters with the original region
+    const auto& boot = config.bootMode == BootMode::FlashMemory ? m_regions[0] : m_regions[1];
+    m_regions.push_back(Region{
+        .start = 0u,
+        .end = boot.end - boot.start,
+        .firstLine = boot.firstLine,
+        .isAlias = true,
+    });
+}
+
+void Heatmap::addRegion(uint32_t start, uint32_t end, bool isAlias)
+{
+    const auto firstLine = static_cast<uint32_t>(m_counters.size());
+    m_counters.resize(m_counters.size() + ((end - start + LineSize - 1u) >> LineShift));
+    m_regions.push_back(Region{
+        .start = start,
+        .end = end,
+        .firstLine = firstLine,
+        .isAlias = isAlias,
+    });
+}
+
+void Heatmap::recordFetch(uint32_t first, uint32_t next)
+{
+    auto address = first;
+    while (address < next) {
+        const auto line = findLine(address);
+        const auto lineEnd = (address | (LineSize - 1u)) + 1u;
+        const auto end = lineEnd < next && lineEnd != 0u ? lineEnd : next;
+        if (line != NoLine) {
+            m_counters[line].fetches += (end - address + 1u) / 2u;
+        }
+        address = end;
+    }
+}
+
+auto Heatmap::counters(uint32_t address) const -> const Counters*
+{
+    const auto line = findLine(address);
+    return line != NoLine ? &m_counters[line] : nullptr;
+}
+
+void Heatmap::clear()
+{
+    std::fill(m_counters.begin(), m_counters.end(), Counters{});
+}
+
+void Heatmap::writeCsv(std::ostream& output) const
+{
+    output << "address,reads,writes,fetches\n";
+
+    char row[64];
+    for (const auto& region : m_regions) {
+        if (region.isAlias) {
+            continue;
+        }
+
+        for (uint32_t address = region.start; address < region.end; address += LineSize) {
+            const auto& counters = m_counters[region.firstLine + ((address - region.start) >> LineShift)];
+            if (counters.reads == 0u && counters.writes == 0u && counters.fetches == 0u) {
+                continue;
+            }
+
+            std::snprintf(row,
+                          sizeof(row),
+                          "0x%08" PRIx32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 "\n",
+                          address,
+                          counters.reads,
+                          counters.writes,
+                          counters.fetches);
+            output << row;
+        }
+    }
+}
+
+void Heatmap::writeBinary(std::ostream& output) const
+{
+    const auto regionCount = static_cast<uint32_t>(m_regions.size() - 1u);
+
+    output.write("STM32HMP", 8);
+    writeLittleEndian(output, LineSize);
+    writeLittleEndian(output, regionCount);
+    for (uint32_t i = 0; i < regionCount; ++i) {
+        writeLittleEndian(output, m_regions[i].start);
+        writeLittleEndian(output, m_regions[i].end);
+    }
+    for (const auto& counters : m_counters) {
+        writeLittleEndian(output, counters.reads);
+        writeLittleEndian(output, counters.writes);
+        writeLittleEndian(output, counters.fetches);
+    }
+}
+
+}  // namespace stm32::debug
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "../memory.hpp"
+
+namespace stm32::debug
+{
+/**
+ * Per cache line access counters of the host-backed memory: flash, system memory, option bytes and SRAM
+ *
+ * Data accesses are counted from the slow path of the page dispatch, so nothing is paid while no heatmap is attached.
+ * Instruction fetches are counted per executed block in halfwords, as Thumb instructions are fetched. Accesses
+ * through bit-band aliases and to peripherals are not counted.
+ */
+class Heatmap {
+public:
+    static constexpr uint32_t LineShift = 5u;
+    static constexpr uint32_t LineSize = 1u << LineShift;
+
+    struct Counters {
+        uint32_t reads = 0u;
+        uint32_t writes = 0u;
+        uint32_t fetches = 0u;
+    };
+
+    explicit Heatmap(const Memory::Config& config);
+
+    inline void recordAccess(uint32_t address, bool write)
+    {
+        if (const auto line = findLine(address); line != NoLine) {
+            ++(write ? m_counters[line].writes : m_counters[line].reads);
+        }
+    }
+
+    /**
+     * Counts fetched halfwords of the sequential block [first, next)
+     */
+    void recordFetch(uint32_t first, uint32_t next);
+
+    /**
+     * @return counters of the line which contains address, or nullptr if it is not host-backed memory
+     */
+    auto counters(uint32_t address) const -> const Counters*;
+
+    void clear();
+
+    /**
+     * Writes "address,reads,writes,fetches" row per line which was accessed at least once
+     */
+    void writeCsv(std::ostream& output) const;
+
+    /**
+     * Writes every line of every region as little-endian binary:
+     * "STM32HMP", line size, region count, (start, end) per region, then (reads, writes, fetches) per line
+     */
+    void writeBinary(std::ostream& output) const;
+
+private:
+    struct Region {
+        uint32_t start;
+        uint32_t end;
+        uint32_t firstLine;
+        bool isAlias;
+    };
+
+    static constexpr uint32_t NoLine = UINT32_MAX;
+
+    inline auto findLine(uint32_t address) const -> uint32_t
+    {
+        for (const auto& region : m_regions) {
+            if (address >= region.start && address < region.end) {
+                return region.firstLine + ((address - region.start) >> LineShift);
+            }
+        }
+        return NoLine;
+    }
+
+    void addRegion(uint32_t start, uint32_t end, bool isAlias);
+
+    std::vector<Region> m_regions;
+    std::vector<Counters> m_counters;
+};
+
+}  // namespace stm32::debug
@@ -0,0 +1,263 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "input_log.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <system_error>
+
+namespace stm32::debug
+{
+using namespace input_log;
+
+InputRecorder::InputRecorder()
+    : m_file{nullptr}
+    , m_buffer{}
+    , m_records{}
+    , m_inMemory{true}
+{
+}
+
+InputRecorder::InputRecorder(const std::string& path)
+    : m_file{std::fopen(path.c_str(), "wb")}
+    , m_buffer{}
+    , m_records{}
+    , m_inMemory{false}
+{
+    if (m_file == nullptr) {
+        throw std::system_error{errno, std::generic_category(), path};
+    }
+
+    m_buffer.reserve(2u * FlushSize);
+    m_buffer.insert(m_buffer.end(), Magic.begin(), Magic.end());
+    for (uint32_t i = 0; i < 4u; ++i) {
+        m_buffer.push_back(static_cast<uint8_t>(Version >> (8u * i)));
+    }
+}
+
+InputRecorder::~InputRecorder()
+{
+    close();
+}
+
+void InputRecorder::recordEvent(uint64_t cycle, const InputEvent& event)
+{
+    if (m_inMemory) {
+        m_records.push_back(InputRecord{.cycle = cycle, .event = event});
+        m_recordCount = m_records.size();
+        return;
+    }
+
+    putRecord(Tag::Event, cycle);
+    m_buffer.push_back(static_cast<uint8_t>(event.type));
+    putVarint(event.channel);
+    putVarint(event.data);
+
+    if (m_buffer.size() >= FlushSize) {
+        flush();
+    }
+}
+
+void InputRecorder::recordBoundary(uint64_t cycle)
+{
+    if (m_inMemory) {
+        m_records.push_back(InputRecord{.cycle = cycle, .event = std::nullopt});
+        m_recordCount = m_records.size();
+        return;
+    }
+
+    putRecord(Tag::Boundary, cycle);
+
+    if (m_buffer.size() >= FlushSize) {
+        flush();
+    }
+}
+
+void InputRecorder::recordHostCall(uint64_t cycle, uint32_t result, std::span<const uint8_t> data)
+{
+    if (m_inMemory) {
+        m_records.push_back(InputRecord{
+            .cycle = cycle,
+            .event = std::nullopt,
+            .hostCall = HostCallResult{.result = result, .data = {data.begin(), data.end()}},
+        });
+        m_recordCount = m_records.size();
+        return;
+    }
+
+    putRecord(Tag::HostCall, cycle);
+    putVarint(result);
+    putVarint(data.size());
+    m_buffer.insert(m_buffer.end(), data.begin(), data.end());
+
+    if (m_buffer.size() >= FlushSize) {
+        flush();
+    }
+}
+
+auto InputRecorder::close() -> bool
+{
+    if (m_file != nullptr) {
+        flush();
+        m_failed |= std::fclose(m_file) != 0;
+        m_file = nullptr;
+    }
+    return !m_failed;
+}
+
+void InputRecorder::truncate(size_t recordCount)
+{
+    if (recordCount < m_records.size()) {
+        m_records.resize(recordCount);
+        m_recordCount = recordCount;
+    }
+}
+
+void InputRecorder::putRecord(Tag tag, uint64_t cycle)
+{
+    m_buffer.push_back(tag);
+    putVarint(cycle - m_previousCycle);
+    m_previousCycle = cycle;
+    ++m_recordCount;
+}
+
+void InputRecorder::putVarint(uint64_t value)
+{
+    while (value >= 0x80u) {
+        m_buffer.push_back(static_cast<uint8_t>(value | 0x80u));
+        value >>= 7u;
+    }
+    m_buffer.push_back(static_cast<uint8_t>(value));
+}
+
+void InputRecorder::flush()
+{
+    if (m_file == nullptr || m_buffer.empty()) {
+        return;
+    }
+
+    // every byte is written once, the file is only appended to
+    m_failed |= std::fwrite(m_buffer.data(), 1u, m_buffer.size(), m_file) != m_buffer.size();
+    m_failed |= std::fflush(m_file) != 0;
+    m_buffer.clear();
+}
+
+InputReplayer::InputReplayer(const std::string& path)
+    : m_ownedRecords{}
+    , m_records{}
+{
+    std::ifstream file{path, std::ios::binary};
+    if (!file) {
+        throw std::system_error{errno, std::generic_category(), path};
+    }
+    const std::vector<uint8_t> data{std::istreambuf_iterator<char>{file}, std::istreambuf_iterator<char>{}};
+
+    if (data.size() < Magic.size() + 4u || !std::equal(Magic.begin(), Magic.end(), data.begin())) {
+        throw std::runtime_error{"not an input log"};
+    }
+    const auto version = static_cast<uint32_t>(data[8] | (data[9] << 8u) | (data[10] << 16u) | (data[11] << 24u));
+    if (version == 0u || version > Version) {
+        throw std::runtime_error{"input log version " + std::to_string(version) + " is not supported"};
+    }
+
+    size_t offset = Magic.size() + 4u;
+    const auto readVarint = [&](uint64_t& value) {
+        value = 0u;
+        for (uint32_t shift = 0; shift < 64u && offset < data.size(); shift += 7u) {
+            const auto byte = data[offset++];
+            value |= uint64_t{byte & 0x7Fu} << shift;
+            if ((byte & 0x80u) == 0u) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // log written by a crashed process ends with an incomplete record, which is dropped
+    uint64_t cycle = 0u;
+    while (offset < data.size()) {
+        const auto tag = data[offset++];
+        uint64_t delta = 0u;
+        if (!readVarint(delta)) {
+            break;
+        }
+        cycle += delta;
+
+        if (tag == Tag::Boundary) {
+            m_ownedRecords.push_back(InputRecord{.cycle = cycle, .event = std::nullopt});
+            continue;
+        }
+        if (tag == Tag::HostCall) {
+            uint64_t result = 0u;
+            uint64_t size = 0u;
+            if (!readVarint(result) || !readVarint(size) || size > data.size() - offset) {
+                break;
+            }
+            const auto begin = data.begin() + static_cast<ptrdiff_t>(offset);
+            offset += size;
+            m_ownedRecords.push_back(InputRecord{
+                .cycle = cycle,
+                .event = std::nullopt,
+                .hostCall = HostCallResult{.result = static_cast<uint32_t>(result), .data = {begin, begin + static_cast<ptrdiff_t>(size)}},
+            });
+            continue;
+        }
+        if (tag != Tag::Event) {
+            throw std::runtime_error{"malformed input log record"};
+        }
+
+        uint64_t channel = 0u;
+        uint64_t eventData = 0u;
+        if (offset >= data.size()) {
+            break;
+        }
+        const auto type = static_cast<InputEventType>(data[offset++]);
+        if (!readVarint(channel) || !readVarint(eventData)) {
+            break;
+        }
+
+        m_ownedRecords.push_back(InputRecord{
+            .cycle = cycle,
+            .event =
+                InputEvent{
+                    .timestamp = cycle,
+                    .type = type,
+                    .channel = static_cast<uint16_t>(channel),
+                    .data = static_cast<uint32_t>(eventData),
+                },
+        });
+    }
+
+    m_records = m_ownedRecords;
+    advanceBoundary();
+}
+
+InputReplayer::InputReplayer(std::span<const InputRecord> records)
+    : m_ownedRecords{}
+    , m_records{records}
+{
+    advanceBoundary();
+}
+
+auto InputReplayer::take() -> InputRecord
+{
+    auto record = m_records[m_next++];
+    if (m_nextBoundary < m_next) {
+        advanceBoundary();
+    }
+    return record;
+}
+
+void InputReplayer::advanceBoundary()
+{
+    m_nextBoundary = std::max(m_nextBoundary, m_next);
+    while (m_nextBoundary < m_records.size() && !m_records[m_nextBoundary].isBoundary()) {
+        ++m_nextBoundary;
+    }
+}
+
+}  // namespace stm32::debug
@@ -0,0 +1,177 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "../input_event.hpp"
+#include "../utils/general.hpp"
+
+namespace stm32::debug
+{
+/**
+ * @brief Log of nondeterministic machine inputs
+ *
+ * File starts with the 8-byte Magic followed by the little-endian 32-bit Version. Every record starts with a tag byte
+ * followed by varint cycle delta from the previous record:
+ *
+ * Event:     input event delivered by the run loop, followed by event type byte, varint channel and varint data
+ * Boundary:  block which was cut before its natural end (by a cycle budget, pacing point, sampling point or timestamp
+ *            of a scheduled event), the cycle is taken before flash wait states of the block are charged
+ * HostCall:  result of a semihosting call, followed by varint R0 and varint size of the data which the call wrote to
+ *            guest memory, then the data
+ *
+ * Recorded events are delivered at the same block boundary on replay, host call results are returned to the next
+ * semihosting call instead of asking the host again. Boundaries only matter with the flash timing
+ * model, which charges wait states per block, so replay cuts blocks at the same cycles to stay bit-exact. Pacing
+ * decisions have no other effect on the virtual machine, so they are captured as boundaries. A log cut short by a crash
+ * is read up to the last complete record.
+ */
+namespace input_log
+{
+constexpr std::array<char, 8> Magic = {'S', 'T', 'M', '3', '2', 'R', 'P', 'L'};
+constexpr uint32_t Version = 2u;  ///< version 1 logs have no host calls and are still read
+
+enum Tag : uint8_t {
+    Event = 0x1u,
+    Boundary = 0x2u,
+    HostCall = 0x3u,
+};
+
+}  // namespace input_log
+
+/**
+ * Guest-visible result of a semihosting call which depends on the host
+ */
+struct HostCallResult {
+    uint32_t result = 0u;         ///< returned in R0
+    std::vector<uint8_t> data{};  ///< bytes written to the guest buffer by SYS_READ
+};
+
+struct InputRecord {
+    uint64_t cycle = 0u;
+    std::optional<InputEvent> event{};         ///< empty for boundary and host call
+    std::optional<HostCallResult> hostCall{};  ///< empty for boundary and event
+
+    inline auto isBoundary() const -> bool { return !event.has_value() && !hostCall.has_value(); }
+};
+
+/**
+ * Append-only input log writer, records are buffered and written in blocks of FlushSize bytes. Log kept in memory
+ * stores decoded records instead
+ */
+class InputRecorder {
+    RESTRICT_COPY(InputRecorder);
+
+public:
+    static constexpr size_t FlushSize = 4096u;
+
+    /**
+     * Keeps the log in memory
+     */
+    explicit InputRecorder();
+
+    /**
+     * @throws std::system_error if file can't be created
+     */
+    explicit InputRecorder(const std::string& path);
+    ~InputRecorder();
+
+    void recordEvent(uint64_t cycle, const InputEvent& event);
+    void recordBoundary(uint64_t cycle);
+    void recordHostCall(uint64_t cycle, uint32_t result, std::span<const uint8_t> data);
+
+    /**
+     * Writes buffered records and closes the file, called by destructor
+     * @return false if any part of the log failed to be written
+     */
+    auto close() -> bool;
+
+    inline auto recordCount() const -> uint64_t { return m_recordCount; }
+
+    /**
+     * Records of the log kept in memory
+     */
+    inline auto records() const -> const std::vector<InputRecord>& { return m_records; }
+
+    /**
+     * Drops records of the log kept in memory starting from the given one
+     */
+    void truncate(size_t recordCount);
+
+private:
+    void putRecord(input_log::Tag tag, uint64_t cycle);
+    void putVarint(uint64_t value);
+    void flush();
+
+    std::FILE* m_file;
+    std::vector<uint8_t> m_buffer;
+    std::vector<InputRecord> m_records;
+    bool m_inMemory;
+    uint64_t m_previousCycle = 0u;
+    uint64_t m_recordCount = 0u;
+    bool m_failed = false;
+};
+
+/**
+ * Input log reader, the whole log is decoded on construction
+ */
+class InputReplayer {
+    RESTRICT_COPY(InputReplayer);
+
+public:
+    static constexpr uint64_t NoCycle = UINT64_MAX;
+
+    /**
+     * @throws std::system_error if file can't be read
+     * @throws std::runtime_error if file is not an input log
+     */
+    explicit InputReplayer(const std::string& path);
+
+    /**
+     * Replays records which are owned by the caller and must outlive the replayer
+     */
+    explicit InputReplayer(std::span<const InputRecord> records);
+
+    /**
+     * @return cycle of the next record, NoCycle when the log is exhausted
+     */
+    inline auto nextCycle() const -> uint64_t { return m_next < m_records.size() ? m_records[m_next].cycle : NoCycle; }
+
+    /**
+     * @return cycle of the next boundary record, NoCycle if there is none
+     */
+    inline auto nextBoundaryCycle() const -> uint64_t { return m_nextBoundary < m_records.size() ? m_records[m_nextBoundary].cycle : NoCycle; }
+
+    /**
+     * Host call results are consumed by the semihosting call they belong to, not by the run loop
+     */
+    inline auto isHostCallNext() const -> bool { return m_next < m_records.size() && m_records[m_next].hostCall.has_value(); }
+
+    /**
+     * Consumes the next record
+     */
+    auto take() -> InputRecord;
+
+    /**
+     * @return number of consumed records
+     */
+    inline auto position() const -> size_t { return m_next; }
+
+    inline auto isFinished() const -> bool { return m_next == m_records.size(); }
+    inline auto records() const -> std::span<const InputRecord> { return m_records; }
+
+private:
+    void advanceBoundary();
+
+    std::vector<InputRecord> m_ownedRecords;
+    std::span<const InputRecord> m_records;
+    size_t m_next = 0u;
+    size_t m_nextBoundary = 0u;
+};
+
+}  // namespace stm32::debug
@@ -0,0 +1,114 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "itm.hpp"
+
+#include <array>
+
+#include "itm_capture.hpp"
+
+namespace stm32::debug
+{
+namespace
+{
+enum RegisterOffset : uint32_t {
+    ITM_STIM0 = 0x000u,
+    ITM_TER = 0xE00u,
+    ITM_TPR = 0xE40u,
+    ITM_TCR = 0xE80u,
+    PeripheralIdStart = 0xFD0u,
+};
+
+// ITMENA, TSENA, SYNCENA, TXENA, SWOENA, TSPrescale, GTSFREQ and TraceBusID are writable, BUSY is read-only
+constexpr uint32_t TraceControlMask = 0x007F0F1Fu;
+
+// PID4 - PID7, PID0 - PID3, CID0 - CID3
+constexpr std::array<uint32_t, 12> IdentificationRegisters = {
+    0x04u, 0x00u, 0x00u, 0x00u, 0x01u, 0xB0u, 0x3Bu, 0x00u, 0x0Du, 0xE0u, 0x05u, 0xB1u,
+};
+
+}  // namespace
+
+Itm::Itm()
+    : MemoryRegion{Memory::ItmStart, Memory::ItmEnd}
+{
+}
+
+void Itm::write(uint32_t address, uint8_t data)
+{
+    const auto offset = address - Memory::ItmStart;
+    if (offset < ITM_STIM0 + 4u * PortCount) {
+        const auto port = static_cast<uint8_t>(offset / 4u);
+        if (m_capture != nullptr && isPortEnabled(port)) {
+            m_capture->push(port, data);
+        }
+        return;
+    }
+
+    const auto shift = (offset & 0x3u) * 8u;
+    const auto mask = 0xFFu << shift;
+    const auto value = static_cast<uint32_t>(data) << shift;
+    switch (offset & ~0x3u) {
+        case ITM_TER:
+            m_traceEnable = (m_traceEnable & ~mask) | value;
+            break;
+        case ITM_TPR:
+            m_tracePrivilege = (m_tracePrivilege & ~mask) | (value & 0xFu);
+            break;
+        case ITM_TCR:
+            m_traceControl = (m_traceControl & ~mask) | (value & TraceControlMask);
+            break;
+        default:
+            break;
+    }
+}
+
+auto Itm::read(uint32_t address) -> uint8_t
+{
+    const auto offset = address - Memory::ItmStart;
+    return static_cast<uint8_t>(readRegister(offset & ~0x3u) >> ((offset & 0x3u) * 8u));
+}
+
+void Itm::reset()
+{
+    const auto enabled = m_capture != nullptr;
+    m_traceEnable = enabled ? UINT32_MAX : 0u;
+    m_tracePrivilege = 0u;
+    m_traceControl = enabled ? 0x1u : 0u;
+}
+
+void Itm::setState(const State& state)
+{
+    m_traceEnable = state.traceEnable;
+    m_tracePrivilege = state.tracePrivilege & 0xFu;
+    m_traceControl = state.traceControl & TraceControlMask;
+}
+
+void Itm::setCapture(ItmCapture* capture)
+{
+    m_capture = capture;
+    reset();
+}
+
+auto Itm::readRegister(uint32_t offset) const -> uint32_t
+{
+    if (offset < ITM_STIM0 + 4u * PortCount) {
+        // FIFOREADY, CMSIS ITM_SendChar spins on it while the capture is behind
+        return m_capture != nullptr && m_capture->isFull() ? 0x0u : 0x1u;
+    }
+    if (offset == ITM_TER) {
+        return m_traceEnable;
+    }
+    if (offset == ITM_TPR) {
+        return m_tracePrivilege;
+    }
+    if (offset == ITM_TCR) {
+        return m_traceControl;
+    }
+    if (offset >= PeripheralIdStart && offset - PeripheralIdStart < 4u * IdentificationRegisters.size()) {
+        return IdentificationRegisters[(offset - PeripheralIdStart) / 4u];
+    }
+    return 0u;
+}
+
+}  // namespace stm32::debug
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+
+#include "../memory.hpp"
+
+namespace stm32::debug
+{
+class ItmCapture;
+
+/**
+ * Instrumentation Trace Macrocell, stimulus ports only
+ *
+ * Every byte written to an enabled stimulus port is handed over to the attached capture, so an 8-bit write is one byte
+ * of the port stream and a word write is four bytes in little-endian order. Attaching the capture plays the part of
+ * the debugger which sets up tracing, ITMENA and all ports are enabled until the firmware changes them. Timestamps,
+ * synchronization packets and TPR privilege checks are not modelled. Stimulus FIFO is not ready while the ring of the
+ * capture is full.
+ *
+ * @par Register map (see C1.7)
+ *
+ * 0xE0000000 - 0xE000007C: ITM_STIM0 - ITM_STIM31
+ * 0xE0000E00: ITM_TER
+ * 0xE0000E40: ITM_TPR
+ * 0xE0000E80: ITM_TCR
+ * 0xE0000FD0 - 0xE0000FFC: Peripheral and component identification registers
+ */
+class Itm final : public MemoryRegion {
+public:
+    static constexpr uint32_t PortCount = 32u;
+
+    /**
+     * Registers saved by snapshots, the capture is host-side and is not included
+     */
+    struct State {
+        uint32_t traceEnable;
+        uint32_t tracePrivilege;
+        uint32_t traceControl;
+    };
+
+    explicit Itm();
+
+public:
+    RESTRICT_COPY(Itm);
+
+    void write(uint32_t address, uint8_t data) override;
+    auto read(uint32_t address) -> uint8_t override;
+
+    void reset();
+
+    inline auto state() const -> State { return State{m_traceEnable, m_tracePrivilege, m_traceControl}; }
+    void setState(const State& state);
+
+    /**
+     * Sends stimulus port writes to the capture until detached with nullptr, capture is not owned
+     */
+    void setCapture(ItmCapture* capture);
+    inline auto capture() -> ItmCapture* { return m_capture; }
+
+    inline auto isPortEnabled(uint8_t port) const -> bool
+    {
+        return (m_traceControl & 0x1u) != 0u && ((m_traceEnable >> port) & 0x1u) != 0u;
+    }
+
+private:
+    auto readRegister(uint32_t offset) const -> uint32_t;
+
+    ItmCapture* m_capture = nullptr;
+
+    uint32_t m_traceEnable = 0u;
+    uint32_t m_tracePrivilege = 0u;
+    uint32_t m_traceControl = 0u;
+};
+
+}  // namespace stm32::debug
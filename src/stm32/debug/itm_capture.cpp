@@ -0,0 +1,141 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "itm_capture.hpp"
+
+#include <bitset>
+#include <cerrno>
+#include <system_error>
+
+namespace stm32::debug
+{
+namespace
+{
+// bytes decoded per pass, so that memory ports take the lock once per batch
+constexpr size_t BatchSize = 4096u;
+
+}  // namespace
+
+ItmCapture::ItmCapture(const Config& config)
+    : m_config{config}
+    , m_files{}
+    , m_ring{}
+    , m_mutex{}
+    , m_condition{}
+    , m_portData{}
+    , m_consumer{}
+{
+    for (size_t port = 0; port < Itm::PortCount; ++port) {
+        const auto& path = m_config.files[port];
+        if (path.empty()) {
+            continue;
+        }
+
+        m_files[port] = std::fopen(path.c_str(), "wb");
+        if (m_files[port] == nullptr) {
+            const auto error = errno;
+            for (auto* file : m_files) {
+                if (file != nullptr) {
+                    std::fclose(file);
+                }
+            }
+            throw std::system_error{error, std::generic_category(), path};
+        }
+    }
+
+    m_consumer = std::thread{&ItmCapture::consumerLoop, this};
+}
+
+ItmCapture::~ItmCapture()
+{
+    {
+        std::lock_guard lock{m_mutex};
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+    m_consumer.join();
+
+    for (auto* file : m_files) {
+        if (file != nullptr) {
+            std::fclose(file);
+        }
+    }
+}
+
+auto ItmCapture::flush() -> bool
+{
+    std::unique_lock lock{m_mutex};
+    m_flushRequested = true;
+    m_condition.notify_all();
+    m_condition.wait(lock, [this] { return m_writtenBytes >= m_pushedBytes; });
+    return !m_writeFailed;
+}
+
+auto ItmCapture::portData(uint8_t port) const -> std::string
+{
+    std::lock_guard lock{m_mutex};
+    return port < Itm::PortCount ? m_portData[port] : std::string{};
+}
+
+void ItmCapture::consumerLoop()
+{
+    std::array<std::string, Itm::PortCount> batch{};
+    std::bitset<Itm::PortCount> unflushed{};
+    uint64_t drained = 0u;
+
+    while (true) {
+        size_t count = 0u;
+        for (; count < BatchSize; ++count) {
+            const auto item = m_ring.tryPop();
+            if (!item.has_value()) {
+                break;
+            }
+            batch[*item >> 8u].push_back(static_cast<char>(*item & 0xFFu));
+        }
+        const auto isRingEmpty = count < BatchSize;
+        drained += count;
+
+        // Files are written outside of the lock and flushed once the ring runs dry
+        auto writeFailed = false;
+        for (size_t port = 0; port < Itm::PortCount; ++port) {
+            if (m_files[port] != nullptr && !batch[port].empty()) {
+                writeFailed |= std::fwrite(batch[port].data(), 1u, batch[port].size(), m_files[port]) != batch[port].size();
+                batch[port].clear();
+                unflushed.set(port);
+            }
+        }
+        if (isRingEmpty) {
+            for (size_t port = 0; port < Itm::PortCount; ++port) {
+                if (unflushed.test(port)) {
+                    writeFailed |= std::fflush(m_files[port]) != 0;
+                }
+            }
+            unflushed.reset();
+        }
+
+        std::unique_lock lock{m_mutex};
+        for (size_t port = 0; port < Itm::PortCount; ++port) {
+            if (!batch[port].empty()) {
+                m_portData[port] += batch[port];
+                batch[port].clear();
+            }
+        }
+        m_writeFailed = m_writeFailed || writeFailed;
+        if (!isRingEmpty) {
+            continue;
+        }
+
+        // Bytes count as written only after the files are flushed
+        m_writtenBytes = drained;
+        m_condition.notify_all();
+        if (m_stopping && count == 0u) {
+            return;
+        }
+
+        // Producer never signals, so that pushing stays free of syscalls, the ring is polled instead
+        m_condition.wait_for(lock, m_config.pollInterval, [this] { return m_stopping || m_flushRequested; });
+        m_flushRequested = false;
+    }
+}
+
+}  // namespace stm32::debug
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "../utils/general.hpp"
+#include "../utils/spsc_queue.hpp"
+#include "itm.hpp"
+
+namespace stm32::debug
+{
+/**
+ * Host side of the ITM stimulus ports
+ *
+ * The emulation thread pushes each stimulus byte into a lock-free ring, so firmware logging costs one store and no
+ * syscall. A background thread drains the ring into per-port streams: the file configured for the port, or memory for
+ * ports without one. Stimulus ports report FIFOREADY only while the ring has room, so firmware which polls it waits for
+ * the consumer. Bytes written without polling which find the ring full are dropped and counted, like overflow packets
+ * of a real trace port.
+ */
+class ItmCapture {
+    RESTRICT_COPY(ItmCapture);
+
+public:
+    static constexpr size_t RingCapacity = 1u << 16u;
+
+    struct Config {
+        std::array<std::string, Itm::PortCount> files{};  ///< output file per port, empty keeps the port in memory
+        std::chrono::microseconds pollInterval{1000};     ///< consumer sleep while the ring is empty
+    };
+
+    /**
+     * @throws std::system_error if an output file can't be created
+     */
+    explicit ItmCapture(const Config& config);
+    ~ItmCapture();
+
+    /**
+     * Must be called only from the emulation thread
+     * @return false if the byte was dropped
+     */
+    inline auto push(uint8_t port, uint8_t data) -> bool
+    {
+        if (!m_ring.tryPush(static_cast<uint16_t>((port << 8u) | data))) {
+            m_droppedBytes.fetch_add(1u, std::memory_order_relaxed);
+            return false;
+        }
+        ++m_pushedBytes;
+        return true;
+    }
+
+    /**
+     * Must be called only from the emulation thread
+     */
+    inline auto isFull() -> bool { return m_ring.isFull(); }
+
+    /**
+     * Waits until bytes pushed so far are written out, must be called from the emulation thread
+     * @return false if writing any of the files failed
+     */
+    auto flush() -> bool;
+
+    /**
+     * Bytes received by a port which has no output file, up to the last flush
+     */
+    auto portData(uint8_t port) const -> std::string;
+
+    inline auto droppedBytes() const -> uint64_t { return m_droppedBytes.load(std::memory_order_relaxed); }
+
+private:
+    void consumerLoop();
+
+    Config m_config;
+    std::array<std::FILE*, Itm::PortCount> m_files;
+
+    utils::SpscQueue<uint16_t, RingCapacity> m_ring;
+    uint64_t m_pushedBytes = 0u;
+    std::atomic<uint64_t> m_droppedBytes{0u};
+
+    mutable std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::array<std::string, Itm::PortCount> m_portData;
+    uint64_t m_writtenBytes = 0u;  // bytes drained from the ring and flushed
+    bool m_flushRequested = false;
+    bool m_stopping = false;
+    bool m_writeFailed = false;
+    std::thread m_consumer;
+};
+
+}  // namespace stm32::debug
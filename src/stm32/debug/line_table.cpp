@@ -0,0 +1,461 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "line_table.hpp"
+
+#include <algorithm>
+#include <map>
+#include <stdexcept>
+
+namespace stm32::debug
+{
+namespace
+{
+// see: DWARF 5, 6.2.5
+enum StandardOpcode : uint8_t {
+    DW_LNS_copy = 1u,
+    DW_LNS_advance_pc = 2u,
+    DW_LNS_advance_line = 3u,
+    DW_LNS_set_file = 4u,
+    DW_LNS_const_add_pc = 8u,
+    DW_LNS_fixed_advance_pc = 9u,
+};
+
+enum ExtendedOpcode : uint8_t {
+    DW_LNE_end_sequence = 1u,
+    DW_LNE_set_address = 2u,
+    DW_LNE_define_file = 3u,
+};
+
+enum LineContentType : uint32_t {
+    DW_LNCT_path = 1u,
+    DW_LNCT_directory_index = 2u,
+};
+
+enum Form : uint32_t {
+    DW_FORM_data2 = 0x05u,
+    DW_FORM_data4 = 0x06u,
+    DW_FORM_data8 = 0x07u,
+    DW_FORM_string = 0x08u,
+    DW_FORM_block = 0x09u,
+    DW_FORM_data1 = 0x0bu,
+    DW_FORM_strp = 0x0eu,
+    DW_FORM_udata = 0x0fu,
+    DW_FORM_data16 = 0x1eu,
+    DW_FORM_line_strp = 0x1fu,
+};
+
+struct Row {
+    uint32_t address;
+    uint32_t file;
+    uint32_t line;
+};
+
+}  // namespace
+
+/**
+ * Decoder of line number programs of all units in the section
+ */
+class LineProgramParser {
+public:
+    explicit LineProgramParser(const ElfFile& elf, LineTable& table)
+        : m_elf{elf}
+        , m_table{table}
+        , m_data{}
+        , m_lineStrings{section(".debug_line_str")}
+        , m_strings{section(".debug_str")}
+        , m_fileIndices{}
+    {
+    }
+
+    void parse(std::span<const uint8_t> data)
+    {
+        m_data = data;
+        m_position = 0u;
+        while (m_position < m_data.size()) {
+            parseUnit();
+        }
+    }
+
+private:
+    auto section(std::string_view name) const -> std::span<const uint8_t>
+    {
+        const auto* found = m_elf.findSection(name);
+        return found != nullptr ? m_elf.sectionData(*found) : std::span<const uint8_t>{};
+    }
+
+    [[noreturn]] static void fail() { throw std::runtime_error{"malformed .debug_line section"}; }
+
+    auto read8() -> uint8_t
+    {
+        if (m_position >= m_end) {
+            fail();
+        }
+        return m_data[m_position++];
+    }
+
+    auto readFixed(uint32_t size) -> uint64_t
+    {
+        uint64_t value = 0u;
+        for (uint32_t i = 0; i < size; ++i) {
+            value |= uint64_t{read8()} << (8u * i);
+        }
+        return value;
+    }
+
+    auto readUleb() -> uint64_t
+    {
+        uint64_t value = 0u;
+        for (uint32_t shift = 0u;; shift += 7u) {
+            const auto byte = read8();
+            if (shift < 64u) {
+                value |= uint64_t{byte & 0x7Fu} << shift;
+            }
+            if ((byte & 0x80u) == 0u) {
+                return value;
+            }
+        }
+    }
+
+    auto readSleb() -> int64_t
+    {
+        int64_t value = 0;
+        uint32_t shift = 0u;
+        uint8_t byte;
+        do {
+            byte = read8();
+            if (shift < 64u) {
+                value |= static_cast<int64_t>(uint64_t{byte & 0x7Fu} << shift);
+            }
+            shift += 7u;
+        } while ((byte & 0x80u) != 0u);
+
+        if (shift < 64u && (byte & 0x40u) != 0u) {
+            value |= -(int64_t{1} << shift);
+        }
+        return value;
+    }
+
+    auto readString() -> std::string
+    {
+        std::string result;
+        for (auto c = read8(); c != 0u; c = read8()) {
+            result.push_back(static_cast<char>(c));
+        }
+        return result;
+    }
+
+    static auto stringAt(std::span<const uint8_t> strings, uint64_t offset) -> std::string
+    {
+        std::string result;
+        for (; offset < strings.size() && strings[offset] != 0u; ++offset) {
+            result.push_back(static_cast<char>(strings[offset]));
+        }
+        return result;
+    }
+
+    /**
+     * Reads attribute of DWARF 5 directory or file entry, strings are returned in text, numbers in value
+     */
+    void readForm(uint64_t form, std::string& text, uint64_t& value)
+    {
+        switch (form) {
+            case DW_FORM_string:
+                text = readString();
+                break;
+            case DW_FORM_line_strp:
+                text = stringAt(m_lineStrings, readFixed(4u));
+                break;
+            case DW_FORM_strp:
+                text = stringAt(m_strings, readFixed(4u));
+                break;
+            case DW_FORM_udata:
+                value = readUleb();
+                break;
+            case DW_FORM_data1:
+                value = readFixed(1u);
+                break;
+            case DW_FORM_data2:
+                value = readFixed(2u);
+                break;
+            case DW_FORM_data4:
+                value = readFixed(4u);
+                break;
+            case DW_FORM_data8:
+                value = readFixed(8u);
+                break;
+            case DW_FORM_data16:
+                m_position += 16u;
+                break;
+            case DW_FORM_block:
+                m_position += readUleb();
+                break;
+            default:
+                fail();
+        }
+    }
+
+    auto readEntries() -> std::vector<std::pair<std::string, uint64_t>>
+    {
+        std::vector<std::pair<uint64_t, uint64_t>> formats(read8());
+        for (auto& [type, form] : formats) {
+            type = readUleb();
+            form = readUleb();
+        }
+
+        std::vector<std::pair<std::string, uint64_t>> entries(readUleb());
+        for (auto& [path, directory] : entries) {
+            for (const auto& [type, form] : formats) {
+                std::string text;
+                uint64_t value = 0u;
+                readForm(form, text, value);
+
+                if (type == DW_LNCT_path) {
+                    path = text;
+                }
+                else if (type == DW_LNCT_directory_index) {
+                    directory = value;
+                }
+            }
+        }
+        return entries;
+    }
+
+    auto addFile(const std::vector<std::string>& directories, const std::string& name, uint64_t directory) -> uint32_t
+    {
+        auto path = name;
+        if (!name.empty() && name.front() != '/' && directory < directories.size() && !directories[directory].empty()) {
+            path = directories[directory] + '/' + name;
+        }
+
+        const auto [it, inserted] = m_fileIndices.emplace(path, static_cast<uint32_t>(m_table.m_files.size()));
+        if (inserted) {
+            m_table.m_files.push_back(path);
+        }
+        return it->second;
+    }
+
+    void parseUnit()
+    {
+        m_end = m_data.size();
+        const auto unitLength = readFixed(4u);
+        if (unitLength >= 0xFFFFFFF0u) {
+            throw std::runtime_error{"64-bit DWARF is not supported"};
+        }
+        const auto unitEnd = m_position + unitLength;
+        if (unitEnd > m_data.size()) {
+            fail();
+        }
+        m_end = unitEnd;
+
+        const auto version = static_cast<uint16_t>(readFixed(2u));
+        if (version < 2u || version > 5u) {
+            throw std::runtime_error{"unsupported .debug_line version " + std::to_string(version)};
+        }
+        if (version >= 5u) {
+            readFixed(2u);  // address and segment selector sizes
+        }
+
+        const auto headerLength = readFixed(4u);
+        const auto programStart = m_position + headerLength;
+
+        const auto minimumInstructionLength = read8();
+        if (version >= 4u) {
+            read8();  // maximum operations per instruction, VLIW only
+        }
+        const auto defaultIsStatement = read8();
+        static_cast<void>(defaultIsStatement);
+        const auto lineBase = static_cast<int8_t>(read8());
+        const auto lineRange = read8();
+        const auto opcodeBase = read8();
+        if (lineRange == 0u || opcodeBase == 0u) {
+            fail();
+        }
+
+        std::vector<uint8_t> standardOpcodeLengths(opcodeBase - 1u);
+        for (auto& length : standardOpcodeLengths) {
+            length = read8();
+        }
+
+        std::vector<std::string> directories;
+        std::vector<uint32_t> files;
+        if (version >= 5u) {
+            for (const auto& [path, index] : readEntries()) {
+                directories.push_back(path);
+            }
+            for (const auto& [path, directory] : readEntries()) {
+                files.push_back(addFile(directories, path, directory));
+            }
+        }
+        else {
+            // index 0 is the compilation directory, which is not recorded in the line table before DWARF 5
+            directories.emplace_back();
+            for (auto directory = readString(); !directory.empty(); directory = readString()) {
+                directories.push_back(directory);
+            }
+
+            // file numbers start from one
+            files.push_back(0u);
+            for (auto name = readString(); !name.empty(); name = readString()) {
+                const auto directory = readUleb();
+                readUleb();
+                readUleb();
+                files.push_back(addFile(directories, name, directory));
+            }
+        }
+
+        m_position = programStart;
+        runProgram(version, minimumInstructionLength, lineBase, lineRange, standardOpcodeLengths, directories, files);
+        m_position = unitEnd;
+    }
+
+    void runProgram(uint16_t version,
+                    uint8_t minimumInstructionLength,
+                    int8_t lineBase,
+                    uint8_t lineRange,
+                    const std::vector<uint8_t>& standardOpcodeLengths,
+                    const std::vector<std::string>& directories,
+                    std::vector<uint32_t>& files)
+    {
+        const auto opcodeBase = static_cast<uint8_t>(standardOpcodeLengths.size() + 1u);
+        const auto initialFile = version >= 5u ? 0u : 1u;
+
+        uint32_t address = 0u;
+        uint64_t file = initialFile;
+        int64_t line = 1;
+        std::vector<Row> sequence;
+
+        const auto emitRow = [&]() {
+            sequence.push_back(Row{
+                .address = address,
+                .file = file < files.size() ? files[file] : UINT32_MAX,
+                .line = static_cast<uint32_t>(line),
+            });
+        };
+
+        while (m_position < m_end) {
+            const auto opcode = read8();
+
+            if (opcode >= opcodeBase) {
+                const auto adjusted = static_cast<uint8_t>(opcode - opcodeBase);
+                address += static_cast<uint32_t>(adjusted / lineRange) * minimumInstructionLength;
+                line += lineBase + adjusted % lineRange;
+                emitRow();
+                continue;
+            }
+
+            switch (opcode) {
+                case 0u: {
+                    const auto length = readUleb();
+                    const auto next = m_position + length;
+                    const auto extended = length != 0u ? read8() : 0u;
+                    if (extended == DW_LNE_end_sequence) {
+                        emitRow();
+                        finishSequence(sequence);
+                        address = 0u;
+                        file = initialFile;
+                        line = 1;
+                    }
+                    else if (extended == DW_LNE_set_address) {
+                        address = static_cast<uint32_t>(readFixed(static_cast<uint32_t>(length - 1u)));
+                    }
+                    else if (extended == DW_LNE_define_file) {
+                        const auto name = readString();
+                        const auto directory = readUleb();
+                        files.push_back(addFile(directories, name, directory));
+                    }
+                    m_position = next;
+                    break;
+                }
+                case DW_LNS_copy:
+                    emitRow();
+                    break;
+                case DW_LNS_advance_pc:
+                    address += static_cast<uint32_t>(readUleb()) * minimumInstructionLength;
+                    break;
+                case DW_LNS_advance_line:
+                    line += readSleb();
+                    break;
+                case DW_LNS_set_file:
+                    file = readUleb();
+                    break;
+                case DW_LNS_const_add_pc:
+                    address += static_cast<uint32_t>((255u - opcodeBase) / lineRange) * minimumInstructionLength;
+                    break;
+                case DW_LNS_fixed_advance_pc:
+                    address += static_cast<uint32_t>(readFixed(2u));
+                    break;
+                default:
+                    // skip operands of the opcodes which only change flags, column or ISA
+                    for (uint8_t i = 0; i < standardOpcodeLengths[opcode - 1u]; ++i) {
+                        readUleb();
+                    }
+                    break;
+            }
+        }
+    }
+
+    void finishSequence(std::vector<Row>& sequence)
+    {
+        for (size_t i = 0; i + 1u < sequence.size(); ++i) {
+            const auto& row = sequence[i];
+            if (row.file != UINT32_MAX && row.address < sequence[i + 1u].address) {
+                m_table.m_ranges.push_back(LineTable::Range{
+                    .begin = row.address,
+                    .end = sequence[i + 1u].address,
+                    .file = row.file,
+                    .line = row.line,
+                });
+            }
+        }
+        sequence.clear();
+    }
+
+    const ElfFile& m_elf;
+    LineTable& m_table;
+
+    std::span<const uint8_t> m_data;
+    size_t m_position = 0u;
+    size_t m_end = 0u;
+
+    std::span<const uint8_t> m_lineStrings;
+    std::span<const uint8_t> m_strings;
+    std::map<std::string, uint32_t> m_fileIndices;
+};
+
+LineTable::LineTable()
+    : m_ranges{}
+    , m_files{}
+{
+}
+
+auto LineTable::parse(const ElfFile& elf) -> LineTable
+{
+    auto table = LineTable{};
+
+    const auto* section = elf.findSection(".debug_line");
+    if (section == nullptr) {
+        return table;
+    }
+
+    LineProgramParser{elf, table}.parse(elf.sectionData(*section));
+    std::sort(table.m_ranges.begin(), table.m_ranges.end(), [](const Range& left, const Range& right) {
+        return left.begin < right.begin;
+    });
+    return table;
+}
+
+auto LineTable::find(uint32_t address) const -> const Range*
+{
+    auto it = std::upper_bound(m_ranges.begin(), m_ranges.end(), address, [](uint32_t value, const Range& range) {
+        return value < range.begin;
+    });
+    if (it == m_ranges.begin()) {
+        return nullptr;
+    }
+
+    --it;
+    return address < it->end ? &*it : nullptr;
+}
+
+}  // namespace stm32::debug
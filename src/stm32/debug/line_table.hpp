@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "elf_file.hpp"
+
+namespace stm32::debug
+{
+/**
+ * Address to source line mapping decoded from the DWARF .debug_line section (versions 2 - 5)
+ */
+class LineTable {
+public:
+    struct Range {
+        uint32_t begin;  ///< first address of the row
+        uint32_t end;    ///< address of the next row in the sequence
+        uint32_t file;   ///< index into files()
+        uint32_t line;
+    };
+
+    /**
+     * @throws std::runtime_error if line program is malformed, table is empty if ELF has no .debug_line section
+     */
+    static auto parse(const ElfFile& elf) -> LineTable;
+
+    explicit LineTable();
+
+    /**
+     * Ranges sorted by address
+     */
+    inline auto ranges() const -> const std::vector<Range>& { return m_ranges; }
+    inline auto files() const -> const std::vector<std::string>& { return m_files; }
+
+    auto find(uint32_t address) const -> const Range*;
+
+private:
+    friend class LineProgramParser;
+
+    std::vector<Range> m_ranges;
+    std::vector<std::string> m_files;
+};
+
+}  // namespace stm32::debug
@@ -0,0 +1,116 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "pc_sampler.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+namespace stm32::debug
+{
+PcSampler::PcSampler(uint64_t interval)
+    : m_interval{interval}
+    , m_entries(InitialCapacity)
+{
+    if (interval == 0u) {
+        throw std::invalid_argument{"sampling interval must be positive"};
+    }
+}
+
+void PcSampler::insert(size_t index, uint64_t key)
+{
+    // keep load factor below 3/4, otherwise probe sequences get long
+    if (4u * (m_size + 1u) > 3u * m_entries.size()) {
+        auto entries = std::vector<Entry>(2u * m_entries.size());
+        std::swap(entries, m_entries);
+
+        for (const auto& entry : entries) {
+            if (entry.count == 0u) {
+                continue;
+            }
+
+            auto position = hash(entry.key) & (m_entries.size() - 1u);
+            while (m_entries[position].count != 0u) {
+                position = (position + 1u) & (m_entries.size() - 1u);
+            }
+            m_entries[position] = entry;
+        }
+
+        index = hash(key) & (m_entries.size() - 1u);
+        while (m_entries[index].count != 0u) {
+            index = (index + 1u) & (m_entries.size() - 1u);
+        }
+    }
+
+    m_entries[index] = Entry{.key = key, .count = 1u};
+    ++m_size;
+    ++m_totalSamples;
+}
+
+auto PcSampler::samples() const -> std::vector<Sample>
+{
+    std::vector<Sample> result;
+    result.reserve(m_size);
+    for (const auto& entry : m_entries) {
+        if (entry.count != 0u) {
+            result.push_back(Sample{
+                .pc = static_cast<uint32_t>(entry.key >> 32u),
+                .lr = static_cast<uint32_t>(entry.key),
+                .count = entry.count,
+            });
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const Sample& left, const Sample& right) {
+        return left.count != right.count ? left.count > right.count : left.pc < right.pc;
+    });
+    return result;
+}
+
+void PcSampler::clear()
+{
+    m_entries.assign(InitialCapacity, Entry{});
+    m_size = 0u;
+    m_totalSamples = 0u;
+}
+
+void PcSampler::writeSamples(std::ostream& output) const
+{
+    output << "pc,lr,count\n";
+
+    char row[64];
+    for (const auto& sample : samples()) {
+        std::snprintf(row, sizeof(row), "0x%08" PRIx32 ",0x%08" PRIx32 ",%" PRIu64 "\n", sample.pc, sample.lr, sample.count);
+        output << row;
+    }
+}
+
+void PcSampler::writeFunctions(std::ostream& output, const ElfFile& elf) const
+{
+    const auto functionName = [&](uint32_t address) -> std::string {
+        const auto* function = elf.findFunction(address & ~uint32_t{0x1u});
+        return function != nullptr ? function->name : "??";
+    };
+
+    std::map<std::pair<std::string, std::string>, uint64_t> functions;
+    for (const auto& sample : samples()) {
+        functions[{functionName(sample.pc), functionName(sample.lr)}] += sample.count;
+    }
+
+    std::vector<std::pair<std::pair<std::string, std::string>, uint64_t>> rows{functions.begin(), functions.end()};
+    std::stable_sort(rows.begin(), rows.end(), [](const auto& left, const auto& right) {
+        return left.second > right.second;
+    });
+
+    output << "function,caller,count\n";
+    for (const auto& [names, count] : rows) {
+        output << names.first << ',' << names.second << ',' << count << '\n';
+    }
+}
+
+}  // namespace stm32::debug
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include "elf_file.hpp"
+
+namespace stm32::debug
+{
+/**
+ * Statistical PC sampling profiler, the equivalent of DWT PC sampling
+ *
+ * Run loop ends a block at every sampling cycle and records the (PC, LR) pair of the next instruction, so the cost is
+ * one extra block boundary per interval. Samples are aggregated in an open addressing hash table with linear probing,
+ * which grows only when a new pair is seen, so long runs with a stable working set never allocate.
+ */
+class PcSampler {
+public:
+    struct Sample {
+        uint32_t pc;
+        uint32_t lr;
+        uint64_t count;
+    };
+
+    /**
+     * @param interval number of cycles between two samples
+     */
+    explicit PcSampler(uint64_t interval);
+
+    inline auto interval() const -> uint64_t { return m_interval; }
+
+    inline void sample(uint32_t pc, uint32_t lr)
+    {
+        const auto key = (uint64_t{pc} << 32u) | lr;
+        auto index = hash(key) & (m_entries.size() - 1u);
+        while (m_entries[index].count != 0u) {
+            if (m_entries[index].key == key) {
+                ++m_entries[index].count;
+                ++m_totalSamples;
+                return;
+            }
+            index = (index + 1u) & (m_entries.size() - 1u);
+        }
+        insert(index, key);
+    }
+
+    inline auto totalSamples() const -> uint64_t { return m_totalSamples; }
+
+    /**
+     * @return aggregated samples sorted by count, most frequent first
+     */
+    auto samples() const -> std::vector<Sample>;
+
+    void clear();
+
+    /**
+     * Writes "pc,lr,count" row per aggregated sample
+     */
+    void writeSamples(std::ostream& output) const;
+
+    /**
+     * Writes "function,caller,count" rows, PC and LR are resolved to the functions which contain them
+     */
+    void writeFunctions(std::ostream& output, const ElfFile& elf) const;
+
+private:
+    struct Entry {
+        uint64_t key = 0u;
+        uint64_t count = 0u;  ///< zero marks empty entry
+    };
+
+    static constexpr size_t InitialCapacity = 4096u;
+
+    static inline auto hash(uint64_t key) -> size_t
+    {
+        // Fibonacci hashing, PC and LR are mostly even and close to each other
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15u) >> 32u);
+    }
+
+    void insert(size_t index, uint64_t key);
+
+    uint64_t m_interval;
+    std::vector<Entry> m_entries;
+    size_t m_size = 0u;
+    uint64_t m_totalSamples = 0u;
+};
+
+}  // namespace stm32::debug
@@ -0,0 +1,190 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <tuple>
+#include <unordered_map>
+
+namespace stm32::debug
+{
+namespace
+{
+// Return addresses are halfword aligned, so the root frame never matches
+constexpr uint32_t NoReturnAddress = 0x1u;
+constexpr uint32_t NoParent = UINT32_MAX;
+
+}  // namespace
+
+Profiler::Profiler(std::vector<ElfFile::Symbol> functions)
+    : m_functions{std::move(functions)}
+    , m_nodes{}
+    , m_frames{}
+{
+    std::sort(m_functions.begin(), m_functions.end(), [](const ElfFile::Symbol& left, const ElfFile::Symbol& right) {
+        return left.address < right.address;
+    });
+    start(0u);
+}
+
+void Profiler::start(uint32_t pc)
+{
+    m_nodes.clear();
+    m_frames.clear();
+
+    m_nodes.push_back(Node{.function = functionStart(pc), .parent = NoParent, .self = 0u, .children = {}});
+    m_frames.push_back(Frame{.node = 0u, .returnAddress = NoReturnAddress});
+}
+
+void Profiler::call(uint32_t target, uint32_t returnAddress)
+{
+    if (m_frames.size() >= MaxStackDepth) {
+        return;
+    }
+
+    const auto parent = m_frames.back().node;
+    const auto function = functionStart(target);
+
+    auto& children = m_nodes[parent].children;
+    auto it = std::find_if(children.begin(), children.end(), [&](uint32_t child) {
+        return m_nodes[child].function == function;
+    });
+
+    uint32_t node;
+    if (it != children.end()) {
+        node = *it;
+    }
+    else {
+        node = static_cast<uint32_t>(m_nodes.size());
+        m_nodes[parent].children.push_back(node);
+        m_nodes.push_back(Node{.function = function, .parent = parent, .self = 0u, .children = {}});
+    }
+
+    m_frames.push_back(Frame{.node = node, .returnAddress = returnAddress & ~0x1u});
+}
+
+void Profiler::unwindTo(uint32_t target)
+{
+    // Branches inside a function are the common case, they don't match any frame
+    for (auto i = m_frames.size(); i > 1u; --i) {
+        if (m_frames[i - 1u].returnAddress == target) {
+            m_frames.resize(i - 1u);
+            return;
+        }
+    }
+}
+
+auto Profiler::functionStart(uint32_t address) const -> uint32_t
+{
+    auto it = std::upper_bound(m_functions.begin(), m_functions.end(), address, [](uint32_t value, const ElfFile::Symbol& symbol) {
+        return value < symbol.address;
+    });
+    if (it != m_functions.begin()) {
+        --it;
+        if (address - it->address < std::max(it->size, 1u)) {
+            return it->address;
+        }
+    }
+
+    // Unknown code is identified by its entry address
+    return address & ~0x1u;
+}
+
+auto Profiler::functionName(uint32_t function) const -> std::string
+{
+    const auto it = std::lower_bound(m_functions.begin(), m_functions.end(), function, [](const ElfFile::Symbol& symbol, uint32_t value) {
+        return symbol.address < value;
+    });
+    if (it != m_functions.end() && it->address == function) {
+        return it->name;
+    }
+
+    char name[11];
+    std::snprintf(name, sizeof(name), "0x%08" PRIx32, function);
+    return name;
+}
+
+auto Profiler::subtreeCount(uint32_t node) const -> uint64_t
+{
+    auto count = m_nodes[node].self;
+    for (const auto child : m_nodes[node].children) {
+        count += subtreeCount(child);
+    }
+    return count;
+}
+
+void Profiler::writeFoldedStacks(std::ostream& output) const
+{
+    std::vector<std::pair<uint32_t, std::string>> pending{{0u, functionName(m_nodes[0].function)}};
+    while (!pending.empty()) {
+        const auto [node, path] = std::move(pending.back());
+        pending.pop_back();
+
+        if (m_nodes[node].self != 0u) {
+            output << path << ' ' << m_nodes[node].self << '\n';
+        }
+        for (const auto child : m_nodes[node].children) {
+            pending.emplace_back(child, path + ';' + functionName(m_nodes[child].function));
+        }
+    }
+}
+
+auto Profiler::topFunctions(size_t count) const -> std::vector<FunctionStatistics>
+{
+    std::unordered_map<uint32_t, FunctionStatistics> functions;
+
+    // Total of a recursive function is counted only at its outermost activation
+    std::unordered_map<uint32_t, uint32_t> active;
+    const auto visit = [&](const auto& self, uint32_t node) -> void {
+        const auto function = m_nodes[node].function;
+        auto& statistics = functions[function];
+        statistics.self += m_nodes[node].self;
+
+        if (active[function]++ == 0u) {
+            statistics.total += subtreeCount(node);
+        }
+        for (const auto child : m_nodes[node].children) {
+            self(self, child);
+        }
+        --active[function];
+    };
+    visit(visit, 0u);
+
+    std::vector<FunctionStatistics> result;
+    for (auto& [function, statistics] : functions) {
+        statistics.name = functionName(function);
+        result.push_back(std::move(statistics));
+    }
+
+    std::sort(result.begin(), result.end(), [](const FunctionStatistics& left, const FunctionStatistics& right) {
+        return std::tie(right.self, right.total, left.name) < std::tie(left.self, left.total, right.name);
+    });
+    result.resize(std::min(count, result.size()));
+    return result;
+}
+
+void Profiler::writeTopTable(std::ostream& output, size_t count) const
+{
+    const auto functions = topFunctions(count);
+    const auto total = std::max<uint64_t>(totalInstructions(), 1u);
+
+    char line[64];
+    std::snprintf(line, sizeof(line), "%8s %14s %8s %14s  ", "self%", "self", "total%", "total");
+    output << line << "function\n";
+
+    for (const auto& function : functions) {
+        std::snprintf(line,
+                      sizeof(line),
+                      "%7.2f%% %14" PRIu64 " %7.2f%% %14" PRIu64 "  ",
+                      100.0 * static_cast<double>(function.self) / static_cast<double>(total),
+                      function.self,
+                      100.0 * static_cast<double>(function.total) / static_cast<double>(total),
+                      function.total);
+        output << line << function.name << '\n';
+    }
+}
+
+}  // namespace stm32::debug
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "../utils/general.hpp"
+#include "elf_file.hpp"
+
+namespace stm32::debug
+{
+/**
+ * Guest function-level profiler
+ *
+ * Keeps a shadow call stack and a calling context tree, every executed instruction is attributed to the function on
+ * top of the stack. Call is a PC write which leaves LR pointing after the instruction (BL, BLX). Return is a PC write to
+ * a return address of one of the stack frames, so BX LR, POP {PC}, LDR PC and exception return are all recognized, and
+ * frames skipped by longjmp-like code are unwound together. Exception entry is a call into its handler. Tail calls stay
+ * attributed to the caller.
+ *
+ * Flash wait states are charged per block, so counts are instructions rather than cycles.
+ */
+class Profiler {
+    RESTRICT_COPY(Profiler);
+
+public:
+    struct FunctionStatistics {
+        std::string name{};
+        uint64_t self = 0u;   ///< instructions executed in the function itself
+        uint64_t total = 0u;  ///< instructions executed in the function and its callees
+    };
+
+    static constexpr size_t MaxStackDepth = 1024u;
+
+    explicit Profiler(std::vector<ElfFile::Symbol> functions);
+
+    /**
+     * Resets profile and roots the call stack at the function which contains PC
+     */
+    void start(uint32_t pc);
+
+    inline void onInstruction() { ++m_nodes[m_frames.back().node].self; }
+
+    /**
+     * Called after an instruction which wrote PC
+     */
+    inline void onBranch(uint32_t target, uint32_t linkRegister, uint32_t sequentialAddress)
+    {
+        if (linkRegister == (sequentialAddress | 0x1u)) {
+            call(target, sequentialAddress);
+        }
+        else {
+            unwindTo(target);
+        }
+    }
+
+    inline void onException(uint32_t handler, uint32_t returnAddress) { call(handler, returnAddress); }
+
+    /**
+     * Writes stacks in Brendan Gregg's folded format, one "root;caller;callee count" line per calling context
+     */
+    void writeFoldedStacks(std::ostream& output) const;
+
+    /**
+     * Functions sorted by self count
+     */
+    auto topFunctions(size_t count) const -> std::vector<FunctionStatistics>;
+    void writeTopTable(std::ostream& output, size_t count) const;
+
+    inline auto totalInstructions() const -> uint64_t { return subtreeCount(0u); }
+
+private:
+    struct Node {
+        uint32_t function;  ///< start address of the function
+        uint32_t parent;
+        uint64_t self;
+        std::vector<uint32_t> children;
+    };
+
+    struct Frame {
+        uint32_t node;
+        uint32_t returnAddress;
+    };
+
+    void call(uint32_t target, uint32_t returnAddress);
+    void unwindTo(uint32_t target);
+    auto functionStart(uint32_t address) const -> uint32_t;
+    auto functionName(uint32_t function) const -> std::string;
+    auto subtreeCount(uint32_t node) const -> uint64_t;
+
+    std::vector<ElfFile::Symbol> m_functions;
+    std::vector<Node> m_nodes;
+    std::vector<Frame> m_frames;
+};
+
+}  // namespace stm32::debug
@@ -0,0 +1,329 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "reverse_execution.hpp"
+
+#include <algorithm>
+#include <span>
+
+#include "input_log.hpp"
+
+namespace stm32::debug
+{
+namespace
+{
+auto snapshotBytes(const Cpu::Snapshot& snapshot) -> size_t
+{
+    size_t bytes = sizeof(snapshot);
+    for (const auto& area : snapshot.memory.areas) {
+        bytes += area.size();
+    }
+    return bytes;
+}
+
+auto isHit(StopReason stopReason) -> bool
+{
+    return stopReason == StopReason::Breakpoint || stopReason == StopReason::Watchpoint;
+}
+
+/**
+ * Re-executed stops were already reported when the history was recorded
+ */
+void discardStop(Cpu& cpu, StopReason stopReason)
+{
+    if (stopReason == StopReason::Watchpoint) {
+        cpu.watchpoints().takeHit();
+    }
+    else if (stopReason == StopReason::StackOverflow) {
+        cpu.stackMonitor().takeOverflow();
+    }
+}
+
+}  // namespace
+
+ReverseExecution::ReverseExecution(Cpu& cpu, Config config)
+    : m_cpu{cpu}
+    , m_config{config}
+    , m_recorder{std::make_unique<InputRecorder>()}
+    , m_replayer{}
+    , m_checkpoints{}
+{
+    reset();
+}
+
+ReverseExecution::~ReverseExecution()
+{
+    if (m_cpu.inputRecorder() == m_recorder.get()) {
+        m_cpu.setInputRecorder(nullptr);
+    }
+    if (m_replayer != nullptr && m_cpu.inputReplayer() == m_replayer.get()) {
+        m_cpu.setInputReplayer(nullptr);
+    }
+}
+
+void ReverseExecution::reset()
+{
+    m_cpu.setInputReplayer(nullptr);
+    m_replayer.reset();
+    m_recorder->truncate(0u);
+    m_cpu.setInputRecorder(m_recorder.get());
+
+    m_checkpoints.clear();
+    m_checkpointBytes = 0u;
+    m_measuredTime = {};
+    m_measuredInstructions = 0u;
+
+    takeCheckpoint();
+    m_nextCheckpoint = position() + m_checkpointInterval;
+}
+
+auto ReverseExecution::run(uint64_t cycleBudget, uint64_t instructionBudget) -> StopReason
+{
+    const auto cycleLimit = m_cpu.cycles() + std::min(cycleBudget, UINT64_MAX - m_cpu.cycles());
+    const auto instructionLimit = position() + std::min(instructionBudget, UINT64_MAX - position());
+
+    while (true) {
+        if (isReplaying() && position() >= m_historyEnd) {
+            returnToHistoryEnd(StopReason::CycleLimit);
+        }
+        if (m_cpu.cycles() >= cycleLimit || position() >= instructionLimit) {
+            return StopReason::CycleLimit;
+        }
+
+        if (isReplaying()) {
+            const auto stopReason = m_cpu.run(cycleLimit - m_cpu.cycles(), std::min(m_historyEnd, instructionLimit) - position());
+            if (stopReason != StopReason::CycleLimit) {
+                if (position() >= m_historyEnd) {
+                    returnToHistoryEnd(stopReason);
+                }
+                return stopReason;
+            }
+            continue;
+        }
+
+        if (position() >= m_nextCheckpoint) {
+            updateCheckpointInterval();
+            takeCheckpoint();
+            m_nextCheckpoint = position() + m_checkpointInterval;
+        }
+
+        const auto startInstructions = position();
+        const auto startTime = std::chrono::steady_clock::now();
+        const auto stopReason = m_cpu.run(cycleLimit - m_cpu.cycles(), std::min(m_nextCheckpoint, instructionLimit) - position());
+        m_measuredTime += std::chrono::steady_clock::now() - startTime;
+        m_measuredInstructions += position() - startInstructions;
+
+        if (stopReason != StopReason::CycleLimit) {
+            return stopReason;
+        }
+    }
+}
+
+auto ReverseExecution::stepBack() -> bool
+{
+    if (position() == historyStart()) {
+        return false;
+    }
+
+    leaveHistoryEnd();
+    moveTo(position() - 1u);
+
+    // Continuing from here must not stop on the breakpoint which was already passed
+    if (m_cpu.breakpoints().contains(m_cpu.registers().PC())) {
+        m_cpu.skipBreakpointOnResume();
+    }
+    return true;
+}
+
+auto ReverseExecution::reverseContinue() -> std::optional<StopReason>
+{
+    if (position() == historyStart()) {
+        return std::nullopt;
+    }
+
+    leaveHistoryEnd();
+
+    // Intervals between checkpoints are scanned from the latest one, hits are counted on the first pass and the
+    // second pass stops on the last of them
+    auto end = position();
+    auto index = checkpointBefore(end - 1u);
+    while (true) {
+        startReplay(index);
+
+        uint32_t hits = 0u;
+        while (position() < end) {
+            const auto stopReason = m_cpu.run(UINT64_MAX, end - position());
+            if (isHit(stopReason) && position() < end) {
+                ++hits;
+            }
+            discardStop(m_cpu, stopReason);
+        }
+
+        if (hits != 0u) {
+            startReplay(index);
+            for (uint32_t hit = 0u;;) {
+                const auto stopReason = m_cpu.run(UINT64_MAX);
+                if (isHit(stopReason) && ++hit == hits) {
+                    return stopReason;
+                }
+                discardStop(m_cpu, stopReason);
+            }
+        }
+
+        if (index == 0u) {
+            startReplay(0u);
+            return std::nullopt;
+        }
+        end = m_checkpoints[index].instructions;
+        --index;
+    }
+}
+
+void ReverseExecution::discardFuture()
+{
+    if (isReplaying()) {
+        m_cpu.setInputReplayer(nullptr);
+        m_recorder->truncate(m_replayStart + m_replayer->position());
+        m_replayer.reset();
+        m_cpu.setInputRecorder(m_recorder.get());
+
+        const auto future = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), position(), [](uint64_t instructions, const Checkpoint& checkpoint) {
+            return instructions < checkpoint.instructions;
+        });
+        for (auto it = future; it != m_checkpoints.end(); ++it) {
+            m_checkpointBytes -= snapshotBytes(it->snapshot);
+        }
+        m_checkpoints.erase(future, m_checkpoints.end());
+        m_nextCheckpoint = position() + m_checkpointInterval;
+    }
+
+    // Changed state can't be reached by re-execution
+    takeCheckpoint();
+}
+
+void ReverseExecution::takeCheckpoint()
+{
+    auto checkpoint = Checkpoint{
+        .instructions = position(),
+        .inputRecord = isReplaying() ? m_replayStart + m_replayer->position() : static_cast<size_t>(m_recorder->recordCount()),
+        .snapshot = m_cpu.snapshot(),
+    };
+    m_checkpointBytes += snapshotBytes(checkpoint.snapshot);
+
+    auto it = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), checkpoint.instructions, [](uint64_t instructions, const Checkpoint& other) {
+        return instructions < other.instructions;
+    });
+    if (it != m_checkpoints.begin() && std::prev(it)->instructions == checkpoint.instructions) {
+        --it;
+        m_checkpointBytes -= snapshotBytes(it->snapshot);
+        *it = std::move(checkpoint);
+    }
+    else {
+        m_checkpoints.insert(it, std::move(checkpoint));
+    }
+
+    if (m_checkpointBytes > m_config.memoryBudget) {
+        thinCheckpoints();
+    }
+}
+
+void ReverseExecution::thinCheckpoints()
+{
+    // Start of history and the newer half stay, so that steps near the current position stay fast
+    const auto olderHalf = m_checkpoints.size() / 2u;
+    size_t kept = 1u;
+    for (size_t i = 1u; i < m_checkpoints.size(); ++i) {
+        if (i < olderHalf && i % 2u == 1u) {
+            m_checkpointBytes -= snapshotBytes(m_checkpoints[i].snapshot);
+            continue;
+        }
+        if (kept != i) {
+            m_checkpoints[kept] = std::move(m_checkpoints[i]);
+        }
+        ++kept;
+    }
+    m_checkpoints.resize(kept);
+}
+
+void ReverseExecution::updateCheckpointInterval()
+{
+    // Speed is measured on live execution only, short runs are dominated by the debugger
+    if (m_measuredTime < std::chrono::milliseconds{10}) {
+        return;
+    }
+
+    const auto seconds = std::chrono::duration<double>{m_measuredTime}.count();
+    const auto latency = std::chrono::duration<double>{m_config.stepLatency}.count();
+    const auto interval = static_cast<double>(m_measuredInstructions) / seconds * latency / 2.0;
+    m_checkpointInterval = std::max(MinCheckpointInterval, static_cast<uint64_t>(interval));
+
+    m_measuredTime = {};
+    m_measuredInstructions = 0u;
+}
+
+void ReverseExecution::leaveHistoryEnd()
+{
+    if (isReplaying()) {
+        return;
+    }
+
+    m_historyEnd = position();
+    if (m_checkpoints.back().instructions != m_historyEnd) {
+        takeCheckpoint();
+    }
+    m_cpu.setInputRecorder(nullptr);
+}
+
+void ReverseExecution::returnToHistoryEnd(StopReason stopReason)
+{
+    m_cpu.setInputReplayer(nullptr);
+    m_replayer.reset();
+
+    // Replayed state is the recorded one, but inputs scheduled for later are kept only by the checkpoint
+    m_cpu.restore(m_checkpoints.back().snapshot);
+    if (stopReason == StopReason::Breakpoint) {
+        m_cpu.skipBreakpointOnResume();
+    }
+
+    m_cpu.setInputRecorder(m_recorder.get());
+    m_nextCheckpoint = position() + m_checkpointInterval;
+}
+
+void ReverseExecution::startReplay(size_t checkpoint)
+{
+    m_cpu.setInputRecorder(nullptr);
+    m_cpu.setInputReplayer(nullptr);
+
+    m_cpu.restore(m_checkpoints[checkpoint].snapshot);
+    m_replayStart = m_checkpoints[checkpoint].inputRecord;
+    m_replayer = std::make_unique<InputReplayer>(std::span{m_recorder->records()}.subspan(m_replayStart));
+    m_cpu.setInputReplayer(m_replayer.get());
+}
+
+auto ReverseExecution::checkpointBefore(uint64_t instructions) const -> size_t
+{
+    const auto it = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), instructions, [](uint64_t value, const Checkpoint& checkpoint) {
+        return value < checkpoint.instructions;
+    });
+    return static_cast<size_t>(std::distance(m_checkpoints.begin(), it)) - 1u;
+}
+
+void ReverseExecution::moveTo(uint64_t instructions)
+{
+    startReplay(checkpointBefore(instructions));
+
+    while (position() < instructions) {
+        // Re-execution across a sparse part of the history leaves checkpoints behind
+        const auto previous = m_checkpoints[checkpointBefore(position())].instructions;
+        const auto next = std::min(instructions, std::max(previous + m_checkpointInterval, position() + 1u));
+        while (position() < next) {
+            discardStop(m_cpu, m_cpu.run(UINT64_MAX, next - position()));
+        }
+
+        if (position() < instructions) {
+            takeCheckpoint();
+        }
+    }
+}
+
+}  // namespace stm32::debug
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "../cpu.hpp"
+
+namespace stm32::debug
+{
+class InputRecorder;
+class InputReplayer;
+
+/**
+ * Stepping backwards and reverse continue on top of periodic checkpoints and deterministic re-execution
+ *
+ * Forward execution goes through run(), which records delivered inputs in memory and takes a checkpoint every
+ * checkpoint interval instructions. Moving back restores the closest earlier checkpoint and re-executes up to the
+ * target instruction with the recorded inputs. Running forward from the past replays the history up to its end and
+ * continues live from there.
+ *
+ * The interval follows the measured execution speed, so that re-executing one interval takes half of the step latency.
+ * When checkpoints exceed the memory budget, every second checkpoint in the older half of the history is dropped, and
+ * re-execution across a sparse part inserts checkpoints back, so only the first step into it is slower.
+ *
+ * Re-executed instructions are seen by tracepoints, conditional breakpoint hit counters and host-side tools attached
+ * to the core. Changing machine state in the past invalidates the rest of the history, it must be dropped with
+ * discardFuture().
+ */
+class ReverseExecution {
+public:
+    struct Config {
+        std::chrono::milliseconds stepLatency;  ///< upper bound of a reverse step
+        size_t memoryBudget;                    ///< bytes of memory kept in checkpoints
+    };
+
+    static constexpr uint64_t InitialCheckpointInterval = 1000000u;
+    static constexpr uint64_t MinCheckpointInterval = 10000u;
+
+    explicit ReverseExecution(Cpu& cpu, Config config);
+    ~ReverseExecution();
+
+public:
+    RESTRICT_COPY(ReverseExecution);
+
+    /**
+     * Drops the history and starts a new one at the current machine state
+     */
+    void reset();
+
+    /**
+     * Executes forward as Cpu::run does, replaying the history first when the core is in the past
+     */
+    auto run(uint64_t cycleBudget, uint64_t instructionBudget = UINT64_MAX) -> StopReason;
+
+    /**
+     * Moves back by one instruction
+     * @return false at the start of history
+     */
+    auto stepBack() -> bool;
+
+    /**
+     * Moves back to the latest breakpoint or watchpoint hit, the core is left stopped on it as by run
+     * @return stop reason of the hit, empty if there was none and the core is at the start of history
+     */
+    auto reverseContinue() -> std::optional<StopReason>;
+
+    /**
+     * Makes the current position the end of history, called after the debugger has changed machine state
+     */
+    void discardFuture();
+
+    /**
+     * Positions are counted in executed instructions
+     */
+    inline auto position() const -> uint64_t { return m_cpu.instructions(); }
+    inline auto historyStart() const -> uint64_t { return m_checkpoints.front().instructions; }
+    inline auto historyEnd() const -> uint64_t { return isReplaying() ? m_historyEnd : position(); }
+
+    inline auto isReplaying() const -> bool { return m_replayer != nullptr; }
+    inline auto checkpointCount() const -> size_t { return m_checkpoints.size(); }
+    inline auto checkpointInterval() const -> uint64_t { return m_checkpointInterval; }
+
+private:
+    struct Checkpoint {
+        uint64_t instructions = 0u;
+        size_t inputRecord = 0u;
+        Cpu::Snapshot snapshot = Cpu::Snapshot{};
+    };
+
+    void takeCheckpoint();
+    void thinCheckpoints();
+    void updateCheckpointInterval();
+
+    void leaveHistoryEnd();
+    void returnToHistoryEnd(StopReason stopReason);
+    void startReplay(size_t checkpoint);
+    auto checkpointBefore(uint64_t instructions) const -> size_t;
+
+    void moveTo(uint64_t instructions);
+
+    Cpu& m_cpu;
+    Config m_config;
+
+    std::unique_ptr<InputRecorder> m_recorder;
+    std::unique_ptr<InputReplayer> m_replayer;
+    size_t m_replayStart = 0u;
+
+    std::vector<Checkpoint> m_checkpoints;
+    size_t m_checkpointBytes = 0u;
+    uint64_t m_checkpointInterval = InitialCheckpointInterval;
+    uint64_t m_nextCheckpoint = 0u;
+    uint64_t m_historyEnd = 0u;
+
+    std::chrono::steady_clock::duration m_measuredTime{};
+    uint64_t m_measuredInstructions = 0u;
+};
+
+}  // namespace stm32::debug
@@ -0,0 +1,432 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "semihosting.hpp"
+
+#include <fcntl.h>
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+#include <string>
+
+#include "../cpu.hpp"
+#include "input_log.hpp"
+
+namespace stm32::debug
+{
+namespace
+{
+// see: Semihosting for AArch32 and AArch64, semihosting operations
+enum Operation : uint32_t {
+    SysOpen = 0x01u,
+    SysClose = 0x02u,
+    SysWriteC = 0x03u,
+    SysWrite0 = 0x04u,
+    SysWrite = 0x05u,
+    SysRead = 0x06u,
+    SysReadC = 0x07u,
+    SysClock = 0x10u,
+    SysTime = 0x11u,
+    SysErrno = 0x13u,
+    SysExit = 0x18u,
+    SysExitExtended = 0x20u,
+};
+
+constexpr uint32_t ApplicationExit = 0x20026u;
+constexpr uint32_t Failure = UINT32_MAX;
+
+constexpr uint32_t BufferSize = 64u * 1024u;
+constexpr uint32_t TransferSize = 64u * 1024u;
+constexpr uint32_t MaxStringSize = 64u * 1024u;
+constexpr uint32_t StringChunkSize = 64u;
+
+constexpr int OpenFlags[] = {O_RDONLY, O_RDWR, O_WRONLY | O_CREAT | O_TRUNC, O_RDWR | O_CREAT | O_TRUNC, O_WRONLY | O_CREAT | O_APPEND,
+                             O_RDWR | O_CREAT | O_APPEND};
+
+// Descriptors are not inherited by child processes, the CRT of Windows also has to be told not to translate newlines
+#if defined(_WIN32)
+constexpr int HostOpenFlags = O_BINARY | O_NOINHERIT;
+#else
+constexpr int HostOpenFlags = O_CLOEXEC;
+#endif
+
+auto readWord(Cpu& cpu, uint32_t address) -> uint32_t
+{
+    return cpu.memory().read<uint32_t>(address);
+}
+
+}  // namespace
+
+/**
+ * Host file descriptor with a write buffer
+ */
+class Semihosting::HostFile {
+public:
+    explicit HostFile(int descriptor, bool owned)
+        : m_descriptor{descriptor}
+        , m_owned{owned}
+        , m_buffer{}
+    {
+    }
+
+    ~HostFile()
+    {
+        flush();
+        if (m_owned) {
+            ::close(m_descriptor);
+        }
+    }
+
+    HostFile(const HostFile&) = delete;
+    HostFile& operator=(const HostFile&) = delete;
+
+    /**
+     * @return false if buffered data couldn't be written
+     */
+    auto write(const uint8_t* data, uint32_t size) -> bool
+    {
+        if (m_buffer.size() + size > BufferSize && !flush()) {
+            return false;
+        }
+        if (size >= BufferSize) {
+            return writeAll(data, size);
+        }
+
+        if (m_buffer.capacity() == 0u) {
+            m_buffer.reserve(BufferSize);
+        }
+        m_buffer.insert(m_buffer.end(), data, data + size);
+        return true;
+    }
+
+    /**
+     * @return number of bytes read, or -1 on error
+     */
+    auto read(uint8_t* data, uint32_t size) -> ssize_t
+    {
+        if (!flush()) {
+            return -1;
+        }
+
+        ssize_t result;
+        do {
+            result = ::read(m_descriptor, data, size);
+        } while (result < 0 && errno == EINTR);
+        return result;
+    }
+
+    auto flush() -> bool
+    {
+        const auto written = writeAll(m_buffer.data(), m_buffer.size());
+        m_buffer.clear();
+        return written;
+    }
+
+private:
+    auto writeAll(const uint8_t* data, size_t size) -> bool
+    {
+        while (size != 0u) {
+            const auto written = ::write(m_descriptor, data, static_cast<uint32_t>(std::min<size_t>(size, TransferSize)));
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return false;
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    int m_descriptor;
+    bool m_owned;
+    std::vector<uint8_t> m_buffer;
+};
+
+Semihosting::Semihosting()
+    : Semihosting{Config{}}
+{
+}
+
+Semihosting::Semihosting(const Config& config)
+    : m_config{config}
+    , m_consoleInput{std::make_shared<HostFile>(config.consoleInput, false)}
+    , m_consoleOutput{std::make_shared<HostFile>(config.consoleOutput, false)}
+    , m_consoleError{std::make_shared<HostFile>(config.consoleError, false)}
+    , m_files{}
+    , m_transfer{}
+    , m_readData{}
+    , m_exitStatus{}
+{
+}
+
+Semihosting::~Semihosting() = default;
+
+void Semihosting::call(Cpu& cpu)
+{
+    const auto operation = cpu.R(0);
+    const auto parameter = cpu.R(1);
+
+    // Exit depends only on the guest, the files are left alone while replaying
+    if (operation == SysExit || operation == SysExitExtended) {
+        if (cpu.inputReplayer() == nullptr) {
+            flush();
+        }
+        if (operation == SysExit) {
+            exit(parameter == ApplicationExit ? 0 : 1);
+        }
+        else {
+            exit(readWord(cpu, parameter) == ApplicationExit ? static_cast<int>(readWord(cpu, parameter + 4u)) : 1);
+        }
+        return;
+    }
+
+    // Output was written when the log was recorded. Logs without host calls are replayed against the live host
+    if (auto* replayer = cpu.inputReplayer(); replayer != nullptr) {
+        if (operation == SysWriteC || operation == SysWrite0) {
+            return;
+        }
+        if (replayer->isHostCallNext()) {
+            replay(cpu, operation, parameter, *replayer->take().hostCall);
+            return;
+        }
+    }
+
+    uint32_t result;
+    m_readData.clear();
+    switch (operation) {
+        case SysOpen:
+            result = open(cpu, parameter);
+            break;
+        case SysClose:
+            result = close(readWord(cpu, parameter));
+            break;
+        case SysWriteC: {
+            const auto c = cpu.memory().read<uint8_t>(parameter);
+            m_consoleOutput->write(&c, 1u);
+            return;
+        }
+        case SysWrite0:
+            writeString(cpu, parameter);
+            return;
+        case SysWrite:
+            result = write(cpu, parameter);
+            break;
+        case SysRead:
+            result = read(cpu, parameter);
+            break;
+        case SysReadC:
+            result = readCharacter();
+            break;
+        case SysClock:
+            result = static_cast<uint32_t>(cpu.cycles() * 100u / m_config.frequency);
+            break;
+        case SysTime:
+            result = static_cast<uint32_t>(std::time(nullptr));
+            break;
+        case SysErrno:
+            result = static_cast<uint32_t>(m_errno);
+            break;
+        default:
+            m_errno = ENOSYS;
+            result = Failure;
+            break;
+    }
+
+    cpu.setR(0, result);
+    if (auto* recorder = cpu.inputRecorder(); recorder != nullptr) {
+        recorder->recordHostCall(cpu.cycles(), result, m_readData);
+    }
+}
+
+void Semihosting::flush()
+{
+    m_consoleOutput->flush();
+    m_consoleError->flush();
+    for (const auto& file : m_files) {
+        if (file != nullptr) {
+            file->flush();
+        }
+    }
+}
+
+auto Semihosting::takeExit() -> std::optional<int>
+{
+    if (!m_exitPending) {
+        return std::nullopt;
+    }
+    m_exitPending = false;
+    return m_exitStatus;
+}
+
+auto Semihosting::open(Cpu& cpu, uint32_t block) -> uint32_t
+{
+    const auto nameAddress = readWord(cpu, block);
+    const auto mode = readWord(cpu, block + 4u);
+    const auto nameSize = std::min(readWord(cpu, block + 8u), MaxStringSize);
+
+    std::string name(nameSize, '\0');
+    cpu.memory().readBlock(nameAddress, reinterpret_cast<uint8_t*>(name.data()), nameSize);
+
+    if (mode >= 12u) {
+        m_errno = EINVAL;
+        return Failure;
+    }
+
+    // Mode is the index into fopen mode strings: r, rb, r+, r+b, w, wb, w+, w+b, a, ab, a+, a+b
+    if (name == ":tt") {
+        return addFile(mode < 4u ? m_consoleInput : mode < 8u ? m_consoleOutput : m_consoleError);
+    }
+
+    const auto descriptor = ::open(name.c_str(), OpenFlags[mode / 2u] | HostOpenFlags, 0644);
+    if (descriptor < 0) {
+        m_errno = errno;
+        return Failure;
+    }
+    return addFile(std::make_shared<HostFile>(descriptor, true));
+}
+
+auto Semihosting::close(uint32_t handle) -> uint32_t
+{
+    if (file(handle) == nullptr) {
+        m_errno = EBADF;
+        return Failure;
+    }
+
+    // Console is shared by all of its handles and stays open
+    auto& entry = m_files[handle - 1u];
+    entry->flush();
+    entry.reset();
+    return 0u;
+}
+
+auto Semihosting::write(Cpu& cpu, uint32_t block) -> uint32_t
+{
+    auto* target = file(readWord(cpu, block));
+    auto address = readWord(cpu, block + 4u);
+    const auto size = readWord(cpu, block + 8u);
+    if (target == nullptr) {
+        m_errno = EBADF;
+        return Failure;
+    }
+
+    // Result is the number of bytes which were not written
+    for (uint32_t done = 0u; done < size;) {
+        const auto chunk = std::min(size - done, TransferSize);
+        m_transfer.resize(chunk);
+        cpu.memory().readBlock(address, m_transfer.data(), chunk);
+        if (!target->write(m_transfer.data(), chunk)) {
+            m_errno = errno;
+            return size - done;
+        }
+        address += chunk;
+        done += chunk;
+    }
+    return 0u;
+}
+
+auto Semihosting::read(Cpu& cpu, uint32_t block) -> uint32_t
+{
+    auto* source = file(readWord(cpu, block));
+    auto address = readWord(cpu, block + 4u);
+    const auto size = readWord(cpu, block + 8u);
+    if (source == nullptr) {
+        m_errno = EBADF;
+        return Failure;
+    }
+
+    // Console output is written before blocking on its input, so that prompts are visible
+    if (source == m_consoleInput.get()) {
+        m_consoleOutput->flush();
+        m_consoleError->flush();
+    }
+
+    // Result is the number of bytes which were not read, short reads stop at the end of file or available input
+    for (uint32_t done = 0u; done < size;) {
+        const auto chunk = std::min(size - done, TransferSize);
+        m_transfer.resize(chunk);
+        const auto count = source->read(m_transfer.data(), chunk);
+        if (count < 0) {
+            m_errno = errno;
+            return done == 0u ? Failure : size - done;
+        }
+        cpu.memory().writeBlock(address, m_transfer.data(), static_cast<uint32_t>(count));
+        if (cpu.inputRecorder() != nullptr) {
+            m_readData.insert(m_readData.end(), m_transfer.begin(), m_transfer.begin() + count);
+        }
+        address += static_cast<uint32_t>(count);
+        done += static_cast<uint32_t>(count);
+        if (static_cast<uint32_t>(count) < chunk) {
+            return size - done;
+        }
+    }
+    return 0u;
+}
+
+auto Semihosting::readCharacter() -> uint32_t
+{
+    m_consoleOutput->flush();
+    m_consoleError->flush();
+
+    uint8_t c = 0u;
+    const auto count = m_consoleInput->read(&c, 1u);
+    if (count < 0) {
+        m_errno = errno;
+    }
+    return count == 1 ? c : Failure;
+}
+
+void Semihosting::writeString(Cpu& cpu, uint32_t address)
+{
+    // String length is unknown, so guest memory is copied in chunks up to the terminator
+    uint8_t chunk[StringChunkSize];
+    for (uint32_t offset = 0u; offset < MaxStringSize; offset += StringChunkSize) {
+        cpu.memory().readBlock(address + offset, chunk, StringChunkSize);
+        const auto* end = std::find(std::begin(chunk), std::end(chunk), uint8_t{0u});
+        m_consoleOutput->write(chunk, static_cast<uint32_t>(end - std::begin(chunk)));
+        if (end != std::end(chunk)) {
+            return;
+        }
+    }
+}
+
+void Semihosting::exit(int status)
+{
+    m_exitStatus = status;
+    m_exitPending = true;
+}
+
+void Semihosting::replay(Cpu& cpu, uint32_t operation, uint32_t parameter, const HostCallResult& result)
+{
+    if (operation == SysRead && !result.data.empty()) {
+        cpu.memory().writeBlock(readWord(cpu, parameter + 4u), result.data.data(), static_cast<uint32_t>(result.data.size()));
+    }
+    cpu.setR(0, result.result);
+}
+
+auto Semihosting::file(uint32_t handle) const -> HostFile*
+{
+    if (handle == 0u || handle > m_files.size()) {
+        return nullptr;
+    }
+    return m_files[handle - 1u].get();
+}
+
+auto Semihosting::addFile(std::shared_ptr<HostFile> file) -> uint32_t
+{
+    auto it = std::find(m_files.begin(), m_files.end(), nullptr);
+    if (it == m_files.end()) {
+        it = m_files.insert(it, nullptr);
+    }
+    *it = std::move(file);
+    return static_cast<uint32_t>(it - m_files.begin()) + 1u;
+}
+
+}  // namespace stm32::debug
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "../utils/general.hpp"
+
+namespace stm32
+{
+class Cpu;
+}  // namespace stm32
+
+namespace stm32::debug
+{
+struct HostCallResult;
+
+/**
+ * ARM semihosting: host services requested by the guest with BKPT 0xAB, operation number in R0 and parameter
+ * (usually a pointer to the argument block) in R1, result is returned in R0
+ *
+ * Supported operations are SYS_OPEN, SYS_CLOSE, SYS_WRITEC, SYS_WRITE0, SYS_WRITE, SYS_READ, SYS_READC, SYS_CLOCK,
+ * SYS_TIME, SYS_ERRNO, SYS_EXIT and SYS_EXIT_EXTENDED. Host files are written through per-file buffers which are
+ * flushed when full, before reading the same file, on close and on exit, so printing a character doesn't cost a
+ * syscall. The guest console is the ":tt" file, opened for reading it is the console input, for writing the output and
+ * for appending the error output.
+ *
+ * Results of calls are logged by the input recorder of the core. While the core replays an input log they are taken
+ * from it and the host isn't touched, so re-executed output isn't written again.
+ */
+class Semihosting {
+public:
+    static constexpr uint8_t BreakpointImmediate = 0xABu;
+
+    struct Config {
+        int consoleInput = 0;            ///< host descriptor of the console input, not owned
+        int consoleOutput = 1;           ///< host descriptor of the console output, not owned
+        int consoleError = 2;            ///< host descriptor of the console error output, not owned
+        uint64_t frequency = 72000000u;  ///< core frequency in Hz, SYS_CLOCK reports virtual time
+    };
+
+    explicit Semihosting();
+    explicit Semihosting(const Config& config);
+    ~Semihosting();
+
+public:
+    RESTRICT_COPY(Semihosting);
+
+    /**
+     * Executes the operation requested by the guest
+     */
+    void call(Cpu& cpu);
+
+    /**
+     * Writes out buffered data of all open files
+     */
+    void flush();
+
+    /**
+     * Exit status, ADP_Stopped_ApplicationExit is a success and other stop reasons are reported as 1
+     */
+    inline auto exitStatus() const -> std::optional<int> { return m_exitStatus; }
+
+    /**
+     * Exit request which wasn't reported by the run loop yet
+     */
+    inline auto isExitPending() const -> bool { return m_exitPending; }
+    auto takeExit() -> std::optional<int>;
+
+private:
+    class HostFile;
+
+    auto open(Cpu& cpu, uint32_t block) -> uint32_t;
+    auto close(uint32_t handle) -> uint32_t;
+    auto write(Cpu& cpu, uint32_t block) -> uint32_t;
+    auto read(Cpu& cpu, uint32_t block) -> uint32_t;
+    auto readCharacter() -> uint32_t;
+    void replay(Cpu& cpu, uint32_t operation, uint32_t parameter, const HostCallResult& result);
+    void writeString(Cpu& cpu, uint32_t address);
+    void exit(int status);
+
+    auto file(uint32_t handle) const -> HostFile*;
+    auto addFile(std::shared_ptr<HostFile> file) -> uint32_t;
+
+    Config m_config;
+    std::shared_ptr<HostFile> m_consoleInput;
+    std::shared_ptr<HostFile> m_consoleOutput;
+    std::shared_ptr<HostFile> m_consoleError;
+
+    // guest handle is the index + 1, closed handles are reused
+    std::vector<std::shared_ptr<HostFile>> m_files;
+    std::vector<uint8_t> m_transfer;
+    std::vector<uint8_t> m_readData;  ///< data of the last SYS_READ, kept for the input log
+    int m_errno = 0;
+
+    std::optional<int> m_exitStatus;
+    bool m_exitPending = false;
+};
+
+}  // namespace stm32::debug
@@ -0,0 +1,42 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "stack_monitor.hpp"
+
+#include <utility>
+
+namespace stm32::debug
+{
+void StackMonitor::reset()
+{
+    m_top.fill(std::nullopt);
+    m_lowest.fill(UINT32_MAX);
+    m_overflow.reset();
+}
+
+auto StackMonitor::top(StackType stack) const -> std::optional<uint32_t>
+{
+    return m_top[static_cast<size_t>(stack)];
+}
+
+auto StackMonitor::lowest(StackType stack) const -> std::optional<uint32_t>
+{
+    const auto index = static_cast<size_t>(stack);
+    if (!m_top[index].has_value()) {
+        return std::nullopt;
+    }
+    return m_lowest[index];
+}
+
+auto StackMonitor::peakUsage(StackType stack) const -> uint32_t
+{
+    const auto index = static_cast<size_t>(stack);
+    return m_top[index].has_value() ? *m_top[index] - m_lowest[index] : 0u;
+}
+
+auto StackMonitor::takeOverflow() -> std::optional<StackOverflow>
+{
+    return std::exchange(m_overflow, std::nullopt);
+}
+
+}  // namespace stm32::debug
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+
+namespace stm32::debug
+{
+enum class StackType : uint8_t {
+    Main = 0u,
+    Process = 1u,
+};
+
+/**
+ * Stack pointer value which went below the configured limit
+ */
+struct StackOverflow {
+    StackType stack;              ///< overflowed stack
+    uint32_t stackPointer;        ///< new stack pointer value
+    uint32_t limit;               ///< configured limit
+    uint32_t instructionAddress;  ///< instruction which moved the stack pointer
+};
+
+/**
+ * Tracks the lowest SP_main and SP_process values and traps when a stack grows below its limit
+ *
+ * The core reports only the instructions which write a stack pointer (push, SP as destination register, MSR and
+ * exception stacking), so monitoring costs nothing on other instructions. The first value written to a stack after
+ * reset is taken as its top.
+ */
+class StackMonitor {
+public:
+    explicit StackMonitor() = default;
+
+    /**
+     * Forgets recorded values and pending trap, limits are kept
+     */
+    void reset();
+
+    inline void update(StackType stack, uint32_t stackPointer, uint32_t instructionAddress)
+    {
+        const auto index = static_cast<size_t>(stack);
+        if (stackPointer < m_lowest[index]) {
+            if (!m_top[index].has_value()) {
+                m_top[index] = stackPointer;
+            }
+            m_lowest[index] = stackPointer;
+        }
+
+        if (stackPointer < m_limits[index] && !m_overflow.has_value()) {
+            m_overflow = StackOverflow{stack, stackPointer, m_limits[index], instructionAddress};
+        }
+    }
+
+    /**
+     * Sets the lowest allowed stack pointer value, zero disables the trap
+     */
+    inline void setLimit(StackType stack, uint32_t limit) { m_limits[static_cast<size_t>(stack)] = limit; }
+    inline auto limit(StackType stack) const -> uint32_t { return m_limits[static_cast<size_t>(stack)]; }
+
+    /**
+     * @return first stack pointer value written after reset
+     */
+    auto top(StackType stack) const -> std::optional<uint32_t>;
+
+    /**
+     * @return lowest stack pointer value written after reset
+     */
+    auto lowest(StackType stack) const -> std::optional<uint32_t>;
+
+    /**
+     * @return maximum number of bytes used by the stack after reset
+     */
+    auto peakUsage(StackType stack) const -> uint32_t;
+
+    inline auto isOverflowed() const -> bool { return m_overflow.has_value(); }
+    auto takeOverflow() -> std::optional<StackOverflow>;
+
+private:
+    std::array<std::optional<uint32_t>, 2u> m_top{};
+    std::array<uint32_t, 2u> m_lowest{UINT32_MAX, UINT32_MAX};
+    std::array<uint32_t, 2u> m_limits{0u, 0u};
+    std::optional<StackOverflow> m_overflow{};
+};
+
+}  // namespace stm32::debug
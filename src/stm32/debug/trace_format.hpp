@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace stm32::debug::trace
+{
+/**
+ * @brief Binary instruction trace format
+ *
+ * File starts with the 8-byte Magic followed by the little-endian 32-bit Version. Records follow, each starts with a tag
+ * byte whose two lowest bits select the kind:
+ *
+ * Instruction:  [7:4] PC delta from previous instruction in halfwords + 7, 15 means the zigzag varint delta follows,
+ *               [3] executed, [2] conditional (instruction was inside IT block)
+ * DataAccess:   [4:3] log2 of access size, [2] write; followed by zigzag varint address delta from previous access and
+ *               varint value. Access belongs to the last instruction record.
+ * Sync:         followed by 64-bit instruction index, 64-bit cycle and 32-bit PC, all little-endian. Resets the delta
+ *               state, so decoding can start at any sync point.
+ * End:          followed by index of sync points: (64-bit file offset, 64-bit instruction index) pairs, 64-bit pair
+ *               count and the 8-byte IndexMagic, so the index is found from the end of the file.
+ *
+ * Conditional branches outside IT blocks are not marked, taken and not taken branches differ by the PC delta.
+ */
+constexpr std::array<char, 8> Magic = {'S', 'T', 'M', '3', '2', 'T', 'R', 'C'};
+constexpr std::array<char, 8> IndexMagic = {'T', 'R', 'C', 'I', 'N', 'D', 'E', 'X'};
+constexpr uint32_t Version = 1u;
+
+enum Tag : uint8_t {
+    Instruction = 0b00u,
+    DataAccess = 0b01u,
+    Sync = 0b10u,
+    End = 0b11u,
+};
+
+constexpr uint8_t TagMask = 0b11u;
+constexpr uint8_t ConditionalFlag = 0x1u << 2u;
+constexpr uint8_t ExecutedFlag = 0x1u << 3u;
+constexpr uint8_t WriteFlag = 0x1u << 2u;
+
+constexpr int32_t ShortDeltaBias = 7;
+constexpr uint8_t LongDelta = 0xFu;
+
+constexpr size_t MaxRecordSize = 32u;
+
+inline auto zigzagEncode(int32_t value) -> uint32_t
+{
+    return (static_cast<uint32_t>(value) << 1u) ^ static_cast<uint32_t>(value >> 31);
+}
+
+inline auto zigzagDecode(uint32_t value) -> int32_t
+{
+    return static_cast<int32_t>(value >> 1u) ^ -static_cast<int32_t>(value & 0x1u);
+}
+
+}  // namespace stm32::debug::trace
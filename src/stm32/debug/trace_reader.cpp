@@ -0,0 +1,168 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "trace_reader.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+
+namespace stm32::debug
+{
+TraceReader::TraceReader(const std::string& path)
+    : m_stream{path, std::ios::binary}
+    , m_syncPoints{}
+    , m_peeked{}
+{
+    if (!m_stream) {
+        throw std::system_error{errno, std::generic_category(), path};
+    }
+
+    std::array<char, 8> magic{};
+    m_stream.read(magic.data(), magic.size());
+    if (!m_stream || magic != trace::Magic || readFixed(4u) != trace::Version) {
+        throw std::runtime_error{path + " is not a supported trace"};
+    }
+
+    readIndex();
+}
+
+auto TraceReader::next() -> std::optional<TraceEvent>
+{
+    if (m_peeked.has_value()) {
+        return std::exchange(m_peeked, std::nullopt);
+    }
+
+    while (true) {
+        const auto tag = readByte();
+        switch (tag & trace::TagMask) {
+            case trace::Instruction: {
+                const auto shortDelta = static_cast<uint8_t>(tag >> 4u);
+                const auto delta = shortDelta == trace::LongDelta ? trace::zigzagDecode(readVarint())
+                                                                  : static_cast<int32_t>(shortDelta) - trace::ShortDeltaBias;
+                m_previousAddress += static_cast<uint32_t>(delta * 2);
+
+                return TraceEvent{
+                    .type = trace::Instruction,
+                    .instruction = m_instruction++,
+                    .address = m_previousAddress,
+                    .value = 0u,
+                    .size = 0u,
+                    .write = false,
+                    .conditional = (tag & trace::ConditionalFlag) != 0u,
+                    .executed = (tag & trace::ExecutedFlag) != 0u,
+                };
+            }
+            case trace::DataAccess: {
+                m_previousDataAddress += static_cast<uint32_t>(trace::zigzagDecode(readVarint()));
+                const auto value = readVarint();
+
+                return TraceEvent{
+                    .type = trace::DataAccess,
+                    .instruction = m_instruction - 1u,
+                    .address = m_previousDataAddress,
+                    .value = value,
+                    .size = static_cast<uint8_t>(1u << ((tag >> 3u) & 0x3u)),
+                    .write = (tag & trace::WriteFlag) != 0u,
+                    .conditional = false,
+                    .executed = false,
+                };
+            }
+            case trace::Sync:
+                m_instruction = readFixed(8u);
+                readFixed(8u);
+                m_previousAddress = static_cast<uint32_t>(readFixed(4u));
+                m_previousDataAddress = 0u;
+                break;
+            default:
+                return std::nullopt;
+        }
+    }
+}
+
+auto TraceReader::seek(uint64_t instruction) -> bool
+{
+    auto it = std::upper_bound(m_syncPoints.begin(), m_syncPoints.end(), instruction, [](uint64_t value, const SyncPoint& syncPoint) {
+        return value < syncPoint.instruction;
+    });
+    if (it == m_syncPoints.begin()) {
+        return false;
+    }
+    --it;
+
+    m_stream.clear();
+    m_stream.seekg(static_cast<std::streamoff>(it->offset));
+    m_peeked.reset();
+
+    while (auto event = next()) {
+        if (event->type == trace::Instruction && event->instruction == instruction) {
+            m_peeked = event;
+            return true;
+        }
+    }
+    return false;
+}
+
+auto TraceReader::readByte() -> uint8_t
+{
+    const auto c = m_stream.get();
+    if (c == std::ifstream::traits_type::eof()) {
+        throw std::runtime_error{"unexpected end of trace"};
+    }
+    return static_cast<uint8_t>(c);
+}
+
+auto TraceReader::readVarint() -> uint32_t
+{
+    uint32_t value = 0u;
+    for (uint32_t shift = 0u; shift < 35u; shift += 7u) {
+        const auto byte = readByte();
+        value |= static_cast<uint32_t>(byte & 0x7Fu) << shift;
+        if ((byte & 0x80u) == 0u) {
+            return value;
+        }
+    }
+    throw std::runtime_error{"malformed trace varint"};
+}
+
+auto TraceReader::readFixed(uint32_t size) -> uint64_t
+{
+    uint64_t value = 0u;
+    for (uint32_t i = 0; i < size; ++i) {
+        value |= uint64_t{readByte()} << (8u * i);
+    }
+    return value;
+}
+
+void TraceReader::readIndex()
+{
+    const auto recordsOffset = m_stream.tellg();
+
+    // count and magic are the last 16 bytes of a closed trace, unfinished trace has no index and can't be seeked
+    m_stream.seekg(0, std::ios::end);
+    if (m_stream.tellg() - recordsOffset < 16) {
+        m_stream.seekg(recordsOffset);
+        return;
+    }
+
+    m_stream.seekg(-16, std::ios::end);
+    const auto count = readFixed(8u);
+    std::array<char, 8> magic{};
+    m_stream.read(magic.data(), magic.size());
+
+    if (m_stream && magic == trace::IndexMagic) {
+        m_stream.seekg(-16 - static_cast<std::streamoff>(count * 16u), std::ios::end);
+        for (uint64_t i = 0; i < count; ++i) {
+            const auto offset = readFixed(8u);
+            const auto instruction = readFixed(8u);
+            m_syncPoints.push_back(SyncPoint{.offset = offset, .instruction = instruction});
+        }
+    }
+
+    m_stream.clear();
+    m_stream.seekg(recordsOffset);
+}
+
+}  // namespace stm32::debug
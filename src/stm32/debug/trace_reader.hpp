@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "trace_format.hpp"
+
+namespace stm32::debug
+{
+struct TraceEvent {
+    trace::Tag type;       ///< Instruction or DataAccess
+    uint64_t instruction;  ///< index of the instruction, data access belongs to the instruction with this index
+    uint32_t address;      ///< instruction or data address
+    uint32_t value;        ///< accessed data
+    uint8_t size;          ///< data access size in bytes
+    bool write;            ///< data access is a write
+    bool conditional;      ///< instruction is inside IT block
+    bool executed;         ///< instruction passed its condition
+};
+
+/**
+ * Decoder of traces written by TraceRecorder
+ */
+class TraceReader {
+public:
+    struct SyncPoint {
+        uint64_t offset;
+        uint64_t instruction;
+    };
+
+    /**
+     * @throws std::system_error if file can't be opened, std::runtime_error if it is not a trace
+     */
+    explicit TraceReader(const std::string& path);
+
+    auto next() -> std::optional<TraceEvent>;
+
+    /**
+     * Positions reader so that next() returns the instruction with the specified index, decoding starts from the
+     * closest preceding sync point
+     * @return false if trace doesn't contain such instruction
+     */
+    auto seek(uint64_t instruction) -> bool;
+
+    inline auto syncPoints() const -> const std::vector<SyncPoint>& { return m_syncPoints; }
+
+private:
+    auto readByte() -> uint8_t;
+    auto readVarint() -> uint32_t;
+    auto readFixed(uint32_t size) -> uint64_t;
+    void readIndex();
+
+    std::ifstream m_stream;
+    std::vector<SyncPoint> m_syncPoints;
+
+    uint64_t m_instruction = 0u;
+    uint32_t m_previousAddress = 0u;
+    uint32_t m_previousDataAddress = 0u;
+    std::optional<TraceEvent> m_peeked;
+};
+
+}  // namespace stm32::debug
@@ -0,0 +1,128 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "trace_recorder.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <system_error>
+
+namespace stm32::debug
+{
+TraceRecorder::TraceRecorder(const Config& config)
+    : m_config{config}
+    , m_file{std::fopen(config.path.c_str(), "wb")}
+    , m_front{}
+    , m_back{}
+    , m_mutex{}
+    , m_condition{}
+    , m_writer{}
+    , m_syncPoints{}
+{
+    if (m_file == nullptr) {
+        throw std::system_error{errno, std::generic_category(), config.path};
+    }
+
+    m_config.bufferSize = std::max(m_config.bufferSize, 2u * trace::MaxRecordSize);
+    m_config.syncInterval = std::max(m_config.syncInterval, uint64_t{1u});
+    m_front.reserve(m_config.bufferSize);
+    m_back.reserve(m_config.bufferSize);
+
+    m_front.insert(m_front.end(), trace::Magic.begin(), trace::Magic.end());
+    putFixed(trace::Version, 4u);
+
+    m_writer = std::thread{&TraceRecorder::writerLoop, this};
+}
+
+TraceRecorder::~TraceRecorder()
+{
+    close();
+}
+
+auto TraceRecorder::close() -> bool
+{
+    if (m_file == nullptr) {
+        return !m_writeFailed;
+    }
+
+    // index is written through the same buffers, each entry may need its own swap
+    reserve();
+    put(trace::End);
+    for (const auto& syncPoint : m_syncPoints) {
+        reserve();
+        putFixed(syncPoint.offset, 8u);
+        putFixed(syncPoint.instruction, 8u);
+    }
+    reserve();
+    putFixed(m_syncPoints.size(), 8u);
+    m_front.insert(m_front.end(), trace::IndexMagic.begin(), trace::IndexMagic.end());
+    swapBuffers();
+
+    {
+        std::lock_guard lock{m_mutex};
+        m_stopping = true;
+    }
+    m_condition.notify_all();
+    m_writer.join();
+
+    m_writeFailed = std::fclose(m_file) != 0 || m_writeFailed;
+    m_file = nullptr;
+    return !m_writeFailed;
+}
+
+void TraceRecorder::putFixed(uint64_t value, uint32_t size)
+{
+    for (uint32_t i = 0; i < size; ++i) {
+        put(static_cast<uint8_t>(value >> (8u * i)));
+    }
+}
+
+void TraceRecorder::writeSync(uint32_t address, uint64_t cycles)
+{
+    m_syncPoints.push_back(SyncPoint{.offset = m_writtenBytes + m_front.size(), .instruction = m_instructionCount});
+
+    put(trace::Sync);
+    putFixed(m_instructionCount, 8u);
+    putFixed(cycles, 8u);
+    putFixed(address, 4u);
+
+    m_previousAddress = address;
+    m_previousDataAddress = 0u;
+    m_nextSyncInstruction = m_instructionCount + m_config.syncInterval;
+}
+
+void TraceRecorder::swapBuffers()
+{
+    std::unique_lock lock{m_mutex};
+    m_condition.wait(lock, [this] { return !m_backPending; });
+
+    m_writtenBytes += m_front.size();
+    std::swap(m_front, m_back);
+    m_front.clear();
+    m_backPending = true;
+
+    lock.unlock();
+    m_condition.notify_all();
+}
+
+void TraceRecorder::writerLoop()
+{
+    std::unique_lock lock{m_mutex};
+    while (true) {
+        m_condition.wait(lock, [this] { return m_backPending || m_stopping; });
+        if (!m_backPending) {
+            return;
+        }
+
+        // back buffer is owned by the writer until it is released
+        lock.unlock();
+        const auto written = std::fwrite(m_back.data(), 1u, m_back.size(), m_file);
+        lock.lock();
+
+        m_writeFailed = m_writeFailed || written != m_back.size();
+        m_backPending = false;
+        m_condition.notify_all();
+    }
+}
+
+}  // namespace stm32::debug
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../utils/general.hpp"
+#include "trace_format.hpp"
+
+namespace stm32::debug
+{
+/**
+ * Compact binary execution trace writer
+ *
+ * Records are encoded into the front buffer on the emulation thread. Full buffer is handed over to the background
+ * writer thread, which writes it to disk while the other buffer is filled, so the run loop only waits for the disk when
+ * it outpaces it by a whole buffer. See trace_format.hpp for the stream layout.
+ */
+class TraceRecorder {
+    RESTRICT_COPY(TraceRecorder);
+
+public:
+    struct Config {
+        std::string path;
+        bool dataAccesses = false;      ///< record data accesses of the core, every memory page takes the slow path
+        uint64_t syncInterval = 65536u;  ///< instructions between two sync points
+        size_t bufferSize = 1u << 20u;   ///< size of each of two buffers in bytes
+    };
+
+    /**
+     * @throws std::system_error if file can't be created
+     */
+    explicit TraceRecorder(const Config& config);
+    ~TraceRecorder();
+
+    inline void recordInstruction(uint32_t address, bool conditional, bool executed, uint64_t cycles)
+    {
+        reserve();
+        if (m_instructionCount == m_nextSyncInstruction) {
+            writeSync(address, cycles);
+        }
+
+        const auto delta = static_cast<int32_t>(address - m_previousAddress) / 2;
+        m_previousAddress = address;
+
+        auto tag = static_cast<uint8_t>(trace::Instruction | (conditional ? trace::ConditionalFlag : 0u) | (executed ? trace::ExecutedFlag : 0u));
+        if (delta >= -trace::ShortDeltaBias && delta <= trace::ShortDeltaBias) {
+            put(static_cast<uint8_t>(tag | static_cast<uint8_t>((delta + trace::ShortDeltaBias) << 4)));
+        }
+        else {
+            put(static_cast<uint8_t>(tag | (trace::LongDelta << 4u)));
+            putVarint(trace::zigzagEncode(delta));
+        }
+
+        ++m_instructionCount;
+    }
+
+    inline void recordDataAccess(uint32_t address, uint32_t size, bool write, uint32_t value)
+    {
+        reserve();
+
+        const auto sizeLog2 = static_cast<uint8_t>(size == 4u ? 2u : size - 1u);
+        put(static_cast<uint8_t>(trace::DataAccess | (write ? trace::WriteFlag : 0u) | (sizeLog2 << 3u)));
+        putVarint(trace::zigzagEncode(static_cast<int32_t>(address - m_previousDataAddress)));
+        putVarint(value);
+        m_previousDataAddress = address;
+    }
+
+    /**
+     * Flushes buffers, writes sync point index and waits for the writer thread, called by destructor
+     * @return false if any part of the trace failed to be written
+     */
+    auto close() -> bool;
+
+    inline auto recordsDataAccesses() const -> bool { return m_config.dataAccesses; }
+    inline auto instructionCount() const -> uint64_t { return m_instructionCount; }
+
+private:
+    struct SyncPoint {
+        uint64_t offset;
+        uint64_t instruction;
+    };
+
+    inline void reserve()
+    {
+        if (m_front.size() + trace::MaxRecordSize > m_config.bufferSize) {
+            swapBuffers();
+        }
+    }
+
+    inline void put(uint8_t byte) { m_front.push_back(byte); }
+
+    inline void putVarint(uint32_t value)
+    {
+        while (value >= 0x80u) {
+            put(static_cast<uint8_t>(value | 0x80u));
+            value >>= 7u;
+        }
+        put(static_cast<uint8_t>(value));
+    }
+
+    void putFixed(uint64_t value, uint32_t size);
+    void writeSync(uint32_t address, uint64_t cycles);
+    void swapBuffers();
+    void writerLoop();
+
+    Config m_config;
+    std::FILE* m_file;
+
+    std::vector<uint8_t> m_front;
+    std::vector<uint8_t> m_back;
+    uint64_t m_writtenBytes = 0u;  // bytes handed to the writer before the front buffer
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    bool m_backPending = false;
+    bool m_stopping = false;
+    bool m_writeFailed = false;
+    std::thread m_writer;
+
+    uint64_t m_instructionCount = 0u;
+    uint64_t m_nextSyncInstruction = 0u;
+    uint32_t m_previousAddress = 0u;
+    uint32_t m_previousDataAddress = 0u;
+    std::vector<SyncPoint> m_syncPoints;
+};
+
+}  // namespace stm32::debug
@@ -0,0 +1,100 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "watchpoints.hpp"
+
+#include <algorithm>
+
+#include "../memory.hpp"
+
+namespace stm32::debug
+{
+namespace
+{
+inline auto isSame(const Watchpoint& left, const Watchpoint& right) -> bool
+{
+    return left.address == right.address && left.length == right.length && left.type == right.type && left.value == right.value;
+}
+
+inline auto matchesType(WatchpointType type, bool write) -> bool
+{
+    switch (type) {
+        case WatchpointType::Write:
+            return write;
+        case WatchpointType::Read:
+            return !write;
+        case WatchpointType::Access:
+            return true;
+    }
+    return false;
+}
+
+}  // namespace
+
+Watchpoints::Watchpoints(Memory& memory)
+    : m_memory{memory}
+    , m_watchpoints{}
+    , m_hit{}
+{
+}
+
+void Watchpoints::add(const Watchpoint& watchpoint)
+{
+    m_watchpoints.push_back(watchpoint);
+    updatePages();
+}
+
+auto Watchpoints::remove(const Watchpoint& watchpoint) -> bool
+{
+    const auto it = std::find_if(m_watchpoints.begin(), m_watchpoints.end(), [&](const Watchpoint& item) {
+        return isSame(item, watchpoint);
+    });
+    if (it == m_watchpoints.end()) {
+        return false;
+    }
+
+    m_watchpoints.erase(it);
+    updatePages();
+    return true;
+}
+
+void Watchpoints::clear()
+{
+    m_watchpoints.clear();
+    m_hit.reset();
+    updatePages();
+}
+
+void Watchpoints::checkAccess(uint32_t address, uint32_t size, bool write, uint32_t value)
+{
+    // The first hit of the instruction wins
+    if (m_hit.has_value()) {
+        return;
+    }
+
+    for (const auto& watchpoint : m_watchpoints) {
+        const auto overlaps = address < uint64_t{watchpoint.address} + watchpoint.length && watchpoint.address < uint64_t{address} + size;
+        const auto valueMatches = !watchpoint.value.has_value() || *watchpoint.value == value;
+        if (overlaps && valueMatches && matchesType(watchpoint.type, write)) {
+            m_hit = WatchpointHit{.watchpoint = watchpoint, .address = address, .write = write};
+            return;
+        }
+    }
+}
+
+auto Watchpoints::takeHit() -> std::optional<WatchpointHit>
+{
+    auto hit = m_hit;
+    m_hit.reset();
+    return hit;
+}
+
+void Watchpoints::updatePages()
+{
+    m_memory.clearSlowPages();
+    for (const auto& watchpoint : m_watchpoints) {
+        m_memory.markSlowPages(watchpoint.address, uint64_t{watchpoint.address} + watchpoint.length);
+    }
+}
+
+}  // namespace stm32::debug
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "../utils/general.hpp"
+
+namespace stm32
+{
+class Memory;
+}  // namespace stm32
+
+namespace stm32::debug
+{
+enum class WatchpointType : uint8_t {
+    Write,
+    Read,
+    Access,
+};
+
+struct Watchpoint {
+    uint32_t address;
+    uint32_t length;
+    WatchpointType type;
+    std::optional<uint32_t> value{};  ///< data value which must match, any value if empty
+};
+
+struct WatchpointHit {
+    Watchpoint watchpoint;  ///< watchpoint which was triggered
+    uint32_t address;       ///< address of the data access
+    bool write;             ///< whether data access was a write
+};
+
+/**
+ * Data watchpoints over address ranges
+ *
+ * Pages covered by armed watchpoints are marked as slow path in the memory, only data accesses to those pages are
+ * checked. Hit is recorded during the access and the run loop stops after the instruction completes, like the DWT
+ * debug event does.
+ */
+class Watchpoints {
+    RESTRICT_COPY(Watchpoints);
+
+public:
+    explicit Watchpoints(Memory& memory);
+
+    void add(const Watchpoint& watchpoint);
+    auto remove(const Watchpoint& watchpoint) -> bool;
+    void clear();
+
+    inline auto isArmed() const -> bool { return !m_watchpoints.empty(); }
+    inline auto watchpoints() const -> const std::vector<Watchpoint>& { return m_watchpoints; }
+
+    void checkAccess(uint32_t address, uint32_t size, bool write, uint32_t value);
+
+    inline auto isHit() const -> bool { return m_hit.has_value(); }
+    auto takeHit() -> std::optional<WatchpointHit>;
+
+    /**
+     * Marks pages of armed watchpoints as slow path in the memory
+     */
+    void updatePages();
+
+private:
+    Memory& m_memory;
+    std::vector<Watchpoint> m_watchpoints;
+    std::optional<WatchpointHit> m_hit;
+};
+
+}  // namespace stm32::debug
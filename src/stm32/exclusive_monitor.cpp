@@ -0,0 +1,119 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "exclusive_monitor.hpp"
+
+#include <stdexcept>
+
+namespace stm32
+{
+namespace
+{
+// Granule address is aligned, so the lowest bit marks valid tag
+constexpr uint32_t InvalidTag = 0u;
+
+constexpr auto tagOf(uint32_t address) -> uint32_t
+{
+    return (address & ~(ExclusiveMonitor::ReservationGranule - 1u)) | 0x1u;
+}
+
+}  // namespace
+
+GlobalExclusiveMonitor::GlobalExclusiveMonitor()
+    : m_mutex{}
+    , m_tags{}
+{
+    m_tags.fill(InvalidTag);
+}
+
+void GlobalExclusiveMonitor::markExclusive(uint8_t processorId, uint32_t address)
+{
+    m_tags.at(processorId) = tagOf(address);
+}
+
+auto GlobalExclusiveMonitor::isExclusive(uint8_t processorId, uint32_t address) const -> bool
+{
+    return m_tags.at(processorId) == tagOf(address);
+}
+
+void GlobalExclusiveMonitor::clearByAddress(uint32_t address)
+{
+    const auto tag = tagOf(address);
+    for (auto& item : m_tags) {
+        if (item == tag) {
+            item = InvalidTag;
+        }
+    }
+}
+
+void GlobalExclusiveMonitor::clearOthersByAddress(uint8_t processorId, uint32_t address)
+{
+    // Whether a store clears the tag of its own processor is IMPLEMENTATION DEFINED, it is kept
+    const auto tag = tagOf(address);
+    for (size_t i = 0; i < m_tags.size(); ++i) {
+        if (i != processorId && m_tags[i] == tag) {
+            m_tags[i] = InvalidTag;
+        }
+    }
+}
+
+void GlobalExclusiveMonitor::clearExclusive(uint8_t processorId)
+{
+    m_tags.at(processorId) = InvalidTag;
+}
+
+ExclusiveMonitor::ExclusiveMonitor() = default;
+
+void ExclusiveMonitor::setGlobalMonitor(GlobalExclusiveMonitor* monitor, uint8_t processorId)
+{
+    if (processorId >= GlobalExclusiveMonitor::MaxProcessors) {
+        throw std::out_of_range{"processor id is out of range"};
+    }
+
+    m_globalMonitor = monitor;
+    m_processorId = processorId;
+}
+
+auto ExclusiveMonitor::lock() -> std::unique_lock<std::recursive_mutex>
+{
+    return m_globalMonitor != nullptr ? m_globalMonitor->lock() : std::unique_lock<std::recursive_mutex>{};
+}
+
+void ExclusiveMonitor::setExclusiveMonitors(uint32_t address)
+{
+    // see: A3.4.1
+    m_isExclusive = true;
+    m_taggedAddress = tagOf(address);
+
+    if (m_globalMonitor != nullptr) {
+        m_globalMonitor->markExclusive(m_processorId, address);
+    }
+}
+
+auto ExclusiveMonitor::exclusiveMonitorsPass(uint32_t address) -> bool
+{
+    // see: A3.4.1, store exclusive always leaves the local monitor in Open Access state
+    const auto localPassed = m_isExclusive && m_taggedAddress == tagOf(address);
+    m_isExclusive = false;
+
+    if (m_globalMonitor == nullptr) {
+        return localPassed;
+    }
+
+    // see: A3.4.2
+    const auto globalPassed = m_globalMonitor->isExclusive(m_processorId, address);
+    m_globalMonitor->clearExclusive(m_processorId);
+
+    const auto passed = localPassed && globalPassed;
+    if (passed) {
+        m_globalMonitor->clearByAddress(address);
+    }
+    return passed;
+}
+
+void ExclusiveMonitor::clearExclusiveLocal()
+{
+    m_isExclusive = false;
+}
+
+}  // namespace stm32
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <mutex>
+
+#include "utils/general.hpp"
+
+namespace stm32
+{
+/**
+ * Global exclusive monitor shared by cores which have common memory, e.g. a memory region attached to each of them
+ *
+ * Tag table holds one tagged granule per processor, so the whole table fits into a single cache line. Exclusive
+ * accesses and stores of all attached cores are serialized by the monitor lock, a store clears the tags other
+ * processors hold on its granule (see A3.4.2). Loads and the cores without a global monitor never touch it.
+ */
+class GlobalExclusiveMonitor {
+public:
+    static constexpr size_t MaxProcessors = 8u;
+
+    explicit GlobalExclusiveMonitor();
+
+    // Lock is recursive, a store exclusive takes it again when it writes the memory
+    inline auto lock() -> std::unique_lock<std::recursive_mutex> { return std::unique_lock{m_mutex}; }
+
+    // Must be called with the monitor lock held
+    void markExclusive(uint8_t processorId, uint32_t address);
+    auto isExclusive(uint8_t processorId, uint32_t address) const -> bool;
+    void clearByAddress(uint32_t address);
+    void clearOthersByAddress(uint8_t processorId, uint32_t address);
+    void clearExclusive(uint8_t processorId);
+
+private:
+    std::recursive_mutex m_mutex;
+    std::array<uint32_t, MaxProcessors> m_tags;
+};
+
+/**
+ * Local exclusive monitor of the core
+ *
+ * @see A3.4 Synchronization and semaphores
+ */
+class ExclusiveMonitor {
+public:
+    /**
+     * Exclusives reservation granule, IMPLEMENTATION DEFINED in range [8, 2048] bytes
+     */
+    static constexpr uint32_t ReservationGranule = 8u;
+
+    explicit ExclusiveMonitor();
+
+public:
+    RESTRICT_COPY(ExclusiveMonitor);
+
+    /**
+     * Attaches global monitor for the memory shared with other cores. Pass nullptr to detach
+     */
+    void setGlobalMonitor(GlobalExclusiveMonitor* monitor, uint8_t processorId);
+
+    /**
+     * Serializes exclusive access with other cores. Returns empty lock if there is no global monitor
+     */
+    auto lock() -> std::unique_lock<std::recursive_mutex>;
+
+    /**
+     * Called by every store before the memory is written, the returned lock must be held until it is
+     */
+    inline auto observeStore(uint32_t address) -> std::unique_lock<std::recursive_mutex>
+    {
+        if (m_globalMonitor == nullptr) {
+            return {};
+        }
+
+        auto lock = m_globalMonitor->lock();
+        m_globalMonitor->clearOthersByAddress(m_processorId, address);
+        return lock;
+    }
+
+    void setExclusiveMonitors(uint32_t address);
+    auto exclusiveMonitorsPass(uint32_t address) -> bool;
+    void clearExclusiveLocal();
+
+    inline auto isExclusive() const -> bool { return m_isExclusive; }
+
+private:
+    bool m_isExclusive = false;
+    uint32_t m_taggedAddress = 0u;
+
+    GlobalExclusiveMonitor* m_globalMonitor = nullptr;
+    uint8_t m_processorId = 0u;
+};
+
+}  // namespace stm32
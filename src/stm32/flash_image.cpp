@@ -0,0 +1,40 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "flash_image.hpp"
+
+#include <algorithm>
+
+#include "utils/mapped_file.hpp"
+
+namespace stm32
+{
+auto FlashImage::load(const std::string& path) -> std::shared_ptr<const FlashImage>
+{
+    return std::make_shared<const FlashImage>(std::make_unique<utils::MappedFile>(path));
+}
+
+auto FlashImage::fromBytes(std::vector<uint8_t> bytes) -> std::shared_ptr<const FlashImage>
+{
+    return std::make_shared<const FlashImage>(std::move(bytes));
+}
+
+FlashImage::FlashImage(std::vector<uint8_t> bytes)
+    : m_bytes{std::move(bytes)}
+    , m_file{}
+    , m_data{m_bytes.data()}
+    , m_size{static_cast<uint32_t>(std::min<size_t>(m_bytes.size(), UINT32_MAX))}
+{
+}
+
+FlashImage::FlashImage(std::unique_ptr<utils::MappedFile> file)
+    : m_bytes{}
+    , m_file{std::move(file)}
+    , m_data{m_file->data()}
+    , m_size{static_cast<uint32_t>(std::min<size_t>(m_file->size(), UINT32_MAX))}
+{
+}
+
+FlashImage::~FlashImage() = default;
+
+}  // namespace stm32
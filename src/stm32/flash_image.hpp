@@ -0,0 +1,46 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "utils/general.hpp"
+
+namespace stm32
+{
+namespace utils
+{
+class MappedFile;
+}
+
+/**
+ * Immutable firmware image, shared by every memory which runs it
+ *
+ * Memory only reads the image, flash programming goes to a private overlay, so any number of instances can run on one
+ * image. Images loaded from a file are mapped read-only, instances then also share its pages with the page cache.
+ */
+class FlashImage {
+public:
+    /**
+     * @throws std::system_error if file can't be mapped
+     */
+    static auto load(const std::string& path) -> std::shared_ptr<const FlashImage>;
+    static auto fromBytes(std::vector<uint8_t> bytes) -> std::shared_ptr<const FlashImage>;
+
+    explicit FlashImage(std::vector<uint8_t> bytes);
+    explicit FlashImage(std::unique_ptr<utils::MappedFile> file);
+    ~FlashImage();
+
+    RESTRICT_COPY(FlashImage);
+
+    inline auto view() const -> utils::ArrayView<const uint8_t, uint32_t> { return {m_data, m_size}; }
+
+private:
+    std::vector<uint8_t> m_bytes;
+    std::unique_ptr<utils::MappedFile> m_file;
+    const uint8_t* m_data = nullptr;
+    uint32_t m_size = 0u;
+};
+
+}  // namespace stm32
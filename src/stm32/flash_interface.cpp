@@ -0,0 +1,106 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "flash_interface.hpp"
+
+#include <algorithm>
+
+#include "utils/math.hpp"
+
+namespace stm32
+{
+using namespace utils;
+
+namespace
+{
+constexpr uint32_t AcrResetValue = 0x00000030u;
+constexpr uint32_t AcrWriteMask = 0x0000001Fu;  // LATENCY, HLFCYA, PRFTBE
+
+}  // namespace
+
+FlashInterface::FlashInterface()
+    : MemoryRegion{FlashInterfaceStart, FlashInterfaceEnd}
+    , m_acr{AcrResetValue}
+    , m_statistics{}
+{
+}
+
+void FlashInterface::write(uint32_t address, uint8_t data)
+{
+    // see: RM0008 3.3.3, only the lowest byte of FLASH_ACR is writable
+    if (address != FlashInterfaceStart) {
+        return;
+    }
+
+    m_acr = (m_acr & ~AcrWriteMask) | (data & AcrWriteMask);
+
+    // PRFTBS follows PRFTBE, buffer switches immediately because the emulated core has no fetch in flight
+    m_acr = isBitSet<4>(m_acr) ? (m_acr | (0x1u << 5u)) : (m_acr & ~(0x1u << 5u));
+}
+
+auto FlashInterface::read(uint32_t address) -> uint8_t
+{
+    const auto offset = address - FlashInterfaceStart;
+    if (offset >= 4u) {
+        return 0u;
+    }
+    return static_cast<uint8_t>(m_acr >> (offset * 8u));
+}
+
+void FlashInterface::reset()
+{
+    m_acr = AcrResetValue;
+    m_isLastLineValid = false;
+    m_lineReadyCycle = 0u;
+    m_statistics = Statistics{};
+}
+
+void FlashInterface::setState(const State& state)
+{
+    m_acr = state.acr;
+    m_lastLine = state.lastLine;
+    m_isLastLineValid = state.isLastLineValid;
+    m_lineReadyCycle = state.lineReadyCycle;
+}
+
+auto FlashInterface::latency() const -> uint8_t
+{
+    return getPart<0, 3>(m_acr);
+}
+
+auto FlashInterface::isPrefetchEnabled() const -> bool
+{
+    return isBitSet<4>(m_acr);
+}
+
+auto FlashInterface::fetchLine(uint32_t line, uint64_t cycle) -> uint64_t
+{
+    // Fetch of this line is still in flight, e.g. the run loop stopped in the middle of the stall
+    if (m_isLastLineValid && line == m_lastLine) {
+        return m_lineReadyCycle - cycle;
+    }
+
+    const auto waitStates = latency();
+    const auto isSequential = m_isLastLineValid && line == m_lastLine + 1u;
+
+    ++m_statistics.lineFetches;
+    if (!isSequential) {
+        ++m_statistics.refills;
+    }
+
+    // Prefetch buffer starts reading the next line as soon as the previous one is delivered, so a sequential line is
+    // ready after one line time unless the core was busy for longer. Any other fetch pays the wait states
+    auto readyCycle = cycle + waitStates;
+    if (isPrefetchEnabled() && isSequential) {
+        readyCycle = std::max(cycle, m_lineReadyCycle + waitStates + 1u);
+    }
+
+    m_lastLine = line;
+    m_isLastLineValid = true;
+    m_lineReadyCycle = readyCycle;
+
+    m_statistics.waitCycles += readyCycle - cycle;
+    return readyCycle - cycle;
+}
+
+}  // namespace stm32
@@ -0,0 +1,98 @@
+#pragma once
+
+#include "memory.hpp"
+
+namespace stm32
+{
+/**
+ * Flash memory interface with the access control register and timing model of the instruction fetch path
+ *
+ * Flash is read in 64-bit lines with FLASH_ACR.LATENCY wait states per line. When the prefetch buffer is enabled,
+ * sequential lines are fetched in the background while the current one executes, so only non-sequential fetches
+ * (taken branches, exception entry and return) pay the refill penalty. Without prefetch every new line pays its wait
+ * states.
+ *
+ * Stall is charged when the core crosses into another line, so the model adds a constant amount of work per line and
+ * a single compare per instruction. Prefetch progress is kept in absolute cycles, hence virtual time doesn't depend on
+ * where the host cuts execution into blocks. Timing model is disabled by default.
+ *
+ * @par Register map (see RM0008 3.3.3)
+ *
+ * 0x40022000: FLASH_ACR, other registers of the interface read as zero
+ */
+class FlashInterface final : public MemoryRegion {
+public:
+    enum AddressSpace : uint32_t {
+        FlashInterfaceStart = 0x40022000u,
+        FlashInterfaceEnd = 0x40022400u,
+    };
+
+    static constexpr uint32_t LineSize = 8u;
+
+    struct Statistics {
+        uint64_t lineFetches;  ///< number of flash lines fetched
+        uint64_t refills;      ///< number of non-sequential fetches
+        uint64_t waitCycles;   ///< total cycles added to the cycle counter
+    };
+
+    /**
+     * Machine state saved by snapshots, statistics are host-side and are not included
+     */
+    struct State {
+        uint32_t acr;
+        uint32_t lastLine;
+        bool isLastLineValid;
+        uint64_t lineReadyCycle;
+    };
+
+    explicit FlashInterface();
+
+    void write(uint32_t address, uint8_t data) override;
+    auto read(uint32_t address) -> uint8_t override;
+
+    void reset();
+
+    inline auto state() const -> State { return State{m_acr, m_lastLine, m_isLastLineValid, m_lineReadyCycle}; }
+    void setState(const State& state);
+
+    inline void setTimingEnabled(bool enabled) { m_timingEnabled = enabled; }
+    inline auto isTimingEnabled() const -> bool { return m_timingEnabled; }
+
+    auto latency() const -> uint8_t;
+    auto isPrefetchEnabled() const -> bool;
+
+    /**
+     * Returns cycles the core has to stall at the given cycle before the instruction at the address is fetched
+     */
+    inline auto fetchStall(uint32_t address, uint64_t cycle) -> uint64_t
+    {
+        if (address >= CodeRegionEnd) {
+            m_isLastLineValid = false;
+            return 0u;
+        }
+        if (m_isLastLineValid && address / LineSize == m_lastLine && cycle >= m_lineReadyCycle) {
+            return 0u;
+        }
+        return fetchLine(address / LineSize, cycle);
+    }
+
+    inline auto statistics() const -> const Statistics& { return m_statistics; }
+
+private:
+    // Instruction fetches from the code region are served by flash, SRAM and peripherals have no wait states
+    static constexpr uint32_t CodeRegionEnd = 0x20000000u;
+
+    auto fetchLine(uint32_t line, uint64_t cycle) -> uint64_t;
+
+    uint32_t m_acr;
+    bool m_timingEnabled = false;
+
+    uint32_t m_lastLine = 0u;
+    bool m_isLastLineValid = false;
+    // cycle at which the last line is delivered to the core
+    uint64_t m_lineReadyCycle = 0u;
+
+    Statistics m_statistics;
+};
+
+}  // namespace stm32
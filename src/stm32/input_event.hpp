@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <tuple>
+
+namespace stm32
+{
+enum class InputEventType : uint8_t {
+    Interrupt,        ///< Sets external interrupt pending in NVIC
+    PeripheralInput,  ///< Passed to the peripheral input handler
+};
+
+/**
+ * Event posted into the core from the host side
+ *
+ * Events are delivered at block boundaries of the run loop, as soon as virtual time reaches the timestamp.
+ * Timestamped events are always delivered in the same order, no matter which thread posted them first.
+ */
+struct InputEvent {
+    uint64_t timestamp;   ///< virtual cycle of delivery, zero means "as soon as possible"
+    InputEventType type;  ///< event kind
+    uint16_t channel;     ///< external interrupt number or peripheral channel
+    uint32_t data;        ///< peripheral payload
+};
+
+inline auto operator<(const InputEvent& left, const InputEvent& right) -> bool
+{
+    return std::tie(left.timestamp, left.type, left.channel, left.data) < std::tie(right.timestamp, right.type, right.channel, right.data);
+}
+
+inline auto operator>(const InputEvent& left, const InputEvent& right) -> bool
+{
+    return right < left;
+}
+
+}  // namespace stm32
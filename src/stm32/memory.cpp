@@ -3,6 +3,11 @@
 
 #include "memory.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <stdexcept>
+
 #include "utils/math.hpp"
 
 namespace stm32
@@ -29,6 +34,25 @@ inline auto setBit(uint8_t data, uint8_t bitNumber, uint8_t value) -> uint8_t
     return static_cast<uint8_t>(data & ~(0x1u << bitNumber)) | static_cast<uint8_t>((value & 0x1u) << bitNumber);
 }
 
+// Flash beyond the loaded image reads as erased
+constexpr uint8_t ErasedFlashValue = 0xFFu;
+
+template <typename Container>
+inline auto readChecked(const Container& container, uint32_t offset) -> uint8_t
+{
+    return offset < container.size() ? container[offset] : ErasedFlashValue;
+}
+
+template <typename Container>
+inline auto writeChecked(Container& container, uint32_t offset, uint8_t data) -> bool
+{
+    if (offset < container.size()) {
+        container[offset] = data;
+        return true;
+    }
+    return false;
+}
+
 }  // namespace
 
 MemoryRegion::MemoryRegion(uint32_t regionStart, uint32_t regionEnd)
@@ -39,23 +63,82 @@ MemoryRegion::MemoryRegion(uint32_t regionStart, uint32_t regionEnd)
 
 Memory::Memory(const Config& config)
     : m_config{config}
+    , m_flashOverlay{}
     , m_systemMemory(config.systemMemoryEnd - config.systemMemoryStart, 0)
     , m_optionBytes(config.optionBytesEnd - config.optionBytesStart, 0)
     , m_sram(config.sramEnd - config.sramStart, 0)
     , m_memoryRegions{}
+    , m_slowPages{}
+    , m_dirtyPages{}
 {
+    for (uint8_t area = 0; area < HostAreaCount; ++area) {
+        const auto pages = (hostAreaSize(static_cast<HostArea>(area)) + (1u << DirtyPageShift) - 1u) >> DirtyPageShift;
+        m_dirtyPages[area].resize((pages + 63u) / 64u, 0u);
+    }
 }
 
 void Memory::attachRegion(MemoryRegion& region)
 {
     auto it = m_memoryRegions.begin();
-    for (; it != m_memoryRegions.end() && (*it)->regionEnd() < region.regionStart(); ++it) {
+    for (; it != m_memoryRegions.end() && (*it)->regionStart() < region.regionStart(); ++it) {
         // skip until inserted region range is greater than current
     }
 
     m_memoryRegions.insert(it, &region);
 }
 
+void Memory::markSlowPages(uint32_t begin, uint64_t end)
+{
+    if (end <= begin) {
+        return;
+    }
+
+    if (m_slowPages.empty()) {
+        m_slowPages.resize((uint64_t{1u} << (32u - PageShift)) / 64u, 0u);
+    }
+
+    const auto lastPage = static_cast<uint32_t>((end - 1u) >> PageShift);
+    for (auto page = begin >> PageShift; page <= lastPage; ++page) {
+        m_slowPages[page / 64u] |= uint64_t{1u} << (page % 64u);
+    }
+}
+
+void Memory::clearSlowPages()
+{
+    if (m_slowPathEverywhere) {
+        m_slowPages.assign((uint64_t{1u} << (32u - PageShift)) / 64u, ONES<64, uint64_t>);
+    }
+    else {
+        m_slowPages.clear();
+    }
+}
+
+void Memory::setSlowPathEverywhere(bool enabled)
+{
+    m_slowPathEverywhere = enabled;
+    clearSlowPages();
+}
+
+void Memory::writeFlash(uint32_t offset, uint8_t data)
+{
+    if (offset >= flashSize()) {
+        return;
+    }
+    if (m_flashOverlay.empty()) {
+        allocateFlashOverlay();
+    }
+    m_flashOverlay[offset] = data;
+    markDirty(HostArea::Flash, offset);
+}
+
+void Memory::allocateFlashOverlay()
+{
+    // Image may be shorter than the flash range, the rest is erased
+    const auto image = m_config.flash;
+    m_flashOverlay.assign(flashSize(), ErasedFlashValue);
+    std::copy(image.begin(), image.begin() + std::min(image.size(), flashSize()), m_flashOverlay.begin());
+}
+
 template <>
 void Memory::write<uint8_t>(uint32_t address, uint8_t data)
 {
@@ -63,25 +146,30 @@ void Memory::write<uint8_t>(uint32_t address, uint8_t data)
         if (address < m_config.flashMemoryStart) {
             switch (m_config.bootMode) {
                 case BootMode::FlashMemory:
-                    m_config.flash[address] = data;
+                    writeFlash(address, data);
                     return;
                 case BootMode::SystemMemory:
-                    m_systemMemory[address] = data;
+                    if (writeChecked(m_systemMemory, address, data)) {
+                        markDirty(HostArea::SystemMemory, address);
+                    }
                     return;
             }
         }
         else {
-            m_config.flash[address - m_config.flashMemoryStart] = data;
+            writeFlash(address - m_config.flashMemoryStart, data);
         }
     }
     else if (address >= m_config.systemMemoryStart && address < m_config.systemMemoryEnd) {
         m_systemMemory[address - m_config.systemMemoryStart] = data;
+        markDirty(HostArea::SystemMemory, address - m_config.systemMemoryStart);
     }
     else if (address >= m_config.optionBytesStart && address < m_config.optionBytesEnd) {
         m_optionBytes[address - m_config.optionBytesStart] = data;
+        markDirty(HostArea::OptionBytes, address - m_config.optionBytesStart);
     }
     else if (address >= m_config.sramStart && address < m_config.sramEnd) {
         m_sram[address - m_config.sramStart] = data;
+        markDirty(HostArea::Sram, address - m_config.sramStart);
     }
     else if (address >= AddressSpace::SramBitBandAliasStart && address < AddressSpace::SramBitBandAliasEnd) {
         const auto [referencedAddress, bitNumber] =
@@ -90,6 +178,7 @@ void Memory::write<uint8_t>(uint32_t address, uint8_t data)
         if (referencedAddress >= m_config.sramStart && referencedAddress < m_config.sramEnd) {
             auto& sramCell = m_sram[referencedAddress - m_config.sramStart];
             sramCell = setBit(sramCell, bitNumber, data);
+            markDirty(HostArea::Sram, referencedAddress - m_config.sramStart);
         }
     }
     else if (address >= AddressSpace::PeripheralBitBandAliasStart && address < AddressSpace::PeripheralBitBandAliasEnd) {
@@ -128,13 +217,13 @@ auto Memory::read<uint8_t>(uint32_t address) const -> uint8_t
         if (address < m_config.flashMemoryStart) {
             switch (m_config.bootMode) {
                 case BootMode::FlashMemory:
-                    return m_config.flash[address];
+                    return readChecked(flash(), address);
                 case BootMode::SystemMemory:
-                    return m_systemMemory[address];
+                    return readChecked(m_systemMemory, address);
             }
         }
         else {
-            return m_config.flash[address - m_config.flashMemoryStart];
+            return readChecked(flash(), address - m_config.flashMemoryStart);
         }
     }
     else if (address >= m_config.systemMemoryStart && address < m_config.systemMemoryEnd) {
@@ -184,32 +273,192 @@ auto Memory::read<uint32_t>(uint32_t address) const -> uint32_t
                              _<24, 8>{read<uint8_t>(address + 3u)});
 }
 
-auto Memory::findRegion(uint32_t address) const -> MemoryRegion*
+void Memory::readBlock(uint32_t address, uint8_t* data, uint32_t size) const
 {
-    if (m_memoryRegions.empty()) {
-        return nullptr;
+    const auto end = uint64_t{address} + size;
+    if (address >= m_config.sramStart && end <= m_config.sramEnd) {
+        std::memcpy(data, m_sram.data() + (address - m_config.sramStart), size);
+        return;
+    }
+    if (address >= m_config.flashMemoryStart && end <= m_config.flashMemoryStart + uint64_t{flash().size()}) {
+        std::memcpy(data, flash().begin() + (address - m_config.flashMemoryStart), size);
+        return;
     }
 
-    size_t position = m_memoryRegions.size() >> 1u;
-    size_t stepSize = position >> 1u;
+    for (uint32_t i = 0; i < size; ++i) {
+        data[i] = read<uint8_t>(address + i);
+    }
+}
 
-    while (true) {
-        if (stepSize == 0) {
-            return nullptr;
+void Memory::writeBlock(uint32_t address, const uint8_t* data, uint32_t size)
+{
+    const auto end = uint64_t{address} + size;
+    if (address >= m_config.sramStart && end <= m_config.sramEnd) {
+        const auto offset = address - m_config.sramStart;
+        std::memcpy(m_sram.data() + offset, data, size);
+        for (auto page = offset >> DirtyPageShift; page << DirtyPageShift < offset + size; ++page) {
+            markDirty(HostArea::Sram, page << DirtyPageShift);
         }
+        return;
+    }
 
-        if (m_memoryRegions[position]->regionEnd() < address) {
-            position += stepSize;
-        }
-        else if (m_memoryRegions[position]->regionStart() > address) {
-            position -= stepSize;
+    for (uint32_t i = 0; i < size; ++i) {
+        write<uint8_t>(address + i, data[i]);
+    }
+}
+
+auto stm32f103c8Config(utils::ArrayView<const uint8_t, uint32_t> flash) -> Memory::Config
+{
+    return Memory::Config{
+        .flashMemoryStart = 0x08000000u,
+        .flashMemoryEnd = 0x08020000u,
+
+        .systemMemoryStart = 0x1ffff000u,
+        .systemMemoryEnd = 0x1ffff800u,
+
+        .optionBytesStart = 0x1ffff800u,
+        .optionBytesEnd = 0x1ffff80Fu,
+
+        .sramStart = 0x20000000u,
+        .sramEnd = 0x20005000u,
+
+        .bootMode = BootMode::FlashMemory,
+        .flash = flash,
+    };
+}
+
+auto Memory::nextSnapshotId() -> uint64_t
+{
+    static std::atomic<uint64_t> id{0u};
+    return ++id;
+}
+
+auto Memory::snapshot() -> Snapshot
+{
+    auto snapshot = Snapshot{.id = nextSnapshotId(), .areas = {}};
+    for (uint8_t area = 0; area < HostAreaCount; ++area) {
+        // unprogrammed flash is the image, which never changes
+        const auto data = hostArea(static_cast<HostArea>(area));
+        snapshot.areas[area].assign(data.begin(), data.end());
+        std::fill(m_dirtyPages[area].begin(), m_dirtyPages[area].end(), 0u);
+    }
+
+    m_snapshotId = snapshot.id;
+    return snapshot;
+}
+
+void Memory::restore(const Snapshot& snapshot)
+{
+    const auto onlyDirtyPages = snapshot.id == m_snapshotId;
+
+    m_lastRestoredPages = 0u;
+    for (uint8_t area = 0; area < HostAreaCount; ++area) {
+        if (area == HostArea::Flash) {
+            restoreFlash(snapshot.areas[area], onlyDirtyPages);
         }
         else {
-            return m_memoryRegions[position];
+            restorePages(static_cast<HostArea>(area), snapshot.areas[area], onlyDirtyPages);
         }
+    }
+
+    m_snapshotId = snapshot.id;
+}
+
+void Memory::restoreFlash(const std::vector<uint8_t>& saved, bool onlyDirtyPages)
+{
+    if (saved.size() > flashSize()) {
+        throw std::invalid_argument{"snapshot was taken from memory with different layout"};
+    }
+
+    auto& dirtyPages = m_dirtyPages[HostArea::Flash];
+    if (saved.empty()) {
+        // Flash wasn't programmed when the snapshot was taken, the overlay is dropped to read the image again
+        m_flashOverlay.clear();
+        m_flashOverlay.shrink_to_fit();
+        std::fill(dirtyPages.begin(), dirtyPages.end(), 0u);
+        return;
+    }
 
-        stepSize >>= 1u;
+    // Images saved before the overlay covered the whole flash range are shorter, the rest is erased
+    if (m_flashOverlay.empty() || saved.size() != flashSize()) {
+        m_flashOverlay.assign(flashSize(), ErasedFlashValue);
+        std::copy(saved.begin(), saved.end(), m_flashOverlay.begin());
+        std::fill(dirtyPages.begin(), dirtyPages.end(), 0u);
+        m_lastRestoredPages += (flashSize() + (1u << DirtyPageShift) - 1u) >> DirtyPageShift;
+        return;
     }
+
+    restorePages(HostArea::Flash, saved, onlyDirtyPages);
+}
+
+void Memory::restorePages(HostArea area, const std::vector<uint8_t>& saved, bool onlyDirtyPages)
+{
+    auto data = hostArea(area);
+    if (saved.size() != data.size()) {
+        throw std::invalid_argument{"snapshot was taken from memory with different layout"};
+    }
+
+    auto& dirtyPages = m_dirtyPages[area];
+    for (uint32_t word = 0; word < dirtyPages.size(); ++word) {
+        auto bits = onlyDirtyPages ? dirtyPages[word] : ONES<64, uint64_t>;
+        while (bits != 0u) {
+            const auto page = word * 64u + static_cast<uint32_t>(__builtin_ctzll(bits));
+            bits &= bits - 1u;
+
+            const auto begin = page << DirtyPageShift;
+            if (begin >= data.size()) {
+                break;
+            }
+            const auto size = std::min(uint32_t{1u} << DirtyPageShift, data.size() - begin);
+            std::memcpy(data.begin() + begin, saved.data() + begin, size);
+            ++m_lastRestoredPages;
+        }
+        dirtyPages[word] = 0u;
+    }
+}
+
+auto Memory::hostArea(HostArea area) -> utils::ArrayView<uint8_t, uint32_t>
+{
+    switch (area) {
+        case HostArea::Flash:
+            return {m_flashOverlay.data(), static_cast<uint32_t>(m_flashOverlay.size())};
+        case HostArea::SystemMemory:
+            return {m_systemMemory.data(), static_cast<uint32_t>(m_systemMemory.size())};
+        case HostArea::OptionBytes:
+            return {m_optionBytes.data(), static_cast<uint32_t>(m_optionBytes.size())};
+        case HostArea::Sram:
+        default:
+            return {m_sram.data(), static_cast<uint32_t>(m_sram.size())};
+    }
+}
+
+auto Memory::hostAreaSize(HostArea area) const -> uint32_t
+{
+    switch (area) {
+        case HostArea::Flash:
+            return flashSize();
+        case HostArea::SystemMemory:
+            return static_cast<uint32_t>(m_systemMemory.size());
+        case HostArea::OptionBytes:
+            return static_cast<uint32_t>(m_optionBytes.size());
+        case HostArea::Sram:
+        default:
+            return static_cast<uint32_t>(m_sram.size());
+    }
+}
+
+auto Memory::findRegion(uint32_t address) const -> MemoryRegion*
+{
+    // regions are sorted by start address, so the only candidate is the last one which starts before the address
+    auto it = std::upper_bound(m_memoryRegions.begin(), m_memoryRegions.end(), address, [](uint32_t value, const MemoryRegion* region) {
+        return value < region->regionStart();
+    });
+    if (it == m_memoryRegions.begin()) {
+        return nullptr;
+    }
+
+    --it;
+    return address < (*it)->regionEnd() ? *it : nullptr;
 }
 
 }  // namespace stm32
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <array>
 #include <cstdint>
 #include <vector>
 
@@ -141,9 +142,34 @@ public:
         uint32_t sramEnd;
 
         BootMode bootMode;
-        utils::ArrayView<uint8_t, uint32_t> flash;
+        utils::ArrayView<const uint8_t, uint32_t> flash;  ///< firmware image, read-only and may be shared, see FlashImage
     };
 
+    /**
+     * Memory backed by host buffers, tracked by snapshots
+     */
+    enum HostArea : uint8_t {
+        Flash,
+        SystemMemory,
+        OptionBytes,
+        Sram,
+        HostAreaCount,
+    };
+
+    /**
+     * Contents of host-backed memory
+     *
+     * Memory tracks pages written since it was last synchronized with a snapshot, i.e. since the snapshot was taken or
+     * restored. Restoring the same snapshot again copies only those pages, any other snapshot is copied entirely.
+     * Flash area is empty while flash isn't programmed, its contents are then the firmware image.
+     */
+    struct Snapshot {
+        uint64_t id = 0u;
+        std::array<std::vector<uint8_t>, HostAreaCount> areas{};
+    };
+
+    static constexpr uint32_t DirtyPageShift = 8u;
+
     explicit Memory(const Config& config);
 
     void attachRegion(MemoryRegion& region);
@@ -153,8 +179,56 @@ public:
     template <typename T>
     auto read(uint32_t address) const -> T;
 
+    /**
+     * Bulk copies for host-side accesses, ranges which lie in SRAM (or flash for reads) are copied at once and
+     * the rest byte by byte. Data accesses aren't checked by the debug logic
+     */
+    void readBlock(uint32_t address, uint8_t* data, uint32_t size) const;
+    void writeBlock(uint32_t address, const uint8_t* data, uint32_t size);
+
     inline auto config() const -> const Config& { return m_config; }
 
+    /**
+     * Current flash contents: the firmware image until flash is first programmed, the private overlay after that
+     */
+    inline auto flash() const -> utils::ArrayView<const uint8_t, uint32_t>
+    {
+        return m_flashOverlay.empty() ? m_config.flash : utils::ArrayView<const uint8_t, uint32_t>{m_flashOverlay.data(), flashSize()};
+    }
+    inline auto isFlashProgrammed() const -> bool { return !m_flashOverlay.empty(); }
+
+    static constexpr uint32_t PageShift = 12u;
+
+    /**
+     * Marks pages overlapping [begin, end) as slow path, data accesses to them are checked by the debug logic
+     */
+    void markSlowPages(uint32_t begin, uint64_t end);
+    void clearSlowPages();
+
+    /**
+     * Makes every page slow path until disabled, e.g. while data accesses are traced
+     */
+    void setSlowPathEverywhere(bool enabled);
+
+    inline auto isSlowPage(uint32_t address) const -> bool
+    {
+        const auto page = address >> PageShift;
+        return !m_slowPages.empty() && (m_slowPages[page / 64u] >> (page % 64u)) & 0x1u;
+    }
+
+
+    auto snapshot() -> Snapshot;
+    void restore(const Snapshot& snapshot);
+
+    /**
+     * @return unique identifier for snapshots created outside of memory, e.g. loaded from a file
+     */
+    static auto nextSnapshotId() -> uint64_t;
+
+    /**
+     * @return number of pages restored by the last restore
+     */
+    inline auto lastRestoredPages() const -> uint32_t { return m_lastRestoredPages; }
 
     inline auto systemMemory() -> std::vector<uint8_t>& { return m_systemMemory; }
     inline auto optionBytes() -> std::vector<uint8_t>& { return m_optionBytes; }
@@ -163,15 +237,47 @@ public:
 
 private:
     auto findRegion(uint32_t address) const -> MemoryRegion*;
+    auto hostArea(HostArea area) -> utils::ArrayView<uint8_t, uint32_t>;
+    auto hostAreaSize(HostArea area) const -> uint32_t;
+
+    inline auto flashSize() const -> uint32_t { return m_config.flashMemoryEnd - m_config.flashMemoryStart; }
+    void writeFlash(uint32_t offset, uint8_t data);
+    void allocateFlashOverlay();
+
+    void restoreFlash(const std::vector<uint8_t>& saved, bool onlyDirtyPages);
+    void restorePages(HostArea area, const std::vector<uint8_t>& saved, bool onlyDirtyPages);
+
+    inline void markDirty(HostArea area, uint32_t offset)
+    {
+        const auto page = offset >> DirtyPageShift;
+        m_dirtyPages[area][page / 64u] |= uint64_t{1u} << (page % 64u);
+    }
 
     Config m_config;
 
+    // copy of the whole flash range, allocated by the first flash write
+    std::vector<uint8_t> m_flashOverlay;
+
     std::vector<uint8_t> m_systemMemory;
     std::vector<uint8_t> m_optionBytes;
 
     std::vector<uint8_t> m_sram;
 
     std::vector<MemoryRegion*> m_memoryRegions;
+
+    // one bit per page, empty while nothing is watched
+    std::vector<uint64_t> m_slowPages;
+    bool m_slowPathEverywhere = false;
+
+    // one bit per page written since synchronization with the snapshot
+    std::array<std::vector<uint64_t>, HostAreaCount> m_dirtyPages;
+    uint64_t m_snapshotId = 0u;
+    uint32_t m_lastRestoredPages = 0u;
 };
 
+/**
+ * Memory layout of STM32F103C8: 128 KiB of flash, 20 KiB of SRAM, booting from flash
+ */
+auto stm32f103c8Config(utils::ArrayView<const uint8_t, uint32_t> flash) -> Memory::Config;
+
 }  // namespace stm32
@@ -12,6 +12,11 @@ using namespace utils;
 
 namespace details
 {
+inline auto isDataAccess(AccessType accessType) -> bool
+{
+    return accessType == AccessType::Normal || accessType == AccessType::Unprivileged;
+}
+
 template <typename T>
 inline auto alignedMemoryRead(Cpu& cpu, Mpu& mpu, uint32_t address, AccessType accessType) -> T
 {
@@ -27,6 +32,10 @@ inline auto alignedMemoryRead(Cpu& cpu, Mpu& mpu, uint32_t address, AccessType a
         value = reverseEndianness(value);
     }
 
+    if (cpu.memory().isSlowPage(address) && isDataAccess(accessType)) {
+        cpu.checkDataAccess(address, sizeof(T), false, value);
+    }
+
     return value;
 }
 
@@ -40,10 +49,15 @@ inline void alignedMemoryWrite(Cpu& cpu, Mpu& mpu, uint32_t address, T value, Ac
 
     const auto descriptor = mpu.validateAddress(address, accessType, true);
 
+    if (cpu.memory().isSlowPage(address) && isDataAccess(accessType)) {
+        cpu.checkDataAccess(address, sizeof(T), true, value);
+    }
+
     if (cpu.systemRegisters().AIRCR().ENDIANNESS) {
         value = reverseEndianness(value);
     }
 
+    const auto lock = cpu.exclusiveMonitor().observeStore(descriptor.physicalAddress);
     cpu.memory().write<T>(descriptor.physicalAddress, value);
 }
 
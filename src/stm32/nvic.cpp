@@ -0,0 +1,100 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "nvic.hpp"
+
+namespace stm32
+{
+namespace
+{
+enum RegisterOffset : uint32_t {
+    ISER = 0x000u,
+    ICER = 0x080u,
+    ISPR = 0x100u,
+    ICPR = 0x180u,
+    IABR = 0x200u,
+    IPR = 0x300u,
+    IPREnd = 0x3F0u,
+};
+
+inline auto isInBank(uint32_t offset, RegisterOffset bank) -> bool
+{
+    // Each bit-per-interrupt bank consists of 8 word registers
+    return offset - bank < 0x20u;
+}
+
+inline auto readBits(const rg::NvicRegistersSet& registers, uint16_t firstInterrupt, bool (rg::NvicRegistersSet::*getter)(uint16_t) const)
+    -> uint8_t
+{
+    uint8_t result = 0u;
+    for (uint16_t i = 0; i < 8u && firstInterrupt + i < rg::NvicRegistersSet::InterruptCount; ++i) {
+        if ((registers.*getter)(static_cast<uint16_t>(firstInterrupt + i))) {
+            result = static_cast<uint8_t>(result | (0x1u << i));
+        }
+    }
+    return result;
+}
+
+template <bool value>
+inline void writeBits(rg::NvicRegistersSet& registers, uint16_t firstInterrupt, uint8_t data, void (rg::NvicRegistersSet::*setter)(uint16_t, bool))
+{
+    // Writing zero has no effect for both set and clear registers
+    for (uint16_t i = 0; i < 8u && firstInterrupt + i < rg::NvicRegistersSet::InterruptCount; ++i) {
+        if ((data >> i) & 0x1u) {
+            (registers.*setter)(static_cast<uint16_t>(firstInterrupt + i), value);
+        }
+    }
+}
+
+}  // namespace
+
+Nvic::Nvic(rg::NvicRegistersSet& registers)
+    : MemoryRegion{NvicStart, NvicEnd}
+    , m_registers{registers}
+{
+}
+
+void Nvic::write(uint32_t address, uint8_t data)
+{
+    const auto offset = address - NvicStart;
+    const auto firstInterrupt = static_cast<uint16_t>((offset & 0x1fu) * 8u);
+
+    if (isInBank(offset, ISER)) {
+        writeBits<true>(m_registers, firstInterrupt, data, &rg::NvicRegistersSet::setEnabled);
+    }
+    else if (isInBank(offset, ICER)) {
+        writeBits<false>(m_registers, firstInterrupt, data, &rg::NvicRegistersSet::setEnabled);
+    }
+    else if (isInBank(offset, ISPR)) {
+        writeBits<true>(m_registers, firstInterrupt, data, &rg::NvicRegistersSet::setPending);
+    }
+    else if (isInBank(offset, ICPR)) {
+        writeBits<false>(m_registers, firstInterrupt, data, &rg::NvicRegistersSet::setPending);
+    }
+    else if (offset >= IPR && offset < IPREnd) {
+        m_registers.setPriority(static_cast<uint16_t>(offset - IPR), data);
+    }
+}
+
+auto Nvic::read(uint32_t address) -> uint8_t
+{
+    const auto offset = address - NvicStart;
+    const auto firstInterrupt = static_cast<uint16_t>((offset & 0x1fu) * 8u);
+
+    if (isInBank(offset, ISER) || isInBank(offset, ICER)) {
+        return readBits(m_registers, firstInterrupt, &rg::NvicRegistersSet::isEnabled);
+    }
+    else if (isInBank(offset, ISPR) || isInBank(offset, ICPR)) {
+        return readBits(m_registers, firstInterrupt, &rg::NvicRegistersSet::isPending);
+    }
+    else if (isInBank(offset, IABR)) {
+        return readBits(m_registers, firstInterrupt, &rg::NvicRegistersSet::isActive);
+    }
+    else if (offset >= IPR && offset < IPREnd) {
+        return m_registers.priority(static_cast<uint16_t>(offset - IPR));
+    }
+
+    return 0u;
+}
+
+}  // namespace stm32
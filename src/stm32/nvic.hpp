@@ -0,0 +1,36 @@
+#pragma once
+
+#include "memory.hpp"
+#include "registers/nvic_registers_set.hpp"
+
+namespace stm32
+{
+/**
+ * Memory mapped view of the NVIC registers in the System Control Space
+ *
+ * @par Register map (see B3.4.3)
+ *
+ * 0xE000E100 - 0xE000E11F: NVIC_ISER0 - NVIC_ISER7
+ * 0xE000E180 - 0xE000E19F: NVIC_ICER0 - NVIC_ICER7
+ * 0xE000E200 - 0xE000E21F: NVIC_ISPR0 - NVIC_ISPR7
+ * 0xE000E280 - 0xE000E29F: NVIC_ICPR0 - NVIC_ICPR7
+ * 0xE000E300 - 0xE000E31F: NVIC_IABR0 - NVIC_IABR7
+ * 0xE000E400 - 0xE000E4EF: NVIC_IPR0 - NVIC_IPR59
+ */
+class Nvic final : public MemoryRegion {
+public:
+    enum AddressSpace : uint32_t {
+        NvicStart = 0xE000E100u,
+        NvicEnd = 0xE000E4F0u,
+    };
+
+    explicit Nvic(rg::NvicRegistersSet& registers);
+
+    void write(uint32_t address, uint8_t data) override;
+    auto read(uint32_t address) -> uint8_t override;
+
+private:
+    rg::NvicRegistersSet& m_registers;
+};
+
+}  // namespace stm32
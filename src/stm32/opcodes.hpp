@@ -1479,9 +1479,11 @@ inline void cmdMsr(uint32_t opCode, Cpu& cpu)
                 switch (utils::getPart<0, 3>(SYSm)) {
                     case 0b000u:
                         cpu.registers().SP_main() = cpu.R(Rn);
+                        cpu.stackMonitor().update(debug::StackType::Main, cpu.registers().SP_main(), cpu.currentInstructionAddress());
                         break;
                     case 0b001u:
                         cpu.registers().SP_process() = cpu.R(Rn);
+                        cpu.stackMonitor().update(debug::StackType::Process, cpu.registers().SP_process(), cpu.currentInstructionAddress());
                         break;
                     default:
                         break;
@@ -1595,6 +1597,12 @@ void cmdHint(T /*opCode*/, Cpu& cpu)
     // TODO: implement hint's logic
 }
 
+inline void cmdBreakpoint(uint16_t opCode, Cpu& cpu)
+{
+    // BKPT is executed regardless of the condition code in IT block
+    cpu.softwareBreakpoint(utils::getPart<0, 8, uint8_t>(opCode));
+}
+
 template <Control control>
 void cmdMiscControl(uint32_t opCode, Cpu& cpu)
 {
@@ -1607,7 +1615,7 @@ void cmdMiscControl(uint32_t opCode, Cpu& cpu)
 
     if constexpr (control == Control::ClearExclusive) {
         UNUSED(option);
-        UNIMPLEMENTED;
+        cpu.exclusiveMonitor().clearExclusiveLocal();
     }
     else if constexpr (control == Control::DataSynchronizationBarrier) {
         cpu.dataSynchronizationBarrier(option);
@@ -1773,8 +1781,6 @@ inline void cmdPush(T opCode, Cpu& cpu)
         // unalignedAllowed = true;
     }
 
-    printf("push %d\n", utils::bitCount(registers));
-
     uint32_t bottomAddress = cpu.registers().SP() - 4u * utils::bitCount(registers);
 
     uint32_t address = bottomAddress;
@@ -1783,11 +1789,12 @@ inline void cmdPush(T opCode, Cpu& cpu)
             continue;
         }
 
-        cpu.memory().write(address, cpu.R(i));
+        cpu.mpu().alignedMemoryWrite(address, cpu.R(i));
         address += 4u;
     }
 
     cpu.registers().SP() = bottomAddress;
+    cpu.stackPointerWritten();
 }
 
 template <Encoding encoding, typename T>
@@ -1825,8 +1832,6 @@ inline void cmdPop(T opCode, Cpu& cpu)
         // unalignedAllowed = true;
     }
 
-    printf("pop %d\n", utils::bitCount(registers));
-
     uint32_t address = cpu.registers().SP();
 
     cpu.registers().SP() = cpu.registers().SP() + 4 * utils::bitCount(registers);
@@ -1836,12 +1841,12 @@ inline void cmdPop(T opCode, Cpu& cpu)
             continue;
         }
 
-        cpu.setR(i, cpu.memory().read<uint32_t>(address));
+        cpu.setR(i, cpu.mpu().alignedMemoryRead<uint32_t>(address));
         address += 4u;
     }
 
     if (utils::isBitSet<15>(registers)) {
-        cpu.loadWritePC(cpu.memory().read<uint32_t>(address));
+        cpu.loadWritePC(cpu.mpu().alignedMemoryRead<uint32_t>(address));
     }
 }
 
@@ -2183,6 +2188,65 @@ inline void cmdStoreRegisterDual(uint32_t opCode, Cpu& cpu)
     }
 }
 
+template <typename Type>
+void cmdLoadRegisterExclusive(uint32_t opCode, Cpu& cpu)
+{
+    static_assert(std::is_same_v<Type, uint8_t> || std::is_same_v<Type, uint16_t> || std::is_same_v<Type, uint32_t>);
+
+    CHECK_CONDITION;
+
+    const auto [imm8, Rt, Rn] = utils::split<_<0, 8>, _<12, 4>, _<16, 4>>(opCode);
+    UNPREDICTABLE_IF(isIn(Rt, 13, 15) || Rn == 15);
+
+    uint32_t imm32 = 0u;
+    if constexpr (std::is_same_v<Type, uint32_t>) {
+        imm32 = static_cast<uint32_t>(static_cast<uint32_t>(imm8) << 2u);
+    }
+    const auto address = cpu.R(Rn) + imm32;
+
+    auto& monitor = cpu.exclusiveMonitor();
+    const auto lock = monitor.lock();
+
+    monitor.setExclusiveMonitors(address);
+    cpu.setR(Rt, static_cast<uint32_t>(cpu.mpu().alignedMemoryRead<Type>(address)));
+}
+
+template <typename Type>
+void cmdStoreRegisterExclusive(uint32_t opCode, Cpu& cpu)
+{
+    static_assert(std::is_same_v<Type, uint8_t> || std::is_same_v<Type, uint16_t> || std::is_same_v<Type, uint32_t>);
+
+    CHECK_CONDITION;
+
+    uint8_t d;
+    uint32_t imm32 = 0u;
+    if constexpr (std::is_same_v<Type, uint32_t>) {
+        const auto [imm8, Rd] = utils::split<_<0, 8>, _<8, 4>>(opCode);
+        d = Rd;
+        imm32 = static_cast<uint32_t>(static_cast<uint32_t>(imm8) << 2u);
+    }
+    else {
+        d = utils::getPart<0, 4>(opCode);
+    }
+
+    const auto [Rt, Rn] = utils::split<_<12, 4>, _<16, 4>>(opCode);
+    UNPREDICTABLE_IF(isIn(d, 13, 15) || isIn(Rt, 13, 15) || Rn == 15);
+    UNPREDICTABLE_IF(d == Rn || d == Rt);
+
+    const auto address = cpu.R(Rn) + imm32;
+
+    auto& monitor = cpu.exclusiveMonitor();
+    const auto lock = monitor.lock();
+
+    if (monitor.exclusiveMonitorsPass(address)) {
+        cpu.mpu().alignedMemoryWrite(address, static_cast<Type>(cpu.R(Rt)));
+        cpu.setR(d, 0u);
+    }
+    else {
+        cpu.setR(d, 1u);
+    }
+}
+
 template <Encoding encoding, typename Type, typename T>
 void cmdStoreImmediate(T opCode, Cpu& cpu)
 {
@@ -2284,7 +2348,7 @@ void cmdLoadImmediate(T opCode, Cpu& cpu)
 
         t = Rt;
         n = Rn;
-        imm32 = static_cast<uint32_t>(opCode << utils::getAlignmentBitCount<Type>());
+        imm32 = static_cast<uint32_t>(imm5 << utils::getAlignmentBitCount<Type>());
         index = true;
         add = true;
         writeBack = false;
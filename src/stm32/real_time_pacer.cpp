@@ -0,0 +1,92 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "real_time_pacer.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+
+namespace stm32
+{
+namespace
+{
+constexpr uint64_t NanosecondsInSecond = 1'000'000'000u;
+constexpr uint64_t MicrosecondsInSecond = 1'000'000u;
+
+/**
+ * Validates the config before anything is derived from it
+ */
+auto validatedBurstCycles(const RealTimePacer::Config& config) -> uint64_t
+{
+    if (config.frequency == 0u) {
+        throw std::invalid_argument{"pacer frequency must be positive"};
+    }
+    if (config.burst.count() < 0) {
+        throw std::invalid_argument{"pacer burst must not be negative"};
+    }
+
+    const auto burst = static_cast<uint64_t>(config.burst.count());
+    if (burst > UINT64_MAX / config.frequency) {
+        throw std::invalid_argument{"pacer burst is too long for the frequency"};
+    }
+    return std::max<uint64_t>(1u, config.frequency * burst / MicrosecondsInSecond);
+}
+
+}  // namespace
+
+RealTimePacer::RealTimePacer(const Config& config)
+    : m_config{config}
+    , m_burstCycles{validatedBurstCycles(config)}
+    , m_anchorTime{Clock::now()}
+    , m_statistics{}
+{
+}
+
+void RealTimePacer::start(uint64_t cycles)
+{
+    m_anchorTime = Clock::now();
+    m_anchorCycles = cycles;
+}
+
+void RealTimePacer::pace(uint64_t cycles)
+{
+    ++m_statistics.bursts;
+
+    const auto target = m_anchorTime + cyclesToDuration(cycles - m_anchorCycles);
+    const auto now = Clock::now();
+
+    if (now >= target) {
+        const auto lag = std::chrono::duration_cast<std::chrono::nanoseconds>(now - target);
+        if (lag > m_config.maxDrift) {
+            // Too far behind, don't try to recover the whole debt at full speed
+            ++m_statistics.rebases;
+            start(cycles);
+        }
+        else {
+            m_statistics.maxLag = std::max(m_statistics.maxLag, lag);
+        }
+        return;
+    }
+
+    ++m_statistics.sleeps;
+
+    // Sleep is coarse, so wake up a bit earlier and spin until the target
+    if (target - now > m_config.spin) {
+        std::this_thread::sleep_until(target - m_config.spin);
+    }
+    while (Clock::now() < target) {
+        std::this_thread::yield();
+    }
+}
+
+auto RealTimePacer::cyclesToDuration(uint64_t cycles) const -> std::chrono::nanoseconds
+{
+    // Split into whole seconds and remainder to avoid overflow on long runs
+    const auto seconds = cycles / m_config.frequency;
+    const auto remainder = cycles % m_config.frequency;
+
+    return std::chrono::nanoseconds{static_cast<int64_t>(seconds * NanosecondsInSecond + remainder * NanosecondsInSecond / m_config.frequency)};
+}
+
+}  // namespace stm32
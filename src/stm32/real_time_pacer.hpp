@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+
+namespace stm32
+{
+/**
+ * Throttles emulation to the configured core frequency
+ *
+ * Run loop executes bursts of instructions and calls pace() between them. Pacer sleeps until the host monotonic clock
+ * catches up with the virtual time of the burst. When emulation falls behind, following bursts are executed without
+ * sleeping until the lag is recovered. If the lag exceeds the drift bound (e.g. after a pause or a slow host), the pacer
+ * rebases its anchor instead of running a long catch up at full speed.
+ */
+class RealTimePacer {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Config {
+        uint64_t frequency;                  ///< core frequency in Hz, e.g. 72 MHz for STM32F103
+        std::chrono::microseconds burst;     ///< virtual time executed between two pace points
+        std::chrono::microseconds maxDrift;  ///< maximal lag which is still recovered by catching up
+        std::chrono::microseconds spin;      ///< last part of each sleep is spent busy waiting to reduce jitter
+    };
+
+    struct Statistics {
+        uint64_t bursts;                  ///< number of pace points
+        uint64_t sleeps;                  ///< number of bursts which were ahead of the host clock
+        uint64_t rebases;                 ///< number of times the drift bound was exceeded
+        std::chrono::nanoseconds maxLag;  ///< maximal recovered lag
+    };
+
+    /**
+     * @throws std::invalid_argument if frequency is zero
+     */
+    explicit RealTimePacer(const Config& config);
+
+    /**
+     * Anchors virtual time to the current host time
+     */
+    void start(uint64_t cycles);
+
+    /**
+     * Waits until host clock reaches virtual time of the specified cycle
+     */
+    void pace(uint64_t cycles);
+
+    /**
+     * Converts number of cycles to virtual time, intermediate results don't overflow on long runs
+     */
+    auto cyclesToDuration(uint64_t cycles) const -> std::chrono::nanoseconds;
+
+    inline auto burstCycles() const -> uint64_t { return m_burstCycles; }
+    inline auto config() const -> const Config& { return m_config; }
+    inline auto statistics() const -> const Statistics& { return m_statistics; }
+
+private:
+    Config m_config;
+    uint64_t m_burstCycles;
+
+    Clock::time_point m_anchorTime;
+    uint64_t m_anchorCycles = 0u;
+
+    Statistics m_statistics;
+};
+
+}  // namespace stm32
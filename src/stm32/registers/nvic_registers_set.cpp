@@ -67,4 +67,93 @@ auto NvicRegistersSet::IPR(uint8_t n) const -> const InterruptPriorityRegister&
     return m_interruptPriorityRegisters[n];
 }
 
+auto NvicRegistersSet::isEnabled(uint16_t interrupt) const -> bool
+{
+    assert(interrupt < InterruptCount);
+    return (m_interruptEnableStates[interrupt >> 5u] >> (interrupt & 0x1fu)) & 0x1u;
+}
+
+void NvicRegistersSet::setEnabled(uint16_t interrupt, bool enabled)
+{
+    assert(interrupt < InterruptCount);
+    const auto mask = 0x1u << (interrupt & 0x1fu);
+    if (enabled) {
+        m_interruptEnableStates[interrupt >> 5u] |= mask;
+    }
+    else {
+        m_interruptEnableStates[interrupt >> 5u] &= ~mask;
+    }
+}
+
+auto NvicRegistersSet::isPending(uint16_t interrupt) const -> bool
+{
+    assert(interrupt < InterruptCount);
+    return (m_interruptPendingStates[interrupt >> 5u] >> (interrupt & 0x1fu)) & 0x1u;
+}
+
+void NvicRegistersSet::setPending(uint16_t interrupt, bool pending)
+{
+    assert(interrupt < InterruptCount);
+    const auto mask = 0x1u << (interrupt & 0x1fu);
+    if (pending) {
+        m_interruptPendingStates[interrupt >> 5u] |= mask;
+    }
+    else {
+        m_interruptPendingStates[interrupt >> 5u] &= ~mask;
+    }
+}
+
+auto NvicRegistersSet::isActive(uint16_t interrupt) const -> bool
+{
+    assert(interrupt < InterruptCount);
+    return (m_interruptActiveBitRegisters[interrupt >> 5u].ACTIVE >> (interrupt & 0x1fu)) & 0x1u;
+}
+
+void NvicRegistersSet::setActive(uint16_t interrupt, bool active)
+{
+    assert(interrupt < InterruptCount);
+    const auto mask = 0x1u << (interrupt & 0x1fu);
+    auto& IABR = m_interruptActiveBitRegisters[interrupt >> 5u];
+    if (active) {
+        IABR.registerData |= mask;
+    }
+    else {
+        IABR.registerData &= ~mask;
+    }
+}
+
+auto NvicRegistersSet::priority(uint16_t interrupt) const -> uint8_t
+{
+    assert(interrupt < InterruptCount);
+    return m_interruptPriorityRegisters[interrupt >> 2u].PRI[interrupt & 0x3u];
+}
+
+void NvicRegistersSet::setPriority(uint16_t interrupt, uint8_t priority)
+{
+    assert(interrupt < InterruptCount);
+    m_interruptPriorityRegisters[interrupt >> 2u].PRI[interrupt & 0x3u] = priority & PriorityMask;
+}
+
+auto NvicRegistersSet::highestPendingInterrupt() const -> std::optional<uint16_t>
+{
+    std::optional<uint16_t> result{};
+    uint16_t resultPriority = 0x100u;
+
+    for (uint16_t n = 0; n < m_interruptPendingStates.size(); ++n) {
+        auto candidates = m_interruptPendingStates[n] & m_interruptEnableStates[n];
+        while (candidates != 0u) {
+            const auto bit = static_cast<uint16_t>(__builtin_ctz(candidates));
+            candidates &= candidates - 1u;
+
+            const auto interrupt = static_cast<uint16_t>((n << 5u) + bit);
+            if (priority(interrupt) < resultPriority) {
+                resultPriority = priority(interrupt);
+                result = interrupt;
+            }
+        }
+    }
+
+    return result;
+}
+
 }  // namespace stm32::sc
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <optional>
 
 #include "nvic_registers.hpp"
 
@@ -22,6 +23,26 @@ public:
 
     auto IPR(uint8_t n) const -> const InterruptPriorityRegister&;
 
+    auto isEnabled(uint16_t interrupt) const -> bool;
+    void setEnabled(uint16_t interrupt, bool enabled);
+
+    auto isPending(uint16_t interrupt) const -> bool;
+    void setPending(uint16_t interrupt, bool pending);
+
+    auto isActive(uint16_t interrupt) const -> bool;
+    void setActive(uint16_t interrupt, bool active);
+
+    auto priority(uint16_t interrupt) const -> uint8_t;
+    void setPriority(uint16_t interrupt, uint8_t priority);
+
+    /**
+     * Finds enabled and pending interrupt with the highest priority (the lowest number wins on equal priority)
+     */
+    auto highestPendingInterrupt() const -> std::optional<uint16_t>;
+
+    static constexpr uint16_t InterruptCount = 240u;
+    static constexpr uint8_t PriorityMask = 0xF0u;  // STM32F1 implements only 4 upper bits of priority
+
 private:
     std::array<uint32_t, 8> m_interruptEnableStates;
     std::array<uint32_t, 8> m_interruptPendingStates;
@@ -0,0 +1,452 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "save_state.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <type_traits>
+
+#include "utils/mapped_file.hpp"
+
+namespace stm32
+{
+namespace
+{
+constexpr char Magic[8] = {'S', 'T', 'M', '3', '2', 'S', 'A', 'V'};
+constexpr uint32_t PageSize = 256u;
+
+constexpr auto makeTag(const char (&name)[5]) -> uint32_t
+{
+    return static_cast<uint32_t>(name[0]) | (static_cast<uint32_t>(name[1]) << 8u) | (static_cast<uint32_t>(name[2]) << 16u) |
+           (static_cast<uint32_t>(name[3]) << 24u);
+}
+
+constexpr uint32_t CoreTag = makeTag("CORE");
+constexpr uint32_t PeripheralsTag = makeTag("PERI");
+constexpr uint32_t PagesTag = makeTag("PAGE");
+
+constexpr uint32_t CoreVersion = 2u;
+constexpr uint32_t PeripheralsVersion = 3u;
+constexpr uint32_t PagesVersion = 1u;
+
+// u64 timestamp, u8 type, u16 channel, u32 data
+constexpr size_t InputEventSize = 15u;
+
+enum class PageEncoding : uint8_t {
+    Stored,
+    Fill,
+    RunLength,
+};
+
+// Run-length encoding: control byte below 128 is followed by (control + 1) literal bytes, otherwise the next byte is
+// repeated (control - 125) times
+constexpr size_t MinRun = 3u;
+constexpr size_t MaxRun = 130u;
+constexpr size_t MaxLiteral = 128u;
+
+class Writer {
+public:
+    void u8(uint8_t value) { m_data.push_back(value); }
+
+    void u16(uint16_t value)
+    {
+        u8(static_cast<uint8_t>(value));
+        u8(static_cast<uint8_t>(value >> 8u));
+    }
+
+    void u32(uint32_t value)
+    {
+        u16(static_cast<uint16_t>(value));
+        u16(static_cast<uint16_t>(value >> 16u));
+    }
+
+    void u64(uint64_t value)
+    {
+        u32(static_cast<uint32_t>(value));
+        u32(static_cast<uint32_t>(value >> 32u));
+    }
+
+    void bytes(const void* data, size_t size)
+    {
+        const auto* begin = static_cast<const uint8_t*>(data);
+        m_data.insert(m_data.end(), begin, begin + size);
+    }
+
+    template <typename T>
+    void blob(const T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        u32(static_cast<uint32_t>(sizeof(T)));
+        bytes(&value, sizeof(T));
+    }
+
+    auto beginChunk(uint32_t tag, uint32_t version) -> size_t
+    {
+        u32(tag);
+        u32(version);
+        u64(0u);
+        return m_data.size();
+    }
+
+    void endChunk(size_t payloadOffset)
+    {
+        const auto size = uint64_t{m_data.size() - payloadOffset};
+        for (uint32_t i = 0; i < 8u; ++i) {
+            m_data[payloadOffset - 8u + i] = static_cast<uint8_t>(size >> (8u * i));
+        }
+        m_data.resize((m_data.size() + 7u) & ~size_t{7u}, 0u);
+    }
+
+    inline auto data() const -> const std::vector<uint8_t>& { return m_data; }
+
+private:
+    std::vector<uint8_t> m_data{};
+};
+
+class Reader {
+public:
+    explicit Reader(const uint8_t* data, size_t size)
+        : m_data{data}
+        , m_size{size}
+    {
+    }
+
+    auto bytes(size_t size) -> const uint8_t*
+    {
+        if (size > m_size - m_offset) {
+            throw std::runtime_error{"save state is truncated"};
+        }
+
+        const auto* result = m_data + m_offset;
+        m_offset += size;
+        return result;
+    }
+
+    inline auto remaining() const -> size_t { return m_size - m_offset; }
+
+    auto u8() -> uint8_t { return *bytes(1u); }
+
+    auto u16() -> uint16_t
+    {
+        const auto* data = bytes(2u);
+        return static_cast<uint16_t>(data[0] | (data[1] << 8u));
+    }
+
+    auto u32() -> uint32_t
+    {
+        const auto low = u16();
+        return low | (uint32_t{u16()} << 16u);
+    }
+
+    auto u64() -> uint64_t
+    {
+        const auto low = u32();
+        return low | (uint64_t{u32()} << 32u);
+    }
+
+    template <typename T>
+    void blob(T& value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        if (u32() != sizeof(T)) {
+            throw std::runtime_error{"save state was written with a different register layout"};
+        }
+        std::memcpy(&value, bytes(sizeof(T)), sizeof(T));
+    }
+
+private:
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_offset = 0u;
+};
+
+auto encodeRunLength(const uint8_t* data, size_t size) -> std::vector<uint8_t>
+{
+    const auto runLength = [&](size_t offset) {
+        size_t length = 1u;
+        while (offset + length < size && length < MaxRun && data[offset + length] == data[offset]) {
+            ++length;
+        }
+        return length;
+    };
+
+    std::vector<uint8_t> encoded;
+    size_t offset = 0u;
+    while (offset < size) {
+        if (const auto run = runLength(offset); run >= MinRun) {
+            encoded.push_back(static_cast<uint8_t>(run + 125u));
+            encoded.push_back(data[offset]);
+            offset += run;
+            continue;
+        }
+
+        const auto literalStart = offset;
+        while (offset < size && offset - literalStart < MaxLiteral && runLength(offset) < MinRun) {
+            ++offset;
+        }
+        encoded.push_back(static_cast<uint8_t>(offset - literalStart - 1u));
+        encoded.insert(encoded.end(), data + literalStart, data + offset);
+    }
+    return encoded;
+}
+
+void decodeRunLength(Reader& reader, uint8_t* output, size_t size)
+{
+    size_t offset = 0u;
+    while (offset < size) {
+        const auto control = reader.u8();
+        const auto length = control < MaxLiteral ? size_t{control} + 1u : size_t{control} - 125u;
+        if (length > size - offset) {
+            throw std::runtime_error{"save state page is corrupted"};
+        }
+
+        if (control < MaxLiteral) {
+            std::memcpy(output + offset, reader.bytes(length), length);
+        }
+        else {
+            std::memset(output + offset, reader.u8(), length);
+        }
+        offset += length;
+    }
+}
+
+void writePages(Writer& writer, uint8_t area, const std::vector<uint8_t>& data)
+{
+    const auto chunk = writer.beginChunk(PagesTag, PagesVersion);
+    writer.u8(area);
+    writer.u32(static_cast<uint32_t>(data.size()));
+    writer.u32(PageSize);
+
+    for (size_t offset = 0u; offset < data.size(); offset += PageSize) {
+        const auto* page = data.data() + offset;
+        const auto size = std::min<size_t>(PageSize, data.size() - offset);
+
+        if (std::all_of(page, page + size, [&](uint8_t value) { return value == page[0]; })) {
+            writer.u8(static_cast<uint8_t>(PageEncoding::Fill));
+            writer.u8(page[0]);
+            continue;
+        }
+
+        if (const auto encoded = encodeRunLength(page, size); encoded.size() < size) {
+            writer.u8(static_cast<uint8_t>(PageEncoding::RunLength));
+            writer.bytes(encoded.data(), encoded.size());
+        }
+        else {
+            writer.u8(static_cast<uint8_t>(PageEncoding::Stored));
+            writer.bytes(page, size);
+        }
+    }
+    writer.endChunk(chunk);
+}
+
+/**
+ * @return size of the address range an area is mapped into, no memory layout has a larger area
+ */
+auto maxAreaSize(uint8_t area) -> uint64_t
+{
+    return area == Memory::Sram ? Memory::SramEnd - Memory::SramStart : Memory::CodeEnd - Memory::CodeStart;
+}
+
+void readPages(Reader& reader, Memory::Snapshot& memory, std::array<bool, Memory::HostAreaCount>& loaded)
+{
+    const auto area = reader.u8();
+    const auto size = reader.u32();
+    const auto pageSize = reader.u32();
+    if (area >= Memory::HostAreaCount || pageSize == 0u || size > maxAreaSize(area)) {
+        throw std::runtime_error{"save state memory chunk is corrupted"};
+    }
+    // every page takes at least its encoding byte
+    if ((uint64_t{size} + pageSize - 1u) / pageSize > reader.remaining()) {
+        throw std::runtime_error{"save state is truncated"};
+    }
+
+    auto& data = memory.areas[area];
+    data.resize(size);
+    for (size_t offset = 0u; offset < size; offset += pageSize) {
+        auto* page = data.data() + offset;
+        const auto pageLength = std::min<size_t>(pageSize, size - offset);
+
+        switch (static_cast<PageEncoding>(reader.u8())) {
+            case PageEncoding::Stored:
+                std::memcpy(page, reader.bytes(pageLength), pageLength);
+                break;
+            case PageEncoding::Fill:
+                std::memset(page, reader.u8(), pageLength);
+                break;
+            case PageEncoding::RunLength:
+                decodeRunLength(reader, page, pageLength);
+                break;
+            default:
+                throw std::runtime_error{"save state page encoding is unknown"};
+        }
+    }
+    loaded[area] = true;
+}
+
+}  // namespace
+
+void SaveState::save(const Cpu::Snapshot& snapshot, const std::string& path)
+{
+    Writer writer;
+    writer.bytes(Magic, sizeof(Magic));
+    writer.u32(Version);
+    writer.u32(2u + Memory::HostAreaCount);
+
+    auto chunk = writer.beginChunk(CoreTag, CoreVersion);
+    writer.blob(snapshot.registers);
+    writer.blob(snapshot.systemRegisters);
+    writer.blob(snapshot.sysTickRegisters);
+    writer.blob(snapshot.nvicRegisters);
+    writer.blob(snapshot.mpuRegisters);
+    writer.u8(static_cast<uint8_t>(snapshot.currentMode));
+    writer.u8(snapshot.wasEventRegistered ? 1u : 0u);
+    writer.u8(snapshot.skipAdvancingIT ? 1u : 0u);
+    writer.u32(snapshot.currentInstructionAddress);
+    writer.u32(snapshot.nextInstructionAddress);
+    writer.u64(snapshot.cycles);
+    writer.u64(snapshot.stallCycles);
+    for (size_t i = 0; i < snapshot.exceptionActive.size(); i += 8u) {
+        uint8_t bits = 0u;
+        for (size_t bit = 0; bit < 8u; ++bit) {
+            bits = static_cast<uint8_t>(bits | (snapshot.exceptionActive.test(i + bit) ? 1u << bit : 0u));
+        }
+        writer.u8(bits);
+    }
+    writer.endChunk(chunk);
+
+    chunk = writer.beginChunk(PeripheralsTag, PeripheralsVersion);
+    writer.u32(snapshot.flashInterface.acr);
+    writer.u32(snapshot.flashInterface.lastLine);
+    writer.u8(snapshot.flashInterface.isLastLineValid ? 1u : 0u);
+    writer.u64(snapshot.flashInterface.lineReadyCycle);
+    writer.u32(snapshot.itm.traceEnable);
+    writer.u32(snapshot.itm.tracePrivilege);
+    writer.u32(snapshot.itm.traceControl);
+    writer.u32(static_cast<uint32_t>(snapshot.pendingInputEvents.size()));
+    for (const auto& event : snapshot.pendingInputEvents) {
+        writer.u64(event.timestamp);
+        writer.u8(static_cast<uint8_t>(event.type));
+        writer.u16(event.channel);
+        writer.u32(event.data);
+    }
+    writer.endChunk(chunk);
+
+    for (uint8_t area = 0; area < Memory::HostAreaCount; ++area) {
+        writePages(writer, area, snapshot.memory.areas[area]);
+    }
+
+    auto* file = std::fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        throw std::system_error{errno, std::generic_category(), path};
+    }
+
+    const auto& data = writer.data();
+    const auto written = std::fwrite(data.data(), 1u, data.size(), file);
+    const auto closed = std::fclose(file) == 0;
+    if (written != data.size() || !closed) {
+        throw std::system_error{errno, std::generic_category(), path};
+    }
+}
+
+auto SaveState::load(const std::string& path) -> Cpu::Snapshot
+{
+    const utils::MappedFile file{path};
+    Reader reader{file.data(), file.size()};
+
+    if (std::memcmp(reader.bytes(sizeof(Magic)), Magic, sizeof(Magic)) != 0) {
+        throw std::runtime_error{"not a save state"};
+    }
+    if (const auto version = reader.u32(); version != Version) {
+        throw std::runtime_error{"save state version " + std::to_string(version) + " is not supported"};
+    }
+
+    Cpu::Snapshot snapshot;
+    snapshot.memory.id = Memory::nextSnapshotId();
+
+    auto hasCore = false;
+    std::array<bool, Memory::HostAreaCount> loadedAreas{};
+
+    const auto chunkCount = reader.u32();
+    for (uint32_t i = 0; i < chunkCount; ++i) {
+        const auto tag = reader.u32();
+        const auto version = reader.u32();
+        const auto size = reader.u64();
+        if (size > file.size()) {
+            throw std::runtime_error{"save state is truncated"};
+        }
+
+        const auto paddedSize = (static_cast<size_t>(size) + 7u) & ~size_t{7u};
+        Reader chunk{reader.bytes(static_cast<size_t>(size)), static_cast<size_t>(size)};
+        reader.bytes(paddedSize - static_cast<size_t>(size));
+
+        // chunks of unknown kinds are skipped, known ones must be of the supported version. CORE version 1 lacks stall
+        // cycles and PERI version 1 lacks the flash line delivery cycle, both only affect flash wait states. PERI
+        // version 2 lacks ITM registers, which are loaded as after reset without a capture
+        const auto expectedVersion = tag == CoreTag ? CoreVersion : tag == PeripheralsTag ? PeripheralsVersion : PagesVersion;
+        const auto isSupported = version == expectedVersion || (tag == CoreTag && version == 1u) ||
+                                 (tag == PeripheralsTag && version >= 1u && version < PeripheralsVersion);
+        if ((tag == CoreTag || tag == PeripheralsTag || tag == PagesTag) && !isSupported) {
+            throw std::runtime_error{"save state chunk version " + std::to_string(version) + " is not supported"};
+        }
+
+        if (tag == CoreTag) {
+            chunk.blob(snapshot.registers);
+            chunk.blob(snapshot.systemRegisters);
+            chunk.blob(snapshot.sysTickRegisters);
+            chunk.blob(snapshot.nvicRegisters);
+            chunk.blob(snapshot.mpuRegisters);
+            snapshot.currentMode = static_cast<ExecutionMode>(chunk.u8());
+            snapshot.wasEventRegistered = chunk.u8() != 0u;
+            snapshot.skipAdvancingIT = chunk.u8() != 0u;
+            snapshot.currentInstructionAddress = chunk.u32();
+            snapshot.nextInstructionAddress = chunk.u32();
+            snapshot.cycles = chunk.u64();
+            snapshot.stallCycles = version >= 2u ? chunk.u64() : 0u;
+            for (size_t bit = 0; bit < snapshot.exceptionActive.size(); bit += 8u) {
+                const auto bits = chunk.u8();
+                for (size_t j = 0; j < 8u; ++j) {
+                    snapshot.exceptionActive[bit + j] = ((bits >> j) & 0x1u) != 0u;
+                }
+            }
+            hasCore = true;
+        }
+        else if (tag == PeripheralsTag) {
+            snapshot.flashInterface.acr = chunk.u32();
+            snapshot.flashInterface.lastLine = chunk.u32();
+            snapshot.flashInterface.isLastLineValid = chunk.u8() != 0u;
+            snapshot.flashInterface.lineReadyCycle = version >= 2u ? chunk.u64() : 0u;
+            if (version >= 3u) {
+                snapshot.itm.traceEnable = chunk.u32();
+                snapshot.itm.tracePrivilege = chunk.u32();
+                snapshot.itm.traceControl = chunk.u32();
+            }
+
+            const auto eventCount = chunk.u32();
+            if (eventCount > chunk.remaining() / InputEventSize) {
+                throw std::runtime_error{"save state is truncated"};
+            }
+            snapshot.pendingInputEvents.resize(eventCount);
+            for (auto& event : snapshot.pendingInputEvents) {
+                event.timestamp = chunk.u64();
+                event.type = static_cast<InputEventType>(chunk.u8());
+                event.channel = chunk.u16();
+                event.data = chunk.u32();
+            }
+        }
+        else if (tag == PagesTag) {
+            readPages(chunk, snapshot.memory, loadedAreas);
+        }
+    }
+
+    if (!hasCore || std::find(loadedAreas.begin(), loadedAreas.end(), false) != loadedAreas.end()) {
+        throw std::runtime_error{"save state is incomplete"};
+    }
+    return snapshot;
+}
+
+}  // namespace stm32
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "cpu.hpp"
+
+namespace stm32
+{
+/**
+ * Versioned on-disk format of machine snapshots
+ *
+ * @par File layout, all integers are little-endian
+ *
+ * Header:  "STM32SAV", u32 format version, u32 chunk count
+ * Chunk:   u32 tag, u32 chunk version, u64 payload size, payload padded to 8 bytes
+ *
+ * CORE:    register sets as (u32 size, raw bytes), execution mode, exception state, IT bookkeeping and virtual time
+ *          with the flash wait states in it
+ * PERI:    flash interface state, ITM registers and scheduled input events
+ * PAGE:    one chunk per host memory area, u8 area, u32 size, u32 page size, then every page is stored, filled with
+ *          one byte value or run-length encoded, whichever is the shortest. Flash area is empty unless flash was
+ *          programmed, such a state is loaded on top of the same firmware image.
+ *
+ * Loader maps the file into memory, so only pages which are actually decoded are read from disk, and skips chunks it
+ * doesn't know. Register sets are stored as raw bytes, so a file is bound to the register layout of the version
+ * which wrote it, any layout change must bump the chunk version.
+ */
+class SaveState {
+public:
+    static constexpr uint32_t Version = 1u;
+
+    /**
+     * @throws std::system_error if file can't be written
+     */
+    static void save(const Cpu::Snapshot& snapshot, const std::string& path);
+
+    /**
+     * @throws std::system_error if file can't be mapped
+     * @throws std::runtime_error if file is malformed or was written by an incompatible version
+     */
+    static auto load(const std::string& path) -> Cpu::Snapshot;
+};
+
+}  // namespace stm32
@@ -0,0 +1,137 @@
+// This is an open source non-commercial project. Dear PVS-Studio, please check it.
+// PVS-Studio Static Code Analyzer for C, C++ and C#: http://www.viva64.com
+
+#include "system.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <barrier>
+#include <stdexcept>
+#include <thread>
+
+namespace stm32
+{
+System::Link::Link(Cpu& from, Cpu& to, uint16_t channel)
+    : m_from{from}
+    , m_to{to}
+    , m_channel{channel}
+    , m_queue{}
+{
+}
+
+void System::Link::send(uint32_t data)
+{
+    // Ring is drained only at quantum boundaries, so overflow depends only on virtual time and stays deterministic
+    if (!m_queue.tryPush(Message{.timestamp = m_from.cycles(), .data = data})) {
+        ++m_droppedMessages;
+    }
+}
+
+void System::Link::deliver(uint64_t latency)
+{
+    while (const auto message = m_queue.tryPop()) {
+        // Keep timestamps strictly increasing to preserve the order of messages sent during the same cycle
+        m_lastDelivery = std::max(message->timestamp + latency, m_lastDelivery + 1u);
+
+        m_to.scheduleInputEvent(InputEvent{
+            .timestamp = m_lastDelivery,
+            .type = InputEventType::PeripheralInput,
+            .channel = m_channel,
+            .data = message->data,
+        });
+    }
+}
+
+System::System(uint64_t quantum)
+    : m_quantum{quantum}
+    , m_devices{}
+    , m_stopReasons{}
+    , m_links{}
+{
+    if (quantum == 0u) {
+        throw std::invalid_argument{"system quantum must be positive"};
+    }
+}
+
+auto System::addDevice(const Memory::Config& memoryConfig) -> Cpu&
+{
+    m_stopReasons.emplace_back();
+    return *m_devices.emplace_back(std::make_unique<Cpu>(memoryConfig));
+}
+
+auto System::connect(Cpu& from, Cpu& to, uint16_t channel) -> Link&
+{
+    return *m_links.emplace_back(std::make_unique<Link>(from, to, channel));
+}
+
+void System::reset()
+{
+    for (auto& device : m_devices) {
+        device->reset();
+    }
+    std::fill(m_stopReasons.begin(), m_stopReasons.end(), std::nullopt);
+}
+
+void System::run(uint64_t cycles)
+{
+    if (m_devices.empty()) {
+        return;
+    }
+
+    const auto quantumCount = (cycles + m_quantum - 1u) / m_quantum;
+
+    std::atomic<bool> failed{false};
+    std::vector<std::exception_ptr> errors(m_devices.size());
+
+    // Completion runs on one thread while all others wait on the barrier, so links are drained without races
+    std::barrier barrier{static_cast<std::ptrdiff_t>(m_devices.size()), [this]() noexcept {
+                             m_currentTime += m_quantum;
+                             exchangeMessages();
+                         }};
+
+    const auto deviceLoop = [&](size_t index) {
+        auto& device = *m_devices[index];
+        auto& stopReason = m_stopReasons[index];
+        for (uint64_t q = 0; q < quantumCount && !failed.load(std::memory_order_relaxed); ++q) {
+            try {
+                const auto quantumEnd = m_currentTime + m_quantum;
+                while (!stopReason.has_value() && device.cycles() < quantumEnd) {
+                    if (const auto reason = device.run(quantumEnd - device.cycles()); reason != StopReason::CycleLimit) {
+                        stopReason = reason;
+                    }
+                }
+            }
+            catch (...) {
+                errors[index] = std::current_exception();
+                failed.store(true, std::memory_order_relaxed);
+            }
+            barrier.arrive_and_wait();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(m_devices.size() - 1u);
+    for (size_t i = 1; i < m_devices.size(); ++i) {
+        threads.emplace_back(deviceLoop, i);
+    }
+    deviceLoop(0u);
+
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    for (const auto& error : errors) {
+        if (error) {
+            std::rethrow_exception(error);
+        }
+    }
+}
+
+void System::exchangeMessages()
+{
+    for (auto& link : m_links) {
+        link->deliver(m_quantum);
+    }
+}
+
+}  // namespace stm32
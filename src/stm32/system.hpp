@@ -0,0 +1,111 @@
+#pragma once
+
+#include <exception>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "cpu.hpp"
+#include "utils/spsc_queue.hpp"
+
+namespace stm32
+{
+/**
+ * Container for several microcontrollers which are simulated together
+ *
+ * Each device runs on its own thread in lock-step quanta of virtual time. Devices exchange messages only through links,
+ * which are drained at quantum boundaries while all devices are stopped. Every message is delivered to the receiver
+ * exactly one quantum after it was sent (in virtual time of the sender), so the result doesn't depend on host
+ * scheduling.
+ *
+ * Device which stops for any other reason than the end of its quantum (semihosting exit, stack overflow, breakpoint,
+ * watchpoint or stop request) is halted: its virtual time stands still and it isn't scheduled until the stop is cleared or the
+ * system is reset, the others keep running.
+ */
+class System {
+public:
+    static constexpr size_t LinkCapacity = 4096u;
+
+    /**
+     * One-directional channel between two devices
+     *
+     * Messages are passed to the input event handler of the receiver as peripheral input events on the link channel
+     */
+    class Link {
+    public:
+        explicit Link(Cpu& from, Cpu& to, uint16_t channel);
+
+        /**
+         * Sends message to the receiver. Must be called only from the sender device thread (e.g. by its peripheral)
+         */
+        void send(uint32_t data);
+
+        inline auto droppedMessages() const -> uint64_t { return m_droppedMessages; }
+
+    private:
+        friend class System;
+
+        struct Message {
+            uint64_t timestamp;
+            uint32_t data;
+        };
+
+        void deliver(uint64_t latency);
+
+        Cpu& m_from;
+        Cpu& m_to;
+        uint16_t m_channel;
+
+        utils::SpscQueue<Message, LinkCapacity> m_queue;
+        uint64_t m_droppedMessages = 0u;
+        uint64_t m_lastDelivery = 0u;
+    };
+
+    /**
+     * @throws std::invalid_argument if quantum is zero
+     */
+    explicit System(uint64_t quantum);
+
+public:
+    RESTRICT_COPY(System);
+
+    auto addDevice(const Memory::Config& memoryConfig) -> Cpu&;
+    auto connect(Cpu& from, Cpu& to, uint16_t channel) -> Link&;
+
+    /**
+     * Resets all devices and clears their stops
+     */
+    void reset();
+
+    /**
+     * Runs all devices for the specified amount of virtual cycles, rounded up to whole quanta.
+     * Rethrows the first exception raised by any device
+     */
+    void run(uint64_t cycles);
+
+    inline auto quantum() const -> uint64_t { return m_quantum; }
+    inline auto devices() const -> const std::vector<std::unique_ptr<Cpu>>& { return m_devices; }
+
+    /**
+     * @return reason the device was halted for, empty while it runs
+     */
+    inline auto stopReason(size_t device) const -> std::optional<StopReason> { return m_stopReasons[device]; }
+
+    /**
+     * Resumes a halted device from the next run, after the caller has handled the stop, e.g. taken the stack overflow
+     * or watchpoint hit
+     */
+    inline void clearStop(size_t device) { m_stopReasons[device].reset(); }
+
+private:
+    void exchangeMessages();
+
+    uint64_t m_quantum;
+    uint64_t m_currentTime = 0u;
+
+    std::vector<std::unique_ptr<Cpu>> m_devices;
+    std::vector<std::optional<StopReason>> m_stopReasons;
+    std::vector<std::unique_ptr<Link>> m_links;
+};
+
+}  // namespace stm32
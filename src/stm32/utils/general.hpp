@@ -21,6 +21,14 @@
 
 #define UNUSED(x) (void)(x)
 
+#ifndef RESTRICT_COPY
+#define RESTRICT_COPY(ClassName)                     \
+    ClassName(const ClassName&) = delete;            \
+    ClassName& operator=(const ClassName&) = delete; \
+    ClassName(ClassName&&) noexcept = delete;        \
+    ClassName& operator=(ClassName&&) noexcept = delete
+#endif
+
 #define DEFINE_REG(StructName, definition)         \
     union StructName {                             \
         struct __attribute__((packed)) definition; \
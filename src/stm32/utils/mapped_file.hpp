@@ -0,0 +1,106 @@
+#pragma once
+
+#if defined(_WIN32)
+#include <cstdio>
+#include <vector>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <system_error>
+
+#include "general.hpp"
+
+namespace stm32::utils
+{
+#if defined(_WIN32)
+/**
+ * Whole file read into memory, Windows builds have no mmap
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path)
+        : m_data{}
+    {
+        auto* file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr) {
+            throw std::system_error{errno, std::generic_category(), path};
+        }
+
+        uint8_t chunk[4096];
+        size_t size = 0u;
+        while ((size = std::fread(chunk, 1u, sizeof(chunk), file)) != 0u) {
+            m_data.insert(m_data.end(), chunk, chunk + size);
+        }
+        const auto failed = std::ferror(file) != 0;
+        std::fclose(file);
+        if (failed) {
+            throw std::system_error{EIO, std::generic_category(), path};
+        }
+    }
+
+    inline auto data() const -> const uint8_t* { return m_data.data(); }
+    inline auto size() const -> size_t { return m_data.size(); }
+
+private:
+    std::vector<uint8_t> m_data;
+};
+#else
+/**
+ * Read-only private mapping of a whole file, pages are read from disk on first access
+ */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path)
+        : m_fd{::open(path.c_str(), O_RDONLY | O_CLOEXEC)}
+    {
+        if (m_fd < 0) {
+            throw std::system_error{errno, std::generic_category(), path};
+        }
+
+        struct stat status {};
+        if (::fstat(m_fd, &status) != 0) {
+            const auto error = errno;
+            ::close(m_fd);
+            throw std::system_error{error, std::generic_category(), path};
+        }
+
+        m_size = static_cast<size_t>(status.st_size);
+        if (m_size != 0u) {
+            m_data = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, m_fd, 0);
+            if (m_data == MAP_FAILED) {
+                const auto error = errno;
+                ::close(m_fd);
+                throw std::system_error{error, std::generic_category(), path};
+            }
+        }
+    }
+
+    ~MappedFile()
+    {
+        if (m_data != nullptr) {
+            ::munmap(m_data, m_size);
+        }
+        ::close(m_fd);
+    }
+
+    RESTRICT_COPY(MappedFile);
+
+    inline auto data() const -> const uint8_t* { return static_cast<const uint8_t*>(m_data); }
+    inline auto size() const -> size_t { return m_size; }
+
+private:
+    int m_fd;
+    void* m_data = nullptr;
+    size_t m_size = 0u;
+};
+#endif
+
+}  // namespace stm32::utils
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+
+namespace stm32::utils
+{
+/**
+ * Bounded lock-free multi-producer single-consumer queue
+ *
+ * Every cell carries a sequence number which tells producers whether the cell is free and the consumer whether
+ * the value in it is already published. Producers only contend with each other on the tail index, the consumer
+ * never takes a lock and never waits for them.
+ *
+ * @note tryPop and empty must be called from a single consumer thread
+ */
+template <typename T, size_t Capacity>
+class MpscQueue {
+    static_assert(Capacity >= 2u && (Capacity & (Capacity - 1u)) == 0u, "Capacity must be a power of two");
+
+    struct Cell {
+        std::atomic<size_t> sequence{0u};
+        T value{};
+    };
+
+public:
+    explicit MpscQueue()
+        : m_cells{std::make_unique<Cell[]>(Capacity)}
+        , m_tail{0u}
+        , m_head{0u}
+    {
+        for (size_t i = 0; i < Capacity; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Enqueues value, safe to call from any thread
+     * @return false if queue is full
+     */
+    auto tryPush(const T& value) -> bool
+    {
+        auto position = m_tail.load(std::memory_order_relaxed);
+        while (true) {
+            auto& cell = m_cells[position & Mask];
+            const auto sequence = cell.sequence.load(std::memory_order_acquire);
+            const auto difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+            if (difference == 0) {
+                if (m_tail.compare_exchange_weak(position, position + 1u, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.sequence.store(position + 1u, std::memory_order_release);
+                    return true;
+                }
+            }
+            else if (difference < 0) {
+                return false;
+            }
+            else {
+                position = m_tail.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * Dequeues the oldest published value
+     */
+    auto tryPop() -> std::optional<T>
+    {
+        auto& cell = m_cells[m_head & Mask];
+        if (cell.sequence.load(std::memory_order_acquire) != m_head + 1u) {
+            return std::nullopt;
+        }
+
+        T value = cell.value;
+        cell.sequence.store(m_head + Capacity, std::memory_order_release);
+        ++m_head;
+        return value;
+    }
+
+    inline auto empty() const -> bool { return m_cells[m_head & Mask].sequence.load(std::memory_order_acquire) != m_head + 1u; }
+
+private:
+    static constexpr size_t Mask = Capacity - 1u;
+
+    std::unique_ptr<Cell[]> m_cells;
+
+    alignas(64) std::atomic<size_t> m_tail;
+    alignas(64) size_t m_head;
+};
+
+}  // namespace stm32::utils
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+namespace stm32::utils
+{
+/**
+ * Bounded lock-free single-producer single-consumer ring buffer
+ *
+ * Both sides cache the opposite index and only reload it when the ring looks full or empty, so in the common case
+ * push and pop touch only their own cache line.
+ */
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2u && (Capacity & (Capacity - 1u)) == 0u, "Capacity must be a power of two");
+
+public:
+    explicit SpscQueue()
+        : m_buffer{std::make_unique<T[]>(Capacity)}
+        , m_tail{0u}
+        , m_headCache{0u}
+        , m_head{0u}
+        , m_tailCache{0u}
+    {
+    }
+
+    /**
+     * Must be called only from the producer thread
+     * @return false if ring is full
+     */
+    auto tryPush(const T& value) -> bool
+    {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_headCache == Capacity) {
+            m_headCache = m_head.load(std::memory_order_acquire);
+            if (tail - m_headCache == Capacity) {
+                return false;
+            }
+        }
+
+        m_buffer[tail & Mask] = value;
+        m_tail.store(tail + 1u, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Must be called only from the producer thread
+     */
+    auto isFull() -> bool
+    {
+        const auto tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_headCache == Capacity) {
+            m_headCache = m_head.load(std::memory_order_acquire);
+        }
+        return tail - m_headCache == Capacity;
+    }
+
+    /**
+     * Must be called only from the consumer thread
+     */
+    auto tryPop() -> std::optional<T>
+    {
+        const auto head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tailCache) {
+            m_tailCache = m_tail.load(std::memory_order_acquire);
+            if (head == m_tailCache) {
+                return std::nullopt;
+            }
+        }
+
+        T value = m_buffer[head & Mask];
+        m_head.store(head + 1u, std::memory_order_release);
+        return value;
+    }
+
+private:
+    static constexpr size_t Mask = Capacity - 1u;
+
+    std::unique_ptr<T[]> m_buffer;
+
+    alignas(64) std::atomic<size_t> m_tail;
+    size_t m_headCache;
+
+    alignas(64) std::atomic<size_t> m_head;
+    size_t m_tailCache;
+};
+
+}  // namespace stm32::utils
@@ -3,9 +3,13 @@
 
 #include <gtest/gtest.h>
 
+#include "test_batch_runner.hpp"
 #include "test_cpu.hpp"
+#include "test_debug.hpp"
+#include "test_interrupts.hpp"
 #include "test_math.hpp"
 #include "test_memory.hpp"
+#include "test_system.hpp"
 #include "test_system_control_registers.hpp"
 
 int main(int argc, char** argv)
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <batch_runner/manifest.hpp>
+#include <batch_runner/report.hpp>
+#include <batch_runner/work_stealing_pool.hpp>
+#include <sstream>
+#include <thread>
+
+TEST(batch_runner, parse_manifest)
+{
+    using namespace batch_runner;
+
+    std::istringstream manifest{"# smoke tests\n"
+                                "\n"
+                                "boot fw/boot.bin\n"
+                                "  loop loop.bin cycles=0x100 input=in.log break=0x08000100 break=256 expect=breakpoint r0=1 r12=0xFF sp=0x20005000 lr=2 pc=3\n"
+                                "crash crash.bin expect=fault\n"};
+    const auto jobs = parseManifest(manifest, "base");
+    ASSERT_EQ(jobs.size(), 3u);
+
+    ASSERT_EQ(jobs[0].name, "boot");
+    ASSERT_EQ(jobs[0].firmware, std::filesystem::path{"base/fw/boot.bin"});
+    ASSERT_TRUE(jobs[0].input.empty());
+    ASSERT_EQ(jobs[0].cycles, 10000000u);
+    ASSERT_EQ(jobs[0].expected, Outcome::CycleLimit);
+
+    ASSERT_EQ(jobs[1].name, "loop");
+    ASSERT_EQ(jobs[1].input, std::filesystem::path{"base/in.log"});
+    ASSERT_EQ(jobs[1].cycles, 0x100u);
+    ASSERT_EQ(jobs[1].breakpoints, (std::vector<uint32_t>{0x08000100u, 256u}));
+    ASSERT_EQ(jobs[1].expected, Outcome::Breakpoint);
+    const std::vector<std::pair<uint8_t, uint32_t>> expectedRegisters{{0u, 1u}, {12u, 0xFFu}, {13u, 0x20005000u}, {14u, 2u}, {15u, 3u}};
+    ASSERT_EQ(jobs[1].registers.size(), expectedRegisters.size());
+    for (size_t i = 0; i < expectedRegisters.size(); ++i) {
+        ASSERT_EQ(jobs[1].registers[i].reg, expectedRegisters[i].first);
+        ASSERT_EQ(jobs[1].registers[i].value, expectedRegisters[i].second);
+    }
+
+    ASSERT_EQ(jobs[2].expected, Outcome::Fault);
+    for (const auto outcome : {Outcome::CycleLimit, Outcome::Breakpoint, Outcome::StackOverflow, Outcome::Fault}) {
+        ASSERT_EQ(parseOutcome(outcomeName(outcome)), outcome);
+    }
+
+    // every malformed line is reported with its number
+    const auto parseError = [](const std::string& text) -> std::string {
+        std::istringstream stream{"# header\n" + text + "\n"};
+        try {
+            parseManifest(stream, {});
+        }
+        catch (const std::runtime_error& e) {
+            return e.what();
+        }
+        return {};
+    };
+    ASSERT_EQ(parseError("job"), "manifest line 2: firmware is missing");
+    ASSERT_EQ(parseError("job fw.bin cycles"), "manifest line 2: expected key=value, got cycles");
+    ASSERT_EQ(parseError("job fw.bin cycles=12x"), "manifest line 2: invalid number 12x");
+    ASSERT_EQ(parseError("job fw.bin cycles="), "manifest line 2: invalid number ");
+    ASSERT_EQ(parseError("job fw.bin expect=timeout"), "manifest line 2: unknown outcome timeout");
+    ASSERT_EQ(parseError("job fw.bin speed=1"), "manifest line 2: unknown key speed");
+    for (const auto name : {"r13", "r01", "r", "rx", "r123", "R0", "xpsr"}) {
+        ASSERT_EQ(parseError(std::string{"job fw.bin "} + name + "=1"), std::string{"manifest line 2: unknown key "} + name);
+    }
+}
+
+TEST(batch_runner, reports)
+{
+    using namespace batch_runner;
+
+    const std::vector<Job> jobs{
+        Job{.name = "a<b>&\"c'", .firmware = "dir/fw&1.bin", .input = {}, .cycles = 1u, .breakpoints = {}, .expected = Outcome::Fault, .registers = {}},
+        Job{.name = "quote\"back\\slash\ttab", .firmware = "fw.bin", .input = {}, .cycles = 1u, .breakpoints = {}, .expected = Outcome::CycleLimit, .registers = {}},
+    };
+    std::vector<JobResult> results(2u);
+    results[0].executed = true;
+    results[0].outcome = Outcome::CycleLimit;
+    results[0].failure = "expected <fault>";
+    results[1].error = "can't open \"fw.bin\"\n";
+
+    std::ostringstream junit;
+    writeJunit(junit, jobs, results, std::chrono::duration<double>{1.5});
+    const auto xml = junit.str();
+    ASSERT_NE(xml.find("<testsuites tests=\"2\" failures=\"1\" errors=\"1\" time=\"1.5\">"), std::string::npos);
+    ASSERT_NE(xml.find("classname=\"fw&amp;1.bin\" name=\"a&lt;b&gt;&amp;&quot;c&apos;\""), std::string::npos);
+    ASSERT_NE(xml.find("<failure message=\"expected &lt;fault&gt;\">cycle-limit</failure>"), std::string::npos);
+    ASSERT_NE(xml.find("<error message=\"can&apos;t open &quot;fw.bin&quot;\n\"/>"), std::string::npos);
+
+    std::ostringstream json;
+    writeJson(json, jobs, results, std::chrono::duration<double>{1.5});
+    const auto text = json.str();
+    ASSERT_NE(text.find("\"tests\": 2,\n  \"passed\": 0,\n  \"failed\": 2,"), std::string::npos);
+    ASSERT_NE(text.find("{\"name\": \"a<b>&\\\"c'\", \"firmware\": \"dir/fw&1.bin\""), std::string::npos);
+    ASSERT_NE(text.find("\"failure\": \"expected <fault>\"}"), std::string::npos);
+    ASSERT_NE(text.find("{\"name\": \"quote\\\"back\\\\slash\\u0009tab\""), std::string::npos);
+    ASSERT_NE(text.find("\"error\": \"can't open \\\"fw.bin\\\"\\u000a\"}"), std::string::npos);
+
+    std::ostringstream empty;
+    writeJson(empty, {}, {}, std::chrono::duration<double>{0.0});
+    ASSERT_NE(empty.str().find("\"jobs\": []\n}"), std::string::npos);
+}
+
+TEST(batch_runner, work_stealing_pool)
+{
+    constexpr size_t TaskCount = 1000u;
+
+    batch_runner::WorkStealingPool pool{4u};
+    ASSERT_EQ(pool.workerCount(), 4u);
+
+    std::vector<std::atomic<uint32_t>> executions(TaskCount);
+    std::vector<std::atomic<uint32_t>> workers(pool.workerCount());
+    pool.run(TaskCount, [&](size_t task, size_t worker) {
+        // uneven tasks make the idle workers steal
+        if (task % 97u == 0u) {
+            std::this_thread::sleep_for(std::chrono::milliseconds{1});
+        }
+        executions[task].fetch_add(1u, std::memory_order_relaxed);
+        workers[worker].fetch_add(1u, std::memory_order_relaxed);
+    });
+
+    for (const auto& count : executions) {
+        ASSERT_EQ(count.load(), 1u);
+    }
+    uint32_t total = 0u;
+    for (const auto& count : workers) {
+        total += count.load();
+    }
+    ASSERT_EQ(total, TaskCount);
+
+    // pool is reusable and a zero worker count still runs the tasks
+    batch_runner::WorkStealingPool single{0u};
+    size_t executed = 0u;
+    single.run(3u, [&](size_t, size_t) { ++executed; });
+    ASSERT_EQ(executed, 3u);
+    pool.run(0u, [](size_t, size_t) { FAIL(); });
+}
@@ -2,12 +2,349 @@
 
 #include <gtest/gtest.h>
 
+#include <filesystem>
+#include <fstream>
+#include <thread>
+#include <stm32/cpu.hpp>
 #include <stm32/memory.hpp>
 #include <stm32/opcodes.hpp>
+#include <stm32/real_time_pacer.hpp>
 #include <stm32/registers/cpu_registers_set.hpp>
+#include <stm32/save_state.hpp>
 
 #include "utils.hpp"
 
 TEST(cpu, Opcodes)
 {
 }
+
+TEST(cpu, exclusive_monitor)
+{
+    using namespace stm32;
+
+    // movs r0, #0x20; lsls r0, r0, #24
+    // ldrex r1, [r0]; adds r1, #1; strex r2, r1, [r0]; strex r3, r1, [r0]
+    // ldrex r1, [r0]; clrex; strex r4, r1, [r0]
+    // b .
+    auto flash = details::createFlash({0x2020u, 0x0600u,                                           //
+                                       0xE850u, 0x1F00u, 0x3101u, 0xE840u, 0x1200u, 0xE840u, 0x1300u,  //
+                                       0xE850u, 0x1F00u, 0xF3BFu, 0x8F2Fu, 0xE840u, 0x1400u,           //
+                                       0xE7FEu});
+
+    auto cpu = details::createCpu(flash);
+    cpu->reset();
+    cpu->run(20u);
+
+    ASSERT_EQ(cpu->R(2), 0u);
+    ASSERT_EQ(cpu->R(3), 1u);
+    ASSERT_EQ(cpu->R(4), 1u);
+    ASSERT_EQ(cpu->memory().read<uint32_t>(0x20000000u), 1u);
+    ASSERT_FALSE(cpu->exclusiveMonitor().isExclusive());
+
+    // successful store exclusive of one core clears reservation of another core in the same granule
+    GlobalExclusiveMonitor global;
+    ExclusiveMonitor first;
+    ExclusiveMonitor second;
+    first.setGlobalMonitor(&global, 0u);
+    second.setGlobalMonitor(&global, 1u);
+
+    first.setExclusiveMonitors(0x20000100u);
+    second.setExclusiveMonitors(0x20000104u);
+    ASSERT_TRUE(second.exclusiveMonitorsPass(0x20000104u));
+    ASSERT_FALSE(first.exclusiveMonitorsPass(0x20000100u));
+
+    // plain store of another core clears the reservation too, a store to another granule doesn't
+    cpu->exclusiveMonitor().setGlobalMonitor(&global, 2u);
+    first.setExclusiveMonitors(0x20000000u);
+    cpu->mpu().alignedMemoryWrite<uint32_t>(0x20000008u, 2u);
+    ASSERT_TRUE(first.exclusiveMonitorsPass(0x20000000u));
+
+    first.setExclusiveMonitors(0x20000000u);
+    cpu->mpu().alignedMemoryWrite<uint32_t>(0x20000004u, 2u);
+    ASSERT_FALSE(first.exclusiveMonitorsPass(0x20000000u));
+
+    // store exclusive takes the recursive lock again for its write
+    cpu->reset();
+    cpu->run(20u);
+    ASSERT_EQ(cpu->R(2), 0u);
+    ASSERT_EQ(cpu->memory().read<uint32_t>(0x20000000u), 2u);
+    cpu->exclusiveMonitor().setGlobalMonitor(nullptr, 0u);
+}
+
+TEST(cpu, load_store_immediate_offset)
+{
+    using namespace stm32;
+
+    // movs r0, #0x20; lsls r0, r0, #24; movs r1, #0x5A
+    // str r1, [r0, #8]; ldr r2, [r0, #8]; push {r1}; pop {r3}
+    // b .
+    auto flash = details::createFlash({0x2020u, 0x0600u, 0x215Au, 0x6081u, 0x6882u, 0xB402u, 0xBC08u, 0xE7FEu});
+
+    auto cpu = details::createCpu(flash);
+    cpu->reset();
+    cpu->run(10u);
+
+    ASSERT_EQ(cpu->memory().read<uint32_t>(0x20000008u), 0x5Au);
+    ASSERT_EQ(cpu->R(2), 0x5Au);
+    ASSERT_EQ(cpu->R(3), 0x5Au);
+
+    // push goes through the MPU, so it is seen by the watchpoints
+    cpu->reset();
+    cpu->watchpoints().add(debug::Watchpoint{.address = 0x20004FFCu, .length = 4u, .type = debug::WatchpointType::Write});
+    ASSERT_EQ(cpu->run(10u), StopReason::Watchpoint);
+    ASSERT_EQ(cpu->registers().PC(), 0x10Cu);
+}
+
+TEST(cpu, flash_wait_states)
+{
+    using namespace stm32;
+
+    // loop: nop x7; b loop
+    auto flash = details::createFlash({0xBF00u, 0xBF00u, 0xBF00u, 0xBF00u, 0xBF00u, 0xBF00u, 0xBF00u, 0xE7F7u});
+
+    // timing model is disabled by default
+    auto cpu = details::createCpu(flash);
+    cpu->reset();
+    cpu->run(120u);
+    ASSERT_EQ(cpu->cycles(), 120u);
+    ASSERT_EQ(cpu->memory().read<uint8_t>(FlashInterface::FlashInterfaceStart), 0x30u);
+
+    // two wait states without prefetch are paid for both lines of every iteration
+    cpu = details::createCpu(flash);
+    cpu->flashInterface().setTimingEnabled(true);
+    cpu->reset();
+    cpu->memory().write<uint8_t>(FlashInterface::FlashInterfaceStart, 0x02u);
+    ASSERT_EQ(cpu->memory().read<uint8_t>(FlashInterface::FlashInterfaceStart), 0x02u);
+
+    cpu->run(120u);
+    ASSERT_EQ(cpu->cycles(), 120u);
+    ASSERT_EQ(cpu->flashInterface().statistics().lineFetches, 20u);
+    ASSERT_EQ(cpu->flashInterface().statistics().waitCycles, 40u);
+
+    // prefetch hides sequential fetch, only the branch refill is paid
+    cpu = details::createCpu(flash);
+    cpu->flashInterface().setTimingEnabled(true);
+    cpu->reset();
+    cpu->memory().write<uint8_t>(FlashInterface::FlashInterfaceStart, 0x12u);
+
+    cpu->run(100u);
+    ASSERT_EQ(cpu->cycles(), 100u);
+    ASSERT_EQ(cpu->flashInterface().statistics().refills, 10u);
+    ASSERT_EQ(cpu->flashInterface().statistics().waitCycles, 20u);
+}
+
+TEST(cpu, flash_wait_states_slicing)
+{
+    using namespace stm32;
+
+    // movs r0, #0; loop: adds r0, #1; lsls r1, r0, #30; beq skip; nop; nop; nop; nop; nop; skip: b loop
+    auto flash = details::createFlash({0x2000u, 0x3001u, 0x0781u, 0xD004u, 0xBF00u, 0xBF00u, 0xBF00u, 0xBF00u, 0xBF00u, 0xE7F6u});
+
+    for (const auto acr : {0x02u, 0x12u}) {
+        const auto runSliced = [&](uint64_t slice) {
+            auto cpu = details::createCpu(flash);
+            cpu->flashInterface().setTimingEnabled(true);
+            cpu->reset();
+            cpu->memory().write<uint8_t>(FlashInterface::FlashInterfaceStart, static_cast<uint8_t>(acr));
+            while (cpu->cycles() < 10000u) {
+                cpu->run(std::min(slice, 10000u - cpu->cycles()));
+                // stall cycles never exceed the budget of the run
+                EXPECT_LE(cpu->cycles(), 10000u);
+            }
+            return cpu;
+        };
+
+        const auto whole = runSliced(10000u);
+        ASSERT_GT(whole->flashInterface().statistics().waitCycles, 0u);
+        for (const auto slice : {1u, 2u, 7u, 13u}) {
+            const auto sliced = runSliced(slice);
+            ASSERT_EQ(sliced->cycles(), whole->cycles());
+            ASSERT_EQ(sliced->instructions(), whole->instructions());
+            ASSERT_EQ(sliced->R(0), whole->R(0));
+            ASSERT_EQ(sliced->flashInterface().statistics().waitCycles, whole->flashInterface().statistics().waitCycles);
+        }
+    }
+}
+
+TEST(cpu, real_time_pacer)
+{
+    using namespace stm32;
+    using namespace std::chrono_literals;
+
+    ASSERT_THROW(RealTimePacer(RealTimePacer::Config{.frequency = 0u, .burst = 1000us, .maxDrift = 1ms, .spin = 0us}),
+                 std::invalid_argument);
+    ASSERT_THROW(RealTimePacer(RealTimePacer::Config{.frequency = 72'000'000u, .burst = -1us, .maxDrift = 1ms, .spin = 0us}),
+                 std::invalid_argument);
+    // frequency * burst doesn't fit into 64 bits
+    ASSERT_THROW(RealTimePacer(RealTimePacer::Config{.frequency = 72'000'000u, .burst = std::chrono::microseconds{INT64_MAX}, .maxDrift = 1ms, .spin = 0us}),
+                 std::invalid_argument);
+
+    // 1000 hours at 72 MHz overflow cycles * 10^9 in 64 bits
+    RealTimePacer pacer{RealTimePacer::Config{.frequency = 72'000'000u, .burst = 1000us, .maxDrift = 1s, .spin = 0us}};
+    ASSERT_EQ(pacer.burstCycles(), 72'000u);
+    ASSERT_EQ(pacer.cyclesToDuration(uint64_t{72'000'000u} * 3'600'000u + 36u), 3'600'000s + 500ns);
+    ASSERT_EQ(pacer.cyclesToDuration(uint64_t{1u} << 40u), 15'270'994'830'222ns);
+
+    // lag below the drift bound is recovered by running without sleeping
+    pacer.start(0u);
+    std::this_thread::sleep_for(20ms);
+    pacer.pace(pacer.burstCycles());
+    pacer.pace(2u * pacer.burstCycles());
+    ASSERT_EQ(pacer.statistics().bursts, 2u);
+    ASSERT_EQ(pacer.statistics().sleeps, 0u);
+    ASSERT_EQ(pacer.statistics().rebases, 0u);
+    ASSERT_GE(pacer.statistics().maxLag, 15ms);
+
+    // larger lag moves the anchor, so the next burst sleeps again
+    RealTimePacer strict{RealTimePacer::Config{.frequency = 72'000'000u, .burst = 1000us, .maxDrift = 1ms, .spin = 0us}};
+    strict.start(0u);
+    std::this_thread::sleep_for(20ms);
+    strict.pace(strict.burstCycles());
+    ASSERT_EQ(strict.statistics().rebases, 1u);
+    ASSERT_EQ(strict.statistics().maxLag, 0ns);
+
+    const auto start = RealTimePacer::Clock::now();
+    strict.pace(strict.burstCycles() + 72'000u * 5u);
+    ASSERT_EQ(strict.statistics().sleeps, 1u);
+    ASSERT_GE(RealTimePacer::Clock::now() - start, 5ms);
+}
+
+TEST(cpu, real_time_pacer_blocks)
+{
+    using namespace stm32;
+    using namespace std::chrono_literals;
+
+    // loop: nop x7; b loop
+    auto flash = details::createFlash({0xBF00u, 0xBF00u, 0xBF00u, 0xBF00u, 0xBF00u, 0xBF00u, 0xBF00u, 0xE7F7u});
+    auto cpu = details::createCpu(flash);
+    cpu->reset();
+
+    // pace points don't fall on the branches, the run loop has to cut the blocks at them
+    RealTimePacer pacer{RealTimePacer::Config{.frequency = 1'000'000u, .burst = 10us, .maxDrift = 1s, .spin = 0us}};
+    ASSERT_EQ(pacer.burstCycles(), 10u);
+    cpu->setRealTimePacer(&pacer);
+    ASSERT_EQ(cpu->run(100u), StopReason::CycleLimit);
+    ASSERT_EQ(cpu->cycles(), 100u);
+    ASSERT_EQ(pacer.statistics().bursts, 9u);
+    cpu->setRealTimePacer(nullptr);
+}
+
+TEST(cpu, snapshot_restore)
+{
+    using namespace stm32;
+
+    // movs r1, #0x20; lsls r1, r1, #24; loop: ldr r0, [r1]; adds r0, #1; str r0, [r1]; b loop
+    auto flash = details::createFlash({0x2120u, 0x0609u, 0x6808u, 0x3001u, 0x6008u, 0xE7FBu});
+    auto cpu = details::createCpu(flash);
+    cpu->reset();
+    cpu->memory().write<uint32_t>(0x20004000u, 0xCAFEu);
+
+    cpu->run(10u);
+    const auto snapshot = cpu->snapshot();
+    const auto counter = cpu->memory().read<uint32_t>(0x20000000u);
+    const auto pc = cpu->registers().PC();
+
+    cpu->run(100u);
+    const auto finalCounter = cpu->memory().read<uint32_t>(0x20000000u);
+    const auto finalPc = cpu->registers().PC();
+    ASSERT_GT(finalCounter, counter);
+
+    // only the page with the counter was written
+    cpu->restore(snapshot);
+    ASSERT_EQ(cpu->memory().lastRestoredPages(), 1u);
+    ASSERT_EQ(cpu->cycles(), 10u);
+    ASSERT_EQ(cpu->registers().PC(), pc);
+    ASSERT_EQ(cpu->memory().read<uint32_t>(0x20000000u), counter);
+
+    // execution after restore repeats the original one
+    cpu->run(100u);
+    ASSERT_EQ(cpu->memory().read<uint32_t>(0x20000000u), finalCounter);
+    ASSERT_EQ(cpu->registers().PC(), finalPc);
+
+    // another snapshot was synchronized with memory since, so everything is copied
+    auto other = cpu->snapshot();
+    cpu->memory().write<uint32_t>(0x20004000u, 0u);
+    cpu->restore(snapshot);
+    ASSERT_GT(cpu->memory().lastRestoredPages(), 1u);
+    ASSERT_EQ(cpu->memory().read<uint32_t>(0x20004000u), 0xCAFEu);
+    ASSERT_EQ(cpu->memory().read<uint32_t>(0x20000000u), counter);
+
+    cpu->restore(other);
+    ASSERT_EQ(cpu->memory().read<uint32_t>(0x20000000u), finalCounter);
+    ASSERT_EQ(cpu->cycles(), 110u);
+}
+
+TEST(cpu, save_state)
+{
+    using namespace stm32;
+
+    // movs r1, #0x20; lsls r1, r1, #24; loop: ldr r0, [r1]; adds r0, #1; str r0, [r1]; b loop
+    auto flash = details::createFlash({0x2120u, 0x0609u, 0x6808u, 0x3001u, 0x6008u, 0xE7FBu});
+    auto cpu = details::createCpu(flash);
+    cpu->reset();
+    for (uint32_t i = 0; i < 0x400u; ++i) {
+        // literal, repeated and random looking bytes
+        cpu->memory().write<uint8_t>(0x20001000u + i, static_cast<uint8_t>(i < 0x200u ? (i * 37u) ^ (i >> 3u) : i / 16u));
+    }
+    cpu->memory().write<uint8_t>(0x08000F00u, 0x5Au);
+    cpu->memory().write<uint32_t>(0xE0000E00u, 0x80000001u);
+    cpu->memory().write<uint32_t>(0xE0000E80u, 0x00010001u);
+    cpu->run(50u);
+
+    const auto path = (std::filesystem::temp_directory_path() / "stm32_save_state_test.bin").string();
+    const auto snapshot = cpu->snapshot();
+    SaveState::save(snapshot, path);
+    ASSERT_LT(std::filesystem::file_size(path), 4096u);
+
+    // flash image is shared, programmed flash is restored into the private overlay
+    auto loaded = details::createCpu(flash);
+    loaded->restore(SaveState::load(path));
+    ASSERT_TRUE(loaded->memory().isFlashProgrammed());
+    ASSERT_EQ(loaded->memory().read<uint8_t>(0x08000F00u), 0x5Au);
+    ASSERT_EQ(flash[0xF00u], 0x00u);
+    ASSERT_EQ(loaded->cycles(), cpu->cycles());
+    ASSERT_EQ(loaded->registers().PC(), cpu->registers().PC());
+    ASSERT_EQ(loaded->memory().read<uint32_t>(0xE0000E00u), 0x80000001u);
+    ASSERT_EQ(loaded->memory().read<uint32_t>(0xE0000E80u), 0x00010001u);
+    for (uint32_t i = 0; i < 0x400u; ++i) {
+        ASSERT_EQ(loaded->memory().read<uint8_t>(0x20001000u + i), cpu->memory().read<uint8_t>(0x20001000u + i));
+    }
+
+    cpu->run(100u);
+    loaded->run(100u);
+    ASSERT_EQ(loaded->memory().read<uint32_t>(0x20000000u), cpu->memory().read<uint32_t>(0x20000000u));
+    ASSERT_EQ(loaded->R(0), cpu->R(0));
+
+    std::ofstream{path, std::ios::binary} << "STM32SAV\x02";
+    ASSERT_THROW(SaveState::load(path), std::runtime_error);
+
+    // sizes of a malformed file are checked before anything is allocated
+    const auto writeChunk = [&](const char* tag, uint32_t version, const std::vector<uint8_t>& payload) {
+        std::ofstream file{path, std::ios::binary};
+        const auto u32 = [&](uint32_t value) {
+            for (uint32_t i = 0; i < 4u; ++i) {
+                file.put(static_cast<char>(value >> (i * 8u)));
+            }
+        };
+        file << "STM32SAV";
+        u32(SaveState::Version);
+        u32(1u);
+        file.write(tag, 4);
+        u32(version);
+        u32(static_cast<uint32_t>(payload.size()));
+        u32(0u);
+        file.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+    };
+    // flash interface and ITM registers, then the event count
+    auto peripherals = std::vector<uint8_t>(29u, 0u);
+    peripherals.insert(peripherals.end(), {0xFFu, 0xFFu, 0xFFu, 0xFFu});
+    writeChunk("PERI", 3u, peripherals);
+    ASSERT_THROW(SaveState::load(path), std::runtime_error);
+    // SRAM area larger than its address range, then with more pages than the chunk holds
+    writeChunk("PAGE", 1u, {0x03u, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0x01u, 0x00u, 0x00u, 0x00u});
+    ASSERT_THROW(SaveState::load(path), std::runtime_error);
+    writeChunk("PAGE", 1u, {0x03u, 0x00u, 0x50u, 0x00u, 0x00u, 0x01u, 0x00u, 0x00u, 0x00u, 0x01u, 0x00u});
+    ASSERT_THROW(SaveState::load(path), std::runtime_error);
+    std::filesystem::remove(path);
+    ASSERT_THROW(SaveState::load(path), std::system_error);
+}
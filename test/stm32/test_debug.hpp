@@ -0,0 +1,1198 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <stm32/cpu.hpp>
+#include <array>
+#include <filesystem>
+#include <fstream>
+#include <gdb_server/gdb_server.hpp>
+#include <sstream>
+#include <stm32/debug/coverage.hpp>
+#include <stm32/debug/elf_file.hpp>
+#include <stm32/debug/fuzz_harness.hpp>
+#include <stm32/debug/heatmap.hpp>
+#include <stm32/debug/input_log.hpp>
+#include <stm32/debug/itm_capture.hpp>
+#include <stm32/debug/line_table.hpp>
+#include <stm32/debug/pc_sampler.hpp>
+#include <stm32/debug/profiler.hpp>
+#include <stm32/debug/reverse_execution.hpp>
+#include <stm32/debug/semihosting.hpp>
+#include <stm32/debug/trace_reader.hpp>
+#include <stm32/debug/trace_recorder.hpp>
+#include <thread>
+
+#include "utils.hpp"
+
+namespace details
+{
+// movs r0, #0x20; lsls r0, r0, #24
+// loop: adds r1, #1; str r1, [r0]; b loop
+auto createCounterFlash() -> std::vector<uint8_t>
+{
+    return createFlash({0x2020u, 0x0600u, 0x3101u, 0x6001u, 0xE7FCu});
+}
+
+/**
+ * Creates ELF image which has only the section headers, symbol and string tables and the extra sections
+ */
+auto createElf(const std::vector<std::pair<std::string, uint32_t>>& functions,
+               uint32_t functionSize,
+               const std::vector<std::pair<std::string, std::vector<uint8_t>>>& extraSections = {}) -> std::vector<uint8_t>
+{
+    const auto sectionCount = static_cast<uint32_t>(4u + extraSections.size());
+
+    std::vector<uint8_t> elf(52u + sectionCount * 40u, 0u);
+    const auto put32 = [&](size_t offset, uint32_t value) {
+        for (uint32_t i = 0; i < 4u; ++i) {
+            elf[offset + i] = static_cast<uint8_t>(value >> (8u * i));
+        }
+    };
+    const auto put16 = [&](size_t offset, uint16_t value) {
+        elf[offset] = static_cast<uint8_t>(value);
+        elf[offset + 1u] = static_cast<uint8_t>(value >> 8u);
+    };
+
+    std::string names{"\0", 1u};
+    std::vector<uint8_t> symbols(16u, 0u);
+    for (const auto& [name, address] : functions) {
+        symbols.resize(symbols.size() + 16u, 0u);
+        const auto symbol = symbols.size() - 16u;
+        for (uint32_t i = 0; i < 4u; ++i) {
+            symbols[symbol + i] = static_cast<uint8_t>(names.size() >> (8u * i));
+            symbols[symbol + 4u + i] = static_cast<uint8_t>(address >> (8u * i));
+            symbols[symbol + 8u + i] = static_cast<uint8_t>(functionSize >> (8u * i));
+        }
+        symbols[symbol + 12u] = 0x12u;  // global function
+        names += name + '\0';
+    }
+
+    std::string sectionNames{"\0", 1u};
+    const auto addSection = [&](uint32_t index, const std::string& name, uint32_t type, const void* data, size_t size, uint32_t link) {
+        const auto header = 52u + index * 40u;
+        put32(header, static_cast<uint32_t>(sectionNames.size()));
+        put32(header + 0x4u, type);
+        put32(header + 0x10u, static_cast<uint32_t>(elf.size()));
+        put32(header + 0x14u, static_cast<uint32_t>(size));
+        put32(header + 0x18u, link);
+        sectionNames += name + '\0';
+
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        elf.insert(elf.end(), bytes, bytes + size);
+    };
+    addSection(1u, ".symtab", 2u, symbols.data(), symbols.size(), 2u);
+    addSection(2u, ".strtab", 3u, names.data(), names.size(), 0u);
+    for (uint32_t i = 0; i < extraSections.size(); ++i) {
+        const auto& [name, data] = extraSections[i];
+        addSection(3u + i, name, 1u, data.data(), data.size(), 0u);
+    }
+    const auto shstrtab = sectionNames + std::string{".shstrtab\0", 10u};
+    addSection(sectionCount - 1u, ".shstrtab", 3u, shstrtab.data(), shstrtab.size(), 0u);
+
+    const uint8_t ident[] = {0x7Fu, 'E', 'L', 'F', 1u, 1u, 1u};
+    std::copy(std::begin(ident), std::end(ident), elf.begin());
+    put16(0x10u, 2u);
+    put16(0x12u, 40u);
+    put32(0x14u, 1u);
+    put32(0x20u, 52u);
+    put16(0x28u, 52u);
+    put16(0x2Eu, 40u);
+    put16(0x30u, static_cast<uint16_t>(sectionCount));
+    put16(0x32u, static_cast<uint16_t>(sectionCount - 1u));
+    return elf;
+}
+
+/**
+ * Creates DWARF 4 line program of a single file, rows are (address, line) pairs and the last address ends sequence
+ */
+auto createLineProgram(const std::string& file, const std::vector<std::pair<uint32_t, uint8_t>>& rows) -> std::vector<uint8_t>
+{
+    // minimum instruction length 1, one operation per instruction, is_stmt, line base -5, line range 14, opcode base 13
+    std::vector<uint8_t> header = {1u, 1u, 1u, 0xFBu, 14u, 13u, 0u, 1u, 1u, 1u, 1u, 0u, 0u, 0u, 1u, 0u, 0u, 1u, 0u};
+    header.insert(header.end(), file.begin(), file.end());
+    header.insert(header.end(), {0u, 0u, 0u, 0u, 0u});
+
+    // set_address and advance_line to the first row, then one special opcode per row
+    std::vector<uint8_t> program = {0u, 5u, 2u};
+    for (uint32_t i = 0; i < 4u; ++i) {
+        program.push_back(static_cast<uint8_t>(rows.front().first >> (8u * i)));
+    }
+    program.insert(program.end(), {3u, static_cast<uint8_t>(rows.front().second - 1u), 1u});
+    for (size_t i = 1; i + 1u < rows.size(); ++i) {
+        const auto addressAdvance = rows[i].first - rows[i - 1u].first;
+        const auto lineAdvance = static_cast<uint32_t>(rows[i].second - rows[i - 1u].second + 5);
+        program.push_back(static_cast<uint8_t>(lineAdvance + 14u * addressAdvance + 13u));
+    }
+    program.insert(program.end(), {2u, static_cast<uint8_t>(rows.back().first - rows[rows.size() - 2u].first), 0u, 1u, 1u});
+
+    const auto unitLength = static_cast<uint32_t>(2u + 4u + header.size() + program.size());
+    std::vector<uint8_t> unit;
+    for (uint32_t i = 0; i < 4u; ++i) {
+        unit.push_back(static_cast<uint8_t>(unitLength >> (8u * i)));
+    }
+    unit.insert(unit.end(), {4u, 0u});
+    for (uint32_t i = 0; i < 4u; ++i) {
+        unit.push_back(static_cast<uint8_t>(header.size() >> (8u * i)));
+    }
+    unit.insert(unit.end(), header.begin(), header.end());
+    unit.insert(unit.end(), program.begin(), program.end());
+    return unit;
+}
+
+/**
+ * Minimal RSP client which talks to the server in acknowledgment mode
+ */
+class GdbClient {
+public:
+    explicit GdbClient(uint16_t port)
+        : m_socket{::socket(AF_INET, SOCK_STREAM, 0)}
+    {
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(port);
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        EXPECT_EQ(::connect(m_socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)), 0);
+    }
+
+    ~GdbClient() { ::close(m_socket); }
+
+    GdbClient(const GdbClient&) = delete;
+    GdbClient& operator=(const GdbClient&) = delete;
+
+    void send(const std::string& payload)
+    {
+        uint8_t checksum = 0u;
+        for (const auto c : payload) {
+            checksum = static_cast<uint8_t>(checksum + static_cast<uint8_t>(c));
+        }
+
+        char suffix[4];
+        std::snprintf(suffix, sizeof(suffix), "#%02x", checksum);
+        const auto packet = "$" + payload + suffix;
+        ::send(m_socket, packet.data(), packet.size(), 0);
+
+        EXPECT_EQ(readByte(), '+');
+    }
+
+    auto receive() -> std::string
+    {
+        auto c = readByte();
+        while (c != '$') {
+            c = readByte();
+        }
+
+        std::string payload;
+        for (c = readByte(); c != '#'; c = readByte()) {
+            payload.push_back(c);
+        }
+        readByte();
+        readByte();
+
+        ::send(m_socket, "+", 1u, 0);
+        return payload;
+    }
+
+    auto request(const std::string& payload) -> std::string
+    {
+        send(payload);
+        return receive();
+    }
+
+private:
+    auto readByte() -> char
+    {
+        char c = 0;
+        return ::recv(m_socket, &c, 1u, 0) == 1 ? c : '\0';
+    }
+
+    int m_socket;
+};
+
+}  // namespace details
+
+TEST(debug, breakpoints_and_watchpoints)
+{
+    using namespace stm32;
+
+    auto flash = details::createCounterFlash();
+    auto cpu = details::createCpu(flash);
+    cpu->reset();
+
+    cpu->breakpoints().add(0x106u);
+    ASSERT_EQ(cpu->run(1000u), StopReason::Breakpoint);
+    ASSERT_EQ(cpu->registers().PC(), 0x106u);
+    ASSERT_EQ(cpu->R(1), 1u);
+
+    // resuming from the breakpoint doesn't hit it again
+    ASSERT_EQ(cpu->run(1000u), StopReason::Breakpoint);
+    ASSERT_EQ(cpu->registers().PC(), 0x106u);
+    ASSERT_EQ(cpu->R(1), 2u);
+
+    cpu->breakpoints().remove(0x106u);
+    cpu->watchpoints().add(debug::Watchpoint{.address = 0x20000000u, .length = 4u, .type = debug::WatchpointType::Write});
+    ASSERT_EQ(cpu->run(1000u), StopReason::Watchpoint);
+    ASSERT_EQ(cpu->registers().PC(), 0x108u);
+    ASSERT_EQ(cpu->memory().read<uint32_t>(0x20000000u), 2u);
+
+    const auto hit = cpu->watchpoints().takeHit();
+    ASSERT_TRUE(hit.has_value());
+    ASSERT_EQ(hit->address, 0x20000000u);
+    ASSERT_TRUE(hit->write);
+
+    cpu->watchpoints().clear();
+    ASSERT_EQ(cpu->run(30u), StopReason::CycleLimit);
+}
+
+TEST(debug, fpb_breakpoint)
+{
+    using namespace stm32;
+
+    auto flash = details::createCounterFlash();
+    auto cpu = details::createCpu(flash);
+    cpu->reset();
+
+    // six code and two literal comparators, disabled after reset
+    ASSERT_EQ(cpu->memory().read<uint32_t>(0xE0002000u), 0x260u);
+
+    cpu->memory().write<uint32_t>(0xE0002000u, 0x3u);
+    // upper halfword of the word at 0x104
+    cpu->memory().write<uint32_t>(0xE0002008u, 0x104u | 0x1u | (0x2u << 30u));
+    ASSERT_EQ(cpu->memory().read<uint32_t>(0xE0002000u), 0x261u);
+    ASSERT_TRUE(cpu->breakpoints().contains(0x106u));
+
+    // batch ending right before the breakpoint must not skip it on the next run
+    ASSERT_EQ(cpu->run(3u), StopReason::CycleLimit);
+    ASSERT_EQ(cpu->registers().PC(), 0x106u);
+    ASSERT_EQ(cpu->run(1000u), StopReason::Breakpoint);
+    ASSERT_EQ(cpu->registers().PC(), 0x106u);
+    ASSERT_EQ(cpu->R(1), 1u);
+
+    // disabling the unit removes its breakpoints
+    cpu->memory().write<uint32_t>(0xE0002000u, 0x2u);
+    ASSERT_FALSE(cpu->breakpoints().contains(0x106u));
+    ASSERT_EQ(cpu->run(30u), StopReason::CycleLimit);
+}
+
+TEST(debug, dwt_watchpoints)
+{
+    using namespace stm32;
+
+    auto flash = details::createCounterFlash();
+    auto cpu = details::createCpu(flash);
+    cpu->reset();
+
+    // four comparators
+    ASSERT_EQ(cpu->memory().read<uint32_t>(0xE0001000u) >> 28u, 4u);
+    ASSERT_FALSE(cpu->memory().isSlowPage(0x20000000u));
+
+    // DWT_COMP0, DWT_MASK0 and DWT_FUNCTION0: write watchpoint over a word
+    cpu->memory().write<uint32_t>(0xE0001020u, 0x20000000u);
+    cpu->memory().write<uint32_t>(0xE0001024u, 2u);
+    cpu->memory().write<uint32_t>(0xE0001028u, 0b0110u);
+    ASSERT_TRUE(cpu->memory().isSlowPage(0x20000000u));
+    ASSERT_FALSE(cpu->memory().isSlowPage(0x20001000u));
+
+    ASSERT_EQ(cpu->run(1000u), StopReason::Watchpoint);
+    ASSERT_EQ(cpu->registers().PC(), 0x108u);
+    ASSERT_EQ(cpu->R(1), 1u);
+    ASSERT_TRUE(cpu->watchpoints().takeHit().has_value());
+
+    // comparator 1 matches the written word value within the address of comparator 0
+    cpu->memory().write<uint32_t>(0xE0001028u, 0u);
+    cpu->memory().write<uint32_t>(0xE0001030u, 5u);
+    cpu->memory().write<uint32_t>(0xE0001038u, 0b0110u | (0x1u << 8u) | (0x2u << 10u));
+    ASSERT_EQ(cpu->run(1000u), StopReason::Watchpoint);
+    ASSERT_EQ(cpu->R(1), 5u);
+    ASSERT_EQ(cpu->memory().read<uint32_t>(0x20000000u), 5u);
+    ASSERT_TRUE(cpu->watchpoints().takeHit().has_value());
+
+    cpu->memory().write<uint32_t>(0xE0001038u, 0u);
+    ASSERT_FALSE(cpu->memory().isSlowPage(0x20000000u));
+    ASSERT_EQ(cpu->run(30u), StopReason::CycleLimit);
+}
+
+TEST(debug, conditional_breakpoints)
+{
+    using namespace stm32;
+
+    auto flash = details::createCounterFlash();
+    auto cpu = details::createCpu(flash);
+    cpu->reset();
+
+    const auto evaluate = [&](std::string_view source) { return debug::Expression::compile(source).evaluate(*cpu, 7u); };
+    ASSERT_EQ(evaluate("1 + 2 * 3 << 1"), 14u);
+    ASSERT_EQ(evaluate("10 - 3 - 2"), 5u);
+    ASSERT_EQ(evaluate("-1 >> 28 == 0xF && hits == 7"), 1u);
+    ASSERT_EQ(evaluate("0 && [0x2000_0000] || !0b0"), 1u);
+    ASSERT_EQ(evaluate("mem8[4] | mem16[4] << 16"), 0x1u | 0x0101u << 16u);
+    ASSERT_EQ(evaluate("pc / 0"), 0u);
+    ASSERT_THROW(evaluate("r16"), std::invalid_argument);
+    ASSERT_THROW(evaluate("(r0"), std::invalid_argument);
+    ASSERT_THROW(evaluate("1 < 2 < 3"), std::invalid_argument);
+
+    // condition is evaluated only at the breakpoint address
+    const auto breakpoint = cpu->breakpoints().addConditional(0x106u, "r1 == 10_000 && hits == 10000");
+    ASSERT_EQ(cpu->run(100000u), StopReason::Breakpoint);
+    ASSERT_EQ(cpu->registers().PC(), 0x106u);
+    ASSERT_EQ(cpu->R(1), 10000u);
+
+    ASSERT_TRUE(cpu->breakpoints().removeConditional(breakpoint));
+    ASSERT_FALSE(cpu->breakpoints().removeConditional(breakpoint));
+    ASSERT_TRUE(cpu->breakpoints().empty());
+
+    // tracepoint records values and doesn't stop
+    cpu->breakpoints().addTracepoint(0x104u, "(r1 & 0xFF) == 0", {"r1", "[0x20000000]"});
+    ASSERT_EQ(cpu->run(4u * 1024u), StopReason::CycleLimit);
+
+    const auto records = cpu->breakpoints().takeTracepointRecords();
+    ASSERT_EQ(records.size(), 5u);
+    ASSERT_EQ(records[0].values, (std::vector<uint32_t>{10240u, 10240u}));
+    ASSERT_EQ(records[0].hits, 241u);
+    ASSERT_TRUE(cpu->breakpoints().takeTracepointRecords().empty());
+}
+
+TEST(debug, trace_recorder)
+{
+    using namespace stm32;
+
+    const auto path = (std::filesystem::temp_directory_path() / "stm32_trace_recorder.bin").string();
+
+    auto flash = details::createCounterFlash();
+    auto cpu = details::createCpu(flash);
+    cpu->reset();
+
+    {
+        // small buffers make the writer thread swap them many times
+        debug::TraceRecorder recorder{{.path = path, .dataAccesses = true, .syncInterval = 64u, .bufferSize = 128u}};
+        cpu->setTraceRecorder(&recorder);
+        ASSERT_EQ(cpu->run(1000u), StopReason::CycleLimit);
+        cpu->setTraceRecorder(nullptr);
+
+        ASSERT_EQ(recorder.instructionCount(), 1000u);
+        ASSERT_TRUE(recorder.close());
+    }
+
+    // movs and lsls, then adds, str and b in a loop
+    const auto addressOf = [](uint64_t instruction) -> uint32_t {
+        return instruction < 2u ? 0x100u + 2u * static_cast<uint32_t>(instruction) : 0x104u + 2u * static_cast<uint32_t>((instruction - 2u) % 3u);
+    };
+
+    debug::TraceReader reader{path};
+    ASSERT_EQ(reader.syncPoints().size(), 16u);
+
+    uint64_t instructions = 0u;
+    uint32_t stores = 0u;
+    while (const auto event = reader.next()) {
+        if (event->type == debug::trace::Instruction) {
+            ASSERT_EQ(event->instruction, instructions);
+            ASSERT_EQ(event->address, addressOf(instructions));
+            ASSERT_FALSE(event->conditional);
+            ++instructions;
+        }
+        else {
+            ASSERT_EQ(addressOf(event->instruction), 0x106u);
+            ASSERT_EQ(event->address, 0x20000000u);
+            ASSERT_EQ(event->size, 4u);
+            ASSERT_TRUE(event->write);
+            ASSERT_EQ(event->value, ++stores);
+        }
+    }
+    ASSERT_EQ(instructions, 1000u);
+    ASSERT_EQ(stores, 333u);
+
+    ASSERT_TRUE(reader.seek(500u));
+    const auto event = reader.next();
+    ASSERT_TRUE(event.has_value());
+    ASSERT_EQ(event->instruction, 500u);
+    ASSERT_EQ(event->address, addressOf(500u));
+    ASSERT_FALSE(reader.seek(1000u));
+
+    std::filesystem::remove(path);
+}
+
+TEST(debug, profiler)
+{
+    using namespace stm32;
+
+    // main: movs r0, #0; loop: bl f; b loop
+    // f: adds r0, #1; bx lr
+    auto flash = details::createFlash({0x2000u, 0xF000u, 0xF801u, 0xE7FCu, 0x3001u, 0x4770u});
+    auto cpu = details::createCpu(flash);
+    cpu->reset();
+
+    const auto elf = debug::ElfFile{details::createElf({{"main", 0x101u}, {"f", 0x109u}}, 8u)};
+    ASSERT_EQ(elf.functions().size(), 2u);
+    ASSERT_EQ(elf.findFunction(0x10Au)->name, "f");
+    ASSERT_EQ(elf.findFunction(0x104u)->name, "main");
+    ASSERT_NE(elf.findSection(".symtab"), nullptr);
+
+    debug::Profiler profiler{elf.functions()};
+    cpu->setProfiler(&profiler);
+    ASSERT_EQ(cpu->run(401u), StopReason::CycleLimit);
+    cpu->setProfiler(nullptr);
+    ASSERT_EQ(cpu->R(0), 100u);
+
+    std::ostringstream folded;
+    profiler.writeFoldedStacks(folded);
+    ASSERT_EQ(folded.str(), "main 201\nmain;f 200\n");
+
+    const auto top = profiler.topFunctions(10u);
+    ASSERT_EQ(top.size(), 2u);
+    ASSERT_EQ(top[0].name, "main");
+    ASSERT_EQ(top[0].self, 201u);
+    ASSERT_EQ(top[0].total, 401u);
+    ASSERT_EQ(top[1].name, "f");
+    ASSERT_EQ(top[1].total, 200u);
+
+    std::ostringstream table;
+    profiler.writeTopTable(table, 1u);
+    ASSERT_NE(table.str().find("50.12%"), std::string::npos);
+    ASSERT_EQ(table.str().find(" f\n"), std::string::npos);
+}
+
+TEST(debug, elf_load_image)
+{
+    using namespace stm32;
+
+    // Two loadable segments in flash with a gap between them and one in SRAM, program headers go at the end
+    auto data = details::createElf({{"main", 0x08000009u}}, 4u);
+    const auto contents = static_cast<uint32_t>(data.size());
+    data.insert(data.end(), {0x11u, 0x22u, 0x33u, 0x44u, 0x55u, 0x66u});
+
+    const auto segments = static_cast<uint32_t>(data.size());
+    const std::vector<std::array<uint32_t, 3>> headers = {
+        {contents, 0x08000000u, 4u},
+        {contents + 4u, 0x08000008u, 2u},
+        {contents, 0x20000000u, 6u},
+    };
+    for (const auto& [offset, address, size] : headers) {
+        const uint32_t header[8] = {1u, offset, address, address, size, size, 5u, 4u};
+        for (const auto word : header) {
+            for (uint32_t i = 0; i < 4u; ++i) {
+                data.push_back(static_cast<uint8_t>(word >> (8u * i)));
+            }
+        }
+    }
+    for (uint32_t i = 0; i < 4u; ++i) {
+        data[0x1Cu + i] = static_cast<uint8_t>(segments >> (8u * i));
+    }
+    data[0x2Au] = 32u;
+    data[0x2Cu] = static_cast<uint8_t>(headers.size());
+
+    const auto elf = debug::ElfFile{std::move(data)};
+    ASSERT_EQ(elf.segments().size(), 3u);
+    ASSERT_EQ(elf.findFunction("main")->address, 0x08000008u);
+
+    const auto image = elf.loadImage(0x08000000u, 0x08020000u);
+    ASSERT_EQ(image, (std::vector<uint8_t>{0x11u, 0x22u, 0x33u, 0x44u, 0xFFu, 0xFFu, 0xFFu, 0xFFu, 0x55u, 0x66u}));
+    ASSERT_TRUE(elf.loadImage(0u, 0x08000000u).empty());
+}
+
+TEST(debug, coverage)
+{
+    using namespace stm32;
+
+    // movs r0, #0; loop: adds r0, #1; cmp r0, #3; bne loop; b .; movs r1, #1
+    auto flash = details::createFlash({0x2000u, 0x3001u, 0x2803u, 0xD1FCu, 0xE7FEu, 0x2101u});
+    auto cpu = details::createCpu(flash);
+    cpu->reset();
+
+    debug::Coverage coverage{cpu->memory().config()};
+    cpu->setCoverage(&coverage);
+    ASSERT_EQ(cpu->run(20u), StopReason::CycleLimit);
+    cpu->setCoverage(nullptr);
+
+    ASSERT_TRUE(coverage.isExecuted(0x108u));
+    ASSERT_TRUE(coverage.isExecuted(0x08000100u));
+    ASSERT_FALSE(coverage.isExecuted(0x10Au));
+    ASSERT_TRUE(coverage.hasBranched(0x106u));
+    ASSERT_TRUE(coverage.hasFallenThrough(0x106u));
+    ASSERT_FALSE(coverage.hasFallenThrough(0x108u));
+
+    std::ostringstream ranges;
+    coverage.writeRanges(ranges);
+    ASSERT_EQ(ranges.str(), "08000100-0800010a\n");
+
+    const auto program = details::createLineProgram("main.c", {{0x100u, 10u}, {0x102u, 11u}, {0x104u, 12u}, {0x108u, 13u}, {0x10Au, 14u}, {0x10Cu, 0u}});
+    const auto elf = debug::ElfFile{details::createElf({{"main", 0x101u}}, 12u, {{".debug_line", program}})};
+    const auto lines = debug::LineTable::parse(elf);
+    ASSERT_EQ(lines.files(), std::vector<std::string>{"main.c"});
+    ASSERT_EQ(lines.ranges().size(), 5u);
+    ASSERT_EQ(lines.find(0x106u)->line, 12u);
+
+    std::ostringstream lcov;
+    coverage.writeLcov(lcov, lines, "unit");
+    ASSERT_EQ(lcov.str(),
+              "TN:unit\nSF:main.c\nBRDA:12,0,0,1\nBRDA:12,0,1,1\nDA:10,1\nDA:11,1\nDA:12,1\nDA:13,1\nDA:14,0\n"
+              "BRF:2\nBRH:2\nLF:5\nLH:4\nend_of_record\n");
+}
+
+TEST(debug, stack_monitor)
+{
+    using namespace stm32;
+
+    // loop: push {r0, r1}; sub sp, #16; b loop
+    auto flash = details::createFlash({0xB403u, 0xB084u, 0xE7FCu});
+    auto cpu = details::createCpu(flash);
+    cpu->reset();
+
+    auto& monitor = cpu->stackMonitor();
+    ASSERT_EQ(monitor.top(debug::StackType::Main), 0x20005000u);
+    ASSERT_FALSE(monitor.lowest(debug::StackType::Process).has_value());
+
+    monitor.setLimit(debug::StackType::Main, 0x20005000u - 100u);
+    ASSERT_EQ(cpu->run(1000u), StopReason::StackOverflow);
+
+    const auto overflow = monitor.takeOverflow();
+    ASSERT_TRUE(overflow.has_value());
+    ASSERT_EQ(overflow->stack, debug::StackType::Main);
+    ASSERT_EQ(overflow->instructionAddress, 0x100u);
+    ASSERT_EQ(overflow->stackPointer, 0x20005000u - 4u * 24u - 8u);
+    ASSERT_EQ(monitor.lowest(debug::StackType::Main), 0x20005000u - 5u * 24u);
+    ASSERT_EQ(monitor.peakUsage(debug::StackType::Main), 5u * 24u);
+
+    monitor.setLimit(debug::StackType::Main, 0u);
+    ASSERT_EQ(cpu->run(30u), StopReason::CycleLimit);
+    ASSERT_FALSE(monitor.isOverflowed());
+    ASSERT_GT(monitor.peakUsage(debug::StackType::Main), 5u * 24u);
+
+    cpu->reset();
+    ASSERT_EQ(monitor.peakUsage(debug::StackType::Main), 0u);
+}
+
+TEST(debug, heatmap)
+{
+    using namespace stm32;
+
+    // movs r1, #0x20; lsls r1, r1, #24; loop: str r0, [r1]; ldr r2, [r1, #32]; push {r0}; b loop
+    auto flash = details::createFlash({0x2120u, 0x0609u, 0x6008u, 0x6A0Au, 0xB401u, 0xE7FBu});
+    auto cpu = details::createCpu(flash);
+    cpu->reset();
+
+    debug::Heatmap heatmap{cpu->memory().config()};
+    cpu->setHeatmap(&heatmap);
+    ASSERT_EQ(cpu->run(100u), StopReason::CycleLimit);
+    cpu->setHeatmap(nullptr);
+
+    const auto* data = heatmap.counters(0x20000000u);
+    ASSERT_NE(data, nullptr);
+    const auto iterations = data->writes;
+    ASSERT_GT(iterations, 1u);
+    ASSERT_EQ(data->reads, 0u);
+    ASSERT_EQ(heatmap.counters(0x20000020u)->reads, iterations);
+    ASSERT_EQ(heatmap.counters(0x20004FFCu)->writes, debug::Heatmap::LineSize / 4u);
+    // the last loop iteration may be cut by the cycle limit after the load
+    ASSERT_GE(heatmap.counters(0x08000100u)->fetches, 4u * iterations);
+    ASSERT_LE(heatmap.counters(0x08000100u)->fetches, 2u + 4u * iterations);
+    ASSERT_EQ(heatmap.counters(0x100u), heatmap.counters(0x08000100u));
+    ASSERT_EQ(heatmap.counters(0x40000000u), nullptr);
+
+    ASSERT_EQ(cpu->run(100u), StopReason::CycleLimit);
+    ASSERT_EQ(heatmap.counters(0x20000000u)->writes, iterations);
+
+    std::ostringstream csv;
+    heatmap.writeCsv(csv);
+    ASSERT_EQ(csv.str().rfind("address,reads,writes,fetches\n0x08000100,0,0,", 0), 0u);
+
+    std::ostringstream binary;
+    heatmap.writeBinary(binary);
+    ASSERT_EQ(binary.str().substr(0u, 8u), "STM32HMP");
+}
+
+TEST(debug, pc_sampler)
+{
+    using namespace stm32;
+
+    // main: movs r0, #0; loop: bl f; b loop
+    // f: adds r0, #1; bx lr
+    auto flash = details::createFlash({0x2000u, 0xF000u, 0xF801u, 0xE7FCu, 0x3001u, 0x4770u});
+    auto cpu = details::createCpu(flash);
+    cpu->reset();
+
+    debug::PcSampler sampler{10u};
+    cpu->setPcSampler(&sampler);
+    ASSERT_EQ(cpu->run(1000u), StopReason::CycleLimit);
+    cpu->setPcSampler(nullptr);
+
+    ASSERT_GE(sampler.totalSamples(), 90u);
+    ASSERT_LE(sampler.totalSamples(), 100u);
+
+    uint64_t total = 0u;
+    for (const auto& sample : sampler.samples()) {
+        ASSERT_GE(sample.pc, 0x102u);
+        ASSERT_LT(sample.pc, 0x10Cu);
+        total += sample.count;
+    }
+    ASSERT_EQ(total, sampler.totalSamples());
+
+    const auto elf = debug::ElfFile{details::createElf({{"main", 0x101u}, {"f", 0x109u}}, 8u)};
+    std::ostringstream functions;
+    sampler.writeFunctions(functions, elf);
+    ASSERT_EQ(functions.str().rfind("function,caller,count\n", 0), 0u);
+    ASSERT_NE(functions.str().find("\nf,main,"), std::string::npos);
+
+    // table grows past the initial capacity without losing samples
+    sampler.clear();
+    for (uint32_t i = 0; i < 10000u; ++i) {
+        sampler.sample(0x08000000u + 2u * i, 0x08000001u);
+        sampler.sample(0x08000000u + 2u * i, 0x08000001u);
+    }
+    const auto samples = sampler.samples();
+    ASSERT_EQ(samples.size(), 10000u);
+    ASSERT_EQ(samples.front().count, 2u);
+    ASSERT_EQ(samples.front().pc, 0x08000000u);
+    ASSERT_EQ(sampler.totalSamples(), 20000u);
+}
+
+TEST(debug, reverse_execution)
+{
+    using namespace stm32;
+
+    // counter loop, IRQ3 handler: adds r4, #1; bx lr
+    auto flash = details::createCounterFlash();
+    flash[0x4Cu] = 0x01u;
+    flash[0x4Du] = 0x02u;
+    flash[0x200u] = 0x01u;
+    flash[0x201u] = 0x34u;
+    flash[0x202u] = 0x70u;
+    flash[0x203u] = 0x47u;
+
+    auto cpu = details::createCpu(flash);
+    cpu->reset();
+    cpu->memory().write<uint32_t>(0xE000E100u, 0x1u << 3u);
+
+    debug::ReverseExecution reverse{*cpu, debug::ReverseExecution::Config{.stepLatency = std::chrono::milliseconds{1}, .memoryBudget = 16u * 32u * 1024u}};
+    ASSERT_FALSE(reverse.stepBack());
+
+    // interrupts are live input, re-execution must see them at the same instructions
+    for (uint32_t i = 0; i < 40u; ++i) {
+        ASSERT_TRUE(cpu->postInterrupt(3u));
+        ASSERT_EQ(reverse.run(100000u), StopReason::CycleLimit);
+    }
+    ASSERT_EQ(cpu->R(4), 40u);
+    ASSERT_GT(reverse.checkpointCount(), 2u);
+    ASSERT_LT(reverse.checkpointInterval(), debug::ReverseExecution::InitialCheckpointInterval);
+
+    struct State {
+        uint64_t position;
+        uint32_t pc;
+        uint32_t counter;
+        uint32_t memory;
+        auto operator==(const State&) const -> bool = default;
+    };
+    const auto state = [&]() {
+        return State{.position = reverse.position(), .pc = cpu->registers().PC(), .counter = cpu->R(1), .memory = cpu->memory().read<uint32_t>(0x20000000u)};
+    };
+
+    std::vector<State> steps;
+    for (uint32_t i = 0; i < 20u; ++i) {
+        steps.push_back(state());
+        ASSERT_EQ(reverse.run(1u), StopReason::CycleLimit);
+    }
+    const auto end = state();
+    ASSERT_EQ(reverse.historyEnd(), end.position);
+
+    for (auto it = steps.rbegin(); it != steps.rend(); ++it) {
+        ASSERT_TRUE(reverse.stepBack());
+        ASSERT_EQ(state(), *it);
+    }
+    ASSERT_TRUE(reverse.isReplaying());
+
+    // the last two handler entries, the second one is found behind a checkpoint
+    cpu->breakpoints().add(0x200u);
+    ASSERT_EQ(reverse.reverseContinue(), StopReason::Breakpoint);
+    ASSERT_EQ(cpu->registers().PC(), 0x200u);
+    ASSERT_EQ(cpu->R(4), 39u);
+    ASSERT_EQ(reverse.reverseContinue(), StopReason::Breakpoint);
+    ASSERT_EQ(cpu->R(4), 38u);
+
+    // forward replay stops on the next hit and then returns to live execution at the end of history
+    ASSERT_EQ(reverse.run(UINT64_MAX), StopReason::Breakpoint);
+    ASSERT_EQ(cpu->R(4), 39u);
+    cpu->breakpoints().remove(0x200u);
+    ASSERT_EQ(reverse.run(end.position - reverse.position()), StopReason::CycleLimit);
+    ASSERT_FALSE(reverse.isReplaying());
+    ASSERT_EQ(state(), end);
+    ASSERT_EQ(cpu->R(4), 40u);
+
+    // changing the past drops the rest of the history
+    ASSERT_TRUE(reverse.stepBack());
+    cpu->setR(1u, 0u);
+    reverse.discardFuture();
+    ASSERT_FALSE(reverse.isReplaying());
+    ASSERT_EQ(reverse.historyEnd(), end.position - 1u);
+    ASSERT_EQ(reverse.run(1u), StopReason::CycleLimit);
+    ASSERT_TRUE(reverse.stepBack());
+    ASSERT_EQ(cpu->R(1), 0u);
+
+    // the first interrupt is taken before the reset handler starts, then there are no hits till the start of history
+    cpu->breakpoints().add(0x100u);
+    ASSERT_EQ(reverse.reverseContinue(), StopReason::Breakpoint);
+    ASSERT_EQ(cpu->registers().PC(), 0x100u);
+    ASSERT_EQ(cpu->R(4), 1u);
+    ASSERT_EQ(reverse.reverseContinue(), std::nullopt);
+    ASSERT_EQ(reverse.position(), reverse.historyStart());
+    ASSERT_FALSE(reverse.stepBack());
+}
+
+TEST(debug, edge_coverage)
+{
+    using namespace stm32;
+
+    // movs r0, #10; loop: subs r0, #1; nop; nop; bne loop; b .
+    auto flash = details::createFlash({0x200Au, 0x3801u, 0xBF00u, 0xBF00u, 0xD1FBu, 0xE7FEu});
+    auto cpu = details::createCpu(flash);
+
+    const auto record = [&](uint64_t instructionsPerRun) {
+        debug::EdgeCoverage coverage;
+        cpu->reset();
+        cpu->setEdgeCoverage(&coverage);
+        for (uint64_t instructions = 0u; instructions < 60u; instructions += instructionsPerRun) {
+            cpu->run(UINT64_MAX, instructionsPerRun);
+        }
+        cpu->setEdgeCoverage(nullptr);
+        coverage.classify();
+        return coverage.map();
+    };
+
+    // blocks cut by the run loop are joined back, so edges don't depend on where the core was stopped
+    const auto edges = record(60u);
+    ASSERT_EQ(record(1u), edges);
+    ASSERT_EQ(record(3u), edges);
+    ASSERT_EQ(std::count_if(edges.begin(), edges.end(), [](uint8_t bucket) { return bucket != 0u; }), 6);
+}
+
+TEST(debug, fuzz_harness)
+{
+    using namespace stm32;
+
+    // bl parse; b .
+    // parse: cmp r1, #2; blt ret; ldrb r2, [r0]; cmp r2, 'F'; bne ret; ldrb r2, [r0, #1]; cmp r2, 'Z'; bne ret; udf; ret: bx lr
+    std::vector<uint16_t> program{0xF000u, 0xF80Eu, 0xE7FEu};
+    program.resize(0x10u, 0xBF00u);
+    program.insert(program.end(), {0x2902u, 0xDB06u, 0x7802u, 0x2A46u, 0xD103u, 0x7842u, 0x2A5Au, 0xD100u, 0xDE00u, 0x4770u});
+    auto flash = details::createFlash(program);
+    auto cpu = details::createCpu(flash);
+
+    debug::FuzzHarness harness{*cpu,
+                               debug::FuzzHarness::Config{
+                                   .entryAddress = 0x121u,
+                                   .inputTarget = debug::FuzzHarness::InputTarget::Memory,
+                                   .inputAddress = 0x20001000u,
+                                   .maxInputSize = 16u,
+                                   .inputChannel = 0u,
+                                   .byteCycles = 0u,
+                                   .startupCycles = 100u,
+                                   .cycleBudget = 1000u,
+                               }};
+    ASSERT_EQ(cpu->edgeCoverage(), &harness.coverage());
+    ASSERT_TRUE(cpu->breakpoints().empty());
+
+    const auto execute = [&](std::string_view input) {
+        return harness.execute(std::span{reinterpret_cast<const uint8_t*>(input.data()), input.size()});
+    };
+
+    auto result = execute("A");
+    ASSERT_EQ(result.outcome, debug::FuzzHarness::Outcome::Returned);
+    ASSERT_EQ(result.address, 0x104u);
+    ASSERT_GT(result.newCoverage, 0u);
+    ASSERT_EQ(execute("B").newCoverage, 0u);
+
+    result = execute("FA");
+    ASSERT_EQ(result.outcome, debug::FuzzHarness::Outcome::Returned);
+    ASSERT_GT(result.newCoverage, 0u);
+
+    result = execute("FZ");
+    ASSERT_EQ(result.outcome, debug::FuzzHarness::Outcome::Fault);
+    ASSERT_EQ(result.address, 0x130u);
+
+    // every execution starts from the snapshot taken at the entry
+    result = execute("FB");
+    ASSERT_EQ(result.outcome, debug::FuzzHarness::Outcome::Returned);
+    ASSERT_EQ(result.newCoverage, 0u);
+    ASSERT_EQ(harness.executions(), 5u);
+    ASSERT_GT(harness.coverage().edgeCount(), 0u);
+}
+
+TEST(debug, fuzz_harness_peripheral_input)
+{
+    using namespace stm32;
+
+    // bl parse; b .
+    // parse: movs r0, #0x20; lsls r0, r0, #24; wait: ldr r1, [r0]; cmp r1, #0; beq wait
+    //        ldrb r2, [r0, #4]; cmp r2, 'F'; bne ret; udf; ret: bx lr
+    std::vector<uint16_t> program{0xF000u, 0xF80Eu, 0xE7FEu};
+    program.resize(0x10u, 0xBF00u);
+    program.insert(program.end(), {0x2020u, 0x0600u, 0x6801u, 0x2900u, 0xD0FCu, 0x7902u, 0x2A46u, 0xD100u, 0xDE00u, 0x4770u});
+    auto flash = details::createFlash(program);
+    auto cpu = details::createCpu(flash);
+
+    debug::FuzzHarness harness{*cpu,
+                               debug::FuzzHarness::Config{
+                                   .entryAddress = 0x121u,
+                                   .inputTarget = debug::FuzzHarness::InputTarget::Peripheral,
+                                   .inputAddress = 0x20000000u,
+                                   .maxInputSize = 16u,
+                                   .inputChannel = 1u,
+                                   .byteCycles = 10u,
+                                   .startupCycles = 100u,
+                                   .cycleBudget = 1000u,
+                               }};
+
+    const auto execute = [&](std::string_view input) {
+        return harness.execute(std::span{reinterpret_cast<const uint8_t*>(input.data()), input.size()});
+    };
+
+    // firmware waits for the receive FIFO forever without input
+    auto result = execute("");
+    ASSERT_EQ(result.outcome, debug::FuzzHarness::Outcome::Timeout);
+    ASSERT_GT(result.newCoverage, 0u);
+
+    result = execute("A");
+    ASSERT_EQ(result.outcome, debug::FuzzHarness::Outcome::Returned);
+    ASSERT_GT(result.newCoverage, 0u);
+    ASSERT_EQ(cpu->memory().read<uint32_t>(0x20000000u), 1u);
+
+    result = execute("FZ");
+    ASSERT_EQ(result.outcome, debug::FuzzHarness::Outcome::Fault);
+    ASSERT_EQ(result.address, 0x130u);
+    ASSERT_EQ(cpu->memory().read<uint32_t>(0x20000000u), 1u);
+    ASSERT_EQ(execute("B").newCoverage, 0u);
+}
+
+TEST(debug, semihosting)
+{
+    using namespace stm32;
+
+    // movs r0, #1; movs r1, #0x20; lsls r1, r1, #24; bkpt 0xab                 open(":tt", "w")
+    // movs r2, #0x20; lsls r2, r2, #24; str r0, [r2, #16]
+    // movs r0, #5; adds r1, #16; bkpt 0xab; movs r4, r0                        write(handle, text, size)
+    // movs r0, #0x20; adds r1, #16; bkpt 0xab; movs r5, #1; b .                exit(3)
+    auto flash = details::createFlash({0x2001u, 0x2120u, 0x0609u, 0xBEABu, 0x2220u, 0x0612u, 0x6110u, 0x2005u, 0x3110u, 0xBEABu, 0x0004u,
+                                       0x2020u, 0x3110u, 0xBEABu, 0x2501u, 0xE7FEu});
+    auto cpu = details::createCpu(flash);
+    cpu->reset();
+
+    const std::string name{":tt"};
+    const std::string text{"hello, semihosting\n"};
+    const auto writeWords = [&](uint32_t address, std::vector<uint32_t> words) {
+        for (const auto word : words) {
+            cpu->memory().write<uint32_t>(address, word);
+            address += 4u;
+        }
+    };
+    writeWords(0x20000000u, {0x20000100u, 4u, static_cast<uint32_t>(name.size())});
+    writeWords(0x20000010u, {0u, 0x20000200u, static_cast<uint32_t>(text.size())});
+    writeWords(0x20000020u, {0x20026u, 3u});
+    cpu->memory().writeBlock(0x20000100u, reinterpret_cast<const uint8_t*>(name.data()), static_cast<uint32_t>(name.size()));
+    cpu->memory().writeBlock(0x20000200u, reinterpret_cast<const uint8_t*>(text.data()), static_cast<uint32_t>(text.size()));
+
+    auto* output = std::tmpfile();
+    ASSERT_NE(output, nullptr);
+    debug::Semihosting semihosting{debug::Semihosting::Config{
+        .consoleInput = -1,
+        .consoleOutput = ::fileno(output),
+        .consoleError = -1,
+        .frequency = 72000000u,
+    }};
+    cpu->setSemihosting(&semihosting);
+
+    // Output stays buffered until exit
+    char contents[64]{};
+    ASSERT_EQ(cpu->run(100u, 11u), StopReason::CycleLimit);
+    ASSERT_EQ(cpu->R(4), 0u);
+    ASSERT_EQ(::pread(::fileno(output), contents, sizeof(contents), 0), 0);
+
+    // Exit stops the core right after the call
+    ASSERT_EQ(cpu->run(100u), StopReason::Exit);
+    ASSERT_EQ(cpu->registers().PC(), 0x11Cu);
+    ASSERT_EQ(cpu->R(5), 0u);
+    ASSERT_EQ(semihosting.takeExit(), 3);
+    ASSERT_FALSE(semihosting.isExitPending());
+    ASSERT_EQ(semihosting.exitStatus(), 3);
+    ASSERT_EQ(::pread(::fileno(output), contents, sizeof(contents), 0), static_cast<ssize_t>(text.size()));
+    ASSERT_EQ(std::string(contents, text.size()), text);
+
+    cpu->setSemihosting(nullptr);
+    std::fclose(output);
+}
+
+TEST(debug, semihosting_replay)
+{
+    using namespace stm32;
+
+    // movs r0, #1; movs r1, #0x20; lsls r1, r1, #24; bkpt 0xab; str r0, [r1, #16]  open(":tt", "r")
+    // movs r0, #6; adds r1, #16; bkpt 0xab; movs r4, r0                           read(handle, buffer, 4)
+    // movs r0, #0x11; bkpt 0xab; movs r5, r0; movs r0, #3; bkpt 0xab              time(); writec(buffer)
+    // movs r0, #0x20; adds r1, #16; bkpt 0xab; b .                                exit(0)
+    auto flash = details::createFlash({0x2001u, 0x2120u, 0x0609u, 0xBEABu, 0x6108u, 0x2006u, 0x3110u, 0xBEABu, 0x0004u, 0x2011u, 0xBEABu,
+                                       0x0005u, 0x2003u, 0xBEABu, 0x2020u, 0x3110u, 0xBEABu, 0xE7FEu});
+    auto cpu = details::createCpu(flash);
+
+    const std::string name{":tt"};
+    const auto start = [&]() {
+        cpu->reset();
+        cpu->memory().write<uint32_t>(0x20000000u, 0x20000100u);
+        cpu->memory().write<uint32_t>(0x20000004u, 0u);
+        cpu->memory().write<uint32_t>(0x20000008u, static_cast<uint32_t>(name.size()));
+        cpu->memory().write<uint32_t>(0x20000014u, 0x20000200u);
+        cpu->memory().write<uint32_t>(0x20000018u, 4u);
+        cpu->memory().write<uint32_t>(0x20000020u, 0x20026u);
+        cpu->memory().write<uint32_t>(0x20000024u, 0u);
+        cpu->memory().write<uint32_t>(0x20000200u, 0u);
+        cpu->memory().writeBlock(0x20000100u, reinterpret_cast<const uint8_t*>(name.data()), static_cast<uint32_t>(name.size()));
+    };
+
+    int input[2];
+    ASSERT_EQ(::pipe(input), 0);
+    ASSERT_EQ(::write(input[1], "abc", 3u), 3);
+    ::close(input[1]);
+    auto* output = std::tmpfile();
+    ASSERT_NE(output, nullptr);
+
+    debug::InputRecorder recorder;
+    {
+        debug::Semihosting semihosting{debug::Semihosting::Config{
+            .consoleInput = input[0],
+            .consoleOutput = ::fileno(output),
+            .consoleError = -1,
+            .frequency = 72000000u,
+        }};
+        start();
+        cpu->setSemihosting(&semihosting);
+        cpu->setInputRecorder(&recorder);
+        ASSERT_EQ(cpu->run(1000u), StopReason::Exit);
+        cpu->setInputRecorder(nullptr);
+        cpu->setSemihosting(nullptr);
+    }
+    ::close(input[0]);
+
+    const auto time = cpu->R(5);
+    ASSERT_EQ(cpu->R(4), 1u);
+    ASSERT_EQ(cpu->memory().read<uint32_t>(0x20000200u), 0x636261u);
+    ASSERT_EQ(std::count_if(recorder.records().begin(), recorder.records().end(), [](const auto& record) { return record.hostCall.has_value(); }), 3);
+    ASSERT_EQ(::lseek(::fileno(output), 0, SEEK_END), 1);
+
+    // results come from the log, the host input is closed and the output isn't written again
+    debug::Semihosting semihosting{debug::Semihosting::Config{
+        .consoleInput = -1,
+        .consoleOutput = ::fileno(output),
+        .consoleError = -1,
+        .frequency = 72000000u,
+    }};
+    debug::InputReplayer replayer{recorder.records()};
+    start();
+    cpu->setSemihosting(&semihosting);
+    cpu->setInputReplayer(&replayer);
+    ASSERT_EQ(cpu->run(1000u), StopReason::Exit);
+    cpu->setInputReplayer(nullptr);
+    cpu->setSemihosting(nullptr);
+
+    ASSERT_TRUE(replayer.isFinished());
+    ASSERT_EQ(cpu->R(4), 1u);
+    ASSERT_EQ(cpu->R(5), time);
+    ASSERT_EQ(cpu->memory().read<uint32_t>(0x20000200u), 0x636261u);
+    ASSERT_EQ(semihosting.takeExit(), 0);
+    ASSERT_EQ(::lseek(::fileno(output), 0, SEEK_END), 1);
+    std::fclose(output);
+
+    // host call data survives the log file
+    const auto path = (std::filesystem::temp_directory_path() / "stm32_semihosting_replay.log").string();
+    {
+        debug::InputRecorder file{path};
+        for (const auto& record : recorder.records()) {
+            if (record.hostCall.has_value()) {
+                file.recordHostCall(record.cycle, record.hostCall->result, record.hostCall->data);
+            }
+        }
+    }
+    const debug::InputReplayer log{path};
+    ASSERT_EQ(log.records().size(), 3u);
+    ASSERT_EQ(log.records()[1].hostCall->result, 1u);
+    ASSERT_EQ(log.records()[1].hostCall->data, (std::vector<uint8_t>{'a', 'b', 'c'}));
+    ASSERT_EQ(log.records()[2].hostCall->result, time);
+    std::filesystem::remove(path);
+}
+
+TEST(debug, itm_capture)
+{
+    using namespace stm32;
+
+    // movs r0, #0xE0; lsls r0, r0, #24
+    // movs r1, #'h'; strb r1, [r0]; movs r1, #'i'; strb r1, [r0]; strb r1, [r0, #4]; ldr r2, [r0]; b .
+    auto flash = details::createFlash({0x20E0u, 0x0600u, 0x2168u, 0x7001u, 0x2169u, 0x7001u, 0x7101u, 0x6802u, 0xE7FEu});
+    auto cpu = details::createCpu(flash);
+
+    const auto path = (std::filesystem::temp_directory_path() / "stm32_itm_port3.txt").string();
+    auto config = debug::ItmCapture::Config{};
+    config.files[3] = path;
+    {
+        debug::ItmCapture capture{config};
+
+        // Ports are disabled until the capture is attached
+        cpu->reset();
+        ASSERT_EQ(cpu->run(8u), StopReason::CycleLimit);
+        ASSERT_EQ(cpu->R(2), 1u);
+        ASSERT_TRUE(capture.flush());
+        ASSERT_EQ(capture.portData(0u), "");
+
+        cpu->itm().setCapture(&capture);
+        cpu->reset();
+        ASSERT_EQ(cpu->run(8u), StopReason::CycleLimit);
+        ASSERT_EQ(cpu->memory().read<uint32_t>(0xE0000E80u) & 0x1u, 1u);
+
+        // Word write is four bytes of the port stream, disabled ports are not captured
+        cpu->memory().write<uint32_t>(0xE000000Cu, 0x64636261u);
+        cpu->memory().write<uint32_t>(0xE0000E00u, 0x9u);
+        cpu->memory().write<uint8_t>(0xE0000004u, '!');
+        cpu->memory().write<uint8_t>(0xE0000000u, '!');
+
+        ASSERT_TRUE(capture.flush());
+        ASSERT_EQ(capture.portData(0u), "hi!");
+        ASSERT_EQ(capture.portData(1u), "i");
+        ASSERT_EQ(capture.portData(3u), "");
+        ASSERT_EQ(capture.droppedBytes(), 0u);
+
+        std::ifstream file{path};
+        ASSERT_EQ(std::string(std::istreambuf_iterator<char>{file}, {}), "abcd");
+
+        // registers are part of the machine state
+        const auto snapshot = cpu->snapshot();
+        cpu->memory().write<uint32_t>(0xE0000E00u, 0u);
+        cpu->restore(snapshot);
+        ASSERT_EQ(cpu->memory().read<uint32_t>(0xE0000E00u), 0x9u);
+        cpu->itm().setCapture(nullptr);
+    }
+    std::filesystem::remove(path);
+
+    // consumer which never wakes up by itself leaves the ring full, FIFOREADY is cleared until it is drained
+    config = debug::ItmCapture::Config{};
+    config.pollInterval = std::chrono::hours{1};
+    debug::ItmCapture capture{config};
+    cpu->itm().setCapture(&capture);
+    cpu->reset();
+    ASSERT_EQ(cpu->memory().read<uint32_t>(0xE0000000u), 1u);
+    for (size_t i = 0; i < 4u * debug::ItmCapture::RingCapacity && cpu->memory().read<uint32_t>(0xE0000000u) != 0u; ++i) {
+        cpu->memory().write<uint8_t>(0xE0000000u, 'x');
+    }
+    ASSERT_EQ(cpu->memory().read<uint32_t>(0xE0000000u), 0u);
+    ASSERT_EQ(capture.droppedBytes(), 0u);
+
+    cpu->memory().write<uint8_t>(0xE0000000u, 'y');
+    ASSERT_EQ(capture.droppedBytes(), 1u);
+    ASSERT_TRUE(capture.flush());
+    ASSERT_EQ(cpu->memory().read<uint32_t>(0xE0000000u), 1u);
+    ASSERT_EQ(capture.portData(0u).find('y'), std::string::npos);
+    cpu->itm().setCapture(nullptr);
+}
+
+TEST(debug, gdb_server)
+{
+    using namespace stm32;
+
+    auto flash = details::createCounterFlash();
+    auto cpu = details::createCpu(flash);
+    cpu->reset();
+
+    debug::GdbServer server{*cpu, debug::GdbServer::Config{.port = 0u, .socketPath = {}, .batchCycles = 1000u, .reverseExecution = true, .flashTiming = false}};
+    server.listen();
+
+    bool serveResult = true;
+    std::thread serverThread{[&]() { serveResult = server.serve(); }};
+
+    {
+        details::GdbClient client{server.port()};
+
+        ASSERT_TRUE(client.request("qSupported:swbreak+").starts_with("PacketSize="));
+        ASSERT_EQ(client.request("?"), "S05");
+        ASSERT_EQ(client.request("vCont?"), "vCont;c;C;s;S");
+
+        ASSERT_EQ(client.request("Z0,106,2"), "OK");
+        ASSERT_EQ(client.request("vCont;c"), "T05");
+        ASSERT_EQ(client.request("pf"), "06010000");
+        ASSERT_EQ(client.request("g").substr(8u, 8u), "01000000");
+
+        ASSERT_EQ(client.request("s"), "T05");
+        ASSERT_EQ(client.request("pf"), "08010000");
+        ASSERT_EQ(client.request("m20000000,4"), "01000000");
+
+        ASSERT_EQ(client.request("z0,106,2"), "OK");
+        ASSERT_EQ(client.request("Z2,20000000,4"), "OK");
+        ASSERT_EQ(client.request("c"), "T05watch:20000000;");
+        ASSERT_EQ(client.request("m20000000,4"), "02000000");
+        ASSERT_EQ(client.request("z2,20000000,4"), "OK");
+
+        ASSERT_EQ(client.request("bs"), "T05");
+        ASSERT_EQ(client.request("pf"), "06010000");
+        ASSERT_EQ(client.request("m20000000,4"), "01000000");
+        ASSERT_EQ(client.request("Z0,104,2"), "OK");
+        ASSERT_EQ(client.request("bc"), "T05");
+        ASSERT_EQ(client.request("pf"), "04010000");
+        ASSERT_EQ(client.request("g").substr(8u, 8u), "01000000");
+        ASSERT_EQ(client.request("bc"), "T05");
+        ASSERT_EQ(client.request("g").substr(8u, 8u), "00000000");
+        ASSERT_EQ(client.request("bc"), "T05replaylog:begin;");
+        ASSERT_EQ(client.request("z0,104,2"), "OK");
+
+        ASSERT_EQ(client.request("P1=78563412"), "OK");
+        ASSERT_EQ(cpu->R(1), 0x12345678u);
+
+        ASSERT_EQ(client.request("X20000010,2:ab"), "OK");
+        ASSERT_EQ(client.request("M20000012,2:cdef"), "OK");
+        ASSERT_EQ(client.request("m20000010,4"), "6162cdef");
+
+        client.send("k");
+    }
+
+    serverThread.join();
+    ASSERT_FALSE(serveResult);
+}
+
+TEST(debug, gdb_server_step_and_detach)
+{
+    using namespace stm32;
+
+    auto flash = details::createCounterFlash();
+    auto cpu = details::createCpu(flash);
+    cpu->reset();
+    // two wait states without prefetch, a step may stall before its instruction is fetched
+    cpu->memory().write<uint8_t>(FlashInterface::FlashInterfaceStart, 0x02u);
+    // comparator programmed by firmware
+    cpu->watchpoints().add(debug::Watchpoint{.address = 0x20000010u, .length = 4u, .type = debug::WatchpointType::Write});
+
+    debug::GdbServer server{*cpu, debug::GdbServer::Config{.port = 0u, .socketPath = {}, .batchCycles = 1000u, .reverseExecution = true, .flashTiming = true}};
+    server.listen();
+
+    bool serveResult = false;
+    std::thread serverThread{[&]() { serveResult = server.serve(); }};
+
+    {
+        details::GdbClient client{server.port()};
+
+        // every step retires exactly one instruction, forward and backward
+        for (const auto* pc : {"02010000", "04010000", "06010000", "08010000", "04010000"}) {
+            ASSERT_EQ(client.request("s"), "T05");
+            ASSERT_EQ(client.request("pf"), pc);
+        }
+        ASSERT_EQ(client.request("bs"), "T05");
+        ASSERT_EQ(client.request("pf"), "08010000");
+        ASSERT_EQ(client.request("s"), "T05");
+        ASSERT_EQ(client.request("pf"), "04010000");
+        ASSERT_GT(cpu->flashInterface().statistics().waitCycles, 0u);
+
+        // only watchpoints inserted by the debugger are removed
+        ASSERT_EQ(client.request("Z2,20000000,4"), "OK");
+        ASSERT_EQ(client.request("z2,20000010,4"), "E01");
+        ASSERT_EQ(client.request("D"), "OK");
+    }
+
+    serverThread.join();
+    ASSERT_TRUE(serveResult);
+    ASSERT_EQ(cpu->watchpoints().watchpoints().size(), 1u);
+    ASSERT_EQ(cpu->watchpoints().watchpoints().front().address, 0x20000010u);
+}
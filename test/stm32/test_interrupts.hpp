@@ -0,0 +1,154 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <filesystem>
+#include <stm32/cpu.hpp>
+#include <stm32/debug/input_log.hpp>
+#include <stm32/utils/mpsc_queue.hpp>
+#include <thread>
+
+#include "utils.hpp"
+
+TEST(interrupts, mpsc_queue)
+{
+    using namespace stm32::utils;
+
+    constexpr uint32_t producerCount = 4u;
+    constexpr uint32_t itemsPerProducer = 10000u;
+
+    MpscQueue<uint32_t, 256> queue;
+
+    std::vector<std::thread> producers;
+    for (uint32_t p = 0; p < producerCount; ++p) {
+        producers.emplace_back([&queue, p]() {
+            for (uint32_t i = 0; i < itemsPerProducer; ++i) {
+                while (!queue.tryPush(p * itemsPerProducer + i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    std::vector<uint32_t> lastSeen(producerCount, 0u);
+    uint32_t received = 0u;
+    while (received < producerCount * itemsPerProducer) {
+        if (const auto item = queue.tryPop(); item.has_value()) {
+            const auto producer = *item / itemsPerProducer;
+            const auto index = *item % itemsPerProducer + 1u;
+
+            // items from a single producer must be received in order
+            ASSERT_GT(index, lastSeen[producer]);
+            lastSeen[producer] = index;
+            ++received;
+        }
+    }
+
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    ASSERT_TRUE(queue.empty());
+}
+
+TEST(interrupts, external_interrupt)
+{
+    using namespace stm32;
+
+    // reset:   b .
+    // handler: movs r4, #42; bx lr
+    auto flash = details::createFlash({0xE7FEu});
+    flash[0x4Cu] = 0x01u;  // IRQ3 vector -> 0x201
+    flash[0x4Du] = 0x02u;
+    flash[0x200u] = 0x2Au;
+    flash[0x201u] = 0x24u;
+    flash[0x202u] = 0x70u;
+    flash[0x203u] = 0x47u;
+
+    auto cpu = details::createCpu(flash);
+    cpu->reset();
+
+    // interrupt is pending but disabled
+    ASSERT_TRUE(cpu->postInterrupt(3u, 100u));
+    ASSERT_EQ(cpu->run(200u), StopReason::CycleLimit);
+    ASSERT_EQ(cpu->R(4), 0u);
+    ASSERT_TRUE(cpu->nvicRegisters().isPending(3u));
+
+    // enable it through NVIC_ISER0
+    cpu->memory().write<uint32_t>(0xE000E100u, 0x1u << 3u);
+    ASSERT_EQ(cpu->run(100u), StopReason::CycleLimit);
+
+    ASSERT_EQ(cpu->R(4), 42u);
+    ASSERT_FALSE(cpu->nvicRegisters().isPending(3u));
+    ASSERT_EQ(cpu->currentMode(), ExecutionMode::Thread);
+    ASSERT_EQ(cpu->registers().PC(), 0x100u);
+    ASSERT_EQ(cpu->registers().SP(), 0x20005000u);
+}
+
+TEST(interrupts, record_replay)
+{
+    using namespace stm32;
+
+    // reset:   loop: adds r0, #1; b loop
+    // handler: adds r4, #1; bx lr
+    auto flash = details::createFlash({0x3001u, 0xE7FDu});
+    flash[0x4Cu] = 0x01u;  // IRQ3 vector -> 0x201
+    flash[0x4Du] = 0x02u;
+    flash[0x200u] = 0x01u;
+    flash[0x201u] = 0x34u;
+    flash[0x202u] = 0x70u;
+    flash[0x203u] = 0x47u;
+
+    struct Received {
+        uint64_t cycle;
+        uint32_t data;
+        auto operator==(const Received&) const -> bool = default;
+    };
+
+    const auto path = (std::filesystem::temp_directory_path() / "stm32_record_replay_test.bin").string();
+    const auto runMachine = [&](debug::InputRecorder* recorder, debug::InputReplayer* replayer, uint64_t budget, uint64_t endCycle) {
+        auto cpu = details::createCpu(flash);
+        cpu->reset();
+        cpu->flashInterface().setTimingEnabled(true);
+        cpu->memory().write<uint32_t>(0xE000E100u, 0x1u << 3u);
+        cpu->setInputRecorder(recorder);
+        cpu->setInputReplayer(replayer);
+
+        auto received = std::make_shared<std::vector<Received>>();
+        cpu->setInputEventHandler([cpu = cpu.get(), received](const InputEvent& event) {
+            received->push_back(Received{.cycle = cpu->cycles(), .data = event.data});
+        });
+
+        while (cpu->cycles() < endCycle) {
+            // live input depends on the host, the log has to reproduce it
+            const auto cycle = static_cast<uint32_t>(cpu->cycles());
+            if (cycle % 300u < budget) {
+                cpu->postInterrupt(3u, 0u);
+                cpu->postInputEvent(InputEvent{.timestamp = cycle + 77u, .type = InputEventType::PeripheralInput, .channel = 1u, .data = cycle});
+            }
+            cpu->run(std::min(budget, endCycle - cpu->cycles()));
+        }
+        return std::make_pair(std::move(cpu), received);
+    };
+
+    std::unique_ptr<Cpu> recorded;
+    std::shared_ptr<std::vector<Received>> recordedInput;
+    {
+        debug::InputRecorder recorder{path};
+        std::tie(recorded, recordedInput) = runMachine(&recorder, nullptr, 100u, 2000u);
+        ASSERT_TRUE(recorder.close());
+        ASSERT_GT(recorder.recordCount(), 0u);
+    }
+    ASSERT_GE(recordedInput->size(), 5u);
+    ASSERT_EQ(recorded->R(4), recordedInput->size());
+
+    // replay runs with a different budget and its own live input is ignored
+    debug::InputReplayer replayer{path};
+    const auto [replayed, replayedInput] = runMachine(nullptr, &replayer, 100000u, recorded->cycles());
+    ASSERT_TRUE(replayer.isFinished());
+    ASSERT_EQ(*replayedInput, *recordedInput);
+    ASSERT_EQ(replayed->R(0), recorded->R(0));
+    ASSERT_EQ(replayed->R(4), recorded->R(4));
+    ASSERT_EQ(replayed->cycles(), recorded->cycles());
+
+    std::filesystem::remove(path);
+}
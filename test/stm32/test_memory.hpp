@@ -2,6 +2,7 @@
 
 #include <gtest/gtest.h>
 
+#include <stm32/flash_image.hpp>
 #include <stm32/memory.hpp>
 
 #include "utils.hpp"
@@ -23,6 +24,40 @@ TEST(memory, memory_consistency)
     }
 }
 
+TEST(memory, shared_flash)
+{
+    using namespace stm32;
+
+    const auto image = FlashImage::fromBytes({0x11u, 0x22u, 0x33u, 0x44u});
+    std::vector<uint8_t> unused;
+    auto config = details::createMemoryConfig(unused);
+    config.flash = image->view();
+    Memory first{config};
+    Memory second{config};
+
+    const auto snapshot = first.snapshot();
+    ASSERT_TRUE(snapshot.areas[Memory::Flash].empty());
+
+    // programming allocates a private copy of the whole flash range
+    first.write<uint16_t>(0x08000002u, 0xBEEFu);
+    first.write<uint8_t>(0x08010000u, 0x5Au);
+    ASSERT_TRUE(first.isFlashProgrammed());
+    ASSERT_FALSE(second.isFlashProgrammed());
+    ASSERT_EQ(first.read<uint32_t>(0x08000000u), 0xBEEF2211u);
+    ASSERT_EQ(first.read<uint8_t>(0x08010000u), 0x5Au);
+    ASSERT_EQ(second.read<uint32_t>(0x08000000u), 0x44332211u);
+    ASSERT_EQ(second.read<uint8_t>(0x08010000u), 0xFFu);
+    ASSERT_EQ(image->view()[2u], 0x33u);
+
+    const auto programmed = first.snapshot();
+    first.restore(snapshot);
+    ASSERT_FALSE(first.isFlashProgrammed());
+    ASSERT_EQ(first.read<uint32_t>(0x00000000u), 0x44332211u);
+
+    second.restore(programmed);
+    ASSERT_EQ(second.read<uint8_t>(0x08010000u), 0x5Au);
+}
+
 TEST(memory, reserved_addresses)
 {
     auto memory = details::createMemory();
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <stm32/system.hpp>
+#include <stm32/utils/spsc_queue.hpp>
+#include <thread>
+
+#include "utils.hpp"
+
+namespace details
+{
+/**
+ * Peripheral which sends every byte written to it over the link
+ */
+class LinkTransmitter final : public MemoryRegion {
+public:
+    explicit LinkTransmitter(System::Link& link)
+        : MemoryRegion{0x40000000u, 0x40000004u}
+        , m_link{link}
+    {
+    }
+
+    void write(uint32_t, uint8_t data) override { m_link.send(data); }
+    auto read(uint32_t) -> uint8_t override { return 0u; }
+
+private:
+    System::Link& m_link;
+};
+
+struct ReceivedMessage {
+    uint64_t cycle;
+    uint32_t data;
+
+    auto operator==(const ReceivedMessage&) const -> bool = default;
+};
+
+auto runLinkedDevices(std::vector<uint8_t>& senderFlash, std::vector<uint8_t>& receiverFlash) -> std::vector<ReceivedMessage>
+{
+    System system{100u};
+    auto& sender = system.addDevice(createMemoryConfig(senderFlash));
+    auto& receiver = system.addDevice(createMemoryConfig(receiverFlash));
+
+    LinkTransmitter transmitter{system.connect(sender, receiver, 7u)};
+    sender.memory().attachRegion(transmitter);
+
+    std::vector<ReceivedMessage> received;
+    receiver.setInputEventHandler([&](const InputEvent& event) {
+        EXPECT_EQ(event.channel, 7u);
+        received.push_back(ReceivedMessage{.cycle = receiver.cycles(), .data = event.data});
+    });
+
+    system.reset();
+    system.run(1000u);
+
+    EXPECT_EQ(sender.cycles(), 1000u);
+    EXPECT_EQ(receiver.cycles(), 1000u);
+    return received;
+}
+
+}  // namespace details
+
+TEST(system, spsc_queue)
+{
+    using namespace stm32::utils;
+
+    constexpr uint32_t itemCount = 10000u;
+
+    SpscQueue<uint32_t, 256> queue;
+
+    std::thread producer{[&queue]() {
+        for (uint32_t i = 0; i < itemCount; ++i) {
+            while (!queue.tryPush(i)) {
+                std::this_thread::yield();
+            }
+        }
+    }};
+
+    for (uint32_t expected = 0; expected < itemCount;) {
+        if (const auto item = queue.tryPop(); item.has_value()) {
+            ASSERT_EQ(*item, expected);
+            ++expected;
+        }
+    }
+
+    producer.join();
+    ASSERT_FALSE(queue.tryPop().has_value());
+}
+
+TEST(system, deterministic_links)
+{
+    using namespace stm32;
+
+    // movs r0, #0x40; lsls r0, r0, #24
+    // loop: strb r1, [r0]; adds r1, #1; b loop
+    auto senderFlash = details::createFlash({0x2040u, 0x0600u, 0x7001u, 0x3101u, 0xE7FCu});
+    // b .
+    auto receiverFlash = details::createFlash({0xE7FEu});
+
+    const auto first = details::runLinkedDevices(senderFlash, receiverFlash);
+    ASSERT_FALSE(first.empty());
+
+    // first byte is stored by the third instruction and arrives one quantum later
+    ASSERT_EQ(first.front(), (details::ReceivedMessage{.cycle = 102u, .data = 0u}));
+    for (size_t i = 1; i < first.size(); ++i) {
+        ASSERT_EQ(first[i].cycle, first[i - 1].cycle + 3u);
+        ASSERT_EQ(first[i].data, (first[i - 1].data + 1u) & 0xFFu);
+    }
+
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_EQ(details::runLinkedDevices(senderFlash, receiverFlash), first);
+    }
+}
+
+TEST(system, halted_devices)
+{
+    using namespace stm32;
+
+    ASSERT_THROW(System{0u}, std::invalid_argument);
+
+    // push {r0}; b .
+    auto overflowFlash = details::createFlash({0xB401u, 0xE7FEu});
+    // b .
+    auto loopFlash = details::createFlash({0xE7FEu});
+
+    System system{100u};
+    auto& overflowing = system.addDevice(details::createMemoryConfig(overflowFlash));
+    auto& looping = system.addDevice(details::createMemoryConfig(loopFlash));
+    system.reset();
+    overflowing.stackMonitor().setLimit(debug::StackType::Main, 0x20005000u);
+
+    // overflowing device stops in its first quantum and isn't scheduled again
+    system.run(1000u);
+    ASSERT_EQ(system.stopReason(0u), StopReason::StackOverflow);
+    ASSERT_FALSE(system.stopReason(1u).has_value());
+    ASSERT_LT(overflowing.cycles(), 100u);
+    ASSERT_EQ(looping.cycles(), 1000u);
+
+    const auto haltedCycles = overflowing.cycles();
+    system.run(1000u);
+    ASSERT_EQ(overflowing.cycles(), haltedCycles);
+    ASSERT_EQ(looping.cycles(), 2000u);
+
+    system.reset();
+    ASSERT_FALSE(system.stopReason(0u).has_value());
+}
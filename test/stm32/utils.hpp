@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stm32/cpu.hpp>
 #include <stm32/memory.hpp>
 
 namespace details {
@@ -21,10 +22,44 @@ auto createMemory() -> Memory
         .sramEnd = 0x20005000u,
 
         .bootMode = BootMode::FlashMemory,
-        .flash = utils::ArrayView<uint8_t, uint32_t>{nullptr, 0}
+        .flash = utils::ArrayView<const uint8_t, uint32_t>{nullptr, 0}
     }};
 }
 
+auto createMemoryConfig(std::vector<uint8_t>& flash) -> Memory::Config
+{
+    return stm32f103c8Config(utils::ArrayView<const uint8_t, uint32_t>{flash.data(), static_cast<uint32_t>(flash.size())});
+}
+
+auto createCpu(std::vector<uint8_t>& flash) -> std::unique_ptr<Cpu>
+{
+    return std::make_unique<Cpu>(createMemoryConfig(flash));
+}
+
+/**
+ * Creates flash image with vector table which has stack at the end of SRAM and reset handler at 0x100
+ */
+auto createFlash(const std::vector<uint16_t>& program) -> std::vector<uint8_t>
+{
+    std::vector<uint8_t> flash(0x1000u, 0u);
+
+    const auto writeWord = [&](uint32_t address, uint32_t value) {
+        for (uint32_t i = 0; i < 4u; ++i) {
+            flash[address + i] = static_cast<uint8_t>(value >> (8u * i));
+        }
+    };
+
+    writeWord(0x0u, 0x20005000u);
+    writeWord(0x4u, 0x00000101u);
+
+    for (size_t i = 0; i < program.size(); ++i) {
+        flash[0x100u + 2u * i] = static_cast<uint8_t>(program[i]);
+        flash[0x100u + 2u * i + 1u] = static_cast<uint8_t>(program[i] >> 8u);
+    }
+
+    return flash;
+}
+
 auto createBitBandAddress(uint32_t address, uint8_t bitNumber, uint32_t bitBandAliasStart, uint32_t bitBandRegionStart) -> uint32_t
 {
     const auto byteOffset = address - bitBandRegionStart;